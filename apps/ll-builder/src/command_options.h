@@ -71,6 +71,21 @@ struct ExtractCommandOptions
 {
     std::string layerFile;
     std::string dir;
+    std::string path; // Path in the layer, extract the whole layer if it's empty
+};
+
+struct InspectCommandOptions
+{
+    std::string layerFile;
+    bool files = false; // List files of the layer
+};
+
+struct DeltaCommandOptions
+{
+    std::string oldFile;
+    std::string newFile;   // Create the delta from oldFile to newFile
+    std::string applyFile; // Or apply this delta to oldFile
+    std::string output;
 };
 
 struct RepoSubcommandOptions
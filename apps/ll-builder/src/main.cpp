@@ -6,12 +6,16 @@
 
 #include "command_options.h"
 #include "configure.h"
+#include "linglong/api/types/v1/Generators.hpp"
 #include "linglong/builder/config.h"
 #include "linglong/builder/linglong_builder.h"
 #include "linglong/cli/cli.h"
 #include "linglong/cli/cli_printer.h"
+#include "linglong/common/error.h"
 #include "linglong/common/global/initialize.h"
 #include "linglong/package/architecture.h"
+#include "linglong/package/layer_file.h"
+#include "linglong/package/uab_file.h"
 #include "linglong/package/version.h"
 #include "linglong/repo/client_factory.h"
 #include "linglong/repo/config.h"
@@ -20,6 +24,7 @@
 #include "linglong/utils/file.h"
 #include "linglong/utils/gettext.h"
 #include "linglong/utils/log/log.h"
+#include "linglong/utils/merkle.h"
 #include "linglong/utils/namespace.h"
 #include "linglong/utils/serialize/yaml.h"
 #include "ocppi/cli/crun/Crun.hpp"
@@ -36,6 +41,8 @@
 #include <string>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <wordexp.h>
 
 namespace {
@@ -369,7 +376,7 @@ int handleExtract(const ExtractCommandOptions &options)
     QString layerFile = QString::fromStdString(options.layerFile);
     QString targetDir = QString::fromStdString(options.dir);
 
-    auto result = linglong::builder::Builder::extractLayer(layerFile, targetDir);
+    auto result = linglong::builder::Builder::extractLayer(layerFile, targetDir, options.path);
     if (!result) {
         LogE("Extract layer failed: {}", result.error());
         return result.error().code();
@@ -379,6 +386,113 @@ int handleExtract(const ExtractCommandOptions &options)
     return 0;
 }
 
+int handleInspect(const InspectCommandOptions &options)
+{
+    auto layerFile = linglong::package::LayerFile::New(QString::fromStdString(options.layerFile));
+    if (!layerFile) {
+        LogE("Open layer file failed: {}", layerFile.error());
+        return layerFile.error().code();
+    }
+
+    auto info = (*layerFile)->metaInfo();
+    if (!info) {
+        LogE("Read layer info failed: {}", info.error());
+        return info.error().code();
+    }
+    std::cout << nlohmann::json(*info).dump(4) << std::endl;
+
+    if (!options.files) {
+        return 0;
+    }
+
+    auto index = (*layerFile)->index();
+    if (!index) {
+        LogE("Read layer index failed: {}", index.error());
+        return index.error().code();
+    }
+
+    // layer files exported by old versions have no index, it's built from the image then
+    if (!*index) {
+        auto image = (*layerFile)->openImage();
+        if (!image) {
+            LogE("Open layer image failed: {}", image.error());
+            return image.error().code();
+        }
+
+        auto built = linglong::package::LayerIndex::build(**image);
+        if (!built) {
+            LogE("Build layer index failed: {}", built.error());
+            return built.error().code();
+        }
+        *index = std::move(built).value();
+    }
+
+    for (const auto &entry : (*index)->entries()) {
+        std::cout << fmt::format("{:06o} {:>12} {} {}",
+                                 entry.mode,
+                                 entry.size,
+                                 S_ISREG(entry.mode) ? digest::to_hex(entry.sha256)
+                                                     : std::string(64, '-'),
+                                 entry.path)
+                  << std::endl;
+    }
+
+    return 0;
+}
+
+linglong::utils::error::Result<std::unique_ptr<linglong::package::UABFile>>
+loadUAB(const std::string &path)
+{
+    LINGLONG_TRACE(fmt::format("load uab {}", path));
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return LINGLONG_ERR(
+          fmt::format("open failed: {}", linglong::common::error::errorString(errno)));
+    }
+
+    return linglong::package::UABFile::loadFromFile(fd);
+}
+
+int handleDelta(const DeltaCommandOptions &options)
+{
+    auto oldFile = loadUAB(options.oldFile);
+    if (!oldFile) {
+        LogE("Load uab failed: {}", oldFile.error());
+        return oldFile.error().code();
+    }
+
+    if (!options.applyFile.empty()) {
+        auto applied = (*oldFile)->applyDelta(options.applyFile, options.output);
+        if (!applied) {
+            LogE("Apply delta failed: {}", applied.error());
+            return applied.error().code();
+        }
+
+        LogI("{} is reconstructed and verified.", options.output);
+        return 0;
+    }
+
+    auto newFile = loadUAB(options.newFile);
+    if (!newFile) {
+        LogE("Load uab failed: {}", newFile.error());
+        return newFile.error().code();
+    }
+
+    auto stat = (*oldFile)->createDelta(**newFile, options.output);
+    if (!stat) {
+        LogE("Create delta failed: {}", stat.error());
+        return stat.error().code();
+    }
+
+    LogI("Delta {} is created, {} bytes are reused from {}, {} bytes are stored.",
+         options.output,
+         stat->copied,
+         options.oldFile,
+         stat->stored);
+    return 0;
+}
+
 std::vector<std::string> getProjectModule(const linglong::api::types::v1::BuilderProject &project)
 {
     std::list<std::string> modules = { "binary", "develop" }; // Start with base modules
@@ -467,6 +581,8 @@ You can report bugs to the linyaps team under this project: https://github.com/O
     ImportCommandOptions importOpts;
     ImportDirCommandOptions importDirOpts;
     ExtractCommandOptions extractOpts;
+    InspectCommandOptions inspectOpts;
+    DeltaCommandOptions deltaOpts;
     RepoSubcommandOptions repoCmdOpts;
 
     // add builder flags
@@ -506,6 +622,13 @@ You can report bugs to the linyaps team under this project: https://github.com/O
     buildBuilder->add_flag("--skip-fetch-source",
                            buildOpts.builderSpecificOptions.skipFetchSource,
                            _("Skip fetch sources"));
+    buildBuilder
+      ->add_option("--fetch-jobs",
+                   buildOpts.builderSpecificOptions.fetchJobs,
+                   _("Number of sources fetched at the same time"))
+      ->type_name("N")
+      ->check(CLI::PositiveNumber)
+      ->capture_default_str();
     buildBuilder->add_flag("--skip-pull-depend",
                            buildOpts.builderSpecificOptions.skipPullDepend,
                            _("Skip pull dependency"));
@@ -580,6 +703,17 @@ You can report bugs to the linyaps team under this project: https://github.com/O
                    exportOpts.exportSpecificOptions.compressor,
                    "supported compressors are: lz4(default), lzma, zstd")
       ->type_name("X");
+    buildExport
+      ->add_option("--compression-level",
+                   exportOpts.exportSpecificOptions.compressionLevel,
+                   _("Compression level of the compressor"))
+      ->type_name("LEVEL");
+    buildExport
+      ->add_option("--cluster-size",
+                   exportOpts.exportSpecificOptions.clusterSize,
+                   _("Max size in bytes of a compressed physical cluster"))
+      ->type_name("BYTES")
+      ->check(CLI::PositiveNumber);
     auto *iconOpt =
       buildExport
         ->add_option("--icon", exportOpts.exportSpecificOptions.iconPath, _("Uab icon (optional)"))
@@ -599,6 +733,13 @@ You can report bugs to the linyaps team under this project: https://github.com/O
                  exportOpts.exportSpecificOptions.noExportDevelop,
                  _("Don't export the develop module"))
       ->needs(layerFlag);
+    buildExport
+      ->add_option("-j, --jobs",
+                   exportOpts.exportSpecificOptions.jobs,
+                   _("Number of modules exported at the same time, all of them by default"))
+      ->type_name("N")
+      ->check(CLI::PositiveNumber)
+      ->needs(layerFlag);
     buildExport->add_option("-o, --output", exportOpts.outputFile, _("Output file"))
       ->type_name("FILE")
       ->excludes(layerFlag);
@@ -656,6 +797,44 @@ You can report bugs to the linyaps team under this project: https://github.com/O
     buildExtract->add_option("DIR", extractOpts.dir, _("Destination directory"))
       ->type_name("DIR")
       ->required();
+    buildExtract->add_option("--path", extractOpts.path, _("Extract only this path of the layer"))
+      ->type_name("PATH");
+
+    // add build inspect
+    auto buildInspect =
+      commandParser.add_subcommand("inspect", _("Show the information of linyaps layer"));
+    buildInspect->usage(_("Usage: ll-builder inspect [OPTIONS] LAYER"));
+    buildInspect->add_option("LAYER", inspectOpts.layerFile, _("Layer file path"))
+      ->required()
+      ->check(CLI::ExistingFile);
+    buildInspect->add_flag("--files", inspectOpts.files, _("List files of the layer"));
+
+    // add build delta
+    auto buildDelta =
+      commandParser.add_subcommand("delta", _("Create or apply the delta between two uab files"));
+    buildDelta->usage(_(R"(Usage: ll-builder delta [OPTIONS] OLD [NEW]
+
+Example:
+# create the delta from old.uab to new.uab
+ll-builder delta old.uab new.uab -o new.delta
+# reconstruct new.uab from old.uab and the delta
+ll-builder delta old.uab --apply new.delta -o new.uab
+)"));
+    buildDelta->add_option("OLD", deltaOpts.oldFile, _("The old uab file"))
+      ->type_name("FILE")
+      ->required()
+      ->check(CLI::ExistingFile);
+    auto *deltaNew = buildDelta->add_option("NEW", deltaOpts.newFile, _("The new uab file"))
+                       ->type_name("FILE")
+                       ->check(CLI::ExistingFile);
+    buildDelta->add_option("--apply", deltaOpts.applyFile, _("Apply the delta to the old uab file"))
+      ->type_name("DELTA")
+      ->check(CLI::ExistingFile)
+      ->excludes(deltaNew);
+    buildDelta
+      ->add_option("-o, --output", deltaOpts.output, _("The created delta or the applied uab file"))
+      ->type_name("FILE")
+      ->required();
 
     auto *buildRepo = linglong::common::cli::addRepoCommand(commandParser,
                                                             repoCmdOpts.repoOptions,
@@ -704,6 +883,19 @@ You can report bugs to the linyaps team under this project: https://github.com/O
         return handleExtract(extractOpts);
     }
 
+    if (buildInspect->parsed()) {
+        return handleInspect(inspectOpts);
+    }
+
+    if (buildDelta->parsed()) {
+        if (deltaOpts.newFile.empty() && deltaOpts.applyFile.empty()) {
+            std::cerr << _("NEW or --apply is required") << std::endl;
+            return -1;
+        }
+
+        return handleDelta(deltaOpts);
+    }
+
     // following command need repo
     auto builderCfg = linglong::builder::loadConfig();
     if (!builderCfg) {
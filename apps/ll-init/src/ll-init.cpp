@@ -2,6 +2,7 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include <fcntl.h>
 #include <sys/epoll.h>
 #include <sys/prctl.h>
 #include <sys/signalfd.h>
@@ -11,8 +12,10 @@
 #include <csignal>
 #include <cstddef>
 #include <cstring>
+#include <ctime>
 #include <filesystem>
 #include <iostream>
+#include <string>
 #include <vector>
 
 #include <sys/socket.h>
@@ -53,6 +56,36 @@ void print_info(std::string_view msg) noexcept
     }
 }
 
+// same events as linglong/utils/tracing.h, ll-init can't link to it
+void trace_instant(const char *name) noexcept
+{
+    static const char *trace_file = ::getenv("LINGLONG_STARTUP_TRACE");
+    if (trace_file == nullptr || *trace_file == '\0') {
+        return;
+    }
+
+    const char *launch_id = ::getenv("LINGLONG_LAUNCH_ID");
+    struct timespec ts{};
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    std::string event = R"({"name":")";
+    event += name;
+    event += R"(","cat":"ll-init","ph":"i","s":"p","ts":)";
+    event += std::to_string(static_cast<long long>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000);
+    event += R"(,"pid":)" + std::to_string(::getpid());
+    event += R"(,"tid":)" + std::to_string(::getpid());
+    event += R"(,"args":{"launch":")";
+    event += launch_id == nullptr ? "" : launch_id;
+    event += "\"}},\n";
+
+    auto fd = ::open(trace_file, O_WRONLY | O_APPEND | O_CLOEXEC);
+    if (fd == -1) {
+        return;
+    }
+    while (::write(fd, event.data(), event.size()) == -1 && errno == EINTR) { }
+    ::close(fd);
+}
+
 class sigConf
 {
 public:
@@ -290,6 +323,7 @@ pid_t run(const std::vector<const char *> &args, const sigConf &conf) noexcept
             return -1;
         }
 
+        trace_instant("ll-init exec");
         ::execvp(c_args[0], const_cast<char *const *>(c_args.data()));
         print_sys_error("Failed to run process");
         ::_exit(EXIT_FAILURE);
@@ -590,6 +624,8 @@ bool register_event(const file_descriptor_wrapper &epfd,
 
 int main(int argc, char **argv) // NOLINT
 {
+    trace_instant("ll-init start");
+
     sigConf conf;
     if (!conf.block_signals()) {
         return -1;
@@ -0,0 +1,174 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/utils/merkle.h"
+#include "linglong/utils/sha256.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace uab {
+
+// UAB_OPTIMISTIC_VERIFY mounts the bundle and starts the application before the bundle is
+// verified. erofsfuse verifies a leaf of the merkle tree before it reads from the leaf for the
+// first time, reads of a mismatched leaf fail with EIO. Meanwhile the whole bundle is verified in
+// the background, and the application is killed if that fails.
+//
+// erofsfuse reads the bundle by pread, the header is linked with --wrap=pread,--wrap=pread64,
+// the wrappers read through LazyVerifier::pread.
+struct LazyVerifier
+{
+    // reads the bundle without being checked, e.g. __real_pread64
+    using ReadFunction = ssize_t (*)(int, void *, std::size_t, off64_t);
+
+    explicit LazyVerifier(ReadFunction read) noexcept
+        : readBundle(read)
+    {
+    }
+
+    // the bundle is the range of the file st, leaves are the sha256 of every leafSize bytes of it
+    void prepare(const struct stat &st,
+                 std::uint64_t bundleOffset,
+                 std::uint64_t bundleLength,
+                 std::size_t bundleLeafSize,
+                 std::vector<std::string> bundleLeaves)
+    {
+        this->dev = st.st_dev;
+        this->ino = st.st_ino;
+        this->offset = bundleOffset;
+        this->length = bundleLength;
+        this->leafSize = bundleLeafSize;
+        this->leaves = std::move(bundleLeaves);
+        this->states = std::make_unique<std::atomic_uint8_t[]>(this->leaves.size());
+        this->pending = true;
+    }
+
+    // verify a leaf of the bundle by its hash in the merkle tree
+    bool verifyLeaf(int fd, std::size_t index) noexcept
+    {
+        auto &state = this->states[index];
+        if (auto value = state.load(); value != 0) {
+            return value == 1;
+        }
+
+        auto begin = index * this->leafSize;
+        auto size = std::min<std::uint64_t>(this->leafSize, this->length - begin);
+        std::vector<std::byte> buf;
+        try {
+            buf.resize(size);
+        } catch (...) {
+            return false;
+        }
+
+        for (std::size_t done = 0; done < size;) {
+            auto ret = this->readBundle(fd,
+                                        buf.data() + done,
+                                        size - done,
+                                        static_cast<off64_t>(this->offset + begin + done));
+            if (ret == -1 && errno == EINTR) {
+                continue;
+            }
+
+            // transient errors are reported to the reader, the leaf stays unknown
+            if (ret <= 0) {
+                return false;
+            }
+
+            done += static_cast<std::size_t>(ret);
+        }
+
+        digest::SHA256 sha256;
+        sha256.update(buf.data(), buf.size());
+        std::array<std::byte, 32> result{};
+        sha256.final(result.data());
+
+        // concurrent readers of the same leaf get the same result, a duplicated hash is harmless
+        auto ok = digest::to_hex(result) == this->leaves[index];
+        state.store(ok ? 1 : 2);
+        if (!ok) {
+            std::cerr << "leaf " << index << " of the bundle mismatched" << std::endl;
+        }
+
+        return ok;
+    }
+
+    // whether the range of a file may be read, leaves of the bundle in the range are verified
+    // first
+    bool readable(int fd, std::uint64_t begin, std::size_t count) noexcept
+    {
+        if (!this->active.load(std::memory_order_relaxed) || count == 0) {
+            return true;
+        }
+
+        auto end = begin + count;
+        auto bundleEnd = this->offset + this->length;
+        if (end <= this->offset || begin >= bundleEnd) {
+            return true;
+        }
+
+        // reads of other files are checked by fstat(2), erofsfuse rarely reads another file
+        if (fd != this->bundleFd.load(std::memory_order_relaxed)) {
+            struct stat st{};
+            if (::fstat(fd, &st) == -1 || st.st_dev != this->dev || st.st_ino != this->ino) {
+                return true;
+            }
+
+            this->bundleFd.store(fd, std::memory_order_relaxed);
+        }
+
+        auto first = (std::max(begin, this->offset) - this->offset) / this->leafSize;
+        auto last = (std::min(end, bundleEnd) - this->offset - 1) / this->leafSize;
+        for (auto index = first; index <= last; ++index) {
+            if (!this->verifyLeaf(fd, index)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // pread(2) by realRead, reads which touch a mismatched leaf of the bundle fail with EIO
+    template <typename Offset, typename Read>
+    ssize_t pread(int fd, void *buf, std::size_t count, Offset position, Read &&realRead) noexcept
+    {
+        if (position >= 0 && !this->readable(fd, static_cast<std::uint64_t>(position), count)) {
+            errno = EIO;
+            return -1;
+        }
+
+        return realRead(fd, buf, count, position);
+    }
+
+    ReadFunction readBundle;
+    // only in the erofsfuse daemon
+    std::atomic_bool active{ false };
+    // the bundle is verified in the background
+    bool pending{ false };
+    dev_t dev{ 0 };
+    ino_t ino{ 0 };
+    std::uint64_t offset{ 0 };
+    std::uint64_t length{ 0 };
+    std::size_t leafSize{ 0 };
+    std::vector<std::string> leaves;
+    // 0 is unknown, 1 is verified, 2 is mismatched
+    std::unique_ptr<std::atomic_uint8_t[]> states;
+    // the fd of the bundle which is read by erofsfuse, it's known since the first read
+    std::atomic_int bundleFd{ -1 };
+};
+
+} // namespace uab
@@ -2,10 +2,15 @@
 //
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
+#include "lazy_verifier.h"
 #include "light_elf.h"
 #include "linglong/api/types/v1/Generators.hpp" // IWYU pragma: keep
 #include "linglong/api/types/v1/UabMetaInfo.hpp"
+#include "linglong/utils/content_store.h"
+#include "linglong/utils/digest_cache.h"
+#include "linglong/utils/merkle.h"
 #include "linglong/utils/sha256.h"
+#include "shared_mount.h"
 
 #include <gelf.h>
 #include <getopt.h>
@@ -14,13 +19,21 @@
 
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <climits>
 #include <cstring>
+#include <csignal>
 #include <filesystem>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <tuple>
 
 #include <fcntl.h>
+#include <sys/file.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/statvfs.h>
@@ -30,6 +43,12 @@
 
 extern "C" int erofsfuse_main(int argc, char **argv);
 
+// erofsfuse reads the bundle by pread, the header is linked with --wrap=pread,--wrap=pread64
+extern "C" {
+ssize_t __real_pread(int fd, void *buf, size_t count, off_t offset);
+ssize_t __real_pread64(int fd, void *buf, size_t count, off64_t offset);
+}
+
 namespace {
 
 std::atomic_bool mountFlag{ false };  // NOLINT
@@ -37,6 +56,28 @@ std::atomic_bool createFlag{ false }; // NOLINT
 std::filesystem::path mountPoint;     // NOLINT
 constexpr std::size_t default_page_size = 4096;
 
+// a shared mount is kept by the shared locks of its users on the ref file, the lock file
+// serializes mounting and unmounting of it
+std::atomic_bool sharedFlag{ false }; // NOLINT
+std::filesystem::path sharedLock;     // NOLINT
+std::filesystem::path sharedRef;      // NOLINT
+int sharedLockFd{ -1 };               // NOLINT
+int sharedRefFd{ -1 };                // NOLINT
+constexpr unsigned default_linger_seconds = 60;
+// the hidden option which runs the reaper of a shared mount, see releaseSharedMount
+constexpr std::string_view reaperOption = "--reap-shared-mount";
+constexpr int reaperArgc = 8;
+
+uab::LazyVerifier lazyVerifier{ __real_pread64 }; // NOLINT
+std::atomic_bool verifyFailed{ false };           // NOLINT
+std::atomic<pid_t> loaderPid{ -1 };               // NOLINT
+std::once_flag cleanOnce;                         // NOLINT
+
+// the signal handler only writes the signal to the pipe, the resources are released by a thread
+// which reads it, most of the cleanup isn't async-signal-safe
+std::array<int, 2> signalPipe{ -1, -1 }; // NOLINT
+pid_t mainPid{ -1 };                     // NOLINT
+
 constexpr auto usage = u8R"(Linglong Universal Application Bundle
 
 An offline distribution executable bundle of linglong.
@@ -49,6 +90,12 @@ Options:
     --mount=PATH mount the read-only filesystem image which is in the 'linglong.bundle' segment of uab to PATH, use ctrl+c to stop. [exclusive]
     --print-meta print content of json which from the 'linglong.meta' segment of uab to STDOUT [exclusive]
     --help print usage of uab [exclusive]
+
+Environment:
+    UAB_SHARED_MOUNT=1 share one mount of the bundle between all launches of the same bundle by the current user.
+    UAB_SHARED_MOUNT_LINGER=SECONDS keep the shared mount for SECONDS after the last launch exits, 60 by default.
+    UAB_CONTENT_STORE=1 extracted files are read-only hardlinks of a store shared by all extracted bundles, it's $XDG_CACHE_HOME/linglong/store.
+    UAB_OPTIMISTIC_VERIFY=1 start the application while verifying the bundle, reads of unverified data wait for its verification.
 )";
 
 enum uabOption : std::uint8_t {
@@ -174,6 +221,160 @@ std::string calculateDigest(int fd, std::size_t bundleOffset, std::size_t bundle
     return stream.str();
 }
 
+// bundles created by former versions only have the digest of the whole section
+bool checkBundle(int fd,
+                 std::size_t bundleOffset,
+                 std::size_t bundleLength,
+                 const linglong::api::types::v1::UabMetaInfo &meta) noexcept
+{
+    if (meta.merkleTree) {
+        const auto &tree = *meta.merkleTree;
+        if (tree.leafSize <= 0
+            || !digest::merkle_verify(fd,
+                                      bundleOffset,
+                                      bundleLength,
+                                      tree.leafSize,
+                                      tree.leaves,
+                                      tree.root)) {
+            std::cerr << "merkle tree of bundle mismatched, root: " << tree.root << std::endl;
+            return false;
+        }
+
+        return true;
+    }
+
+    if (auto digest = calculateDigest(fd, bundleOffset, bundleLength); digest != meta.digest) {
+        std::cerr << "sha256 mismatched, expected: " << meta.digest << " calculated: " << digest
+                  << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+// the bundle which has been verified and isn't changed since then is trusted, see digest_cache.h
+int verifyBundle(int fd,
+                 std::size_t bundleOffset,
+                 std::size_t bundleLength,
+                 const linglong::api::types::v1::UabMetaInfo &meta) noexcept
+{
+    const auto &expected = meta.merkleTree ? meta.merkleTree->root : meta.digest;
+    std::optional<digest::VerifiedCache> cache;
+    struct stat st{};
+    if (auto dir = digest::VerifiedCache::default_directory(); dir && ::fstat(fd, &st) == 0) {
+        cache.emplace(std::move(dir).value());
+        if (cache->contains(st, bundleOffset, bundleLength, expected)) {
+            return 0;
+        }
+    }
+
+    if (!checkBundle(fd, bundleOffset, bundleLength, meta)) {
+        if (cache) {
+            cache->erase(st);
+        }
+        return -1;
+    }
+
+    if (cache) {
+        cache->insert(st, bundleOffset, bundleLength, expected);
+    }
+
+    return 0;
+}
+
+bool prepareLazyVerifier(int fd,
+                         std::size_t bundleOffset,
+                         std::size_t bundleLength,
+                         const linglong::api::types::v1::UabMetaInfo &meta) noexcept
+{
+    // a bundle without merkle tree can't be verified partially
+    if (!meta.merkleTree || meta.merkleTree->leafSize <= 0) {
+        return false;
+    }
+
+    const auto &tree = *meta.merkleTree;
+    struct stat st{};
+    if (::fstat(fd, &st) == -1) {
+        return false;
+    }
+
+    // verified before, nothing to do
+    if (auto dir = digest::VerifiedCache::default_directory();
+        dir
+        && digest::VerifiedCache{ std::move(dir).value() }.contains(st,
+                                                                    bundleOffset,
+                                                                    bundleLength,
+                                                                    tree.root)) {
+        return false;
+    }
+
+    try {
+        auto leafSize = static_cast<std::size_t>(tree.leafSize);
+        if (tree.leaves.size() != (bundleLength + leafSize - 1) / leafSize
+            || digest::merkle_root(tree.leaves) != tree.root) {
+            std::cerr << "merkle tree of bundle mismatched, root: " << tree.root << std::endl;
+            return false;
+        }
+
+        lazyVerifier.prepare(st, bundleOffset, bundleLength, leafSize, tree.leaves);
+    } catch (...) {
+        return false;
+    }
+
+    return true;
+}
+
+// stop and kill a process and all of its descendants, including processes in containers
+void killProcessTree(pid_t root) noexcept
+{
+    try {
+        std::vector<pid_t> tree{ root };
+        ::kill(root, SIGSTOP);
+        for (bool found = true; found;) {
+            found = false;
+            std::error_code ec;
+            for (const auto &entry : std::filesystem::directory_iterator{ "/proc", ec }) {
+                auto name = entry.path().filename().string();
+                if (name.find_first_not_of("0123456789") != std::string::npos) {
+                    continue;
+                }
+
+                auto pid = static_cast<pid_t>(std::stol(name));
+                if (std::find(tree.cbegin(), tree.cend(), pid) != tree.cend()) {
+                    continue;
+                }
+
+                // the command in the second field may contain spaces and parentheses
+                std::string content;
+                std::getline(std::ifstream{ entry.path() / "stat" }, content);
+                auto pos = content.rfind(')');
+                if (pos == std::string::npos) {
+                    continue;
+                }
+
+                std::istringstream fields{ content.substr(pos + 1) };
+                char state{ 0 };
+                pid_t ppid{ 0 };
+                if (!(fields >> state >> ppid)
+                    || std::find(tree.cbegin(), tree.cend(), ppid) == tree.cend()) {
+                    continue;
+                }
+
+                // stopped processes can't fork any more
+                ::kill(pid, SIGSTOP);
+                tree.push_back(pid);
+                found = true;
+            }
+        }
+
+        for (auto pid : tree) {
+            ::kill(pid, SIGKILL);
+        }
+    } catch (...) {
+        ::kill(root, SIGKILL);
+    }
+}
+
 std::optional<std::filesystem::path> find_fusermount() noexcept
 {
     auto *pathEnv = getenv("PATH");
@@ -234,7 +435,8 @@ std::optional<std::filesystem::path> find_fusermount() noexcept
 }
 
 int mountSelfBundle(const lightElf::native_elf &elf,
-                    const linglong::api::types::v1::UabMetaInfo &meta) noexcept
+                    const linglong::api::types::v1::UabMetaInfo &meta,
+                    bool optimistic) noexcept
 {
     auto bundleSh = elf.getSectionHeader(meta.sections.bundle);
     if (!bundleSh) {
@@ -243,14 +445,20 @@ int mountSelfBundle(const lightElf::native_elf &elf,
     }
 
     auto bundleOffset = bundleSh->sh_offset;
-    if (auto digest = calculateDigest(elf.underlyingFd(), bundleOffset, bundleSh->sh_size);
-        digest != meta.digest) {
-        std::cerr << "sha256 mismatched, expected: " << meta.digest << " calculated: " << digest
-                  << std::endl;
-        return -1;
+    auto lazy = optimistic
+      && prepareLazyVerifier(elf.underlyingFd(), bundleOffset, bundleSh->sh_size, meta);
+    if (!lazy) {
+        if (auto ret = verifyBundle(elf.underlyingFd(), bundleOffset, bundleSh->sh_size, meta);
+            ret != 0) {
+            return ret;
+        }
     }
 
-    auto selfBin = elf.absolutePath();
+    // the file which is verified lazily must be the one which is opened, not a file which
+    // replaced it in the meanwhile
+    auto selfBin = lazy
+      ? std::filesystem::path{ "/proc/self/fd" } / std::to_string(elf.underlyingFd())
+      : elf.absolutePath();
     auto offsetStr = "--offset=" + std::to_string(bundleOffset);
     std::array<const char *, 4> erofs_argv = { "erofsfuse",
                                                offsetStr.c_str(),
@@ -264,6 +472,14 @@ int mountSelfBundle(const lightElf::native_elf &elf,
     }
 
     if (fusePid == 0) {
+        // erofsfuse runs as a daemon, it mustn't keep the locks of the shared mount
+        if (sharedLockFd != -1) {
+            ::close(sharedLockFd);
+        }
+        if (sharedRefFd != -1) {
+            ::close(sharedRefFd);
+        }
+
         auto *maskOutput = ::getenv("UAB_EROFSFUSE_VERBOSE");
         if (maskOutput == nullptr) {
             auto tmpfd = ::open("/tmp", O_TMPFILE | O_WRONLY, S_IRUSR | S_IWUSR);
@@ -283,6 +499,7 @@ int mountSelfBundle(const lightElf::native_elf &elf,
             }
         }
 
+        lazyVerifier.active.store(lazy);
         _exit(erofsfuse_main(4, const_cast<char **>(erofs_argv.data())));
     }
 
@@ -311,20 +528,16 @@ int mountSelfBundle(const lightElf::native_elf &elf,
     return ret;
 }
 
-void cleanResource() noexcept
+bool umountBundle(const std::filesystem::path &path) noexcept
 {
-    if (!mountFlag.load(std::memory_order_relaxed)) {
-        return;
-    }
-
     auto pid = fork();
     if (pid < 0) {
         std::cerr << "fork() error" << ": " << ::strerror(errno) << std::endl;
-        return;
+        return false;
     }
 
     if (pid == 0) {
-        if (::execlp("fusermount", "fusermount", "-z", "-u", mountPoint.c_str(), nullptr) == -1) {
+        if (::execlp("fusermount", "fusermount", "-z", "-u", path.c_str(), nullptr) == -1) {
             std::cerr << "fusermount error: " << ::strerror(errno) << std::endl;
             ::_exit(1);
         }
@@ -336,6 +549,190 @@ void cleanResource() noexcept
     auto ret = ::waitpid(pid, &status, 0);
     if (ret == -1) {
         std::cerr << "wait failed:" << ::strerror(errno) << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+void verifyInBackground(int fd, const linglong::api::types::v1::UabMetaInfo &meta) noexcept
+{
+    if (verifyBundle(fd, lazyVerifier.offset, lazyVerifier.length, meta) == 0) {
+        return;
+    }
+
+    verifyFailed.store(true);
+    std::cerr << "failed to verify the bundle, the application will be killed" << std::endl;
+    if (auto pid = loaderPid.load(); pid > 0) {
+        killProcessTree(pid);
+    }
+
+    if (sharedFlag.load(std::memory_order_relaxed)
+        && !uab::invalidateSharedMount(sharedLock, [] {
+               return umountBundle(mountPoint);
+           })) {
+        std::cerr << "failed to unmount the shared mount " << mountPoint << std::endl;
+    }
+}
+
+// whether a live erofsfuse is mounted at path, the mount of a dead erofsfuse is removed
+bool isMounted(const std::filesystem::path &path) noexcept
+{
+    struct stat st{};
+    if (::stat(path.c_str(), &st) == -1) {
+        if (errno == ENOTCONN) {
+            umountBundle(path);
+        }
+        return false;
+    }
+
+    struct stat parent{};
+    if (::stat(path.parent_path().c_str(), &parent) == -1) {
+        return false;
+    }
+
+    return st.st_dev != parent.st_dev;
+}
+
+unsigned sharedMountLinger() noexcept
+{
+    auto *linger = ::getenv("UAB_SHARED_MOUNT_LINGER");
+    if (linger == nullptr) {
+        return default_linger_seconds;
+    }
+
+    char *end{ nullptr };
+    auto seconds = std::strtoul(linger, &end, 10);
+    if (end == linger || *end != '\0' || seconds > UINT_MAX) {
+        std::cerr << "invalid UAB_SHARED_MOUNT_LINGER: " << linger << std::endl;
+        return default_linger_seconds;
+    }
+
+    return static_cast<unsigned>(seconds);
+}
+
+// the last user of a shared mount unmounts it, or leaves a reaper to unmount it after lingering
+void releaseSharedMount() noexcept
+{
+    auto lockFd = uab::lockFile(sharedLock, LOCK_EX);
+    ::close(sharedRefFd);
+    sharedRefFd = -1;
+    sharedFlag.store(false, std::memory_order_relaxed);
+    mountFlag.store(false, std::memory_order_relaxed);
+    if (lockFd == -1) {
+        return;
+    }
+    auto unlock = defer([lockFd] {
+        ::close(lockFd);
+    });
+
+    auto refFd = uab::lockFile(sharedRef, LOCK_EX | LOCK_NB);
+    if (refFd == -1) {
+        // still used by other launches
+        return;
+    }
+    auto unref = defer([refFd] {
+        ::close(refFd);
+    });
+
+    auto linger = sharedMountLinger();
+    struct stat stamp{};
+    // the reaper gives up if the ref file is touched again, a later reaper takes over
+    if (linger == 0 || ::futimens(refFd, nullptr) == -1 || ::fstat(refFd, &stamp) == -1) {
+        if (umountBundle(mountPoint)) {
+            std::error_code ec;
+            std::filesystem::remove(mountPoint, ec);
+        }
+        return;
+    }
+
+    // the reaper runs this executable again, other threads may hold locks of malloc or iostream
+    // while forking, the child only calls async-signal-safe functions until execv
+    auto lingerArg = std::to_string(linger);
+    auto secArg = std::to_string(stamp.st_mtim.tv_sec);
+    auto nsecArg = std::to_string(stamp.st_mtim.tv_nsec);
+    std::array<const char *, reaperArgc + 1> argv{ "uab-reaper",
+                                                   reaperOption.data(),
+                                                   lingerArg.c_str(),
+                                                   secArg.c_str(),
+                                                   nsecArg.c_str(),
+                                                   sharedLock.c_str(),
+                                                   sharedRef.c_str(),
+                                                   mountPoint.c_str(),
+                                                   nullptr };
+
+    auto pid = fork();
+    if (pid < 0) {
+        std::cerr << "fork() error: " << ::strerror(errno) << std::endl;
+        umountBundle(mountPoint);
+        return;
+    }
+
+    if (pid != 0) {
+        return;
+    }
+
+    ::setsid();
+    if (auto null = ::open("/dev/null", O_RDWR | O_CLOEXEC); null != -1) {
+        ::dup2(null, STDIN_FILENO);
+        ::dup2(null, STDOUT_FILENO);
+        ::dup2(null, STDERR_FILENO);
+    }
+
+    // lockFd and refFd are closed on exec
+    ::execv("/proc/self/exe", const_cast<char *const *>(argv.data()));
+    ::_exit(1);
+}
+
+// the reaper left by releaseSharedMount, it unmounts the shared mount after lingering unless the
+// mount is used again meanwhile
+int reapSharedMount(char **argv) noexcept
+{
+    char *end{ nullptr };
+    auto linger = std::strtoul(argv[2], &end, 10);
+    if (end == argv[2] || *end != '\0' || linger > UINT_MAX) {
+        return 1;
+    }
+    auto sec = std::strtoll(argv[3], &end, 10);
+    if (end == argv[3] || *end != '\0') {
+        return 1;
+    }
+    auto nsec = std::strtol(argv[4], &end, 10);
+    if (end == argv[4] || *end != '\0') {
+        return 1;
+    }
+    sharedLock = argv[5];
+    sharedRef = argv[6];
+    mountPoint = argv[7];
+
+    std::this_thread::sleep_for(std::chrono::seconds(linger));
+
+    auto lockFd = uab::lockFile(sharedLock, LOCK_EX);
+    auto refFd = uab::lockFile(sharedRef, LOCK_EX | LOCK_NB);
+    struct stat st{};
+    if (lockFd != -1 && refFd != -1 && ::fstat(refFd, &st) == 0 && st.st_mtim.tv_sec == sec
+        && st.st_mtim.tv_nsec == nsec) {
+        if (umountBundle(mountPoint)) {
+            std::error_code ec;
+            std::filesystem::remove(mountPoint, ec);
+        }
+    }
+
+    return 0;
+}
+
+void releaseResource() noexcept
+{
+    if (!mountFlag.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    if (sharedFlag.load(std::memory_order_relaxed)) {
+        releaseSharedMount();
+        return;
+    }
+
+    if (!umountBundle(mountPoint)) {
         return;
     }
     mountFlag.store(false, std::memory_order_relaxed);
@@ -354,6 +751,13 @@ void cleanResource() noexcept
     createFlag.store(false, std::memory_order_relaxed);
 }
 
+// it's called at exit and by the thread which handles signals, maybe at the same time, the later
+// one waits for the first one
+void cleanResource() noexcept
+{
+    std::call_once(cleanOnce, releaseResource);
+}
+
 [[noreturn]] void cleanAndExit(int exitCode) noexcept
 {
     cleanResource();
@@ -362,6 +766,33 @@ void cleanResource() noexcept
 
 void handleSig() noexcept
 {
+    if (::pipe2(signalPipe.data(), O_CLOEXEC) == -1) {
+        std::cerr << "pipe2() error: " << ::strerror(errno) << std::endl;
+        return;
+    }
+    mainPid = ::getpid();
+
+    try {
+        std::thread([] {
+            int sig{ 0 };
+            while (true) {
+                auto ret = ::read(signalPipe[0], &sig, sizeof(sig));
+                if (ret == -1 && errno == EINTR) {
+                    continue;
+                }
+
+                if (ret != sizeof(sig)) {
+                    return;
+                }
+
+                cleanAndExit(128 + sig);
+            }
+        }).detach();
+    } catch (const std::system_error &e) {
+        std::cerr << "failed to start signal handler: " << e.what() << std::endl;
+        return;
+    }
+
     sigset_t blocking_mask;
     sigemptyset(&blocking_mask);
     auto quitSignals = { SIGTERM, SIGINT, SIGQUIT, SIGHUP, SIGABRT };
@@ -372,8 +803,14 @@ void handleSig() noexcept
     struct sigaction sa{};
 
     sa.sa_handler = [](int sig) -> void {
-        // TODO: maybe not async safe, find a better way to handle signal
-        cleanAndExit(128 + sig);
+        // forked processes, e.g. erofsfuse, don't have the thread which reads the pipe
+        if (::getpid() != mainPid) {
+            ::_exit(128 + sig);
+        }
+
+        auto savedErrno = errno;
+        std::ignore = ::write(signalPipe[1], &sig, sizeof(sig));
+        errno = savedErrno;
     };
     sa.sa_mask = blocking_mask;
     sa.sa_flags = 0;
@@ -383,13 +820,8 @@ void handleSig() noexcept
     }
 }
 
-int createMountPoint(std::string_view uuid) noexcept
+std::filesystem::path uabRuntimeDir() noexcept
 {
-    if (createFlag.load(std::memory_order_relaxed)) {
-        std::cout << "mount point already has been created" << std::endl;
-        return 0;
-    }
-
     const char *runtimeDirPtr{ nullptr };
     runtimeDirPtr = ::getenv("XDG_RUNTIME_DIR");
     if (runtimeDirPtr == nullptr) {
@@ -398,10 +830,25 @@ int createMountPoint(std::string_view uuid) noexcept
     }
 
     auto runtimeDir = resolveRealPath(runtimeDirPtr);
+    if (runtimeDir.empty()) {
+        return {};
+    }
+
+    return std::filesystem::path{ runtimeDir } / "linglong" / "UAB";
+}
+
+int createMountPoint(std::string_view uuid) noexcept
+{
+    if (createFlag.load(std::memory_order_relaxed)) {
+        std::cout << "mount point already has been created" << std::endl;
+        return 0;
+    }
+
+    auto runtimeDir = uabRuntimeDir();
     if (runtimeDir.empty()) {
         return -1;
     }
-    auto mountPointPath = std::filesystem::path{ runtimeDir } / "linglong" / "UAB" / uuid;
+    auto mountPointPath = runtimeDir / uuid;
 
     std::error_code ec;
     if (!std::filesystem::create_directories(mountPointPath, ec) && ec) {
@@ -443,6 +890,55 @@ getMetaInfo(const lightElf::native_elf &elf) noexcept
     return meta;
 }
 
+// the same as a recursive copy, but regular files are checked out from the content store
+int extractToStore(const std::filesystem::path &destination,
+                   const digest::ContentStore &store) noexcept
+{
+    std::error_code ec;
+    try {
+        for (auto it = std::filesystem::recursive_directory_iterator{ mountPoint, ec };
+             !ec && it != std::filesystem::recursive_directory_iterator{};
+             it.increment(ec)) {
+            auto target = destination / it->path().lexically_relative(mountPoint);
+            auto status = it->symlink_status(ec);
+            if (ec) {
+                break;
+            }
+
+            if (std::filesystem::is_directory(status)) {
+                std::filesystem::create_directory(target, it->path(), ec);
+            } else if (std::filesystem::is_regular_file(status)) {
+                // e.g. the destination is on another filesystem
+                if (!store.checkout(it->path(), target)) {
+                    std::filesystem::copy_file(it->path(), target, ec);
+                }
+            } else {
+                std::filesystem::copy(it->path(),
+                                      target,
+                                      std::filesystem::copy_options::copy_symlinks,
+                                      ec);
+            }
+
+            if (ec) {
+                std::cerr << "failed to extract " << it->path() << ": " << ec.message()
+                          << std::endl;
+                return ec.value();
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "failed to extract bundle: " << e.what() << std::endl;
+        return -1;
+    }
+
+    if (ec) {
+        std::cerr << "failed to extract bundle from " << mountPoint << ": " << ec.message()
+                  << std::endl;
+        return ec.value();
+    }
+
+    return 0;
+}
+
 int extractBundle(std::string_view destination) noexcept
 {
     std::error_code ec;
@@ -451,6 +947,15 @@ int extractBundle(std::string_view destination) noexcept
         return ec.value();
     }
 
+    if (const auto *env = ::getenv("UAB_CONTENT_STORE");
+        env != nullptr && std::string_view{ env } != "0") {
+        if (auto dir = digest::ContentStore::default_directory(); dir) {
+            return extractToStore(destination, digest::ContentStore{ std::move(dir).value() });
+        }
+
+        std::cerr << "content store is unavailable, copy files instead" << std::endl;
+    }
+
     auto options =
       std::filesystem::copy_options::copy_symlinks | std::filesystem::copy_options::recursive;
     std::filesystem::copy(mountPoint, destination, options, ec);
@@ -494,13 +999,13 @@ int runAppLoader(const std::vector<std::string_view> &loaderArgs) noexcept
         argv[i + 1] = loaderArgs[i].data();
     }
 
-    auto loaderPid = fork();
-    if (loaderPid < 0) {
+    auto pid = fork();
+    if (pid < 0) {
         std::cerr << "fork() error" << ": " << ::strerror(errno) << std::endl;
         return errno;
     }
 
-    if (loaderPid == 0) {
+    if (pid == 0) {
         if (::setenv("LINGLONG_UAB_LOADER_ONLY_APP", "true", 1) < 0) {
             std::cerr << "setenv error: " << ::strerror(errno) << std::endl;
             return errno;
@@ -513,8 +1018,14 @@ int runAppLoader(const std::vector<std::string_view> &loaderArgs) noexcept
         }
     }
 
+    loaderPid.store(pid);
+    // the background verification may fail before the loader is known
+    if (verifyFailed.load()) {
+        killProcessTree(pid);
+    }
+
     int status{ 0 };
-    auto ret = ::waitpid(loaderPid, &status, 0);
+    auto ret = ::waitpid(pid, &status, 0);
     if (ret == -1) {
         std::cerr << "waitpid failed:" << ::strerror(errno) << std::endl;
         return errno;
@@ -599,15 +1110,79 @@ argOption parseArgs(const std::vector<std::string_view> &args)
     return opts;
 }
 
+bool useSharedMount(const linglong::api::types::v1::UabMetaInfo &meta) noexcept
+{
+    auto *shared = ::getenv("UAB_SHARED_MOUNT");
+    if (shared == nullptr || std::string_view{ shared } == "0") {
+        return false;
+    }
+
+    const auto &digest = meta.merkleTree ? meta.merkleTree->root : meta.digest;
+    return !digest.empty() && digest.find('/') == std::string::npos;
+}
+
+// launches of the same bundle share one mount at <runtime dir>/shared/<digest>, which is
+// verified and mounted by the first one, so the page cache is shared as well
+int mountSharedBundle(const lightElf::native_elf &elf,
+                      const linglong::api::types::v1::UabMetaInfo &meta,
+                      bool optimistic) noexcept
+{
+    auto runtimeDir = uabRuntimeDir();
+    if (runtimeDir.empty()) {
+        return -1;
+    }
+
+    const auto &digest = meta.merkleTree ? meta.merkleTree->root : meta.digest;
+    auto sharedDir = runtimeDir / "shared";
+    auto mountPointPath = sharedDir / digest;
+    std::error_code ec;
+    if (!std::filesystem::create_directories(mountPointPath, ec) && ec) {
+        std::cerr << "couldn't create mount point " << mountPointPath << ": " << ec.message()
+                  << std::endl;
+        return ec.value();
+    }
+
+    sharedLock = sharedDir / (digest + ".lock");
+    sharedRef = sharedDir / (digest + ".ref");
+    mountPoint = std::move(mountPointPath);
+    auto ret = uab::acquireSharedMount(
+      sharedLock,
+      sharedRef,
+      sharedLockFd,
+      sharedRefFd,
+      [] {
+          return isMounted(mountPoint);
+      },
+      [&elf, &meta, optimistic] {
+          return mountSelfBundle(elf, meta, optimistic);
+      });
+    if (ret != 0) {
+        return ret;
+    }
+
+    sharedFlag.store(true, std::memory_order_relaxed);
+    return 0;
+}
+
 int mountSelf(const lightElf::native_elf &elf,
               const linglong::api::types::v1::UabMetaInfo &metaInfo,
-              const std::filesystem::path &mp = {}) noexcept
+              const std::filesystem::path &mp = {},
+              bool optimistic = false) noexcept
 {
     if (mountFlag.load(std::memory_order_relaxed)) {
         std::cout << "bundle already has been mounted" << std::endl;
         return 0;
     }
 
+    if (mp.empty() && useSharedMount(metaInfo)) {
+        if (auto ret = mountSharedBundle(elf, metaInfo, optimistic); ret != 0) {
+            return ret;
+        }
+
+        mountFlag.store(true, std::memory_order_relaxed);
+        return 0;
+    }
+
     if (mp.empty()) {
         const auto &uuid = metaInfo.uuid;
         if (auto ret = createMountPoint(uuid); ret != 0) {
@@ -627,7 +1202,7 @@ int mountSelf(const lightElf::native_elf &elf,
         mountPoint = mp;
     }
 
-    if (auto ret = mountSelfBundle(elf, metaInfo); ret != 0) {
+    if (auto ret = mountSelfBundle(elf, metaInfo, optimistic); ret != 0) {
         return ret;
     }
 
@@ -636,8 +1211,24 @@ int mountSelf(const lightElf::native_elf &elf,
 }
 } // namespace
 
+extern "C" {
+ssize_t __wrap_pread(int fd, void *buf, size_t count, off_t offset)
+{
+    return lazyVerifier.pread(fd, buf, count, offset, __real_pread);
+}
+
+ssize_t __wrap_pread64(int fd, void *buf, size_t count, off64_t offset)
+{
+    return lazyVerifier.pread(fd, buf, count, offset, __real_pread64);
+}
+}
+
 int main(int argc, char **argv)
 {
+    if (argc == reaperArgc && std::string_view{ argv[1] } == reaperOption) {
+        return reapSharedMount(argv);
+    }
+
     handleSig();
 
     std::vector<std::string_view> args;
@@ -678,7 +1269,14 @@ int main(int argc, char **argv)
         std::abort();
     });
 
-    if (auto ret = mountSelf(elf, metaInfo, opts.mountPath); ret != 0) {
+    const bool onlyApp = metaInfo.onlyApp.value_or(false);
+    auto *optimistic = ::getenv("UAB_OPTIMISTIC_VERIFY");
+    if (auto ret = mountSelf(elf,
+                             metaInfo,
+                             opts.mountPath,
+                             optimistic != nullptr && std::string_view{ optimistic } != "0"
+                               && opts.mountPath.empty() && opts.extractPath.empty() && onlyApp);
+        ret != 0) {
         return ret;
     }
 
@@ -693,8 +1291,6 @@ int main(int argc, char **argv)
         return extractBundle(opts.extractPath);
     }
 
-    const bool onlyApp = metaInfo.onlyApp.value_or(false);
-
     if (!onlyApp) {
         std::cout << "This UAB is not support for running" << std::endl;
         return 0;
@@ -721,5 +1317,27 @@ int main(int argc, char **argv)
         return 1;
     }
 
-    return runAppLoader(opts.loaderArgs);
+    std::thread verifier;
+    if (lazyVerifier.pending) {
+        try {
+            verifier = std::thread(verifyInBackground, elf.underlyingFd(), std::cref(metaInfo));
+        } catch (const std::system_error &e) {
+            std::cerr << "failed to start verification: " << e.what() << std::endl;
+            verifyInBackground(elf.underlyingFd(), metaInfo);
+            if (verifyFailed.load()) {
+                return -1;
+            }
+        }
+    }
+
+    auto ret = runAppLoader(opts.loaderArgs);
+    if (verifier.joinable()) {
+        verifier.join();
+    }
+
+    if (verifyFailed.load()) {
+        return -1;
+    }
+
+    return ret;
 }
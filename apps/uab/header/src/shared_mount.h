@@ -0,0 +1,99 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "utils.h"
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace uab {
+
+// open and flock(2) a file, -1 if it failed or would block with LOCK_NB
+inline int lockFile(const std::filesystem::path &path, int operation) noexcept
+{
+    auto fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+        std::cerr << "failed to open " << path << ": " << ::strerror(errno) << std::endl;
+        return -1;
+    }
+
+    while (::flock(fd, operation) == -1) {
+        if (errno == EINTR) {
+            continue;
+        }
+
+        if (errno != EWOULDBLOCK) {
+            std::cerr << "failed to lock " << path << ": " << ::strerror(errno) << std::endl;
+        }
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// A shared mount is kept by the shared locks of its users on the ref file, the lock file
+// serializes mounting and unmounting of it.
+//
+// Take a reference of the shared mount, the bundle is mounted by mount() unless mounted() tells
+// it's mounted already. lockFd is held while mounting, refFd is the reference on success.
+template <typename Mounted, typename Mount>
+int acquireSharedMount(const std::filesystem::path &lock,
+                       const std::filesystem::path &ref,
+                       int &lockFd,
+                       int &refFd,
+                       Mounted &&mounted,
+                       Mount &&mount) noexcept
+{
+    lockFd = lockFile(lock, LOCK_EX);
+    if (lockFd == -1) {
+        return -1;
+    }
+    auto unlock = defer([&lockFd] {
+        ::close(lockFd);
+        lockFd = -1;
+    });
+
+    refFd = lockFile(ref, LOCK_SH);
+    if (refFd == -1) {
+        return -1;
+    }
+
+    if (!mounted()) {
+        if (auto ret = mount(); ret != 0) {
+            ::close(refFd);
+            refFd = -1;
+            return ret;
+        }
+    }
+
+    return 0;
+}
+
+// unmount the shared mount by unmount(), e.g. the bundle failed the verification, later launches
+// mount and verify it again instead of reusing it
+template <typename Unmount>
+bool invalidateSharedMount(const std::filesystem::path &lock, Unmount &&unmount) noexcept
+{
+    auto lockFd = lockFile(lock, LOCK_EX);
+    if (lockFd == -1) {
+        return false;
+    }
+    auto unlock = defer([lockFd] {
+        ::close(lockFd);
+    });
+
+    return unmount();
+}
+
+} // namespace uab
@@ -11,6 +11,7 @@
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
 #include <cstdint>
 #include <cstdlib>
 #include <exception>
@@ -23,6 +24,7 @@
 #include <utility>
 #include <vector>
 
+#include <glob.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <unistd.h>
@@ -145,8 +147,100 @@ loadPackageInfoFromJson(const std::filesystem::path &json) noexcept
     return std::nullopt;
 }
 
+// collect the directories listed in a ld.so.conf of the host, like parse_conf of ldconfig
+void hostLibraryDirs(const std::filesystem::path &conf,
+                     std::vector<std::filesystem::path> &dirs,
+                     int depth) noexcept
+{
+    // ldconfig gives up on include loops as well
+    if (depth > 16) {
+        return;
+    }
+
+    std::ifstream stream{ conf };
+    if (!stream.is_open()) {
+        return;
+    }
+
+    std::string line;
+    while (std::getline(stream, line)) {
+        if (auto comment = line.find('#'); comment != std::string::npos) {
+            line.resize(comment);
+        }
+
+        auto trimmed = linglong::common::strings::trim(line, " \t\r");
+        if (trimmed.empty() || linglong::common::strings::starts_with(trimmed, "hwcap")) {
+            continue;
+        }
+
+        if (!linglong::common::strings::starts_with(trimmed, "include ")
+            && !linglong::common::strings::starts_with(trimmed, "include\t")) {
+            dirs.emplace_back(trimmed);
+            continue;
+        }
+
+        auto patterns = linglong::common::strings::split(
+          trimmed.substr(8), ' ', linglong::common::strings::splitOption::SkipEmpty);
+        for (auto pattern : patterns) {
+            std::filesystem::path path{ linglong::common::strings::trim(pattern, "\t") };
+            if (path.is_relative()) {
+                path = conf.parent_path() / path;
+            }
+
+            glob_t result{};
+            if (::glob(path.c_str(), 0, nullptr, &result) == 0) {
+                for (std::size_t i = 0; i < result.gl_pathc; ++i) {
+                    hostLibraryDirs(result.gl_pathv[i], dirs, depth + 1);
+                }
+            }
+            ::globfree(&result);
+        }
+    }
+}
+
+// the prebuilt ld.so.cache only has libraries of the bundle, libraries of the host are found in
+// the default search paths of the dynamic linker. if ld.so.conf of the host adds other
+// directories, e.g. for the GPU driver, ldconfig has to run in the container.
+bool hostHasExtraLibraryDirs(const std::string &triplet) noexcept
+{
+    std::vector<std::filesystem::path> dirs;
+    hostLibraryDirs("/etc/ld.so.conf", dirs, 0);
+
+    std::error_code ec;
+    std::vector<std::filesystem::path> defaultDirs;
+    for (const auto &dir : { std::string{ "/lib" },
+                             std::string{ "/lib64" },
+                             std::string{ "/usr/lib" },
+                             std::string{ "/usr/lib64" },
+                             "/lib/" + triplet,
+                             "/usr/lib/" + triplet }) {
+        // /lib is a symlink to /usr/lib on merged /usr
+        defaultDirs.push_back(std::filesystem::weakly_canonical(dir, ec));
+    }
+
+    for (const auto &dir : dirs) {
+        auto canonical = std::filesystem::weakly_canonical(dir, ec);
+        if (ec || std::find(defaultDirs.cbegin(), defaultDirs.cend(), canonical)
+              != defaultDirs.cend()) {
+            continue;
+        }
+
+        for (const auto &entry : std::filesystem::directory_iterator{ canonical, ec }) {
+            auto name = entry.path().filename().string();
+            if (linglong::common::strings::starts_with(name, "lib")
+                && name.find(".so") != std::string::npos) {
+                std::cout << "found libraries in " << dir << ", ldconfig is required" << std::endl;
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 bool processLDConfig(linglong::generator::ContainerCfgBuilder &builder,
-                     const std::string &arch) noexcept
+                     const std::string &arch,
+                     const std::filesystem::path &extraDir) noexcept
 {
     std::optional<std::string> triplet;
     if (arch == "x86_64") {
@@ -166,6 +260,29 @@ bool processLDConfig(linglong::generator::ContainerCfgBuilder &builder,
         return false;
     }
 
+    std::error_code ec;
+    auto prebuilt = extraDir / "ld.so.cache";
+    if (std::filesystem::exists(prebuilt, ec) && !hostHasExtraLibraryDirs(triplet.value())) {
+        builder.addExtraMounts(
+          std::vector<ocppi::runtime::config::types::Mount>{ ocppi::runtime::config::types::Mount{
+            .destination = "/etc/ld.so.cache",
+            .options = { { "ro", "bind" } },
+            .source = prebuilt,
+            .type = "bind",
+          } });
+        return true;
+    }
+
+    // fallback to generate ld.so.cache at startup of the container
+    auto runtimeLD = containerBundle / "ld.so.cache";
+    {
+        std::ofstream stream{ runtimeLD };
+        if (!stream) {
+            std::cerr << "failed to open file " << runtimeLD << std::endl;
+            return false;
+        }
+    }
+
     auto content = builder.ldConf(triplet.value());
     auto ldConf = containerBundle / "ld.so.conf";
     {
@@ -189,6 +306,12 @@ bool processLDConfig(linglong::generator::ContainerCfgBuilder &builder,
     }
 
     builder.addExtraMounts(std::vector<ocppi::runtime::config::types::Mount>{
+      ocppi::runtime::config::types::Mount{
+        .destination = "/etc/ld.so.cache",
+        .options = { { "bind" } },
+        .source = runtimeLD,
+        .type = "bind",
+      },
       ocppi::runtime::config::types::Mount{
         .destination = "/etc/" + randomFile.filename().string(),
         .options = { { "ro", "bind" } },
@@ -401,15 +524,6 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) // NOLINT
     auto gid = ::getgid();
     linglong::generator::ContainerCfgBuilder builder;
 
-    auto runtimeLD = containerBundle / "ld.so.cache";
-    {
-        std::ofstream stream{ runtimeLD };
-        if (!stream) {
-            std::cerr << "failed to open file " << runtimeLD << std::endl;
-            return -1;
-        }
-    }
-
     const auto &appID = appInfo->id;
     builder.setAppId(appID)
       .setBundlePath(containerBundle)
@@ -420,17 +534,11 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) // NOLINT
       .addGIdMapping(gid, gid, 1)
       .addExtraMounts(
         std::vector<ocppi::runtime::config::types::Mount>{ ocppi::runtime::config::types::Mount{
-                                                             .destination = "/etc/ld.so.cache",
-                                                             .options = { { "bind" } },
-                                                             .source = runtimeLD,
-                                                             .type = "bind",
-                                                           },
-                                                           ocppi::runtime::config::types::Mount{
-                                                             .destination = "/tmp",
-                                                             .options = { { "rbind" } },
-                                                             .source = "/tmp",
-                                                             .type = "bind",
-                                                           } })
+          .destination = "/tmp",
+          .options = { { "rbind" } },
+          .source = "/tmp",
+          .type = "bind",
+        } })
       .appendEnv("LINGLONG_APPID", appID);
 
     auto extraDir = bundleDir / "extra";
@@ -529,8 +637,8 @@ int main([[maybe_unused]] int argc, [[maybe_unused]] char **argv) // NOLINT
     }
     builder.setAppPath(appLayerFilesDir);
 
-    // generate ld.so.cache and font cache at runtime
-    if (!processLDConfig(builder, appInfo->arch[0])) {
+    // use the prebuilt ld.so.cache or generate it at runtime
+    if (!processLDConfig(builder, appInfo->arch[0], extraDir)) {
         std::cerr << "failed to processing ld config" << std::endl;
         return -1;
     }
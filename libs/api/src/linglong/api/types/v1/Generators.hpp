@@ -23,6 +23,7 @@
 #include "linglong/api/types/v1/Version.hpp"
 #include "linglong/api/types/v1/Sections.hpp"
 #include "linglong/api/types/v1/UabLayer.hpp"
+#include "linglong/api/types/v1/UabMerkleTree.hpp"
 #include "linglong/api/types/v1/State.hpp"
 #include "linglong/api/types/v1/RuntimeConfigure.hpp"
 #include "linglong/api/types/v1/RunContextConfig.hpp"
@@ -258,6 +259,9 @@ void to_json(json & j, const RuntimeConfigure & x);
 void from_json(const json & j, UabLayer & x);
 void to_json(json & j, const UabLayer & x);
 
+void from_json(const json & j, UabMerkleTree & x);
+void to_json(json & j, const UabMerkleTree & x);
+
 void from_json(const json & j, Sections & x);
 void to_json(json & j, const Sections & x);
 
@@ -1359,6 +1363,19 @@ j["info"] = x.info;
 j["minified"] = x.minified;
 }
 
+inline void from_json(const json & j, UabMerkleTree& x) {
+x.leafSize = j.at("leafSize").get<int64_t>();
+x.leaves = j.at("leaves").get<std::vector<std::string>>();
+x.root = j.at("root").get<std::string>();
+}
+
+inline void to_json(json & j, const UabMerkleTree & x) {
+j = json::object();
+j["leafSize"] = x.leafSize;
+j["leaves"] = x.leaves;
+j["root"] = x.root;
+}
+
 inline void from_json(const json & j, Sections& x) {
 x.bundle = j.at("bundle").get<std::string>();
 x.icon = get_stack_optional<std::string>(j, "icon");
@@ -1375,6 +1392,7 @@ j["icon"] = x.icon;
 inline void from_json(const json & j, UabMetaInfo& x) {
 x.digest = j.at("digest").get<std::string>();
 x.layers = j.at("layers").get<std::vector<UabLayer>>();
+x.merkleTree = get_stack_optional<UabMerkleTree>(j, "merkleTree");
 x.onlyApp = get_stack_optional<bool>(j, "onlyApp");
 x.sections = j.at("sections").get<Sections>();
 x.uuid = j.at("uuid").get<std::string>();
@@ -1385,6 +1403,9 @@ inline void to_json(json & j, const UabMetaInfo & x) {
 j = json::object();
 j["digest"] = x.digest;
 j["layers"] = x.layers;
+if (x.merkleTree) {
+j["merkleTree"] = x.merkleTree;
+}
 if (x.onlyApp) {
 j["onlyApp"] = x.onlyApp;
 }
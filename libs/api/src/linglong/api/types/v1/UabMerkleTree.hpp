@@ -0,0 +1,54 @@
+// This file is generated by tools/codegen.sh
+// DO NOT EDIT IT.
+
+// clang-format off
+
+//  To parse this JSON data, first install
+//
+//      json.hpp  https://github.com/nlohmann/json
+//
+//  Then include this file, and then do
+//
+//     UabMerkleTree.hpp data = nlohmann::json::parse(jsonString);
+
+#pragma once
+
+#include <optional>
+#include <nlohmann/json.hpp>
+#include "linglong/api/types/v1/helper.hpp"
+
+namespace linglong {
+namespace api {
+namespace types {
+namespace v1 {
+/**
+* SHA-256 of the fixed size leaves of the bundle section, which can be verified in parallel
+* or on demand. It's absent in UAB files created by former versions.
+*/
+
+using nlohmann::json;
+
+/**
+* SHA-256 of the fixed size leaves of the bundle section, which can be verified in parallel
+* or on demand. It's absent in UAB files created by former versions.
+*/
+struct UabMerkleTree {
+/**
+* Size of every leaf in bytes, the last leaf may be shorter.
+*/
+int64_t leafSize;
+/**
+* Digests of all leaves in hex, in the order of their offsets.
+*/
+std::vector<std::string> leaves;
+/**
+* SHA-256 of the concatenated hex digests of all leaves.
+*/
+std::string root;
+};
+}
+}
+}
+}
+
+// clang-format on
@@ -18,6 +18,7 @@
 #include "linglong/api/types/v1/helper.hpp"
 
 #include "linglong/api/types/v1/UabLayer.hpp"
+#include "linglong/api/types/v1/UabMerkleTree.hpp"
 #include "linglong/api/types/v1/Sections.hpp"
 
 namespace linglong {
@@ -43,6 +44,11 @@ struct UabMetaInfo {
 std::string digest;
 std::vector<UabLayer> layers;
 /**
+* SHA-256 of the fixed size leaves of the bundle section, which can be verified in parallel
+* or on demand. It's absent in UAB files created by former versions.
+*/
+std::optional<UabMerkleTree> merkleTree;
+/**
 * whether this UAB file has been exported in only-App mode.
 */
 std::optional<bool> onlyApp;
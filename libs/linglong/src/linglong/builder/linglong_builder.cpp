@@ -10,11 +10,13 @@
 #include "linglong/api/types/v1/ExportDirs.hpp"
 #include "linglong/api/types/v1/Generators.hpp"
 #include "linglong/builder/printer.h"
+#include "linglong/builder/source_cache.h"
 #include "linglong/common/global/initialize.h"
 #include "linglong/common/strings.h"
 #include "linglong/package/architecture.h"
 #include "linglong/package/fuzzy_reference.h"
 #include "linglong/package/layer_dir.h"
+#include "linglong/package/layer_image.h"
 #include "linglong/package/layer_packager.h"
 #include "linglong/package/reference.h"
 #include "linglong/package/uab_packager.h"
@@ -40,13 +42,16 @@
 #include <QTemporaryDir>
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <vector>
 
 #include <fcntl.h>
@@ -68,44 +73,6 @@ currentReference(const api::types::v1::BuilderProject &project)
     return package::Reference::fromBuilderProject(project);
 }
 
-utils::error::Result<void>
-fetchSources(const std::vector<api::types::v1::BuilderProjectSource> &sources,
-             const QDir &cacheDir,
-             const QDir &destination,
-             [[maybe_unused]] const api::types::v1::BuilderConfig &cfg) noexcept
-{
-    LINGLONG_TRACE("fetch sources to " + destination.absolutePath().toStdString());
-
-    for (decltype(sources.size()) pos = 0; pos < sources.size(); ++pos) {
-        if (!sources.at(pos).url.has_value()) {
-            return LINGLONG_ERR("source missing url");
-        }
-        auto url = QString::fromStdString(*(sources.at(pos).url));
-        if (url.length() > 75) {         // NOLINT
-            url = "..." + url.right(70); // NOLINT
-        }
-        printReplacedText(fmt::format("{:<20}{:<15}{:<75}downloading ...",
-                                      "Source " + std::to_string(pos),
-                                      sources.at(pos).kind,
-                                      url.toStdString()),
-                          2);
-        SourceFetcher fetcher(sources.at(pos), cacheDir);
-        auto result = fetcher.fetch(QDir(destination));
-        if (!result) {
-            return LINGLONG_ERR(result);
-        }
-        printReplacedText(QString("%1%2%3%4")
-                            .arg("Source " + QString::number(pos), -20)             // NOLINT
-                            .arg(QString::fromStdString(sources.at(pos).kind), -15) // NOLINT
-                            .arg(url, -75)                                          // NOLINT
-                            .arg("complete\n")
-                            .toStdString(),
-                          2);
-    }
-
-    return LINGLONG_OK;
-}
-
 } // namespace
 
 namespace detail {
@@ -491,19 +458,43 @@ utils::error::Result<void> Builder::buildStageFetchSource() noexcept
                    .arg("Status")
                    .toStdString(),
                  2);
-    auto fetchCacheDir = QString::fromStdString(internalDir / "cache");
+    // the cache is shared by all projects of the user
+    auto fetchCacheDir = SourceCache::defaultDirectory();
     if (!qEnvironmentVariableIsEmpty("LINGLONG_FETCH_CACHE")) {
-        fetchCacheDir = qgetenv("LINGLONG_FETCH_CACHE");
+        fetchCacheDir = qgetenv("LINGLONG_FETCH_CACHE").toStdString();
+    }
+    if (fetchCacheDir.empty()) {
+        fetchCacheDir = internalDir / "cache";
     }
     // clean sources directory on every build
     auto fetchSourcesDir = QDir(QString::fromStdString(internalDir / "sources"));
     fetchSourcesDir.removeRecursively();
-    auto result = fetchSources(*this->project->sources, fetchCacheDir, fetchSourcesDir, this->cfg);
+    std::vector<SourceFetcher> fetchers;
+    for (const auto &source : *this->project->sources) {
+        fetchers.emplace_back(source, QString::fromStdString(fetchCacheDir));
+    }
+    auto result = fetchSources(fetchers, fetchSourcesDir, this->buildOptions.fetchJobs);
 
     if (!result) {
         return LINGLONG_ERR(result);
     }
 
+    std::uint64_t cacheSize = 10ULL << 30; // NOLINT
+    if (!qEnvironmentVariableIsEmpty("LINGLONG_FETCH_CACHE_SIZE")) {
+        auto size = parseCacheSize(qgetenv("LINGLONG_FETCH_CACHE_SIZE").toStdString());
+        if (size) {
+            cacheSize = *size;
+        } else {
+            LogW("invalid LINGLONG_FETCH_CACHE_SIZE, use the default size {}", cacheSize);
+        }
+    }
+    auto freed = SourceCache(fetchCacheDir).evict(cacheSize);
+    if (!freed) {
+        LogW("failed to evict entries of source cache: {}", freed.error());
+    } else if (*freed > 0) {
+        LogI("{} bytes of source cache {} are evicted", *freed, fetchCacheDir);
+    }
+
     return LINGLONG_OK;
 }
 
@@ -1420,6 +1411,10 @@ utils::error::Result<void> Builder::exportUAB(const ExportOption &option,
         }
     });
     package::UABPackager packager(workingDir, exportWorkingDir);
+    // the bundle image of the last export is reused if nothing is changed since then
+    if (this->project) {
+        packager.setBundleCache(this->internalDir / "uab-cache");
+    }
     auto exportOpts = option;
     if (exportOpts.compressor.empty()) {
         LogI("Compressor not specified, defaulting to lz4 for UAB export.");
@@ -1547,7 +1542,8 @@ utils::error::Result<void> Builder::exportUAB(const ExportOption &option,
             args.emplace_back(exportOpts.compressor);
             return runFromRepo(*ref, args);
         };
-        packager.setBundleCB(utilsBundler);
+        packager.setBundleCB(utilsBundler,
+                             fmt::format("{} -z {}", ref->toString(), exportOpts.compressor));
     } else {
         LogW("cn.org.linyaps.builder.utils not found, using system tools");
     }
@@ -1646,6 +1642,14 @@ utils::error::Result<void> Builder::exportUAB(const ExportOption &option,
         packager.setCompressor(option.compressor.c_str());
     }
 
+    if (option.compressionLevel) {
+        packager.setCompressionLevel(*option.compressionLevel);
+    }
+
+    if (option.clusterSize) {
+        packager.setClusterSize(*option.clusterSize);
+    }
+
     if (this->project->runtime) {
         auto runtimeRef =
           detail::clearDependency(this->project->runtime.value(), this->repo, false);
@@ -1701,10 +1705,7 @@ utils::error::Result<void> Builder::exportLayer(const ExportOption &option)
         return LINGLONG_ERR(fmt::format("no {} found", ref->toString()));
     }
 
-    package::LayerPackager pkger;
-    if (!option.compressor.empty()) {
-        pkger.setCompressor(option.compressor.c_str());
-    }
+    std::vector<std::pair<std::string, package::LayerDir>> layers;
     for (const auto &module : modules) {
         if (option.noExportDevelop && module == "develop") {
             continue;
@@ -1719,19 +1720,87 @@ utils::error::Result<void> Builder::exportLayer(const ExportOption &option)
             continue;
         }
 
-        auto layerFile = QString::fromStdString(workingDir / layerExportFilename(*ref, module));
-        auto ret = pkger.pack(*layerDir, layerFile);
-        if (!ret) {
+        layers.emplace_back(module, std::move(layerDir).value());
+    }
+
+    if (layers.empty()) {
+        return LINGLONG_OK;
+    }
+
+    // modules are independent, each one is staged and compressed by its own packager, the
+    // threads of the machine are divided among the jobs so they don't oversubscribe it
+    auto jobs =
+      option.jobs == 0 ? layers.size() : std::min<std::size_t>(option.jobs, layers.size());
+    auto cpus = std::max(1U, std::thread::hardware_concurrency());
+    auto workers = std::max(1U, static_cast<unsigned>(cpus / jobs));
+
+    std::atomic_size_t next{ 0 };
+    std::atomic_bool failed{ false };
+    std::mutex mutex;
+    utils::error::Result<void> failure = LINGLONG_OK;
+
+    auto worker = [&]() noexcept {
+        for (auto index = next++; index < layers.size() && !failed; index = next++) {
+            const auto &[module, layerDir] = layers[index];
+
+            package::LayerPackager pkger;
+            if (!option.compressor.empty()) {
+                pkger.setCompressor(option.compressor.c_str());
+            }
+
+            if (option.compressionLevel) {
+                pkger.setCompressionLevel(*option.compressionLevel);
+            }
+
+            if (option.clusterSize) {
+                pkger.setClusterSize(*option.clusterSize);
+            }
+
+            // --workers=1 is passed as well, mkfs.erofs may use all CPUs by default, which
+            // exceeds the budget of concurrent jobs
+            pkger.setWorkers(workers);
+
+            auto layerFile = QString::fromStdString(workingDir / layerExportFilename(*ref, module));
+            auto ret = pkger.pack(layerDir, layerFile);
+            if (ret) {
+                LogI("exported layer {}/{}", ref->toString(), module);
+                continue;
+            }
+
             LogE("export layer {}/{} failed: {}", ref->toString(), module, ret.error());
-            return LINGLONG_ERR("export layer {}/{} failed", ret);
+            std::lock_guard lock(mutex);
+            if (!failed.exchange(true)) {
+                failure = LINGLONG_ERR(
+                  fmt::format("export layer {}/{} failed", ref->toString(), module),
+                  ret);
+            }
         }
+    };
+
+    std::vector<std::thread> threads;
+    try {
+        for (std::size_t i = 1; i < jobs; ++i) {
+            threads.emplace_back(worker);
+        }
+    } catch (...) {
+        // fewer jobs are fine
+    }
+
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    if (!failure) {
+        return LINGLONG_ERR(failure);
     }
 
     return LINGLONG_OK;
 }
 
 utils::error::Result<void> Builder::extractLayer(const QString &layerPath,
-                                                 const QString &destination)
+                                                 const QString &destination,
+                                                 const std::filesystem::path &path)
 {
     LINGLONG_TRACE("extract " + layerPath.toStdString() + " to " + destination.toStdString());
 
@@ -1745,14 +1814,27 @@ utils::error::Result<void> Builder::extractLayer(const QString &layerPath,
         return LINGLONG_ERR(destination.toStdString() + " already exists");
     }
 
+    // the layer is read in process, erofs-utils are only needed by images it doesn't support.
+    // other errors, e.g. the checksum mismatches or the path doesn't exist, are returned.
+    auto image = (*layerFile)->openImage();
+    if (image) {
+        auto extracted = (*layerFile)->extract(path, destDir.absolutePath().toStdString());
+        if (!extracted) {
+            return LINGLONG_ERR(extracted);
+        }
+        return LINGLONG_OK;
+    }
+    LogW("failed to open layer image, fallback to unpack it: {}", image.error());
+
     package::LayerPackager pkg;
     auto layerDir = pkg.unpack(*(*layerFile));
     if (!layerDir) {
         return LINGLONG_ERR(layerDir);
     }
 
-    auto output =
-      utils::Cmd("cp").exec({ "-r", layerDir->path(), destDir.absolutePath().toStdString() });
+    auto output = utils::Cmd("cp").exec({ "-r",
+                                          (layerDir->path() / path.relative_path()).string(),
+                                          destDir.absolutePath().toStdString() });
     if (!output) {
         return LINGLONG_ERR(output);
     }
@@ -1803,6 +1885,17 @@ utils::error::Result<void> Builder::importLayer(repo::OSTreeRepo &ostree,
         return LINGLONG_ERR(layerFile);
     }
 
+    // import the layer from the image directly, unpack it only if the image isn't supported
+    auto image = (*layerFile)->openImage();
+    if (image) {
+        auto result = ostree.importLayerImage(package::LayerImage{ **image });
+        if (!result) {
+            return LINGLONG_ERR(result);
+        }
+        return LINGLONG_OK;
+    }
+    LogW("failed to open layer image, fallback to unpack it: {}", image.error());
+
     package::LayerPackager pkg;
 
     auto layerDir = pkg.unpack(*(*layerFile));
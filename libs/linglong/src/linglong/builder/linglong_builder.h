@@ -28,9 +28,14 @@ struct ExportOption
     std::string iconPath;
     std::string loader;
     std::string compressor;
+    std::optional<int> compressionLevel;
+    std::optional<std::size_t> clusterSize;
     std::string ref;
     std::vector<std::string> modules;
     bool noExportDevelop{ false };
+    // modules exported at the same time, 0 means all of them, they share the threads of
+    // compression
+    unsigned jobs{ 0 };
 };
 
 struct BuilderBuildOptions
@@ -45,6 +50,8 @@ struct BuilderBuildOptions
     bool skipCheckOutput{ false };
     bool skipStripSymbols{ false };
     bool isolateNetWork{ false };
+    // 同时获取的源码数
+    unsigned fetchJobs{ 4 };
 };
 
 utils::error::Result<std::vector<std::filesystem::path>>
@@ -99,7 +106,10 @@ public:
       -> utils::error::Result<void>;
     auto exportLayer(const ExportOption &option) -> utils::error::Result<void>;
 
-    static auto extractLayer(const QString &layerPath, const QString &destination)
+    // path is relative to the root of the layer, the whole layer is extracted if it's empty
+    static auto extractLayer(const QString &layerPath,
+                             const QString &destination,
+                             const std::filesystem::path &path = {})
       -> utils::error::Result<void>;
 
     auto push(const std::string &module,
@@ -0,0 +1,549 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/builder/source_cache.h"
+
+#include "linglong/common/error.h"
+#include "linglong/common/xdg.h"
+#include "linglong/package/erofs_builder.h"
+#include "linglong/utils/file.h"
+#include "linglong/utils/finally/finally.h"
+#include "linglong/utils/log/log.h"
+#include "linglong/utils/merkle.h"
+#include "linglong/utils/sha256.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace linglong::builder {
+
+namespace {
+
+// FileLock keeps the paths locked by the process in a map, which isn't safe to be changed by
+// sources fetched at the same time, locks of entries are created and destroyed under this mutex
+std::recursive_mutex &fileLockMutex()
+{
+    static std::recursive_mutex mutex;
+    return mutex;
+}
+
+constexpr std::array<std::string_view, 4> entryKinds{ "archive_", "dsc_", "file_", "git_" };
+
+bool isHex(std::string_view str) noexcept
+{
+    return !str.empty() && std::all_of(str.cbegin(), str.cend(), [](char c) {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+    });
+}
+
+// lock files, records and temporary files of entries have a dot in their names, entries don't
+bool isEntryName(std::string_view name) noexcept
+{
+    return name.find('.') == std::string_view::npos
+      && std::any_of(entryKinds.cbegin(), entryKinds.cend(), [name](std::string_view kind) {
+             return name.substr(0, kind.size()) == kind;
+         });
+}
+
+// the entries whose fetch may leave the temporary, which is removed under their locks:
+//   tmp_<digest>: the tree or the file of archive_, dsc_ or file_<digest> before it's checked
+//   <entry>.tmp: the checkout of a git entry before it's saved
+//   <entry>.digest.tmp: the record of an entry before it's written
+// empty if it isn't a temporary
+std::vector<std::filesystem::path> temporaryOwners(const std::filesystem::path &path)
+{
+    constexpr std::string_view tmpPrefix = "tmp_";
+    constexpr std::string_view tmpSuffix = ".tmp";
+    constexpr std::string_view recordSuffix = ".digest";
+
+    auto name = path.filename().string();
+    std::string_view view{ name };
+    if (view.substr(0, tmpPrefix.size()) == tmpPrefix) {
+        auto digest = view.substr(tmpPrefix.size());
+        if (!isHex(digest)) {
+            return {};
+        }
+
+        std::vector<std::filesystem::path> owners;
+        for (auto kind : { "archive_", "dsc_", "file_" }) {
+            owners.push_back(path.parent_path() / (kind + std::string{ digest }));
+        }
+        return owners;
+    }
+
+    if (view.size() <= tmpSuffix.size()
+        || view.substr(view.size() - tmpSuffix.size()) != tmpSuffix) {
+        return {};
+    }
+    view.remove_suffix(tmpSuffix.size());
+    if (view.size() > recordSuffix.size()
+        && view.substr(view.size() - recordSuffix.size()) == recordSuffix) {
+        view.remove_suffix(recordSuffix.size());
+    }
+    if (!isEntryName(view)) {
+        return {};
+    }
+    return { path.parent_path() / std::string{ view } };
+}
+
+std::filesystem::path recordPath(const std::filesystem::path &entry)
+{
+    return entry.string() + ".digest";
+}
+
+std::filesystem::path lockPath(const std::filesystem::path &entry)
+{
+    return entry.string() + ".lock";
+}
+
+utils::error::Result<std::string> fileSha256(const std::filesystem::path &path) noexcept
+{
+    LINGLONG_TRACE(fmt::format("calculate digest of {}", path))
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd == -1) {
+        return LINGLONG_ERR(
+          fmt::format("failed to open {}: {}", path, common::error::errorString(errno)));
+    }
+    auto closeFd = utils::finally::finally([fd] {
+        ::close(fd);
+    });
+
+    digest::SHA256 sha256;
+    std::vector<std::byte> buf(1024 * 1024);
+    while (true) {
+        auto ret = ::read(fd, buf.data(), buf.size());
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ret == -1) {
+            return LINGLONG_ERR(
+              fmt::format("failed to read {}: {}", path, common::error::errorString(errno)));
+        }
+        if (ret == 0) {
+            break;
+        }
+
+        sha256.update(buf.data(), static_cast<std::size_t>(ret));
+    }
+
+    std::array<std::byte, 32> digest{};
+    sha256.final(digest.data());
+    return digest::to_hex(digest);
+}
+
+// the digest of a file is the sha256 of its content, the one of a tree covers everything of
+// the tree except timestamps
+utils::error::Result<std::string> entryDigest(const std::filesystem::path &entry) noexcept
+{
+    LINGLONG_TRACE(fmt::format("calculate digest of entry {}", entry))
+
+    std::error_code ec;
+    auto status = std::filesystem::symlink_status(entry, ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("failed to get status of {}", entry), ec);
+    }
+    if (status.type() == std::filesystem::file_type::regular) {
+        return fileSha256(entry);
+    }
+    if (status.type() == std::filesystem::file_type::directory) {
+        return package::erofsTreeDigest(entry);
+    }
+
+    return LINGLONG_ERR(fmt::format("{} is neither a file nor a directory", entry));
+}
+
+utils::error::Result<std::uint64_t> entrySize(const std::filesystem::path &entry) noexcept
+{
+    LINGLONG_TRACE(fmt::format("calculate size of entry {}", entry))
+
+    std::error_code ec;
+    if (std::filesystem::is_directory(entry, ec)) {
+        auto size = utils::calculateDirectorySize(entry);
+        if (!size) {
+            return LINGLONG_ERR(size);
+        }
+        return *size;
+    }
+
+    auto size = std::filesystem::file_size(entry, ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("failed to get size of {}", entry), ec);
+    }
+    return size;
+}
+
+struct Record
+{
+    std::string digest;
+    std::uint64_t size{ 0 };
+};
+
+// the record is "<digest>\n<size>\n"
+std::optional<Record> readRecord(const std::filesystem::path &entry) noexcept
+{
+    std::ifstream in(recordPath(entry));
+    Record record;
+    if (!(in >> record.digest >> record.size)) {
+        return std::nullopt;
+    }
+    return record;
+}
+
+utils::error::Result<void> writeRecord(const std::filesystem::path &entry,
+                                       const Record &record) noexcept
+{
+    LINGLONG_TRACE(fmt::format("record digest of entry {}", entry))
+
+    auto record_path = recordPath(entry);
+    auto tmp = record_path.string() + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << record.digest << '\n' << record.size << '\n';
+        if (!out.flush()) {
+            return LINGLONG_ERR(fmt::format("failed to write {}", tmp));
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, record_path, ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("failed to rename {} to {}", tmp, record_path), ec);
+    }
+    return LINGLONG_OK;
+}
+
+void removeEntry(const std::filesystem::path &entry) noexcept
+{
+    // the lock file is kept, another process may be waiting for it
+    std::error_code ec;
+    std::filesystem::remove(recordPath(entry), ec);
+    if (ec) {
+        LogW("failed to remove {}: {}", recordPath(entry), ec.message());
+    }
+    std::filesystem::remove_all(entry, ec);
+    if (ec) {
+        LogW("failed to remove {}: {}", entry, ec.message());
+    }
+}
+
+} // namespace
+
+SourceCache::Entry::Entry(std::filesystem::path path, utils::filelock::FileLock lock) noexcept
+    : entryPath(std::move(path))
+    , lock(std::move(lock))
+{
+}
+
+SourceCache::Entry::~Entry()
+{
+    std::lock_guard guard(fileLockMutex());
+    this->lock.reset();
+}
+
+utils::error::Result<void> SourceCache::Entry::commit() noexcept
+{
+    LINGLONG_TRACE(fmt::format("commit entry {}", this->entryPath))
+
+    std::error_code ec;
+    if (!std::filesystem::exists(this->entryPath, ec)) {
+        return LINGLONG_OK;
+    }
+
+    if (!readRecord(this->entryPath)) {
+        auto digest = entryDigest(this->entryPath);
+        if (!digest) {
+            return LINGLONG_ERR(digest);
+        }
+        auto size = entrySize(this->entryPath);
+        if (!size) {
+            return LINGLONG_ERR(size);
+        }
+        return writeRecord(this->entryPath, { .digest = std::move(digest).value(), .size = *size });
+    }
+
+    // the record is written once, its mtime is the last time the entry is used
+    std::filesystem::last_write_time(recordPath(this->entryPath),
+                                     std::filesystem::file_time_type::clock::now(),
+                                     ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("failed to touch {}", recordPath(this->entryPath)), ec);
+    }
+    return LINGLONG_OK;
+}
+
+utils::error::Result<SourceCache::Entry>
+SourceCache::lockEntry(const std::filesystem::path &path) noexcept
+{
+    LINGLONG_TRACE(fmt::format("lock entry {}", path))
+
+    std::lock_guard guard(fileLockMutex());
+    auto lock = utils::filelock::FileLock::create(lockPath(path));
+    if (!lock) {
+        return LINGLONG_ERR(lock);
+    }
+    return Entry(path, std::move(lock).value());
+}
+
+SourceCache::SourceCache(std::filesystem::path dir) noexcept
+    : dir(std::move(dir))
+{
+}
+
+std::filesystem::path SourceCache::defaultDirectory() noexcept
+{
+    auto cacheHome = common::xdg::getXDGCacheHomeDir();
+    if (cacheHome.empty()) {
+        return {};
+    }
+    return cacheHome / "linglong" / "sources";
+}
+
+std::optional<std::string>
+SourceCache::entryName(const api::types::v1::BuilderProjectSource &source) noexcept
+{
+    if (!source.url) {
+        return std::nullopt;
+    }
+
+    if (source.kind == "git") {
+        // a branch or a tag may be moved, only commits are cached
+        if (!source.commit || !isHex(*source.commit)
+            || (source.commit->size() != 40 && source.commit->size() != 64)) { // NOLINT
+            return std::nullopt;
+        }
+
+        digest::SHA256 sha256;
+        sha256.update(reinterpret_cast<const std::byte *>(source.url->data()), source.url->size());
+        std::array<std::byte, 32> urlDigest{};
+        sha256.final(urlDigest.data());
+        auto name = fmt::format("git_{}_{}", digest::to_hex(urlDigest), *source.commit);
+        if (!source.submodules.value_or(true)) {
+            name += "_nosubmodules";
+        }
+        return name;
+    }
+
+    if (source.kind != "archive" && source.kind != "dsc" && source.kind != "file") {
+        return std::nullopt;
+    }
+    if (!source.digest || !isHex(*source.digest) || source.digest->size() != 64) { // NOLINT
+        return std::nullopt;
+    }
+    return source.kind + "_" + *source.digest;
+}
+
+utils::error::Result<SourceCache::Entry> SourceCache::open(const std::string &name) noexcept
+{
+    LINGLONG_TRACE(fmt::format("open entry {} of source cache {}", name, this->dir))
+
+    if (!isEntryName(name)) {
+        return LINGLONG_ERR("invalid entry name");
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(this->dir, ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("failed to create {}", this->dir), ec);
+    }
+
+    auto path = this->dir / name;
+    auto entry = lockEntry(path);
+    if (!entry) {
+        return LINGLONG_ERR(entry);
+    }
+    auto ret = entry->lock->lock(utils::filelock::LockType::Write);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    if (!std::filesystem::exists(path, ec)) {
+        return entry;
+    }
+
+    // the name of a file is its digest. the record of a tree is written after it's fetched, a tree
+    // without one is left by an interrupted build or an older version, it can't be checked and is
+    // fetched again
+    std::optional<std::string> expected;
+    if (name.rfind("file_", 0) == 0) {
+        expected = name.substr(std::string_view{ "file_" }.size());
+    } else if (auto record = readRecord(path); record) {
+        expected = std::move(record->digest);
+    }
+
+    if (!expected) {
+        LogW("entry {} of source cache isn't recorded, fetch it again", path);
+    } else if (auto digest = entryDigest(path); !digest) {
+        LogW("failed to check entry {} of source cache: {}", path, digest.error());
+    } else if (*digest != *expected) {
+        LogW("entry {} of source cache is corrupted, its digest is {} rather than {}",
+             path,
+             *digest,
+             *expected);
+    } else {
+        return entry;
+    }
+
+    // commit() records whatever is left, the entry mustn't be reused without being checked
+    removeEntry(path);
+    if (std::filesystem::exists(path, ec)) {
+        return LINGLONG_ERR(fmt::format("failed to remove unchecked entry {}", path));
+    }
+    return entry;
+}
+
+utils::error::Result<std::uint64_t> SourceCache::evict(std::uint64_t maxSize) noexcept
+{
+    LINGLONG_TRACE(fmt::format("evict entries of source cache {}", this->dir))
+
+    struct Candidate
+    {
+        std::filesystem::path path;
+        std::uint64_t size{ 0 };
+        std::filesystem::file_time_type lastUse;
+    };
+
+    std::error_code ec;
+    if (!std::filesystem::exists(this->dir, ec)) {
+        return 0;
+    }
+
+    std::vector<Candidate> candidates;
+    std::vector<Candidate> temporaries;
+    std::uint64_t total{ 0 };
+    for (const auto &item : std::filesystem::directory_iterator{ this->dir, ec }) {
+        if (!isEntryName(item.path().filename().string())) {
+            if (!temporaryOwners(item.path()).empty()) {
+                auto size = entrySize(item.path());
+                temporaries.push_back({ .path = item.path(), .size = size ? *size : 0 });
+            }
+            continue;
+        }
+
+        // entries without records are left by interrupted builds or older versions
+        Candidate candidate;
+        candidate.path = item.path();
+        std::error_code timeEc;
+        if (auto record = readRecord(item.path()); record) {
+            candidate.size = record->size;
+            candidate.lastUse = std::filesystem::last_write_time(recordPath(item.path()), timeEc);
+        } else {
+            auto size = entrySize(item.path());
+            candidate.size = size ? *size : 0;
+            candidate.lastUse = std::filesystem::last_write_time(item.path(), timeEc);
+        }
+        total += candidate.size;
+        candidates.push_back(std::move(candidate));
+    }
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("failed to list {}", this->dir), ec);
+    }
+
+    // a temporary is stale unless the fetch of its entry is running, which holds the lock
+    std::uint64_t freed{ 0 };
+    for (const auto &temporary : temporaries) {
+        std::vector<Entry> owners;
+        for (const auto &owner : temporaryOwners(temporary.path)) {
+            auto entry = lockEntry(owner);
+            if (!entry) {
+                LogW("failed to lock entry {}: {}", owner, entry.error());
+                break;
+            }
+
+            auto locked = entry->lock->tryLock(utils::filelock::LockType::Write);
+            if (!locked || !*locked) {
+                break;
+            }
+            owners.push_back(std::move(entry).value());
+        }
+
+        if (owners.size() != temporaryOwners(temporary.path).size()) {
+            LogD("temporary {} is in use, skip it", temporary.path);
+            total += temporary.size;
+            continue;
+        }
+
+        LogD("remove stale temporary {} of {} bytes", temporary.path, temporary.size);
+        std::filesystem::remove_all(temporary.path, ec);
+        if (ec) {
+            LogW("failed to remove {}: {}", temporary.path, ec.message());
+            total += temporary.size;
+            continue;
+        }
+        freed += temporary.size;
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.lastUse < b.lastUse;
+    });
+
+    for (const auto &candidate : candidates) {
+        if (total <= maxSize) {
+            break;
+        }
+
+        auto entry = lockEntry(candidate.path);
+        if (!entry) {
+            LogW("failed to lock entry {}: {}", candidate.path, entry.error());
+            continue;
+        }
+
+        auto locked = entry->lock->tryLock(utils::filelock::LockType::Write);
+        if (!locked || !*locked) {
+            LogD("entry {} is in use, skip it", candidate.path);
+            continue;
+        }
+
+        LogD("evict entry {} of {} bytes", candidate.path, candidate.size);
+        removeEntry(candidate.path);
+        total -= candidate.size;
+        freed += candidate.size;
+    }
+
+    return freed;
+}
+
+std::optional<std::uint64_t> parseCacheSize(const std::string &size) noexcept
+{
+    std::size_t digits{ 0 };
+    std::uint64_t value{ 0 };
+    for (; digits < size.size() && size[digits] >= '0' && size[digits] <= '9'; ++digits) {
+        auto digit = static_cast<std::uint64_t>(size[digits] - '0');
+        if (value > (std::numeric_limits<std::uint64_t>::max() - digit) / 10) { // NOLINT
+            return std::nullopt;
+        }
+        value = value * 10 + digit; // NOLINT
+    }
+    if (digits == 0 || size.size() > digits + 1) {
+        return std::nullopt;
+    }
+    if (digits == size.size()) {
+        return value;
+    }
+
+    constexpr std::string_view suffixes = "KMGT";
+    auto pos = suffixes.find(static_cast<char>(std::toupper(size.back())));
+    if (pos == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    auto shift = 10 * (pos + 1); // NOLINT
+    if (value > (std::numeric_limits<std::uint64_t>::max() >> shift)) {
+        return std::nullopt;
+    }
+    return value << shift;
+}
+
+} // namespace linglong::builder
@@ -0,0 +1,89 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/api/types/v1/BuilderProjectSource.hpp"
+#include "linglong/utils/error/error.h"
+#include "linglong/utils/filelock.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+
+namespace linglong::builder {
+
+// The cache of fetched sources, which is shared by all projects of the user. Entries are keyed by
+// what the source is, not where it's built:
+//   archive_<digest>, dsc_<digest>: the extracted tree of the archive of the declared digest
+//   file_<digest>: the file of the declared digest
+//   git_<sha256 of url>_<commit>: the checkout of the commit, with its submodules, the entry of a
+//   checkout without submodules ends with _nosubmodules
+// the fetch scripts create the entries and copy them out, trees are copied by reflinks if the
+// filesystem supports them, files by hardlinks.
+//
+// Every entry has a lock file <entry>.lock, which is locked while it's fetched or copied out, and
+// a record <entry>.digest of its digest and size. The digest is checked whenever the entry is
+// reused, the mtime of the record is the last time the entry was used.
+class SourceCache
+{
+public:
+    // an entry locked for writing, the lock is released when it's destroyed
+    class Entry
+    {
+    public:
+        Entry(const Entry &) = delete;
+        Entry &operator=(const Entry &) = delete;
+        Entry(Entry &&) noexcept = default;
+        Entry &operator=(Entry &&) noexcept = delete;
+        ~Entry();
+
+        [[nodiscard]] const std::filesystem::path &path() const noexcept { return entryPath; }
+
+        // record the digest of a new entry and the time it's used, nothing is recorded if the
+        // entry doesn't exist, e.g. the source isn't cached. an entry which exists when it's
+        // opened is checked by open(), so what isn't recorded yet is fetched under the lock
+        utils::error::Result<void> commit() noexcept;
+
+    private:
+        friend class SourceCache;
+
+        Entry(std::filesystem::path path, utils::filelock::FileLock lock) noexcept;
+
+        std::filesystem::path entryPath;
+        std::optional<utils::filelock::FileLock> lock;
+    };
+
+    explicit SourceCache(std::filesystem::path dir) noexcept;
+
+    // $XDG_CACHE_HOME/linglong/sources
+    static std::filesystem::path defaultDirectory() noexcept;
+
+    // the name of the entry of the source, nullopt if the source isn't cached, e.g. the commit of
+    // a git source is a branch rather than a hash
+    static std::optional<std::string>
+    entryName(const api::types::v1::BuilderProjectSource &source) noexcept;
+
+    // lock the entry, the entry is removed if its content doesn't match its digest any more or
+    // it's a tree without a record, so it's fetched again
+    utils::error::Result<Entry> open(const std::string &name) noexcept;
+
+    // remove the least recently used entries until the size of the cache isn't greater than
+    // maxSize, entries which are in use are skipped. temporaries left by interrupted fetches are
+    // always removed. returns the size which is freed.
+    utils::error::Result<std::uint64_t> evict(std::uint64_t maxSize) noexcept;
+
+    [[nodiscard]] const std::filesystem::path &directory() const noexcept { return dir; }
+
+private:
+    static utils::error::Result<Entry> lockEntry(const std::filesystem::path &path) noexcept;
+
+    std::filesystem::path dir;
+};
+
+// the size limit of the cache, like 10G, suffixes K, M, G and T are powers of 1024
+std::optional<std::uint64_t> parseCacheSize(const std::string &size) noexcept;
+
+} // namespace linglong::builder
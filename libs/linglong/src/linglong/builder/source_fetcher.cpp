@@ -7,6 +7,8 @@
 #include "source_fetcher.h"
 
 #include "configure.h"
+#include "linglong/builder/printer.h"
+#include "linglong/builder/source_cache.h"
 #include "linglong/common/formatter.h"
 #include "linglong/common/global/initialize.h"
 #include "linglong/utils/error/error.h"
@@ -15,8 +17,48 @@
 #include <QDir>
 #include <QTemporaryDir>
 
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+
 namespace linglong::builder {
 
+namespace {
+
+// the destination directory and the entry of the cache which the script of the source writes to
+std::vector<std::string> sourceOutputs(SourceFetcher &fetcher)
+{
+    const auto &source = fetcher.getSource();
+    std::vector<std::string> outputs{ "name:" + fetcher.getSourceName().toStdString() };
+    if (source.kind == "git") {
+        outputs.emplace_back("url:" + source.url.value_or(""));
+    } else if (source.digest) {
+        outputs.emplace_back("digest:" + *source.digest);
+    }
+
+    return outputs;
+}
+
+void printSourceStatus(std::size_t pos, const SourceFetcher &fetcher, const std::string &status)
+{
+    const auto &source = fetcher.getSource();
+    auto url = source.url.value_or("");
+    if (url.length() > 75) {                         // NOLINT
+        url = "..." + url.substr(url.length() - 70); // NOLINT
+    }
+    printReplacedText(fmt::format("{:<20}{:<15}{:<75}{}\n",
+                                  "Source " + std::to_string(pos),
+                                  source.kind,
+                                  url,
+                                  status),
+                      2);
+}
+
+} // namespace
+
 auto SourceFetcher::fetch(QDir destination) noexcept -> utils::error::Result<void>
 {
     LINGLONG_TRACE("fetch source");
@@ -56,6 +98,16 @@ auto SourceFetcher::fetch(QDir destination) noexcept -> utils::error::Result<voi
         LogD("Dumping {} from qrc to {}", scriptName.toStdString(), scriptFile.toStdString());
         QFile::copy(":/scripts/" + scriptName, scriptFile);
     }
+    // the entry is locked until the source is copied out of it, so that a build in parallel
+    // neither fetches it at the same time nor evicts it
+    std::optional<SourceCache::Entry> cacheEntry;
+    if (auto name = SourceCache::entryName(this->source); name) {
+        auto entry = SourceCache(this->cacheDir.absolutePath().toStdString()).open(*name);
+        if (!entry) {
+            return LINGLONG_ERR("failed to open entry of source cache", entry);
+        }
+        cacheEntry.emplace(std::move(entry).value());
+    }
     if (source.kind == "git") {
         m_cmd->setEnv("GIT_SUBMODULES", source.submodules.value_or(true) ? "true" : "");
     }
@@ -70,6 +122,13 @@ auto SourceFetcher::fetch(QDir destination) noexcept -> utils::error::Result<voi
         return LINGLONG_ERR("stderr:", output);
     }
 
+    if (cacheEntry) {
+        auto ret = cacheEntry->commit();
+        if (!ret) {
+            LogW("failed to record entry of source cache: {}", ret.error());
+        }
+    }
+
     if (!dir.isNull()) {
         dir->remove();
     }
@@ -103,4 +162,113 @@ SourceFetcher::SourceFetcher(api::types::v1::BuilderProjectSource source, const
     Q_ASSERT(false);
 }
 
+utils::error::Result<void>
+fetchSources(std::vector<SourceFetcher> &fetchers, const QDir &destination, unsigned jobs) noexcept
+{
+    LINGLONG_TRACE("fetch sources to " + destination.absolutePath().toStdString());
+
+    const auto count = fetchers.size();
+    for (const auto &fetcher : fetchers) {
+        if (!fetcher.getSource().url.has_value()) {
+            return LINGLONG_ERR("source missing url");
+        }
+    }
+
+    // a source waits for the last former sources which write to the same places, which wait for
+    // the ones before them in turn
+    std::vector<std::vector<std::size_t>> formers(count);
+    std::map<std::string, std::size_t> lastWriters;
+    for (std::size_t pos = 0; pos < count; ++pos) {
+        for (auto &output : sourceOutputs(fetchers[pos])) {
+            auto [it, inserted] = lastWriters.try_emplace(std::move(output), pos);
+            if (!inserted) {
+                formers[pos].push_back(it->second);
+                it->second = pos;
+            }
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable finishedCond;
+    std::vector<bool> finished(count, false);
+    std::size_t next{ 0 };
+    std::size_t running{ 0 };
+    std::size_t completed{ 0 };
+    std::optional<std::size_t> failedPos;
+    std::optional<utils::error::Result<void>> failure;
+
+    auto printSummary = [&]() {
+        printReplacedText(
+          fmt::format("Fetching sources: {}/{} complete, {} running", completed, count, running),
+          2);
+    };
+
+    // sources are taken in order, so every source before the first failed one is fetched
+    auto worker = [&]() noexcept {
+        while (true) {
+            std::size_t pos{ 0 };
+            {
+                std::unique_lock lock(mutex);
+                if (next >= count || (failedPos && next > *failedPos)) {
+                    return;
+                }
+
+                pos = next++;
+                finishedCond.wait(lock, [&]() {
+                    return std::all_of(formers[pos].cbegin(),
+                                       formers[pos].cend(),
+                                       [&finished](std::size_t former) {
+                                           return finished[former];
+                                       });
+                });
+                if (failedPos && pos > *failedPos) {
+                    finished[pos] = true;
+                    finishedCond.notify_all();
+                    continue;
+                }
+
+                ++running;
+                printSummary();
+            }
+
+            auto ret = fetchers[pos].fetch(destination);
+
+            std::lock_guard lock(mutex);
+            --running;
+            ++completed;
+            finished[pos] = true;
+            printSourceStatus(pos, fetchers[pos], ret ? "complete" : "failed");
+            if (!ret && (!failedPos || pos < *failedPos)) {
+                failedPos = pos;
+                failure = std::move(ret);
+            }
+            printSummary();
+            finishedCond.notify_all();
+        }
+    };
+
+    jobs = static_cast<unsigned>(std::min<std::size_t>(std::max(1U, jobs), count));
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < jobs; ++i) {
+            workers.emplace_back(worker);
+        }
+    } catch (...) {
+        // fewer jobs are fine
+    }
+
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+    printReplacedText("");
+
+    if (failure) {
+        return LINGLONG_ERR(fmt::format("failed to fetch source {}", *failedPos),
+                            std::move(failure).value());
+    }
+
+    return LINGLONG_OK;
+}
+
 } // namespace linglong::builder
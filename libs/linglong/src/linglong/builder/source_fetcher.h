@@ -16,6 +16,9 @@
 #include <QObject>
 #include <QUrl>
 
+#include <memory>
+#include <vector>
+
 namespace linglong::builder {
 
 class SourceFetcher
@@ -27,11 +30,24 @@ public:
 
     void setCommand(std::shared_ptr<utils::Cmd> cmd) { this->m_cmd = cmd; }
 
-private:
+    [[nodiscard]] const api::types::v1::BuilderProjectSource &getSource() const noexcept
+    {
+        return this->source;
+    }
+
     QString getSourceName();
+
+private:
     QDir cacheDir;
     api::types::v1::BuilderProjectSource source;
     std::shared_ptr<utils::Cmd> m_cmd = std::make_shared<utils::Cmd>("sh");
 };
 
+// fetch sources to destination, at most jobs of them at the same time. sources which are fetched
+// to the same directory or share an entry of the cache are fetched one after another in their
+// order. if some of them fail, the error of the first failed one in the order of sources is
+// returned, the same as fetching them one by one, and the sources after it aren't fetched.
+utils::error::Result<void>
+fetchSources(std::vector<SourceFetcher> &fetchers, const QDir &destination, unsigned jobs) noexcept;
+
 } // namespace linglong::builder
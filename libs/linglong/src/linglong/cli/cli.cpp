@@ -33,14 +33,18 @@
 #include "linglong/package/reference.h"
 #include "linglong/package/version.h"
 #include "linglong/runtime/container_builder.h"
+#include "linglong/runtime/container_registry.h"
 #include "linglong/runtime/run_context.h"
+#include "linglong/runtime/run_context_cache.h"
 #include "linglong/utils/bash_command_helper.h"
+#include "linglong/utils/content_store.h"
 #include "linglong/utils/error/error.h"
 #include "linglong/utils/file.h"
 #include "linglong/utils/finally/finally.h"
 #include "linglong/utils/gettext.h"
 #include "linglong/utils/namespace.h"
 #include "linglong/utils/runtime_config.h"
+#include "linglong/utils/tracing.h"
 #include "linglong/utils/xdp.h"
 #include "ocppi/runtime/ExecOption.hpp"
 #include "ocppi/runtime/RunOption.hpp"
@@ -82,6 +86,7 @@
 
 #include <fcntl.h>
 #include <pwd.h>
+#include <signal.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -1183,29 +1188,19 @@ int Cli::run(const RunOptions &options)
 {
     LINGLONG_TRACE("command run");
 
-    auto userContainerDir = std::filesystem::path{ "/run/linglong" } / std::to_string(getuid());
-    if (auto ret = utils::ensureDirectory(userContainerDir); !ret) {
-        this->printer.printErr(ret.error());
-        return -1;
+    utils::tracing::Span runSpan{ "ll-cli run" };
+    if (utils::tracing::enabled()) {
+        // export the launch ID before any child process is started
+        LogD("launch ID: {}", utils::tracing::launchID());
     }
 
-    auto mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
-    auto pidFile = userContainerDir / std::to_string(getpid());
-    // placeholder file
-    auto fd = ::open(pidFile.c_str(), O_WRONLY | O_CREAT | O_EXCL, mode);
-    if (fd == -1) {
-        LogE("create file {} error: {}", pidFile, common::error::errorString(errno));
-        QCoreApplication::exit(-1);
+    // the entry is kept until this process exits, other processes know the container is
+    // running as long as it exists
+    auto registryEntry = runtime::ContainerRegistry{}.create(getuid());
+    if (!registryEntry) {
+        this->printer.printErr(registryEntry.error());
         return -1;
     }
-    ::close(fd);
-
-    QObject::connect(QCoreApplication::instance(), &QCoreApplication::aboutToQuit, [pidFile] {
-        std::error_code ec;
-        if (!std::filesystem::remove(pidFile, ec) && ec) {
-            LogE("failed to remove file {}: {}", pidFile.c_str(), ec.message());
-        }
-    });
 
     auto fuzzyRef = package::FuzzyReference::parse(options.appid);
     if (!fuzzyRef) {
@@ -1252,15 +1247,27 @@ int Cli::run(const RunOptions &options)
     }
 
     if (!nvidiaCdiFound) {
+        utils::tracing::Span span{ "detect drivers" };
         detectDrivers();
     }
 
-    auto runContext = std::make_unique<runtime::RunContext>(**repo);
-    auto res = runContext->resolve(*curAppRef, opts);
-    if (!res) {
-        handleCommonError(res.error());
+    // debug instance id is generated for each run, there is nothing to reuse
+    std::optional<runtime::RunContextCache> contextCache;
+    if (!options.debug) {
+        contextCache.emplace(runtime::RunContextCache::defaultCacheDir());
+    }
+
+    utils::tracing::Span resolveSpan{ "resolve run context" };
+    auto resolved = runtime::resolveRunContext(**repo,
+                                               *curAppRef,
+                                               opts,
+                                               contextCache ? &*contextCache : nullptr);
+    resolveSpan.end();
+    if (!resolved) {
+        handleCommonError(resolved.error());
         return -1;
     }
+    auto runContext = std::move(resolved).value();
 
     if (options.debug) {
         auto installRes = ensureBaseDevelopModule(*runContext);
@@ -1276,7 +1283,7 @@ int Cli::run(const RunOptions &options)
         }
 
         runContext = std::make_unique<runtime::RunContext>(**repo);
-        res = runContext->resolve(*curAppRef, opts);
+        auto res = runContext->resolve(*curAppRef, opts);
         if (!res) {
             handleCommonError(res.error());
             return -1;
@@ -1304,38 +1311,25 @@ int Cli::run(const RunOptions &options)
 
     // this lambda will dump reference of containerID, app, base and runtime to
     // /run/linglong/getuid()/getpid() to store these needed information
-    auto dumpContainerInfo = [&pidFile, &runContext, this]() -> bool {
+    auto dumpContainerInfo = [&registryEntry, &runContext, this]() -> bool {
         LINGLONG_TRACE("dump info")
-        std::error_code ec;
-        if (!std::filesystem::exists(pidFile, ec)) {
-            if (ec) {
-                LogE("couldn't get status of {}: {}", pidFile.c_str(), ec.message());
-                return false;
-            }
-
-            LogE("state file {} doesn't exist", pidFile.string());
-            return false;
-        }
-
-        std::ofstream stream{ pidFile };
-        if (!stream.is_open()) {
-            this->printer.printErr(
-              LINGLONG_ERRV(fmt::format("failed to open {}", pidFile.c_str())));
+        auto ret = registryEntry->update(runContext->stateInfo());
+        if (!ret) {
+            this->printer.printErr(LINGLONG_ERRV(ret));
             return false;
         }
-        stream << nlohmann::json(runContext->stateInfo());
-        stream.close();
 
         return true;
     };
 
-    auto containers = getCurrentContainers().value_or(std::vector<api::types::v1::CliContainer>{});
+    // only the container of this app is asked for its state
+    auto isCurrent = [&containerID, &curAppRef](const api::types::v1::CliContainer &container) {
+        return container.id == containerID && container.package == curAppRef->toString();
+    };
+    auto containers =
+      getCurrentContainers(isCurrent).value_or(std::vector<api::types::v1::CliContainer>{});
     for (const auto &container : containers) {
         LogD("found running container: {}", container.package);
-        if (container.id != containerID || container.package != curAppRef->toString()) {
-            continue;
-        }
-
         if (!dumpContainerInfo()) {
             return -1;
         }
@@ -1348,7 +1342,9 @@ int Cli::run(const RunOptions &options)
         break;
     }
 
+    utils::tracing::Span cacheSpan{ "ensure cache" };
     auto cacheRes = this->ensureCache(*runContext);
+    cacheSpan.end();
     if (!cacheRes) {
         this->printer.printErr(LINGLONG_ERRV(cacheRes));
         return -1;
@@ -1395,6 +1391,7 @@ int Cli::run(const RunOptions &options)
         }
         argPointers.push_back(nullptr);
 
+        utils::tracing::Span namespaceSpan{ "run in namespace" };
         auto runRes = linglong::utils::runInNamespace(static_cast<int>(args.size()),
                                                       argPointers.data(),
                                                       geteuid(),
@@ -1414,6 +1411,8 @@ int Cli::runWithContext(const RunOptions &options)
 {
     LINGLONG_TRACE("command run with context");
 
+    utils::tracing::Span runSpan{ "ll-cli run with context" };
+
     if (!options.runContext) {
         this->printer.printErr(LINGLONG_ERRV("run context is required"));
         return -1;
@@ -1535,7 +1534,9 @@ int Cli::runResolvedContext(runtime::RunContext &runContext,
         runOptions.disableXdp = true;
     }
 
+    utils::tracing::Span createSpan{ "create container" };
     auto container = this->containerBuilder.createRunContainer(runContext, runOptions);
+    createSpan.end();
     if (!container) {
         this->printer.printErr(container.error());
         return -1;
@@ -1601,69 +1602,64 @@ int Cli::enter(const EnterOptions &options)
     return 0;
 }
 
-utils::error::Result<std::vector<api::types::v1::CliContainer>>
-Cli::getCurrentContainers() const noexcept
+utils::error::Result<std::vector<api::types::v1::CliContainer>> Cli::getCurrentContainers(
+  const std::function<bool(const api::types::v1::CliContainer &)> &filter) const noexcept
 {
     LINGLONG_TRACE("get current running containers")
 
-    auto containersRet = this->ociCLI.list();
-    if (!containersRet) {
-        return LINGLONG_ERR(containersRet);
+    auto registered = runtime::ContainerRegistry{}.list(::getuid());
+    if (!registered) {
+        return LINGLONG_ERR(registered);
     }
-    auto containers = std::move(containersRet).value();
 
+    // the OCI runtime is only asked if a container doesn't have a pid file, e.g. it is started
+    // by a former version, or the runtime doesn't support --pid-file. The pid is saved to the pid
+    // file then, so that the runtime is asked once per container
     std::vector<api::types::v1::CliContainer> myContainers;
-    auto infoDir = std::filesystem::path{ "/run/linglong" } / std::to_string(::getuid());
-
-    std::error_code ec;
-    auto it = std::filesystem::directory_iterator{ infoDir, ec };
-    if (ec) {
-        if (ec == std::errc::no_such_file_or_directory) {
-            return myContainers;
-        }
-
-        return LINGLONG_ERR(fmt::format("failed to list {}", infoDir), ec);
-    }
-
-    for (const auto &pidFile : it) {
-        const auto &file = pidFile.path();
-        const auto &process = "/proc" / file.filename();
-
-        std::error_code ec;
-        if (!std::filesystem::exists(process, ec)) {
-            // this process may exit abnormally, skip it.
-            LogD("{} doesn't exist", process.string());
+    for (auto &container : *registered) {
+        auto &info = container.info;
+        if (container.owner == ::getpid()) {
             continue;
         }
 
-        if (pidFile.file_size(ec) == 0) {
+        api::types::v1::CliContainer current{
+            .id = std::move(info.containerID),
+            .package = !info.app.empty()
+              ? info.app
+              : (info.runtime && !info.runtime->empty() ? *info.runtime : info.base),
+            .pid = 0,
+        };
+        if (filter && !filter(current)) {
             continue;
         }
 
-        auto info = linglong::utils::serialize::LoadJSONFile<
-          linglong::api::types::v1::ContainerProcessStateInfo>(file);
-        if (!info) {
-            LogD("load info from {}: {}", file.string(), info.error());
-            continue;
+        auto bundle = common::dir::getBundleDir(current.id);
+        std::optional<int64_t> pid = runtime::ContainerRegistry::containerPid(bundle);
+        if (!pid) {
+            auto state = this->ociCLI.state(current.id);
+            if (!state || !state->pid) {
+                // it's not fully started yet or exiting
+                LogD("couldn't get state of container {} of process {}",
+                     current.id,
+                     container.owner);
+                continue;
+            }
+            pid = state->pid;
+
+            auto ret = runtime::ContainerRegistry::saveContainerPid(bundle, *pid);
+            if (!ret) {
+                LogD("failed to save pid of container {}: {}", current.id, ret.error());
+            }
         }
 
-        auto container = std::find_if(containers.begin(),
-                                      containers.end(),
-                                      [&info](const ocppi::types::ContainerListItem &item) {
-                                          return item.id == info->containerID;
-                                      });
-        if (container == containers.cend()) {
-            LogD("couldn't find container that process {} belongs to", file.filename().string());
+        // the container is exiting, its owner hasn't removed the entry yet
+        if (::kill(static_cast<pid_t>(*pid), 0) != 0 && errno == ESRCH) {
+            LogD("process {} of container {} has exited", *pid, current.id);
             continue;
         }
 
-        myContainers.emplace_back(api::types::v1::CliContainer{
-          .id = std::move(info->containerID),
-          .package = !info->app.empty()
-            ? info->app
-            : (info->runtime && !info->runtime->empty() ? *info->runtime : info->base),
-          .pid = container->pid,
-        });
+        current.pid = *pid;
+        myContainers.emplace_back(std::move(current));
     }
 
     return myContainers;
@@ -1708,28 +1704,28 @@ utils::error::Result<std::vector<std::string>> Cli::getRunningAppContainers(cons
     LINGLONG_TRACE("get app running containers");
 
     std::vector<std::string> containerIDList{};
-    auto containers = getCurrentContainers();
+    auto containers =
+      getCurrentContainers([this, &id](const api::types::v1::CliContainer &container) {
+          // first check if the id matches container id, then check if the id matches package
+          // appid or reference
+          if (isContainerIDMatch(container.id, id)) {
+              return true;
+          }
+
+          auto ref = package::Reference::parse(container.package);
+          if (!ref) {
+              LogW("{}", ref.error());
+              return false;
+          }
+
+          return ref->id == id || ref->toString() == id;
+      });
     if (!containers) {
         return LINGLONG_ERR(containers);
     }
 
     for (const auto &container : *containers) {
-        // first check if the id matches container id, then check if the id matches package appid or
-        // reference
-        if (isContainerIDMatch(container.id, id)) {
-            containerIDList.emplace_back(container.id);
-            continue;
-        }
-
-        auto ref = package::Reference::parse(container.package);
-        if (!ref) {
-            LogW("{}", ref.error());
-            continue;
-        }
-
-        if (ref->id == id || ref->toString() == id) {
-            containerIDList.emplace_back(container.id);
-        }
+        containerIDList.emplace_back(container.id);
     }
 
     if (containerIDList.size() > 1) {
@@ -2093,6 +2089,11 @@ int Cli::prune()
 {
     LINGLONG_TRACE("command prune");
 
+    // files of extracted UAB which were removed don't need their objects any more
+    if (auto dir = digest::ContentStore::default_directory(); dir) {
+        digest::ContentStore{ std::move(dir).value() }.prune();
+    }
+
     QEventLoop loop;
     QString jobIDReply = "";
     auto pkgMan = this->getPkgMan();
@@ -2319,7 +2320,21 @@ int Cli::size(const SizeOptions &options)
         return -1;
     }
 
-    this->printer.printModuleSizes(moduleSizes, calculatedSizes->actualTotalSize, *repoSize);
+    std::optional<Printer::ContentStoreUsage> storeUsage;
+    if (auto dir = digest::ContentStore::default_directory(); dir) {
+        auto usage = digest::ContentStore{ *dir }.usage();
+        storeUsage = Printer::ContentStoreUsage{
+          .path = dir->string(),
+          .objects = usage.objects,
+          .size = usage.size,
+          .logicalSize = usage.logicalSize,
+        };
+    }
+
+    this->printer.printModuleSizes(moduleSizes,
+                                   calculatedSizes->actualTotalSize,
+                                   *repoSize,
+                                   storeUsage);
     return 0;
 }
 
@@ -21,6 +21,8 @@
 
 #include <CLI/CLI.hpp>
 
+#include <functional>
+
 namespace linglong::runtime {
 class RunContext;
 }
@@ -240,8 +242,11 @@ private:
                                          const std::string &type);
     static void filterPackageInfosByVersion(
       std::map<std::string, std::vector<api::types::v1::PackageInfoV2>> &list) noexcept;
+    // the running containers of current user, the OCI runtime is only asked for those which
+    // pass the filter
     [[nodiscard]] utils::error::Result<std::vector<api::types::v1::CliContainer>>
-    getCurrentContainers() const noexcept;
+    getCurrentContainers(const std::function<bool(const api::types::v1::CliContainer &)> &filter =
+                           {}) const noexcept;
     int installFromFile(const QFileInfo &fileInfo,
                         const api::types::v1::CommonOptions &commonOptions);
     int setRepoConfig(const QVariantMap &config);
@@ -351,11 +351,23 @@ std::string formatSize(std::uint64_t size)
     return out.str();
 }
 
+// how many times the files would take the space if every one was a copy
+std::string formatRatio(std::uint64_t logicalSize, std::uint64_t actualSize)
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(2)
+        << (actualSize == 0 ? 1.0
+                            : static_cast<double>(logicalSize) / static_cast<double>(actualSize))
+        << 'x';
+    return out.str();
+}
+
 } // namespace
 
 void CLIPrinter::printModuleSizes(const std::vector<ModuleSizeInfo> &list,
                                   std::uint64_t actualTotalSize,
-                                  std::uint64_t repoSize)
+                                  std::uint64_t repoSize,
+                                  const std::optional<ContentStoreUsage> &store)
 {
     std::uint64_t totalExclusiveSize{ 0 };
     std::uint64_t totalSharedSize{ 0 };
@@ -386,7 +398,20 @@ void CLIPrinter::printModuleSizes(const std::vector<ModuleSizeInfo> &list,
               << _("Exclusive: ") << formatSize(totalExclusiveSize) << ", " << _("Shared: ")
               << formatSize(totalSharedSize) << ")" << std::endl
               << _("Calculated actual total size: ") << formatSize(actualTotalSize) << std::endl
+              << _("Deduplication ratio: ") << formatRatio(totalLogicalSize, actualTotalSize)
+              << std::endl
               << _("Repository real size: ") << formatSize(repoSize) << std::endl;
+
+    if (!store || store->objects == 0) {
+        return;
+    }
+
+    std::cout << std::endl
+              << _("Content store of extracted UAB: ") << store->path << std::endl
+              << _("Objects: ") << store->objects << ", " << _("Size: ") << formatSize(store->size)
+              << ", " << _("Logical size: ") << formatSize(store->logicalSize) << std::endl
+              << _("Deduplication ratio: ") << formatRatio(store->logicalSize, store->size)
+              << std::endl;
 }
 
 void CLIPrinter::printDepends(const std::vector<DependsNode> &trees)
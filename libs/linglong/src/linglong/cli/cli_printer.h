@@ -48,7 +48,8 @@ public:
     void printInspect(const api::types::v1::InspectResult &result) override;
     void printModuleSizes(const std::vector<ModuleSizeInfo> &list,
                           std::uint64_t actualTotalSize,
-                          std::uint64_t repoSize) override;
+                          std::uint64_t repoSize,
+                          const std::optional<ContentStoreUsage> &store) override;
     void printDepends(const std::vector<DependsNode> &trees) override;
     void printMessage(const std::string &message) override;
     void clearLine() override;
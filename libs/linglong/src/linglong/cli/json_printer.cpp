@@ -114,7 +114,8 @@ void JSONPrinter::printInspect(const api::types::v1::InspectResult &result)
 
 void JSONPrinter::printModuleSizes(const std::vector<ModuleSizeInfo> &list,
                                    std::uint64_t actualTotalSize,
-                                   std::uint64_t repoSize)
+                                   std::uint64_t repoSize,
+                                   const std::optional<ContentStoreUsage> &store)
 {
     std::uint64_t totalExclusiveSize{ 0 };
     std::uint64_t totalSharedSize{ 0 };
@@ -138,7 +139,7 @@ void JSONPrinter::printModuleSizes(const std::vector<ModuleSizeInfo> &list,
         });
     }
 
-    std::cout << nlohmann::json{
+    nlohmann::json result{
       { "modules", modules },
       { "calculatedLogicalSize",
         { { "exclusiveSize", totalExclusiveSize },
@@ -146,8 +147,17 @@ void JSONPrinter::printModuleSizes(const std::vector<ModuleSizeInfo> &list,
           { "logicalSize", totalLogicalSize } } },
       { "calculatedActualSize", actualTotalSize },
       { "repositoryRealSize", repoSize },
-    }.dump(4)
-              << std::endl;
+    };
+    if (store) {
+        result["contentStore"] = {
+            { "path", store->path },
+            { "objects", store->objects },
+            { "size", store->size },
+            { "logicalSize", store->logicalSize },
+        };
+    }
+
+    std::cout << result.dump(4) << std::endl;
 }
 
 void JSONPrinter::printDepends(const std::vector<DependsNode> &trees)
@@ -20,6 +20,7 @@
 
 #include <cstdint>
 #include <map>
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -61,6 +62,15 @@ public:
         std::uint64_t actualSize{ 0 };
     };
 
+    // files extracted from UAB which share the content store, see digest::ContentStore
+    struct ContentStoreUsage
+    {
+        std::string path;
+        std::uint64_t objects{ 0 };
+        std::uint64_t size{ 0 };
+        std::uint64_t logicalSize{ 0 };
+    };
+
     struct DependsNode
     {
         std::string ref;
@@ -90,7 +100,8 @@ public:
     virtual void printInspect(const api::types::v1::InspectResult &) = 0;
     virtual void printModuleSizes(const std::vector<ModuleSizeInfo> &list,
                                   std::uint64_t actualTotalSize,
-                                  std::uint64_t repoSize) = 0;
+                                  std::uint64_t repoSize,
+                                  const std::optional<ContentStoreUsage> &store) = 0;
     virtual void printDepends(const std::vector<DependsNode> &trees) = 0;
     virtual void printMessage(const std::string &message) = 0;
 
@@ -22,6 +22,12 @@ std::unique_ptr<ExtensionIf> ExtensionFactory::makeExtension(const std::string &
     return std::make_unique<ExtensionImplDummy>();
 }
 
+std::string ExtensionFactory::hostState()
+{
+    return std::string(ExtensionImplNVIDIADisplayDriver::Identify) + "="
+      + ExtensionImplNVIDIADisplayDriver::hostDriverEnable();
+}
+
 ExtensionImplNVIDIADisplayDriver::ExtensionImplNVIDIADisplayDriver()
 {
     driverName = hostDriverEnable();
@@ -28,6 +28,10 @@ class ExtensionFactory
 {
 public:
     static std::unique_ptr<ExtensionIf> makeExtension(const std::string &name);
+
+    // everything the extensions read from the host to decide whether they are enabled, it
+    // changes whenever an extension may be enabled differently, e.g. the driver is upgraded
+    static std::string hostState();
 };
 
 class ExtensionImplNVIDIADisplayDriver : public ExtensionIf
@@ -41,9 +45,10 @@ public:
 
     static constexpr auto Identify = "org.deepin.driver.display.nvidia";
 
-private:
-    std::string hostDriverEnable();
+    // the version of the NVIDIA driver of the host, like 550-120, empty if it isn't loaded
+    static std::string hostDriverEnable();
 
+private:
     std::string driverName;
 };
 
@@ -0,0 +1,357 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/package/erofs_builder.h"
+
+#include "linglong/common/error.h"
+#include "linglong/common/strings.h"
+#include "linglong/utils/cmd.h"
+#include "linglong/utils/finally/finally.h"
+#include "linglong/utils/log/log.h"
+#include "linglong/utils/merkle.h"
+#include "linglong/utils/sha256.h"
+
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+namespace linglong::package {
+
+namespace {
+
+struct TreeEntry
+{
+    std::string path;
+    struct stat st{};
+    // the target of symlink, the first path of hardlinks or the digest of regular file
+    std::string content;
+};
+
+utils::error::Result<std::string> fileDigest(const std::filesystem::path &path) noexcept
+{
+    LINGLONG_TRACE(fmt::format("calculate digest of {}", path))
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (fd == -1) {
+        return LINGLONG_ERR(
+          fmt::format("failed to open {}: {}", path, common::error::errorString(errno)));
+    }
+    auto closeFd = utils::finally::finally([fd] {
+        ::close(fd);
+    });
+
+    digest::SHA256 sha256;
+    std::vector<std::byte> buf(1024 * 1024);
+    while (true) {
+        auto ret = ::read(fd, buf.data(), buf.size());
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ret == -1) {
+            return LINGLONG_ERR(
+              fmt::format("failed to read {}: {}", path, common::error::errorString(errno)));
+        }
+        if (ret == 0) {
+            break;
+        }
+
+        sha256.update(buf.data(), static_cast<std::size_t>(ret));
+    }
+
+    std::array<std::byte, 32> result{};
+    sha256.final(result.data());
+    return digest::to_hex(result);
+}
+
+// name and value of every extended attribute, sorted by name
+std::string xattrsOf(const std::filesystem::path &path)
+{
+    auto size = ::llistxattr(path.c_str(), nullptr, 0);
+    if (size <= 0) {
+        return {};
+    }
+
+    std::string names(static_cast<std::size_t>(size), '\0');
+    size = ::llistxattr(path.c_str(), names.data(), names.size());
+    if (size <= 0) {
+        return {};
+    }
+    names.resize(static_cast<std::size_t>(size));
+
+    std::map<std::string, std::string> attrs;
+    for (std::size_t begin = 0; begin < names.size();) {
+        auto end = names.find('\0', begin);
+        auto name = names.substr(begin, end - begin);
+        begin = end == std::string::npos ? names.size() : end + 1;
+
+        std::string value;
+        auto length = ::lgetxattr(path.c_str(), name.c_str(), nullptr, 0);
+        if (length > 0) {
+            value.resize(static_cast<std::size_t>(length));
+            length = ::lgetxattr(path.c_str(), name.c_str(), value.data(), value.size());
+            value.resize(static_cast<std::size_t>(std::max<ssize_t>(length, 0)));
+        }
+        attrs.emplace(std::move(name), std::move(value));
+    }
+
+    std::string result;
+    for (const auto &[name, value] : attrs) {
+        result += fmt::format("{}:{}={}:", name.size(), name, value.size());
+        result += value;
+    }
+    return result;
+}
+
+} // namespace
+
+std::vector<std::string> mkfsErofsArgs(const ErofsBuildOptions &options,
+                                       const std::filesystem::path &image,
+                                       const std::filesystem::path &source,
+                                       bool supportWorkers)
+{
+    std::vector<std::string> args;
+    if (!options.compressor.empty()) {
+        // the "-zX,level" form is accepted by all versions of erofs-utils
+        args.emplace_back(options.compressionLevel
+                            ? fmt::format("-z{},{}", options.compressor, *options.compressionLevel)
+                            : "-z" + options.compressor);
+    }
+
+    if (!options.features.empty()) {
+        args.emplace_back(fmt::format("-E{}", fmt::join(options.features, ",")));
+    }
+
+    if (options.clusterSize) {
+        args.emplace_back(fmt::format("-C{}", *options.clusterSize));
+    }
+
+    // force 4096 block size, default is page size, loongarch64 uses 16384 which isn't supported
+    // by x86 and arm64
+    args.emplace_back("-b4096");
+
+    if (options.timestamp) {
+        args.emplace_back(fmt::format("-T{}", *options.timestamp));
+    }
+
+    if (!options.uuid.empty()) {
+        args.emplace_back("-U" + options.uuid);
+    }
+
+    if (supportWorkers) {
+        auto workers = options.workers;
+        if (workers == 0) {
+            workers = std::max(1U, std::thread::hardware_concurrency());
+        }
+        args.emplace_back(fmt::format("--workers={}", workers));
+    }
+
+    for (const auto &regex : options.excludeRegex) {
+        args.emplace_back("--exclude-regex=" + regex);
+    }
+
+    args.emplace_back(image);
+    args.emplace_back(source);
+    return args;
+}
+
+bool mkfsErofsSupportWorkers() noexcept
+{
+    // multithreaded compression is added in erofs-utils 1.8
+    static const bool supported = [] {
+        auto help = utils::Cmd("mkfs.erofs").exec({ "--help" });
+        return help && help->find("--workers") != std::string::npos;
+    }();
+
+    return supported;
+}
+
+std::string mkfsErofsVersion() noexcept
+{
+    static const std::string version = [] {
+        auto output = utils::Cmd("mkfs.erofs").exec({ "--version" });
+        return output ? std::string{ common::strings::trim(*output, " \n") } : std::string{};
+    }();
+
+    return version;
+}
+
+std::string erofsUuid(std::string_view digest)
+{
+    // the first 128 bits of the digest, marked as a custom (version 8) uuid of RFC 9562
+    std::string hex{ digest.substr(0, 32) };
+    hex.resize(32, '0');
+    hex[12] = '8';
+    hex[16] = "89ab"[std::string_view{ "0123456789abcdef" }.find(hex[16]) & 0x3];
+
+    return fmt::format("{}-{}-{}-{}-{}",
+                       hex.substr(0, 8),
+                       hex.substr(8, 4),
+                       hex.substr(12, 4),
+                       hex.substr(16, 4),
+                       hex.substr(20));
+}
+
+std::int64_t sourceDateEpoch() noexcept
+{
+    const auto *env = ::getenv("SOURCE_DATE_EPOCH");
+    if (env == nullptr) {
+        return 0;
+    }
+
+    std::string_view value{ env };
+    std::int64_t epoch{ 0 };
+    auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), epoch);
+    if (ec != std::errc{} || end != value.data() + value.size() || epoch < 0) {
+        LogW("invalid SOURCE_DATE_EPOCH {}, use 0 instead", value);
+        return 0;
+    }
+
+    return epoch;
+}
+
+utils::error::Result<std::string> erofsTreeDigest(const std::filesystem::path &source) noexcept
+{
+    LINGLONG_TRACE(fmt::format("calculate digest of tree {}", source))
+
+    try {
+        std::vector<TreeEntry> entries{ TreeEntry{ .path = "" } };
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(source, ec)) {
+            if (ec) {
+                break;
+            }
+            entries.push_back({ .path = entry.path().lexically_relative(source).string() });
+        }
+        if (ec) {
+            return LINGLONG_ERR(fmt::format("couldn't iterate directory {}", source), ec);
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const TreeEntry &a, const TreeEntry &b) {
+            return a.path < b.path;
+        });
+
+        // files of the tree which are hardlinks of each other are one inode of the image, the
+        // content of one of them is enough
+        std::map<std::pair<dev_t, ino_t>, std::string> inodes;
+        std::vector<TreeEntry *> files;
+        for (auto &entry : entries) {
+            auto path = source / entry.path;
+            if (::lstat(path.c_str(), &entry.st) == -1) {
+                return LINGLONG_ERR(
+                  fmt::format("failed to stat {}: {}", path, common::error::errorString(errno)));
+            }
+
+            if (S_ISLNK(entry.st.st_mode)) {
+                entry.content = std::filesystem::read_symlink(path).string();
+                continue;
+            }
+
+            if (!S_ISREG(entry.st.st_mode)) {
+                continue;
+            }
+
+            auto [it, inserted] =
+              inodes.try_emplace({ entry.st.st_dev, entry.st.st_ino }, entry.path);
+            if (!inserted) {
+                entry.content = "=" + it->second;
+                continue;
+            }
+            files.push_back(&entry);
+        }
+
+        // hash files by a pool of threads, like staging them
+        std::atomic_size_t next{ 0 };
+        std::atomic_bool failed{ false };
+        std::mutex mutex;
+        utils::error::Result<void> failure = LINGLONG_OK;
+        auto worker = [&]() noexcept {
+            for (auto index = next++; index < files.size() && !failed; index = next++) {
+                auto digest = fileDigest(source / files[index]->path);
+                if (digest) {
+                    files[index]->content = std::move(digest).value();
+                    continue;
+                }
+
+                std::lock_guard lock(mutex);
+                if (!failed.exchange(true)) {
+                    failure = LINGLONG_ERR(digest);
+                }
+            }
+        };
+
+        auto threads = static_cast<unsigned>(std::min<std::size_t>(
+          std::max(1U, std::thread::hardware_concurrency()), files.size()));
+        std::vector<std::thread> workers;
+        try {
+            for (unsigned i = 1; i < threads; ++i) {
+                workers.emplace_back(worker);
+            }
+        } catch (...) {
+            // fewer threads are fine
+        }
+
+        worker();
+        for (auto &thread : workers) {
+            thread.join();
+        }
+
+        if (!failure) {
+            return LINGLONG_ERR(failure);
+        }
+
+        digest::SHA256 sha256;
+        auto update = [&sha256](std::string_view data) {
+            sha256.update(reinterpret_cast<const std::byte *>(data.data()), data.size());
+        };
+        for (const auto &entry : entries) {
+            const auto &st = entry.st;
+            // sizes of directories depend on the filesystem the tree is staged to
+            auto size = S_ISDIR(st.st_mode) ? 0 : static_cast<std::uint64_t>(st.st_size);
+            auto rdev = S_ISCHR(st.st_mode) || S_ISBLK(st.st_mode) ? st.st_rdev : 0;
+            update(fmt::format("{}:{}", entry.path.size(), entry.path));
+            update(fmt::format(
+              " {:o} {} {} {} {} ", st.st_mode, st.st_uid, st.st_gid, size, rdev));
+            update(fmt::format("{}:{}", entry.content.size(), entry.content));
+            auto xattrs = xattrsOf(source / entry.path);
+            update(fmt::format("{}:{}", xattrs.size(), xattrs));
+            update("\n");
+        }
+
+        std::array<std::byte, 32> result{};
+        sha256.final(result.data());
+        return digest::to_hex(result);
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR("failed to calculate digest", e);
+    }
+}
+
+utils::error::Result<void> buildErofsImage(const std::filesystem::path &image,
+                                           const std::filesystem::path &source,
+                                           const ErofsBuildOptions &options) noexcept
+{
+    LINGLONG_TRACE(fmt::format("build erofs image {} from {}", image, source))
+
+    auto ret = utils::Cmd("mkfs.erofs")
+                 .exec(mkfsErofsArgs(options, image, source, mkfsErofsSupportWorkers()));
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    return LINGLONG_OK;
+}
+
+} // namespace linglong::package
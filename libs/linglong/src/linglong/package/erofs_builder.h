@@ -0,0 +1,69 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/utils/error/error.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace linglong::package {
+
+struct ErofsBuildOptions
+{
+    // lz4, lz4hc, lzma, zstd..., empty means uncompressed
+    std::string compressor;
+    // the level of the compressor, the default of mkfs.erofs is used if it's not set
+    std::optional<int> compressionLevel;
+    // the max size of a physical cluster (-C), larger clusters compress better but are slower
+    // to read randomly
+    std::optional<std::size_t> clusterSize;
+    // extended options (-E), e.g. fragments, dedupe, ztailpacking
+    std::vector<std::string> features;
+    std::vector<std::string> excludeRegex;
+    // threads to compress, 0 means the number of CPUs, it's ignored if mkfs.erofs doesn't
+    // support multithreaded compression
+    unsigned workers{ 0 };
+    // the timestamp of all files of the image (-T), so the image doesn't depend on the
+    // timestamps of the directory
+    std::optional<std::int64_t> timestamp;
+    // the uuid of the image (-U), mkfs.erofs generates a random one if it's empty
+    std::string uuid;
+};
+
+// the arguments of mkfs.erofs which builds image from the directory source
+std::vector<std::string> mkfsErofsArgs(const ErofsBuildOptions &options,
+                                       const std::filesystem::path &image,
+                                       const std::filesystem::path &source,
+                                       bool supportWorkers);
+
+// whether the mkfs.erofs in PATH supports --workers, it's checked once per process
+bool mkfsErofsSupportWorkers() noexcept;
+
+// the version of the mkfs.erofs in PATH, empty if it's not found
+std::string mkfsErofsVersion() noexcept;
+
+// an uuid derived from a hex digest, images built from the same tree get the same uuid
+std::string erofsUuid(std::string_view digest);
+
+// SOURCE_DATE_EPOCH of the environment, 0 if it's not set or invalid
+std::int64_t sourceDateEpoch() noexcept;
+
+// the sha256 of everything mkfs.erofs takes from the directory source: paths, types, permission
+// bits, owners, sizes, symlink targets, hardlinks, extended attributes and contents of files, so
+// images built from trees of the same digest by the same mkfs.erofs and arguments are
+// interchangeable. timestamps aren't part of it, a tree staged again from the same layers has the
+// same digest, images of it are only interchangeable if they're built with a fixed timestamp.
+utils::error::Result<std::string> erofsTreeDigest(const std::filesystem::path &source) noexcept;
+
+utils::error::Result<void> buildErofsImage(const std::filesystem::path &image,
+                                           const std::filesystem::path &source,
+                                           const ErofsBuildOptions &options) noexcept;
+
+} // namespace linglong::package
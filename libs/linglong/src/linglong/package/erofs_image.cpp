@@ -0,0 +1,1596 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/package/erofs_image.h"
+
+#include "linglong/common/error.h"
+#include "linglong/utils/file.h"
+#include "linglong/utils/finally/finally.h"
+
+#include <fmt/format.h>
+#include <lz4.h>
+#include <lzma.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <endian.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The on-disk format is described by fs/erofs/erofs_fs.h of the Linux kernel, the mapping of
+// compressed files follows fs/erofs/zmap.c.
+
+namespace linglong::package {
+
+namespace {
+
+constexpr std::uint32_t superBlockMagic = 0xE0F5E1E2;
+constexpr std::uint64_t superBlockOffset = 1024;
+constexpr std::size_t superBlockSize = 128;
+constexpr std::uint32_t nullAddress = 0xFFFFFFFF;
+constexpr unsigned inodeSlotBits = 5;
+
+constexpr std::uint32_t featureZeroPadding = 0x1;
+// it's also the feature of big pclusters
+constexpr std::uint32_t featureCompressionConfigs = 0x2;
+constexpr std::uint32_t featureZTailPacking = 0x10;
+// it's also the feature of deduplication
+constexpr std::uint32_t featureFragments = 0x20;
+// chunked files, compression head2, xattr prefixes... are supported as well
+constexpr std::uint32_t supportedFeatures = 0x7F;
+
+enum Layout : std::uint8_t {
+    FlatPlain = 0,
+    CompressedFull = 1,
+    FlatInline = 2,
+    CompressedCompact = 3,
+    ChunkBased = 4,
+};
+
+constexpr std::uint16_t chunkFormatBitsMask = 0x1F;
+constexpr std::uint16_t chunkFormatIndexes = 0x20;
+
+enum LClusterType : std::uint8_t {
+    Plain = 0,
+    Head1 = 1,
+    NonHead = 2,
+    Head2 = 3,
+};
+
+constexpr std::uint16_t d0CompressedBlocks = 1U << 11;
+
+constexpr std::uint16_t adviseCompacted2B = 0x1;
+constexpr std::uint16_t adviseBigPCluster1 = 0x2;
+constexpr std::uint16_t adviseBigPCluster2 = 0x4;
+constexpr std::uint16_t adviseInlinePCluster = 0x8;
+constexpr std::uint16_t adviseInterlacedPCluster = 0x10;
+constexpr std::uint16_t adviseFragmentPCluster = 0x20;
+
+enum Algorithm : std::uint8_t {
+    LZ4 = 0,
+    LZMA = 1,
+    AlgorithmMax = 4,
+    // uncompressed pclusters
+    Shifted = AlgorithmMax,
+    Interlaced,
+};
+
+constexpr std::uint16_t supportedAlgorithms = (1U << LZ4) | (1U << LZMA);
+constexpr std::size_t maxPClusterSize = 1024 * 1024;
+constexpr std::uint32_t lzmaMaxDictSize = 8 * maxPClusterSize;
+// an extent is decompressed into memory at once
+constexpr std::uint64_t maxExtentSize = 64 * 1024 * 1024;
+constexpr std::uint64_t maxDirSize = 1ULL << 30;
+constexpr std::uint64_t maxSmallFileSize = 16 * 1024 * 1024;
+
+std::uint16_t le16(const std::byte *p) noexcept
+{
+    std::uint16_t v{ 0 };
+    std::memcpy(&v, p, sizeof(v));
+    return le16toh(v);
+}
+
+std::uint32_t le32(const std::byte *p) noexcept
+{
+    std::uint32_t v{ 0 };
+    std::memcpy(&v, p, sizeof(v));
+    return le32toh(v);
+}
+
+std::uint64_t le64(const std::byte *p) noexcept
+{
+    std::uint64_t v{ 0 };
+    std::memcpy(&v, p, sizeof(v));
+    return le64toh(v);
+}
+
+std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment) noexcept
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool isCompressed(std::uint8_t layout) noexcept
+{
+    return layout == CompressedFull || layout == CompressedCompact;
+}
+
+std::string corrupted(const ErofsInode &inode, std::string_view what)
+{
+    return fmt::format("corrupted inode {}: {}", inode.nid, what);
+}
+
+} // namespace
+
+struct ErofsFile::Compressed
+{
+    struct Extent
+    {
+        std::uint64_t start{ 0 };
+        std::uint64_t length{ 0 };
+        std::uint64_t position{ 0 };
+        std::uint64_t compressedLength{ 0 };
+        std::uint8_t algorithm{ 0 };
+        bool fragment{ false };
+    };
+
+    // the state of looking up logical clusters, like z_erofs_maprecorder
+    struct Recorder
+    {
+        std::uint64_t lcn{ 0 };
+        std::uint8_t type{ 0 };
+        std::uint8_t headType{ 0 };
+        std::uint32_t clusterOffset{ 0 };
+        std::array<std::uint32_t, 2> delta{};
+        std::uint32_t pblk{ 0 };
+        std::uint32_t compressedBlocks{ 0 };
+        std::uint64_t nextPackOffset{ 0 };
+    };
+
+    utils::error::Result<void> init(const ErofsImage &image, const ErofsInode &inode) noexcept;
+    utils::error::Result<void> loadFull(const ErofsImage &image,
+                                        const ErofsInode &inode,
+                                        Recorder &m,
+                                        std::uint64_t lcn) const noexcept;
+    utils::error::Result<void> loadCompact(const ErofsImage &image,
+                                           const ErofsInode &inode,
+                                           Recorder &m,
+                                           std::uint64_t lcn,
+                                           bool lookahead) const noexcept;
+    utils::error::Result<void> load(const ErofsImage &image,
+                                    const ErofsInode &inode,
+                                    Recorder &m,
+                                    std::uint64_t lcn,
+                                    bool lookahead) const noexcept;
+    utils::error::Result<void> lookback(const ErofsImage &image,
+                                        const ErofsInode &inode,
+                                        Recorder &m,
+                                        Extent &extent,
+                                        std::uint32_t distance) const noexcept;
+    utils::error::Result<void> compressedLength(const ErofsImage &image,
+                                                const ErofsInode &inode,
+                                                Recorder &m,
+                                                Extent &extent) const noexcept;
+    utils::error::Result<void> decompressedLength(const ErofsImage &image,
+                                                  const ErofsInode &inode,
+                                                  Recorder &m,
+                                                  Extent &extent) const noexcept;
+    // the whole extent which contains offset, findTail is used by init only
+    utils::error::Result<Extent> map(const ErofsImage &image,
+                                     const ErofsInode &inode,
+                                     std::uint64_t offset,
+                                     bool findTail = false) noexcept;
+    utils::error::Result<void> decompress(const ErofsImage &image,
+                                          const ErofsInode &inode,
+                                          const Extent &extent) noexcept;
+
+    bool initialized{ false };
+    std::uint16_t advise{ 0 };
+    std::array<std::uint8_t, 2> algorithms{};
+    std::uint8_t lclusterBits{ 0 };
+    std::uint64_t tailHeadLcn{ 0 };
+    std::uint64_t inlineDataPosition{ 0 };
+    std::uint16_t inlineDataSize{ 0 };
+    std::uint64_t fragmentOffset{ 0 };
+
+    // the last decompressed extent
+    std::vector<std::byte> extent;
+    std::uint64_t extentStart{ 0 };
+    std::vector<std::byte> raw;
+    // the packed inode which holds fragments
+    std::unique_ptr<ErofsFile> packed;
+};
+
+utils::error::Result<std::unique_ptr<ErofsImage>> ErofsImage::open(int fd, off_t offset) noexcept
+{
+    LINGLONG_TRACE("open erofs image");
+
+    std::unique_ptr<ErofsImage> image{ new (std::nothrow) ErofsImage };
+    if (!image) {
+        return LINGLONG_ERR("out of memory");
+    }
+
+    image->fd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (image->fd == -1) {
+        return LINGLONG_ERR(fmt::format("dup error: {}", common::error::errorString(errno)));
+    }
+    image->offset = offset;
+
+    std::array<std::byte, superBlockSize> sb{};
+    auto ret = image->readAt(superBlockOffset, sb.data(), sb.size());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    if (le32(sb.data()) != superBlockMagic) {
+        return LINGLONG_ERR("not an erofs image");
+    }
+
+    image->blockBits = std::to_integer<std::uint8_t>(sb[12]);
+    if (image->blockBits < 9 || image->blockBits > 16) {
+        return LINGLONG_ERR(fmt::format("unsupported block size 2^{}", image->blockBits));
+    }
+
+    image->rootNid = le16(sb.data() + 14);
+    image->metaBlockAddress = le32(sb.data() + 40);
+    image->features = le32(sb.data() + 80);
+    if ((image->features & ~supportedFeatures) != 0) {
+        return LINGLONG_ERR(fmt::format("unsupported features {:#x}", image->features));
+    }
+
+    image->algorithms = 1U << LZ4;
+    if ((image->features & featureCompressionConfigs) != 0) {
+        image->algorithms = le16(sb.data() + 84);
+    }
+    if ((image->algorithms & ~supportedAlgorithms) != 0) {
+        return LINGLONG_ERR(
+          fmt::format("unsupported compression algorithms {:#x}", image->algorithms));
+    }
+
+    if (le16(sb.data() + 86) != 0) {
+        return LINGLONG_ERR("images with extra devices aren't supported");
+    }
+
+    image->dirBlockBits = std::to_integer<std::uint8_t>(sb[90]);
+    if (image->dirBlockBits > 4) {
+        return LINGLONG_ERR(fmt::format("unsupported directory block size 2^{}",
+                                        image->blockBits + image->dirBlockBits));
+    }
+
+    if ((image->features & featureFragments) != 0) {
+        image->packedNid = le64(sb.data() + 96);
+    }
+
+    return image;
+}
+
+ErofsImage::~ErofsImage()
+{
+    if (this->fd != -1) {
+        ::close(this->fd);
+    }
+}
+
+utils::error::Result<void>
+ErofsImage::readAt(std::uint64_t position, void *buf, std::size_t len) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("read {} bytes at {} of erofs image", len, position));
+
+    auto *out = static_cast<std::byte *>(buf);
+    while (len > 0) {
+        auto ret = ::pread(this->fd, out, len, this->offset + static_cast<off_t>(position));
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return LINGLONG_ERR(fmt::format("pread error: {}", common::error::errorString(errno)));
+        }
+        if (ret == 0) {
+            return LINGLONG_ERR("unexpected end of image");
+        }
+
+        out += ret;
+        len -= ret;
+        position += ret;
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<ErofsInode> ErofsImage::root() const noexcept
+{
+    return this->inode(this->rootNid);
+}
+
+utils::error::Result<ErofsInode> ErofsImage::inode(std::uint64_t nid) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("read inode {}", nid));
+
+    ErofsInode inode;
+    inode.nid = nid;
+    inode.position = (static_cast<std::uint64_t>(this->metaBlockAddress) << this->blockBits)
+      + (nid << inodeSlotBits);
+
+    // compact inodes take 32 bytes, extended ones take 64 bytes
+    std::array<std::byte, 64> raw{};
+    auto ret = this->readAt(inode.position, raw.data(), 32);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    auto format = le16(raw.data());
+    auto extended = (format & 1) != 0;
+    inode.layout = (format >> 1) & 7;
+    if (inode.layout > ChunkBased) {
+        return LINGLONG_ERR(fmt::format("unsupported data layout {}", inode.layout));
+    }
+
+    auto xattrCount = le16(raw.data() + 2);
+    inode.xattrSize = xattrCount == 0 ? 0 : 12 + (xattrCount - 1) * 4;
+    inode.mode = le16(raw.data() + 4);
+    inode.rawBlockAddress = le32(raw.data() + 16);
+    if (extended) {
+        ret = this->readAt(inode.position + 32, raw.data() + 32, 32);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        inode.inodeSize = 64;
+        inode.size = le64(raw.data() + 8);
+    } else {
+        inode.inodeSize = 32;
+        inode.size = le32(raw.data() + 8);
+    }
+
+    return inode;
+}
+
+utils::error::Result<ErofsInode>
+ErofsImage::lookup(const std::filesystem::path &path) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("look up {} in erofs image", path.string()));
+
+    auto current = this->root();
+    if (!current) {
+        return LINGLONG_ERR(current);
+    }
+
+    for (const auto &component : path.lexically_normal()) {
+        if (component.empty() || component == "." || component == "/") {
+            continue;
+        }
+        if (component == "..") {
+            return LINGLONG_ERR("'..' isn't allowed");
+        }
+
+        if (!S_ISDIR(current->mode)) {
+            return LINGLONG_ERR(fmt::format("inode {} isn't a directory", current->nid));
+        }
+
+        auto entries = this->readDir(*current);
+        if (!entries) {
+            return LINGLONG_ERR(entries);
+        }
+
+        auto entry = std::find_if(entries->cbegin(), entries->cend(), [&component](const auto &e) {
+            return e.name == component.string();
+        });
+        if (entry == entries->cend()) {
+            return LINGLONG_ERR(fmt::format("{} not found", component.string()), ENOENT);
+        }
+
+        current = this->inode(entry->nid);
+        if (!current) {
+            return LINGLONG_ERR(current);
+        }
+    }
+
+    return current;
+}
+
+utils::error::Result<std::vector<ErofsDirEntry>>
+ErofsImage::readDir(const ErofsInode &dir) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("read directory {}", dir.nid));
+
+    if (!S_ISDIR(dir.mode)) {
+        return LINGLONG_ERR("not a directory");
+    }
+    if (dir.size > maxDirSize) {
+        return LINGLONG_ERR(fmt::format("directory is too large: {}", dir.size));
+    }
+
+    std::vector<std::byte> data;
+    try {
+        data.resize(dir.size);
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    ErofsFile file{ *this, dir };
+    auto ret = file.readFully(0, data.data(), data.size());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    // every block starts with an array of erofs_dirent, which is followed by the names
+    constexpr std::size_t direntSize = 12;
+    const std::size_t blockSize = std::size_t{ 1 } << (this->blockBits + this->dirBlockBits);
+    std::vector<ErofsDirEntry> entries;
+    try {
+        for (std::size_t block = 0; block < data.size(); block += blockSize) {
+            const auto *base = data.data() + block;
+            const auto maxSize = std::min(blockSize, data.size() - block);
+            if (maxSize < direntSize) {
+                return LINGLONG_ERR(corrupted(dir, "truncated directory block"));
+            }
+
+            const std::size_t firstNameOffset = le16(base + 8);
+            if (firstNameOffset < direntSize || firstNameOffset >= maxSize
+                || firstNameOffset % direntSize != 0) {
+                return LINGLONG_ERR(corrupted(dir, "invalid name offset"));
+            }
+
+            const auto count = firstNameOffset / direntSize;
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto *dirent = base + i * direntSize;
+                const std::size_t nameOffset = le16(dirent + 8);
+                std::size_t nameEnd = maxSize;
+                if (i + 1 < count) {
+                    nameEnd = le16(dirent + direntSize + 8);
+                }
+                if (nameOffset >= nameEnd || nameEnd > maxSize) {
+                    return LINGLONG_ERR(corrupted(dir, "invalid name offset"));
+                }
+
+                const auto *name = reinterpret_cast<const char *>(base + nameOffset);
+                // the last name of a block may be padded by '\0'
+                std::string_view entryName{ name, ::strnlen(name, nameEnd - nameOffset) };
+                if (entryName.empty() || entryName.find('/') != std::string_view::npos) {
+                    return LINGLONG_ERR(corrupted(dir, "invalid name"));
+                }
+                if (entryName == "." || entryName == "..") {
+                    continue;
+                }
+
+                entries.push_back({ std::string{ entryName }, le64(dirent) });
+            }
+        }
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    return entries;
+}
+
+utils::error::Result<std::string> ErofsImage::readLink(const ErofsInode &link) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("read symlink {}", link.nid));
+
+    if (!S_ISLNK(link.mode)) {
+        return LINGLONG_ERR("not a symlink");
+    }
+    if (link.size == 0 || link.size >= PATH_MAX) {
+        return LINGLONG_ERR(corrupted(link, fmt::format("invalid target length {}", link.size)));
+    }
+
+    std::string target(link.size, '\0');
+    ErofsFile file{ *this, link };
+    auto ret = file.readFully(0, reinterpret_cast<std::byte *>(target.data()), target.size());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    return target;
+}
+
+utils::error::Result<std::string> ErofsImage::readFile(const ErofsInode &file) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("read file {}", file.nid));
+
+    if (!S_ISREG(file.mode)) {
+        return LINGLONG_ERR("not a regular file");
+    }
+    if (file.size > maxSmallFileSize) {
+        return LINGLONG_ERR(fmt::format("file is too large: {}", file.size));
+    }
+
+    std::string content(file.size, '\0');
+    ErofsFile reader{ *this, file };
+    auto ret = reader.readFully(0, reinterpret_cast<std::byte *>(content.data()), content.size());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    return content;
+}
+
+utils::error::Result<void> ErofsImage::extract(const ErofsInode &dir,
+                                               const std::filesystem::path &destination,
+                                               unsigned threads) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("extract erofs image to {}", destination.string()));
+
+    struct Task
+    {
+        ErofsInode inode;
+        std::filesystem::path path;
+    };
+
+    std::vector<Task> files;
+    // a file with more than one link is written once, others are linked to it
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> links;
+    // directories are writable until their content is extracted
+    std::vector<Task> dirs;
+
+    try {
+        std::unordered_map<std::uint64_t, std::filesystem::path> extracted;
+        // directories can't be hard linked, a directory which is reached twice is linked by a
+        // crafted entry, e.g. to its ancestor, and it would be extracted forever
+        std::unordered_set<std::uint64_t> extractedDirs{ dir.nid };
+        std::vector<Task> pending{ { dir, destination } };
+        while (!pending.empty()) {
+            auto current = std::move(pending.back());
+            pending.pop_back();
+
+            auto entries = this->readDir(current.inode);
+            if (!entries) {
+                return LINGLONG_ERR(entries);
+            }
+
+            for (const auto &entry : *entries) {
+                auto inode = this->inode(entry.nid);
+                if (!inode) {
+                    return LINGLONG_ERR(inode);
+                }
+
+                auto path = current.path / entry.name;
+                if (S_ISDIR(inode->mode)) {
+                    if (!extractedDirs.insert(inode->nid).second) {
+                        return LINGLONG_ERR(
+                          fmt::format("directory {} is linked more than once", path.string()));
+                    }
+                    if (::mkdir(path.c_str(), 0700) == -1) {
+                        return LINGLONG_ERR(fmt::format("mkdir {} error: {}",
+                                                        path.string(),
+                                                        common::error::errorString(errno)));
+                    }
+
+                    dirs.push_back({ *inode, path });
+                    pending.push_back({ *inode, std::move(path) });
+                    continue;
+                }
+
+                if (S_ISLNK(inode->mode)) {
+                    auto target = this->readLink(*inode);
+                    if (!target) {
+                        return LINGLONG_ERR(target);
+                    }
+
+                    if (::symlink(target->c_str(), path.c_str()) == -1) {
+                        return LINGLONG_ERR(fmt::format("symlink {} error: {}",
+                                                        path.string(),
+                                                        common::error::errorString(errno)));
+                    }
+                    continue;
+                }
+
+                if (S_ISFIFO(inode->mode) || S_ISSOCK(inode->mode)) {
+                    if (::mknod(path.c_str(), inode->mode & (S_IFMT | 0777), 0) == -1) {
+                        return LINGLONG_ERR(fmt::format("mknod {} error: {}",
+                                                        path.string(),
+                                                        common::error::errorString(errno)));
+                    }
+                    continue;
+                }
+
+                if (!S_ISREG(inode->mode)) {
+                    return LINGLONG_ERR(fmt::format("unsupported file type of {}", path.string()));
+                }
+
+                auto [it, inserted] = extracted.try_emplace(inode->nid, path);
+                if (!inserted) {
+                    links.emplace_back(it->second, std::move(path));
+                    continue;
+                }
+
+                files.push_back({ *inode, std::move(path) });
+            }
+        }
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    std::atomic_size_t next{ 0 };
+    std::atomic_bool failed{ false };
+    std::mutex mutex;
+    utils::error::Result<void> failure = LINGLONG_OK;
+
+    auto writeFile = [this](const Task &task) noexcept -> utils::error::Result<void> {
+        LINGLONG_TRACE(fmt::format("extract {}", task.path.string()));
+
+        auto out = ::open(task.path.c_str(),
+                          O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW,
+                          0600);
+        if (out == -1) {
+            return LINGLONG_ERR(fmt::format("open error: {}", common::error::errorString(errno)));
+        }
+        auto closeOut = utils::finally::finally([out] {
+            ::close(out);
+        });
+
+        const auto &inode = task.inode;
+        if (inode.layout == FlatPlain && inode.size > 0) {
+            // the content is stored as is, it's copied in kernel
+            auto position = static_cast<std::uint64_t>(inode.rawBlockAddress) << this->blockBits;
+            auto ret = utils::copyRange(this->fd,
+                                        this->offset + static_cast<off_t>(position),
+                                        out,
+                                        0,
+                                        inode.size);
+            if (!ret) {
+                return LINGLONG_ERR(ret);
+            }
+        } else {
+            ErofsFile file{ *this, inode };
+            std::vector<std::byte> buf(maxPClusterSize);
+            std::uint64_t offset{ 0 };
+            while (offset < inode.size) {
+                auto len = file.read(offset, buf.data(), buf.size());
+                if (!len) {
+                    return LINGLONG_ERR(len);
+                }
+                if (*len == 0) {
+                    return LINGLONG_ERR(corrupted(inode, "unexpected end of file"));
+                }
+
+                std::size_t written{ 0 };
+                while (written < *len) {
+                    auto ret = ::pwrite(out,
+                                        buf.data() + written,
+                                        *len - written,
+                                        static_cast<off_t>(offset + written));
+                    if (ret == -1) {
+                        if (errno == EINTR) {
+                            continue;
+                        }
+
+                        return LINGLONG_ERR(
+                          fmt::format("write error: {}", common::error::errorString(errno)));
+                    }
+                    written += ret;
+                }
+                offset += *len;
+            }
+        }
+
+        if (::fchmod(out, inode.mode & 0777) == -1) {
+            return LINGLONG_ERR(fmt::format("fchmod error: {}", common::error::errorString(errno)));
+        }
+
+        return LINGLONG_OK;
+    };
+
+    auto worker = [&]() noexcept {
+        try {
+            for (auto index = next++; index < files.size() && !failed; index = next++) {
+                auto ret = writeFile(files[index]);
+                if (ret) {
+                    continue;
+                }
+
+                std::lock_guard lock(mutex);
+                if (!failed.exchange(true)) {
+                    failure = LINGLONG_ERR(ret);
+                }
+            }
+        } catch (const std::exception &e) {
+            std::lock_guard lock(mutex);
+            if (!failed.exchange(true)) {
+                failure = LINGLONG_ERR(e);
+            }
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, files.size()));
+
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(worker);
+        }
+    } catch (...) {
+        // fewer threads are fine
+    }
+
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    if (!failure) {
+        return LINGLONG_ERR(failure);
+    }
+
+    for (const auto &[target, path] : links) {
+        if (::link(target.c_str(), path.c_str()) == -1) {
+            return LINGLONG_ERR(fmt::format("link {} error: {}",
+                                            path.string(),
+                                            common::error::errorString(errno)));
+        }
+    }
+
+    // children first, a read-only directory can't be written any more
+    for (auto it = dirs.crbegin(); it != dirs.crend(); ++it) {
+        if (::chmod(it->path.c_str(), it->inode.mode & 0777) == -1) {
+            return LINGLONG_ERR(fmt::format("chmod {} error: {}",
+                                            it->path.string(),
+                                            common::error::errorString(errno)));
+        }
+    }
+
+    if (::chmod(destination.c_str(), dir.mode & 0777) == -1) {
+        return LINGLONG_ERR(fmt::format("chmod {} error: {}",
+                                        destination.string(),
+                                        common::error::errorString(errno)));
+    }
+
+    return LINGLONG_OK;
+}
+
+ErofsFile::ErofsFile(const ErofsImage &image, ErofsInode inode) noexcept
+    : image(image)
+    , inode_(inode)
+{
+}
+
+ErofsFile::~ErofsFile() = default;
+
+utils::error::Result<std::size_t>
+ErofsFile::read(std::uint64_t offset, std::byte *buf, std::size_t len) noexcept
+{
+    if (offset >= this->inode_.size || len == 0) {
+        return 0;
+    }
+
+    len = static_cast<std::size_t>(std::min<std::uint64_t>(len, this->inode_.size - offset));
+    if (isCompressed(this->inode_.layout)) {
+        return this->readCompressed(offset, buf, len);
+    }
+
+    return this->readFlat(offset, buf, len);
+}
+
+utils::error::Result<void>
+ErofsFile::readFully(std::uint64_t offset, std::byte *buf, std::size_t len) noexcept
+{
+    LINGLONG_TRACE(fmt::format("read {} bytes at {} of inode {}", len, offset, this->inode_.nid));
+
+    while (len > 0) {
+        auto ret = this->read(offset, buf, len);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+        if (*ret == 0) {
+            return LINGLONG_ERR("unexpected end of file");
+        }
+
+        offset += *ret;
+        buf += *ret;
+        len -= *ret;
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<std::size_t>
+ErofsFile::readFlat(std::uint64_t offset, std::byte *buf, std::size_t len) noexcept
+{
+    LINGLONG_TRACE(fmt::format("read inode {}", this->inode_.nid));
+
+    const auto &inode = this->inode_;
+    const auto blockBits = this->image.blockBits;
+    const std::uint64_t blockSize = 1ULL << blockBits;
+    // the position of the data which follows the inode and its xattrs
+    const auto inlinePosition = inode.position + inode.inodeSize + inode.xattrSize;
+
+    std::optional<std::uint64_t> position;
+    std::uint64_t available{ 0 };
+    switch (inode.layout) {
+    case FlatPlain: {
+        position = (static_cast<std::uint64_t>(inode.rawBlockAddress) << blockBits) + offset;
+        available = inode.size - offset;
+    } break;
+    case FlatInline: {
+        // the last block is stored after the inode
+        const auto lastBlock = (inode.size + blockSize - 1) / blockSize - 1;
+        const auto tailStart = lastBlock << blockBits;
+        if (offset < tailStart) {
+            position = (static_cast<std::uint64_t>(inode.rawBlockAddress) << blockBits) + offset;
+            available = tailStart - offset;
+            break;
+        }
+
+        if ((inlinePosition & (blockSize - 1)) + (inode.size - tailStart) > blockSize) {
+            return LINGLONG_ERR(corrupted(inode, "inline data crosses the block"));
+        }
+        position = inlinePosition + (offset - tailStart);
+        available = inode.size - offset;
+    } break;
+    case ChunkBased: {
+        const auto format = static_cast<std::uint16_t>(inode.rawBlockAddress & 0xFFFF);
+        if ((format & ~(chunkFormatBitsMask | chunkFormatIndexes)) != 0) {
+            return LINGLONG_ERR(fmt::format("unsupported chunk format {:#x}", format));
+        }
+
+        const auto chunkBits = blockBits + (format & chunkFormatBitsMask);
+        if (chunkBits >= 48) {
+            return LINGLONG_ERR(corrupted(inode, "invalid chunk size"));
+        }
+
+        // chunk indexes take 8 bytes, block maps take 4 bytes
+        const std::uint64_t unit = (format & chunkFormatIndexes) != 0 ? 8 : 4;
+        const auto chunk = offset >> chunkBits;
+        std::array<std::byte, 8> entry{};
+        auto ret = this->image.readAt(alignUp(inlinePosition, unit) + unit * chunk,
+                                      entry.data(),
+                                      unit);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        const auto address = le32(entry.data() + (unit == 8 ? 4 : 0));
+        const auto chunkStart = chunk << chunkBits;
+        const auto chunkEnd = chunkStart + (1ULL << chunkBits);
+        available = std::min<std::uint64_t>(chunkEnd, inode.size) - offset;
+        if (address != nullAddress) {
+            position = (static_cast<std::uint64_t>(address) << blockBits) + (offset - chunkStart);
+        }
+    } break;
+    default:
+        return LINGLONG_ERR(fmt::format("unsupported data layout {}", inode.layout));
+    }
+
+    len = static_cast<std::size_t>(std::min<std::uint64_t>(len, available));
+    if (!position) {
+        // a hole
+        std::fill_n(buf, len, std::byte{ 0 });
+        return len;
+    }
+
+    auto ret = this->image.readAt(*position, buf, len);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    return len;
+}
+
+utils::error::Result<std::size_t>
+ErofsFile::readCompressed(std::uint64_t offset, std::byte *buf, std::size_t len) noexcept
+{
+    LINGLONG_TRACE(fmt::format("read compressed inode {}", this->inode_.nid));
+
+    if (!this->compressed) {
+        this->compressed.reset(new (std::nothrow) Compressed);
+        if (!this->compressed) {
+            return LINGLONG_ERR("out of memory");
+        }
+    }
+
+    auto &z = *this->compressed;
+    if (!z.initialized) {
+        auto ret = z.init(this->image, this->inode_);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+        z.initialized = true;
+    }
+
+    auto cached = [&z, offset]() noexcept {
+        return !z.extent.empty() && offset >= z.extentStart
+          && offset - z.extentStart < z.extent.size();
+    };
+
+    if (!cached()) {
+        auto extent = z.map(this->image, this->inode_, offset);
+        if (!extent) {
+            return LINGLONG_ERR(extent);
+        }
+        if (extent->start > offset || offset - extent->start >= extent->length) {
+            return LINGLONG_ERR(corrupted(this->inode_, "extent doesn't cover the offset"));
+        }
+
+        if (extent->fragment) {
+            // the tail of the file is a part of the packed inode
+            if (!z.packed) {
+                auto packedInode = this->image.inode(this->image.packedNid);
+                if (!packedInode) {
+                    return LINGLONG_ERR(packedInode);
+                }
+
+                z.packed.reset(new (std::nothrow) ErofsFile(this->image, *packedInode));
+                if (!z.packed) {
+                    return LINGLONG_ERR("out of memory");
+                }
+            }
+
+            len = static_cast<std::size_t>(
+              std::min<std::uint64_t>(len, extent->start + extent->length - offset));
+            auto ret = z.packed->read(z.fragmentOffset + (offset - extent->start), buf, len);
+            if (!ret) {
+                return LINGLONG_ERR(ret);
+            }
+            if (*ret == 0) {
+                return LINGLONG_ERR(corrupted(this->inode_, "fragment is out of packed inode"));
+            }
+
+            return ret;
+        }
+
+        auto ret = z.decompress(this->image, this->inode_, *extent);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+    }
+
+    const auto skip = static_cast<std::size_t>(offset - z.extentStart);
+    len = std::min(len, z.extent.size() - skip);
+    std::copy_n(z.extent.data() + skip, len, buf);
+    return len;
+}
+
+utils::error::Result<void> ErofsFile::Compressed::init(const ErofsImage &image,
+                                                       const ErofsInode &inode) noexcept
+{
+    LINGLONG_TRACE("read map header");
+
+    std::array<std::byte, 8> header{};
+    auto ret = image.readAt(alignUp(inode.position + inode.inodeSize + inode.xattrSize, 8),
+                            header.data(),
+                            header.size());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    const auto clusterBits = std::to_integer<std::uint8_t>(header[7]);
+    if ((clusterBits & 0x80) != 0) {
+        // the whole file is a fragment of the packed inode
+        if (image.packedNid == 0) {
+            return LINGLONG_ERR(corrupted(inode, "fragment without packed inode"));
+        }
+
+        this->advise = adviseFragmentPCluster;
+        this->fragmentOffset = le64(header.data()) ^ (1ULL << 63);
+        this->tailHeadLcn = 0;
+        return LINGLONG_OK;
+    }
+
+    this->advise = le16(header.data() + 4);
+    const auto algorithmType = std::to_integer<std::uint8_t>(header[6]);
+    this->algorithms = { static_cast<std::uint8_t>(algorithmType & 0xF),
+                         static_cast<std::uint8_t>(algorithmType >> 4) };
+    if (this->algorithms[0] >= AlgorithmMax || this->algorithms[1] >= AlgorithmMax) {
+        return LINGLONG_ERR(fmt::format("unsupported algorithm type {:#x}", algorithmType));
+    }
+    if ((clusterBits & 0x78) != 0) {
+        return LINGLONG_ERR(fmt::format("unsupported cluster bits {:#x}", clusterBits));
+    }
+
+    this->lclusterBits = image.blockBits + (clusterBits & 7);
+    if ((image.features & featureCompressionConfigs) == 0
+        && (this->advise & (adviseBigPCluster1 | adviseBigPCluster2)) != 0) {
+        return LINGLONG_ERR(corrupted(inode, "big pcluster without the feature"));
+    }
+    if (inode.layout == CompressedCompact
+        && ((this->advise & adviseBigPCluster1) == 0)
+          != ((this->advise & adviseBigPCluster2) == 0)) {
+        return LINGLONG_ERR(corrupted(inode, "big pclusters of compact indexes mismatch"));
+    }
+
+    if ((this->advise & adviseInlinePCluster) != 0) {
+        if ((image.features & featureZTailPacking) == 0) {
+            return LINGLONG_ERR(corrupted(inode, "tail packing without the feature"));
+        }
+
+        this->inlineDataSize = le16(header.data() + 2);
+        auto tail = this->map(image, inode, inode.size - 1, true);
+        if (!tail) {
+            return LINGLONG_ERR(tail);
+        }
+
+        const auto blockSize = 1ULL << image.blockBits;
+        if (tail->compressedLength == 0
+            || (tail->position & (blockSize - 1)) + tail->compressedLength > blockSize) {
+            return LINGLONG_ERR(corrupted(inode, "invalid inline pcluster"));
+        }
+    }
+
+    if ((this->advise & adviseFragmentPCluster) != 0) {
+        if (image.packedNid == 0) {
+            return LINGLONG_ERR(corrupted(inode, "fragment without packed inode"));
+        }
+
+        this->fragmentOffset = le32(header.data());
+        auto tail = this->map(image, inode, inode.size - 1, true);
+        if (!tail) {
+            return LINGLONG_ERR(tail);
+        }
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<void> ErofsFile::Compressed::loadFull(const ErofsImage &image,
+                                                           const ErofsInode &inode,
+                                                           Recorder &m,
+                                                           std::uint64_t lcn) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("load full index {}", lcn));
+
+    // the legacy map header takes 16 bytes
+    const auto position =
+      alignUp(inode.position + inode.inodeSize + inode.xattrSize, 8) + 16 + lcn * 8;
+    std::array<std::byte, 8> index{};
+    auto ret = image.readAt(position, index.data(), index.size());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    m.lcn = lcn;
+    m.nextPackOffset = position + index.size();
+
+    const auto advise = le16(index.data());
+    m.type = advise & 3;
+    if (m.type == NonHead) {
+        m.clusterOffset = 1U << this->lclusterBits;
+        m.delta[0] = le16(index.data() + 4);
+        if ((m.delta[0] & d0CompressedBlocks) != 0) {
+            if ((this->advise & (adviseBigPCluster1 | adviseBigPCluster2)) == 0) {
+                return LINGLONG_ERR(corrupted(inode, "unexpected compressed block count"));
+            }
+
+            m.compressedBlocks = m.delta[0] & ~d0CompressedBlocks;
+            m.delta[0] = 1;
+        }
+        m.delta[1] = le16(index.data() + 6);
+        return LINGLONG_OK;
+    }
+
+    m.clusterOffset = le16(index.data() + 2);
+    if (m.clusterOffset >= 1U << this->lclusterBits) {
+        return LINGLONG_ERR(corrupted(inode, "invalid cluster offset"));
+    }
+    m.pblk = le32(index.data() + 4);
+    return LINGLONG_OK;
+}
+
+namespace {
+
+std::uint32_t decodeCompactedBits(unsigned lobits,
+                                  const std::byte *in,
+                                  unsigned position,
+                                  std::uint8_t &type) noexcept
+{
+    const auto v = le32(in + position / 8) >> (position & 7);
+    type = static_cast<std::uint8_t>((v >> lobits) & 3);
+    return v & ((1U << lobits) - 1);
+}
+
+std::uint32_t compactedLookaheadDistance(unsigned lobits,
+                                         unsigned encodeBits,
+                                         unsigned vcnt,
+                                         const std::byte *in,
+                                         unsigned i) noexcept
+{
+    std::uint32_t lo{ 0 };
+    std::uint32_t d1{ 0 };
+    std::uint8_t type{ 0 };
+    do {
+        lo = decodeCompactedBits(lobits, in, encodeBits * i, type);
+        if (type != NonHead) {
+            return d1;
+        }
+        ++d1;
+    } while (++i < vcnt);
+
+    // the last lcluster of a pack saves delta[1] instead of delta[0]
+    if ((lo & d0CompressedBlocks) == 0) {
+        d1 += lo - 1;
+    }
+    return d1;
+}
+
+} // namespace
+
+utils::error::Result<void> ErofsFile::Compressed::loadCompact(const ErofsImage &image,
+                                                              const ErofsInode &inode,
+                                                              Recorder &m,
+                                                              std::uint64_t lcn,
+                                                              bool lookahead) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("load compact index {}", lcn));
+
+    const auto base = alignUp(inode.position + inode.inodeSize + inode.xattrSize, 8) + 8;
+    const auto totalIndexes =
+      (inode.size + (1ULL << this->lclusterBits) - 1) >> this->lclusterBits;
+    if (lcn >= totalIndexes || this->lclusterBits > 14) {
+        return LINGLONG_ERR(corrupted(inode, "invalid logical cluster"));
+    }
+
+    m.lcn = lcn;
+    // 4-byte indexes come first, until the 2-byte ones can be aligned to 32 bytes
+    const std::uint64_t initial4B = ((32 - base % 32) / 4) & 7;
+    std::uint64_t compacted2B{ 0 };
+    if ((this->advise & adviseCompacted2B) != 0 && initial4B < totalIndexes) {
+        compacted2B = (totalIndexes - initial4B) / 16 * 16;
+    }
+
+    auto position = base;
+    unsigned amortizedShift = 2;
+    auto index = lcn;
+    if (index >= initial4B) {
+        position += initial4B * 4;
+        index -= initial4B;
+        if (index < compacted2B) {
+            amortizedShift = 1;
+        } else {
+            position += compacted2B * 2;
+            index -= compacted2B;
+        }
+    }
+    position += index << amortizedShift;
+
+    unsigned vcnt{ 0 };
+    if (amortizedShift == 2 && this->lclusterBits <= 14) {
+        vcnt = 2;
+    } else if (amortizedShift == 1 && this->lclusterBits <= 12) {
+        vcnt = 16;
+    } else {
+        return LINGLONG_ERR(fmt::format("unsupported logical cluster size 2^{}",
+                                        static_cast<unsigned>(this->lclusterBits)));
+    }
+
+    // a pack of vcnt indexes ends with the block address of its first head
+    const unsigned packSize = vcnt << amortizedShift;
+    const auto packPosition = position / packSize * packSize;
+    std::array<std::byte, 32> pack{};
+    auto ret = image.readAt(packPosition, pack.data(), packSize);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+    m.nextPackOffset = packPosition + packSize;
+
+    const bool bigPCluster = (this->advise & adviseBigPCluster1) != 0;
+    const unsigned lobits = std::max<unsigned>(this->lclusterBits, 12);
+    const unsigned encodeBits = (packSize - 4) * 8 / vcnt;
+    int i = static_cast<int>((position - packPosition) >> amortizedShift);
+    const auto *in = pack.data();
+
+    std::uint8_t type{ 0 };
+    auto lo = decodeCompactedBits(lobits, in, encodeBits * i, type);
+    m.type = type;
+    if (type == NonHead) {
+        m.clusterOffset = 1U << this->lclusterBits;
+        if (lookahead) {
+            m.delta[1] = compactedLookaheadDistance(lobits, encodeBits, vcnt, in, i);
+        }
+
+        if ((lo & d0CompressedBlocks) != 0) {
+            if (!bigPCluster) {
+                return LINGLONG_ERR(corrupted(inode, "unexpected compressed block count"));
+            }
+
+            m.compressedBlocks = lo & ~d0CompressedBlocks;
+            m.delta[0] = 1;
+            return LINGLONG_OK;
+        }
+        if (i + 1 != static_cast<int>(vcnt)) {
+            m.delta[0] = lo;
+            return LINGLONG_OK;
+        }
+
+        // the last lcluster of a pack saves delta[1], delta[0] is got from the previous one
+        lo = decodeCompactedBits(lobits, in, encodeBits * (i - 1), type);
+        if (type != NonHead) {
+            lo = 0;
+        } else if ((lo & d0CompressedBlocks) != 0) {
+            lo = 1;
+        }
+        m.delta[0] = lo + 1;
+        return LINGLONG_OK;
+    }
+
+    m.clusterOffset = lo;
+    m.delta[0] = 0;
+    // the block address of a head is the base of the pack plus the blocks before it
+    std::uint32_t blocks{ 0 };
+    if (!bigPCluster) {
+        blocks = 1;
+        while (i > 0) {
+            --i;
+            lo = decodeCompactedBits(lobits, in, encodeBits * i, type);
+            if (type == NonHead) {
+                i -= static_cast<int>(lo);
+            }
+            if (i >= 0) {
+                ++blocks;
+            }
+        }
+    } else {
+        while (i > 0) {
+            --i;
+            lo = decodeCompactedBits(lobits, in, encodeBits * i, type);
+            if (type == NonHead) {
+                if ((lo & d0CompressedBlocks) != 0) {
+                    --i;
+                    blocks += lo & ~d0CompressedBlocks;
+                    continue;
+                }
+                if (lo <= 1) {
+                    return LINGLONG_ERR(corrupted(inode, "invalid compact index"));
+                }
+                i -= static_cast<int>(lo) - 2;
+                continue;
+            }
+            ++blocks;
+        }
+    }
+
+    m.pblk = le32(in + packSize - 4) + blocks;
+    return LINGLONG_OK;
+}
+
+utils::error::Result<void> ErofsFile::Compressed::load(const ErofsImage &image,
+                                                       const ErofsInode &inode,
+                                                       Recorder &m,
+                                                       std::uint64_t lcn,
+                                                       bool lookahead) const noexcept
+{
+    if (inode.layout == CompressedCompact) {
+        return this->loadCompact(image, inode, m, lcn, lookahead);
+    }
+
+    LINGLONG_TRACE("load full index");
+
+    const auto totalIndexes =
+      (inode.size + (1ULL << this->lclusterBits) - 1) >> this->lclusterBits;
+    if (lcn >= totalIndexes) {
+        return LINGLONG_ERR(corrupted(inode, "invalid logical cluster"));
+    }
+
+    return this->loadFull(image, inode, m, lcn);
+}
+
+utils::error::Result<void> ErofsFile::Compressed::lookback(const ErofsImage &image,
+                                                           const ErofsInode &inode,
+                                                           Recorder &m,
+                                                           Extent &extent,
+                                                           std::uint32_t distance) const noexcept
+{
+    LINGLONG_TRACE("look back for the head");
+
+    while (m.lcn >= distance) {
+        const auto lcn = m.lcn - distance;
+        auto ret = this->load(image, inode, m, lcn, false);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        if (m.type == NonHead) {
+            distance = m.delta[0];
+            if (distance == 0) {
+                break;
+            }
+            continue;
+        }
+
+        m.headType = m.type;
+        extent.start = (lcn << this->lclusterBits) | m.clusterOffset;
+        return LINGLONG_OK;
+    }
+
+    return LINGLONG_ERR(corrupted(inode, fmt::format("bogus lookback distance {}", distance)));
+}
+
+utils::error::Result<void> ErofsFile::Compressed::compressedLength(const ErofsImage &image,
+                                                                   const ErofsInode &inode,
+                                                                   Recorder &m,
+                                                                   Extent &extent) const noexcept
+{
+    LINGLONG_TRACE("get compressed length");
+
+    if (m.headType == Plain || (m.headType == Head1 && (this->advise & adviseBigPCluster1) == 0)
+        || (m.headType == Head2 && (this->advise & adviseBigPCluster2) == 0)) {
+        extent.compressedLength = 1ULL << this->lclusterBits;
+        return LINGLONG_OK;
+    }
+
+    if (m.compressedBlocks == 0) {
+        auto ret = this->load(image, inode, m, m.lcn + 1, false);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        if (m.type != NonHead) {
+            // a pcluster of one logical cluster
+            m.compressedBlocks = 1U << (this->lclusterBits - image.blockBits);
+        } else if (m.delta[0] != 1 || m.compressedBlocks == 0) {
+            return LINGLONG_ERR(corrupted(inode, "bogus compressed block count"));
+        }
+    }
+
+    extent.compressedLength = static_cast<std::uint64_t>(m.compressedBlocks) << image.blockBits;
+    return LINGLONG_OK;
+}
+
+utils::error::Result<void> ErofsFile::Compressed::decompressedLength(
+  const ErofsImage &image, const ErofsInode &inode, Recorder &m, Extent &extent) const noexcept
+{
+    LINGLONG_TRACE("get decompressed length");
+
+    // the extent ends at the next head
+    auto lcn = m.lcn;
+    const auto headLcn = extent.start >> this->lclusterBits;
+    do {
+        if ((lcn << this->lclusterBits) >= inode.size) {
+            extent.length = inode.size - extent.start;
+            return LINGLONG_OK;
+        }
+
+        auto ret = this->load(image, inode, m, lcn, true);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        if (m.type != NonHead) {
+            if (lcn != headLcn) {
+                break;
+            }
+            m.delta[1] = 1;
+        }
+        lcn += m.delta[1];
+    } while (m.delta[1] != 0);
+
+    extent.length = (lcn << this->lclusterBits) + m.clusterOffset - extent.start;
+    return LINGLONG_OK;
+}
+
+utils::error::Result<ErofsFile::Compressed::Extent> ErofsFile::Compressed::map(
+  const ErofsImage &image, const ErofsInode &inode, std::uint64_t offset, bool findTail) noexcept
+{
+    LINGLONG_TRACE(fmt::format("map offset {} of inode {}", offset, inode.nid));
+
+    const bool tailPacking = (this->advise & adviseInlinePCluster) != 0;
+    const bool fragment = (this->advise & adviseFragmentPCluster) != 0;
+    Extent extent;
+    if (fragment && !findTail && this->tailHeadLcn == 0) {
+        extent.length = inode.size;
+        extent.fragment = true;
+        return extent;
+    }
+
+    Recorder m;
+    const auto initialLcn = offset >> this->lclusterBits;
+    const auto endOffset = offset & ((1ULL << this->lclusterBits) - 1);
+    auto ret = this->load(image, inode, m, initialLcn, false);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    if (tailPacking && findTail) {
+        // the inline pcluster follows the indexes
+        this->inlineDataPosition = m.nextPackOffset;
+    }
+
+    switch (m.type) {
+    case Plain:
+    case Head1:
+    case Head2:
+        if (endOffset >= m.clusterOffset) {
+            m.headType = m.type;
+            extent.start = (m.lcn << this->lclusterBits) | m.clusterOffset;
+            break;
+        }
+
+        // the offset belongs to the previous extent
+        if (m.lcn == 0) {
+            return LINGLONG_ERR(corrupted(inode, "invalid logical cluster 0"));
+        }
+        m.delta[0] = 1;
+        [[fallthrough]];
+    case NonHead:
+        ret = this->lookback(image, inode, m, extent, m.delta[0]);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+        break;
+    default:
+        return LINGLONG_ERR(corrupted(inode, fmt::format("unknown cluster type {}", m.type)));
+    }
+
+    if (findTail) {
+        this->tailHeadLcn = m.lcn;
+        // the high 32 bits of the fragment offset of full indexes
+        if (fragment && inode.layout == CompressedFull) {
+            this->fragmentOffset |= static_cast<std::uint64_t>(m.pblk) << 32;
+        }
+    }
+
+    if (tailPacking && m.lcn == this->tailHeadLcn) {
+        extent.position = this->inlineDataPosition;
+        extent.compressedLength = this->inlineDataSize;
+    } else if (fragment && m.lcn == this->tailHeadLcn) {
+        extent.fragment = true;
+    } else {
+        extent.position = static_cast<std::uint64_t>(m.pblk) << image.blockBits;
+        ret = this->compressedLength(image, inode, m, extent);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+    }
+
+    if (m.headType == Plain) {
+        extent.algorithm =
+          (this->advise & adviseInterlacedPCluster) != 0 ? Interlaced : Shifted;
+    } else {
+        extent.algorithm = this->algorithms[m.headType == Head2 ? 1 : 0];
+        if ((image.algorithms & (1U << extent.algorithm)) == 0) {
+            return LINGLONG_ERR(
+              corrupted(inode, fmt::format("unavailable algorithm {}", extent.algorithm)));
+        }
+    }
+
+    ret = this->decompressedLength(image, inode, m, extent);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    // the last logical cluster may be divided into three parts
+    if (extent.start + extent.length > inode.size) {
+        extent.length = inode.size - extent.start;
+    }
+
+    return extent;
+}
+
+utils::error::Result<void> ErofsFile::Compressed::decompress(const ErofsImage &image,
+                                                             const ErofsInode &inode,
+                                                             const Extent &extent) noexcept
+{
+    LINGLONG_TRACE(fmt::format("decompress extent at {} of inode {}", extent.start, inode.nid));
+
+    if (extent.compressedLength == 0 || extent.compressedLength > maxPClusterSize) {
+        return LINGLONG_ERR(corrupted(inode, "invalid pcluster size"));
+    }
+    if (extent.length == 0 || extent.length > maxExtentSize) {
+        return LINGLONG_ERR(corrupted(inode, "invalid extent size"));
+    }
+
+    this->extent.clear();
+    try {
+        this->raw.resize(extent.compressedLength);
+        this->extent.resize(extent.length);
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    auto ret = image.readAt(extent.position, this->raw.data(), this->raw.size());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    const std::size_t blockSize = std::size_t{ 1 } << image.blockBits;
+    auto *out = this->extent.data();
+    const auto length = static_cast<std::size_t>(extent.length);
+    const auto *in = this->raw.data();
+    const auto inputSize = this->raw.size();
+
+    // compressed data is padded by zeros ahead, so that it ends at the end of the pcluster, the
+    // padding is in the first block
+    const auto firstBlockSize = std::min(blockSize, inputSize);
+    auto inputMargin = [in, firstBlockSize]() noexcept {
+        std::size_t margin{ 0 };
+        while (margin < firstBlockSize && in[margin] == std::byte{ 0 }) {
+            ++margin;
+        }
+        return margin;
+    };
+
+    auto fail = [this](std::string message) {
+        this->extent.clear();
+        return message;
+    };
+
+    switch (extent.algorithm) {
+    case Shifted: {
+        if (length > inputSize) {
+            return LINGLONG_ERR(fail(corrupted(inode, "plain extent is too large")));
+        }
+        std::copy_n(in, length, out);
+    } break;
+    case Interlaced: {
+        if (inputSize > blockSize || length > blockSize) {
+            return LINGLONG_ERR(fail(corrupted(inode, "interlaced extent is too large")));
+        }
+        const auto skip = static_cast<std::size_t>(extent.start & (blockSize - 1));
+        const auto right = std::min(blockSize - skip, length);
+        std::copy_n(in + skip, right, out);
+        std::copy_n(in, length - right, out + right);
+    } break;
+    case LZ4: {
+        std::size_t margin{ 0 };
+        if ((image.features & featureZeroPadding) != 0) {
+            margin = inputMargin();
+            if (margin == firstBlockSize) {
+                return LINGLONG_ERR(fail(corrupted(inode, "empty lz4 pcluster")));
+            }
+        }
+
+        // a part of the decompressed data is referred by deduplicated extents
+        auto decompressed =
+          ::LZ4_decompress_safe_partial(reinterpret_cast<const char *>(in + margin),
+                                        reinterpret_cast<char *>(out),
+                                        static_cast<int>(inputSize - margin),
+                                        static_cast<int>(length),
+                                        static_cast<int>(length));
+        if (decompressed != static_cast<int>(length)) {
+            return LINGLONG_ERR(fail(fmt::format("lz4 decompression of inode {} failed: {}",
+                                                 inode.nid,
+                                                 decompressed)));
+        }
+    } break;
+    case LZMA: {
+        auto margin = inputMargin();
+        if (margin == firstBlockSize) {
+            return LINGLONG_ERR(fail(corrupted(inode, "empty lzma pcluster")));
+        }
+
+        lzma_stream stream = LZMA_STREAM_INIT;
+        auto endStream = utils::finally::finally([&stream] {
+            ::lzma_end(&stream);
+        });
+        stream.next_in = reinterpret_cast<const std::uint8_t *>(in + margin);
+        stream.avail_in = inputSize - margin;
+        stream.next_out = reinterpret_cast<std::uint8_t *>(out);
+        stream.avail_out = length;
+
+        // MicroLZMA, the size of the decompressed data isn't exact for deduplicated extents
+        auto lzmaRet =
+          ::lzma_microlzma_decoder(&stream, stream.avail_in, length, false, lzmaMaxDictSize);
+        if (lzmaRet != LZMA_OK) {
+            return LINGLONG_ERR(fail(fmt::format("failed to initialize lzma decoder: {}",
+                                                 static_cast<int>(lzmaRet))));
+        }
+
+        lzmaRet = ::lzma_code(&stream, LZMA_FINISH);
+        if (lzmaRet != LZMA_STREAM_END || stream.avail_out != 0) {
+            return LINGLONG_ERR(fail(fmt::format("lzma decompression of inode {} failed: {}",
+                                                 inode.nid,
+                                                 static_cast<int>(lzmaRet))));
+        }
+    } break;
+    default:
+        return LINGLONG_ERR(
+          fail(fmt::format("unsupported compression algorithm {}", extent.algorithm)));
+    }
+
+    this->extentStart = extent.start;
+    return LINGLONG_OK;
+}
+
+} // namespace linglong::package
@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/utils/error/error.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace linglong::package {
+
+struct ErofsInode
+{
+    std::uint64_t nid{ 0 };
+    std::uint32_t mode{ 0 };
+    std::uint64_t size{ 0 };
+
+    // the on-disk details, they are only meaningful to ErofsImage and ErofsFile
+    std::uint64_t position{ 0 };
+    std::uint8_t layout{ 0 };
+    std::uint16_t inodeSize{ 0 };
+    std::uint32_t xattrSize{ 0 };
+    // the start block of flat layouts, the chunk format of chunk based layout
+    std::uint32_t rawBlockAddress{ 0 };
+};
+
+struct ErofsDirEntry
+{
+    std::string name;
+    std::uint64_t nid{ 0 };
+};
+
+// ErofsImage reads an erofs image in process, so that the content of a layer or an UAB can be
+// imported or extracted without mounting it by erofsfuse or extracting it by fsck.erofs first.
+//
+// Files in the flat, inline and chunk based layouts, and files compressed by lz4 or lzma are
+// supported, including big pclusters, tail packing, fragments and deduplicated extents. Images
+// which need other algorithms or extra devices are refused by open(), callers may fall back to
+// erofs-utils then. Xattrs are ignored.
+//
+// All methods read the image by pread, so an image can be shared by threads.
+class ErofsImage
+{
+public:
+    // the image starts at offset of fd, fd is duplicated, so it can be closed after that
+    static utils::error::Result<std::unique_ptr<ErofsImage>> open(int fd,
+                                                                  off_t offset = 0) noexcept;
+    ErofsImage(const ErofsImage &) = delete;
+    ErofsImage(ErofsImage &&) = delete;
+    ErofsImage &operator=(const ErofsImage &) = delete;
+    ErofsImage &operator=(ErofsImage &&) = delete;
+    ~ErofsImage();
+
+    [[nodiscard]] utils::error::Result<ErofsInode> root() const noexcept;
+    [[nodiscard]] utils::error::Result<ErofsInode> inode(std::uint64_t nid) const noexcept;
+    // path is relative to the root, symlinks are not followed
+    [[nodiscard]] utils::error::Result<ErofsInode>
+    lookup(const std::filesystem::path &path) const noexcept;
+    // entries of the directory except "." and ".."
+    [[nodiscard]] utils::error::Result<std::vector<ErofsDirEntry>>
+    readDir(const ErofsInode &dir) const noexcept;
+    [[nodiscard]] utils::error::Result<std::string> readLink(const ErofsInode &link) const noexcept;
+    // the whole content of a small regular file, e.g. info.json
+    [[nodiscard]] utils::error::Result<std::string> readFile(const ErofsInode &file) const noexcept;
+
+    // extract the directory dir to destination which must exist, regular files are written by
+    // threads, 0 means the number of CPUs
+    [[nodiscard]] utils::error::Result<void> extract(const ErofsInode &dir,
+                                                     const std::filesystem::path &destination,
+                                                     unsigned threads = 0) const noexcept;
+
+private:
+    friend class ErofsFile;
+
+    ErofsImage() = default;
+
+    [[nodiscard]] utils::error::Result<void>
+    readAt(std::uint64_t position, void *buf, std::size_t len) const noexcept;
+
+    int fd{ -1 };
+    off_t offset{ 0 };
+    std::uint8_t blockBits{ 0 };
+    std::uint8_t dirBlockBits{ 0 };
+    std::uint16_t rootNid{ 0 };
+    std::uint32_t metaBlockAddress{ 0 };
+    std::uint32_t features{ 0 };
+    std::uint16_t algorithms{ 0 };
+    std::uint64_t packedNid{ 0 };
+};
+
+// ErofsFile reads the content of a regular file, a directory or a symlink in an ErofsImage. The
+// last decompressed extent is cached, so sequential reads decompress every extent once, it isn't
+// thread safe.
+class ErofsFile
+{
+public:
+    ErofsFile(const ErofsImage &image, ErofsInode inode) noexcept;
+    ErofsFile(const ErofsFile &) = delete;
+    ErofsFile(ErofsFile &&) = delete;
+    ErofsFile &operator=(const ErofsFile &) = delete;
+    ErofsFile &operator=(ErofsFile &&) = delete;
+    ~ErofsFile();
+
+    [[nodiscard]] const ErofsInode &inode() const noexcept { return inode_; }
+
+    // read at most len bytes at offset, fewer bytes may be read before the end of file, 0 means
+    // the end of file
+    [[nodiscard]] utils::error::Result<std::size_t>
+    read(std::uint64_t offset, std::byte *buf, std::size_t len) noexcept;
+    // read exactly len bytes at offset
+    [[nodiscard]] utils::error::Result<void>
+    readFully(std::uint64_t offset, std::byte *buf, std::size_t len) noexcept;
+
+private:
+    struct Compressed;
+
+    utils::error::Result<std::size_t>
+    readFlat(std::uint64_t offset, std::byte *buf, std::size_t len) noexcept;
+    utils::error::Result<std::size_t>
+    readCompressed(std::uint64_t offset, std::byte *buf, std::size_t len) noexcept;
+
+    const ErofsImage &image;
+    ErofsInode inode_;
+    std::unique_ptr<Compressed> compressed;
+};
+
+} // namespace linglong::package
@@ -11,18 +11,60 @@
 #include "linglong/common/error.h"
 #include "linglong/common/formatter.h"
 #include "linglong/utils/error/error.h"
+#include "linglong/utils/finally/finally.h"
 #include "linglong/utils/log/formatter.h" // IWYU pragma: keep
+#include "linglong/utils/log/log.h"
 #include "linglong/utils/serialize/json.h"
+#include "linglong/utils/sha256.h"
 
 #include <QDataStream>
 #include <QFileInfo>
 
+#include <vector>
+
 #include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace linglong::package {
 
 using nlohmann::json;
 
+namespace {
+
+utils::error::Result<std::string> readAt(int fd, off_t offset, std::size_t len) noexcept
+{
+    LINGLONG_TRACE(fmt::format("read {} bytes at {}", len, offset));
+
+    std::string buf;
+    try {
+        buf.resize(len);
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    std::size_t done{ 0 };
+    while (done < len) {
+        auto ret = ::pread(fd, buf.data() + done, len - done, offset + static_cast<off_t>(done));
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return LINGLONG_ERR(
+              fmt::format("pread error: {}", common::error::errorString(errno)));
+        }
+        if (ret == 0) {
+            return LINGLONG_ERR("unexpected end of file");
+        }
+        done += ret;
+    }
+
+    return buf;
+}
+
+} // namespace
+
 LayerFile::~LayerFile()
 {
     if (this->cleanup) {
@@ -89,6 +131,17 @@ utils::error::Result<api::types::v1::LayerInfo> LayerFile::metaInfo() noexcept
         return LINGLONG_ERR(layerInfo);
     }
 
+    auto footer = this->footer();
+    if (!footer) {
+        return LINGLONG_ERR(footer);
+    }
+    if (*footer) {
+        auto verified = this->verifyHeader(**footer);
+        if (!verified) {
+            return LINGLONG_ERR(verified);
+        }
+    }
+
     return layerInfo;
 }
 
@@ -126,6 +179,260 @@ utils::error::Result<quint32> LayerFile::binaryDataOffset() noexcept
     return number.size() + *size + sizeof(quint32);
 }
 
+utils::error::Result<std::unique_ptr<ErofsImage>> LayerFile::openImage() noexcept
+{
+    LINGLONG_TRACE("open erofs image of layer file");
+
+    auto offset = this->binaryDataOffset();
+    if (!offset) {
+        return LINGLONG_ERR(offset);
+    }
+
+    auto image = ErofsImage::open(this->handle(), *offset);
+    if (!image) {
+        return LINGLONG_ERR(image);
+    }
+
+    return image;
+}
+
+utils::error::Result<std::optional<LayerIndexFooter>> LayerFile::footer() noexcept
+{
+    LINGLONG_TRACE("read index footer of layer file");
+
+    auto offset = this->binaryDataOffset();
+    if (!offset) {
+        return LINGLONG_ERR(offset);
+    }
+
+    struct stat st{};
+    if (::fstat(this->handle(), &st) == -1) {
+        return LINGLONG_ERR(
+          fmt::format("failed to stat layer file: {}", common::error::errorString(errno)));
+    }
+
+    auto fileSize = static_cast<std::uint64_t>(st.st_size);
+    if (fileSize < *offset + LayerIndexFooter::size) {
+        return std::nullopt;
+    }
+
+    auto data = readAt(this->handle(),
+                       static_cast<off_t>(fileSize - LayerIndexFooter::size),
+                       LayerIndexFooter::size);
+    if (!data) {
+        return LINGLONG_ERR(data);
+    }
+
+    auto footer = LayerIndexFooter::parse(reinterpret_cast<const std::byte *>(data->data()));
+    if (!footer) {
+        // written by old versions, the file ends with the erofs image
+        return std::nullopt;
+    }
+
+    if (footer->version != LayerIndexFooter::currentVersion) {
+        LogD("ignore index of unknown version {}", footer->version);
+        return std::nullopt;
+    }
+
+    if (footer->imageSize > fileSize || footer->indexSize > fileSize
+        || *offset + footer->imageSize + footer->indexSize + LayerIndexFooter::size != fileSize) {
+        return LINGLONG_ERR("index footer doesn't match the size of layer file");
+    }
+
+    return footer;
+}
+
+utils::error::Result<void> LayerFile::verifyHeader(const LayerIndexFooter &footer) noexcept
+{
+    LINGLONG_TRACE("verify header of layer file");
+
+    auto offset = this->binaryDataOffset();
+    if (!offset) {
+        return LINGLONG_ERR(offset);
+    }
+
+    auto header = readAt(this->handle(), 0, *offset);
+    if (!header) {
+        return LINGLONG_ERR(header);
+    }
+
+    if (sha256Of(*header) != footer.headerSha256) {
+        return LINGLONG_ERR("header checksum mismatch, the layer file is corrupted");
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<std::optional<LayerIndex>> LayerFile::index() noexcept
+{
+    LINGLONG_TRACE("read index of layer file");
+
+    auto footer = this->footer();
+    if (!footer) {
+        return LINGLONG_ERR(footer);
+    }
+    if (!*footer) {
+        return std::nullopt;
+    }
+
+    auto verified = this->verifyHeader(**footer);
+    if (!verified) {
+        return LINGLONG_ERR(verified);
+    }
+
+    auto offset = this->binaryDataOffset();
+    if (!offset) {
+        return LINGLONG_ERR(offset);
+    }
+
+    auto data = readAt(this->handle(),
+                       static_cast<off_t>(*offset + (*footer)->imageSize),
+                       (*footer)->indexSize);
+    if (!data) {
+        return LINGLONG_ERR(data);
+    }
+
+    if (sha256Of(*data) != (*footer)->indexSha256) {
+        return LINGLONG_ERR("index checksum mismatch, the layer file is corrupted");
+    }
+
+    auto index = LayerIndex::parse(*data, (*footer)->count);
+    if (!index) {
+        return LINGLONG_ERR(index);
+    }
+
+    return std::move(index).value();
+}
+
+utils::error::Result<void> LayerFile::extract(const std::filesystem::path &path,
+                                              const std::filesystem::path &destination) noexcept
+{
+    LINGLONG_TRACE(fmt::format("extract {} of layer file to {}", path, destination));
+
+    auto image = this->openImage();
+    if (!image) {
+        return LINGLONG_ERR(image);
+    }
+
+    auto index = this->index();
+    if (!index) {
+        return LINGLONG_ERR(index);
+    }
+
+    auto relative = path.lexically_normal().relative_path().string();
+    if (!relative.empty() && relative.back() == '/') {
+        relative.pop_back();
+    }
+
+    const LayerIndexEntry *entry{ nullptr };
+    auto inode = [&]() -> utils::error::Result<ErofsInode> {
+        if (relative.empty() || relative == ".") {
+            relative.clear();
+            return (*image)->root();
+        }
+
+        if (!*index) {
+            return (*image)->lookup(relative);
+        }
+
+        entry = (*index)->find(relative);
+        if (entry == nullptr) {
+            return LINGLONG_ERR("no such file in layer");
+        }
+
+        return (*image)->inode(entry->nid);
+    }();
+    if (!inode) {
+        return LINGLONG_ERR(inode);
+    }
+
+    if (S_ISDIR(inode->mode)) {
+        if (::mkdir(destination.c_str(), 0700) == -1) {
+            return LINGLONG_ERR(fmt::format("mkdir {} error: {}",
+                                            destination,
+                                            common::error::errorString(errno)));
+        }
+
+        auto ret = (*image)->extract(*inode, destination);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        return LINGLONG_OK;
+    }
+
+    if (S_ISLNK(inode->mode)) {
+        auto target = (*image)->readLink(*inode);
+        if (!target) {
+            return LINGLONG_ERR(target);
+        }
+
+        if (::symlink(target->c_str(), destination.c_str()) == -1) {
+            return LINGLONG_ERR(fmt::format("symlink {} error: {}",
+                                            destination,
+                                            common::error::errorString(errno)));
+        }
+
+        return LINGLONG_OK;
+    }
+
+    if (!S_ISREG(inode->mode)) {
+        return LINGLONG_ERR("unsupported file type");
+    }
+
+    auto out = ::open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (out == -1) {
+        return LINGLONG_ERR(fmt::format("failed to open {}: {}",
+                                        destination,
+                                        common::error::errorString(errno)));
+    }
+    auto closeOut = utils::finally::finally([out] {
+        ::close(out);
+    });
+
+    ErofsFile file{ **image, *inode };
+    digest::SHA256 sha256;
+    std::vector<std::byte> buf(1024 * 1024);
+    std::uint64_t offset{ 0 };
+    while (offset < inode->size) {
+        auto len = file.read(offset, buf.data(), buf.size());
+        if (!len) {
+            return LINGLONG_ERR(len);
+        }
+        if (*len == 0) {
+            return LINGLONG_ERR("unexpected end of file");
+        }
+
+        std::size_t written{ 0 };
+        while (written < *len) {
+            auto ret = ::write(out, buf.data() + written, *len - written);
+            if (ret == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                return LINGLONG_ERR(
+                  fmt::format("write error: {}", common::error::errorString(errno)));
+            }
+            written += ret;
+        }
+        sha256.update(buf.data(), *len);
+        offset += *len;
+    }
+
+    std::array<std::byte, 32> digest{};
+    sha256.final(digest.data());
+    if (entry != nullptr && digest != entry->sha256) {
+        return LINGLONG_ERR(fmt::format("checksum mismatch of {}", relative));
+    }
+
+    if (::fchmod(out, inode->mode & 0777) == -1) {
+        return LINGLONG_ERR(fmt::format("fchmod error: {}", common::error::errorString(errno)));
+    }
+
+    return LINGLONG_OK;
+}
+
 utils::error::Result<void> LayerFile::saveTo(const QString &destination) noexcept
 {
     LINGLONG_TRACE(fmt::format("save layer file to {}", destination.toStdString()));
@@ -7,11 +7,17 @@
 #pragma once
 
 #include "linglong/api/types/v1/LayerInfo.hpp"
+#include "linglong/package/erofs_image.h"
+#include "linglong/package/layer_index.h"
 #include "linglong/utils/error/error.h"
 
 #include <QFile>
 #include <QSharedPointer>
 
+#include <filesystem>
+#include <memory>
+#include <optional>
+
 namespace linglong::package {
 
 inline const QByteArray &magicNumber()
@@ -28,6 +34,12 @@ inline const QByteArray &magicNumber()
 // meta info length  4                 40
 // meta info         meta info length  44
 // binary data                         44 + meta info length
+// index (optional)  index size        44 + meta info length + image size
+// index footer      104               file size - 104
+//
+// The index and its footer are appended by newer versions, see LayerIndex and LayerIndexFooter.
+// Old versions read the binary data to the end of file, which is fine as erofs ignores the bytes
+// after the image.
 class LayerFile : public QFile
 {
 public:
@@ -41,6 +53,18 @@ public:
 
     utils::error::Result<quint32> binaryDataOffset() noexcept;
 
+    // read the binary data in process, it fails if the image isn't supported by ErofsImage
+    utils::error::Result<std::unique_ptr<ErofsImage>> openImage() noexcept;
+
+    // the table of contents, nullopt if the layer file has no index, the header checksum is
+    // checked as well
+    utils::error::Result<std::optional<LayerIndex>> index() noexcept;
+
+    // extract path in the layer to destination which must not exist, path may be a directory, a
+    // regular file or a symlink. Regular files are verified by the index if there is one.
+    utils::error::Result<void> extract(const std::filesystem::path &path,
+                                       const std::filesystem::path &destination) noexcept;
+
     utils::error::Result<void> saveTo(const QString &destination) noexcept;
 
     // NOTE: Maybe should be removed. and use QTemporaryFile
@@ -52,6 +76,8 @@ public:
 private:
     LayerFile() = default;
     utils::error::Result<quint32> metaInfoLength();
+    utils::error::Result<std::optional<LayerIndexFooter>> footer() noexcept;
+    utils::error::Result<void> verifyHeader(const LayerIndexFooter &footer) noexcept;
 
     bool cleanup = false;
     quint32 metaInfoLengthValue = 0;
@@ -0,0 +1,43 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/package/layer_image.h"
+
+#include "linglong/utils/serialize/packageinfo_handler.h"
+
+#include <fmt/format.h>
+
+#include <sys/stat.h>
+
+namespace linglong::package {
+
+utils::error::Result<api::types::v1::PackageInfoV2> LayerImage::info() const
+{
+    LINGLONG_TRACE(fmt::format("get layer info from {} of erofs image", this->path_.string()));
+
+    auto inode = this->image_.lookup(this->path_ / "info.json");
+    if (!inode) {
+        return LINGLONG_ERR(inode);
+    }
+
+    auto content = this->image_.readFile(*inode);
+    if (!content) {
+        return LINGLONG_ERR(content);
+    }
+
+    auto info = utils::serialize::parsePackageInfo(*content);
+    if (!info) {
+        return LINGLONG_ERR(info);
+    }
+
+    return info;
+}
+
+bool LayerImage::valid() const noexcept
+{
+    auto inode = this->image_.lookup(this->path_ / "info.json");
+    return inode && S_ISREG(inode->mode);
+}
+
+} // namespace linglong::package
@@ -0,0 +1,39 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/api/types/v1/PackageInfoV2.hpp"
+#include "linglong/package/erofs_image.h"
+#include "linglong/utils/error/error.h"
+
+#include <filesystem>
+
+namespace linglong::package {
+
+// LayerImage is the counterpart of LayerDir, the layer is a directory in an erofs image, e.g. the
+// root of a layer file or layers/<id>/<module> of an UAB, it's read without mounting the image.
+class LayerImage
+{
+public:
+    LayerImage(const ErofsImage &image, std::filesystem::path path = {})
+        : image_(image)
+        , path_(std::move(path))
+    {
+    }
+
+    [[nodiscard]] utils::error::Result<api::types::v1::PackageInfoV2> info() const;
+    [[nodiscard]] bool valid() const noexcept;
+
+    [[nodiscard]] const ErofsImage &image() const noexcept { return image_; }
+
+    // the path relative to the root of the image
+    [[nodiscard]] std::filesystem::path path() const noexcept { return path_; }
+
+private:
+    const ErofsImage &image_;
+    std::filesystem::path path_;
+};
+
+} // namespace linglong::package
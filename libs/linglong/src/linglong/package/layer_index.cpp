@@ -0,0 +1,324 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/package/layer_index.h"
+
+#include "linglong/utils/sha256.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include <endian.h>
+#include <sys/stat.h>
+
+namespace linglong::package {
+
+namespace {
+
+constexpr std::string_view footerMagic = "<<< ll index >>>";
+constexpr std::size_t entryFixedSize = 4 + 8 + 8 + 32 + 2;
+
+template <typename T>
+void put(std::string &out, T value)
+{
+    if constexpr (sizeof(T) == 2) {
+        value = htole16(value);
+    } else if constexpr (sizeof(T) == 4) {
+        value = htole32(value);
+    } else {
+        value = htole64(value);
+    }
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+T get(const std::byte *p) noexcept
+{
+    T value{ 0 };
+    std::memcpy(&value, p, sizeof(value));
+    if constexpr (sizeof(T) == 2) {
+        return le16toh(value);
+    } else if constexpr (sizeof(T) == 4) {
+        return le32toh(value);
+    } else {
+        return le64toh(value);
+    }
+}
+
+void putDigest(std::string &out, const std::array<std::byte, 32> &digest)
+{
+    out.append(reinterpret_cast<const char *>(digest.data()), digest.size());
+}
+
+} // namespace
+
+std::array<std::byte, 32> sha256Of(std::string_view data) noexcept
+{
+    digest::SHA256 sha256;
+    std::array<std::byte, 32> digest{};
+    sha256.update(reinterpret_cast<const std::byte *>(data.data()), data.size());
+    sha256.final(digest.data());
+    return digest;
+}
+
+utils::error::Result<LayerIndex> LayerIndex::build(const ErofsImage &image,
+                                                   unsigned threads) noexcept
+{
+    LINGLONG_TRACE("build index of layer");
+
+    LayerIndex index;
+    // the entry to fill the digest of each regular file, hard links are hashed once
+    std::vector<std::size_t> files;
+
+    try {
+        auto root = image.root();
+        if (!root) {
+            return LINGLONG_ERR(root);
+        }
+
+        std::unordered_map<std::uint64_t, std::size_t> hashed;
+        std::vector<std::pair<std::string, ErofsInode>> pending{ { "", *root } };
+        while (!pending.empty()) {
+            auto [parent, dir] = std::move(pending.back());
+            pending.pop_back();
+
+            auto entries = image.readDir(dir);
+            if (!entries) {
+                return LINGLONG_ERR(entries);
+            }
+
+            for (auto &entry : *entries) {
+                auto inode = image.inode(entry.nid);
+                if (!inode) {
+                    return LINGLONG_ERR(inode);
+                }
+
+                auto path = parent.empty() ? std::move(entry.name) : parent + "/" + entry.name;
+                if (path.size() > std::numeric_limits<std::uint16_t>::max()) {
+                    return LINGLONG_ERR(fmt::format("path is too long: {}", path));
+                }
+
+                index.entries_.push_back({ .path = path,
+                                           .mode = inode->mode,
+                                           .size = inode->size,
+                                           .nid = inode->nid });
+                if (S_ISDIR(inode->mode)) {
+                    pending.emplace_back(std::move(path), *inode);
+                } else if (S_ISREG(inode->mode)
+                           && hashed.try_emplace(inode->nid, index.entries_.size() - 1).second) {
+                    files.push_back(index.entries_.size() - 1);
+                }
+            }
+        }
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    std::atomic_size_t next{ 0 };
+    std::atomic_bool failed{ false };
+    std::mutex mutex;
+    utils::error::Result<void> failure = LINGLONG_OK;
+
+    auto hashFile = [&image](LayerIndexEntry &entry) noexcept -> utils::error::Result<void> {
+        LINGLONG_TRACE(fmt::format("hash {}", entry.path));
+
+        auto inode = image.inode(entry.nid);
+        if (!inode) {
+            return LINGLONG_ERR(inode);
+        }
+
+        ErofsFile file{ image, *inode };
+        digest::SHA256 sha256;
+        std::vector<std::byte> buf(1024 * 1024);
+        std::uint64_t offset{ 0 };
+        while (offset < inode->size) {
+            auto len = file.read(offset, buf.data(), buf.size());
+            if (!len) {
+                return LINGLONG_ERR(len);
+            }
+            if (*len == 0) {
+                return LINGLONG_ERR("unexpected end of file");
+            }
+
+            sha256.update(buf.data(), *len);
+            offset += *len;
+        }
+        sha256.final(entry.sha256.data());
+
+        return LINGLONG_OK;
+    };
+
+    auto worker = [&]() noexcept {
+        try {
+            for (auto i = next++; i < files.size() && !failed; i = next++) {
+                auto ret = hashFile(index.entries_[files[i]]);
+                if (ret) {
+                    continue;
+                }
+
+                std::lock_guard lock(mutex);
+                if (!failed.exchange(true)) {
+                    failure = LINGLONG_ERR(ret);
+                }
+            }
+        } catch (const std::exception &e) {
+            std::lock_guard lock(mutex);
+            if (!failed.exchange(true)) {
+                failure = LINGLONG_ERR(e);
+            }
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, files.size()));
+
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(worker);
+        }
+    } catch (...) {
+        // fewer threads are fine
+    }
+
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    if (!failure) {
+        return LINGLONG_ERR(failure);
+    }
+
+    // other links of a hashed file share its digest
+    std::unordered_map<std::uint64_t, std::array<std::byte, 32>> digests;
+    for (auto i : files) {
+        digests.emplace(index.entries_[i].nid, index.entries_[i].sha256);
+    }
+    for (auto &entry : index.entries_) {
+        if (S_ISREG(entry.mode)) {
+            entry.sha256 = digests[entry.nid];
+        }
+    }
+
+    std::sort(index.entries_.begin(), index.entries_.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.path < rhs.path;
+    });
+
+    return index;
+}
+
+utils::error::Result<LayerIndex> LayerIndex::parse(std::string_view data,
+                                                   std::uint32_t count) noexcept
+{
+    LINGLONG_TRACE("parse index of layer");
+
+    LayerIndex index;
+    try {
+        index.entries_.reserve(std::min<std::size_t>(count, data.size() / entryFixedSize));
+        const auto *p = reinterpret_cast<const std::byte *>(data.data());
+        const auto *end = p + data.size();
+        for (std::uint32_t i = 0; i < count; ++i) {
+            if (static_cast<std::size_t>(end - p) < entryFixedSize) {
+                return LINGLONG_ERR("index is truncated");
+            }
+
+            LayerIndexEntry entry;
+            entry.mode = get<std::uint32_t>(p);
+            entry.size = get<std::uint64_t>(p + 4);
+            entry.nid = get<std::uint64_t>(p + 12);
+            std::memcpy(entry.sha256.data(), p + 20, entry.sha256.size());
+            auto length = get<std::uint16_t>(p + 52);
+            p += entryFixedSize;
+            if (static_cast<std::size_t>(end - p) < length) {
+                return LINGLONG_ERR("index is truncated");
+            }
+
+            entry.path.assign(reinterpret_cast<const char *>(p), length);
+            p += length;
+            // find() relies on the order
+            if (!index.entries_.empty() && !(index.entries_.back().path < entry.path)) {
+                return LINGLONG_ERR(fmt::format("index isn't sorted at {}", entry.path));
+            }
+            index.entries_.push_back(std::move(entry));
+        }
+
+        if (p != end) {
+            return LINGLONG_ERR("unexpected data after index");
+        }
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    return index;
+}
+
+std::string LayerIndex::serialize() const
+{
+    std::string out;
+    for (const auto &entry : this->entries_) {
+        put(out, entry.mode);
+        put(out, entry.size);
+        put(out, entry.nid);
+        putDigest(out, entry.sha256);
+        put(out, static_cast<std::uint16_t>(entry.path.size()));
+        out.append(entry.path);
+    }
+
+    return out;
+}
+
+const LayerIndexEntry *LayerIndex::find(std::string_view path) const noexcept
+{
+    auto it = std::lower_bound(this->entries_.begin(),
+                               this->entries_.end(),
+                               path,
+                               [](const LayerIndexEntry &entry, std::string_view path) {
+                                   return entry.path < path;
+                               });
+    if (it == this->entries_.end() || it->path != path) {
+        return nullptr;
+    }
+
+    return &*it;
+}
+
+std::string LayerIndexFooter::serialize() const
+{
+    std::string out{ footerMagic };
+    put(out, this->version);
+    put(out, this->count);
+    put(out, this->imageSize);
+    put(out, this->indexSize);
+    putDigest(out, this->headerSha256);
+    putDigest(out, this->indexSha256);
+    return out;
+}
+
+std::optional<LayerIndexFooter> LayerIndexFooter::parse(const std::byte *data) noexcept
+{
+    if (std::memcmp(data, footerMagic.data(), footerMagic.size()) != 0) {
+        return std::nullopt;
+    }
+
+    LayerIndexFooter footer;
+    footer.version = get<std::uint32_t>(data + 16);
+    footer.count = get<std::uint32_t>(data + 20);
+    footer.imageSize = get<std::uint64_t>(data + 24);
+    footer.indexSize = get<std::uint64_t>(data + 32);
+    std::memcpy(footer.headerSha256.data(), data + 40, footer.headerSha256.size());
+    std::memcpy(footer.indexSha256.data(), data + 72, footer.indexSha256.size());
+    return footer;
+}
+
+} // namespace linglong::package
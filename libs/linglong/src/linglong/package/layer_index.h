@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/package/erofs_image.h"
+#include "linglong/utils/error/error.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace linglong::package {
+
+struct LayerIndexEntry
+{
+    // relative to the root of the layer, the root itself isn't recorded
+    std::string path;
+    std::uint32_t mode{ 0 };
+    std::uint64_t size{ 0 };
+    // where the inode is in the erofs image, see ErofsImage::inode
+    std::uint64_t nid{ 0 };
+    // the digest of the content of a regular file, zeros for others
+    std::array<std::byte, 32> sha256{};
+};
+
+// LayerIndex is the table of contents of a layer file, it lists all files of the erofs image, so
+// the content of a layer can be listed and a single file can be found and verified without
+// mounting or walking the image.
+//
+// Serialized entries are sorted by path, every entry is (little endian):
+//
+// Name              Length (bytes)
+// mode              4
+// size              8
+// nid               8
+// sha256            32
+// path length       2
+// path              path length
+class LayerIndex
+{
+public:
+    // walk the image and hash all regular files by threads, 0 means the number of CPUs
+    static utils::error::Result<LayerIndex> build(const ErofsImage &image,
+                                                  unsigned threads = 0) noexcept;
+    static utils::error::Result<LayerIndex> parse(std::string_view data,
+                                                  std::uint32_t count) noexcept;
+
+    [[nodiscard]] std::string serialize() const;
+    [[nodiscard]] const std::vector<LayerIndexEntry> &entries() const noexcept { return entries_; }
+    [[nodiscard]] const LayerIndexEntry *find(std::string_view path) const noexcept;
+
+private:
+    std::vector<LayerIndexEntry> entries_;
+};
+
+// LayerIndexFooter is the last bytes of a layer file which has an index, old layer files end with
+// the erofs image, which is checked by the magic number and the sizes. All fields are little
+// endian:
+//
+// Name              Length (bytes)    Starts at (bytes)
+// magic number      16                0
+// version           4                 16
+// entry count       4                 20
+// image size        8                 24
+// index size        8                 32
+// header sha256     32                40
+// index sha256      32                72
+struct LayerIndexFooter
+{
+    constexpr static std::size_t size = 104;
+    constexpr static std::uint32_t currentVersion = 1;
+
+    std::uint32_t version{ currentVersion };
+    std::uint32_t count{ 0 };
+    std::uint64_t imageSize{ 0 };
+    std::uint64_t indexSize{ 0 };
+    // the digest of all bytes before the erofs image, i.e. the magic number and the meta info
+    std::array<std::byte, 32> headerSha256{};
+    std::array<std::byte, 32> indexSha256{};
+
+    [[nodiscard]] std::string serialize() const;
+    // nullopt if data doesn't start with the magic number of the footer
+    static std::optional<LayerIndexFooter> parse(const std::byte *data) noexcept;
+};
+
+std::array<std::byte, 32> sha256Of(std::string_view data) noexcept;
+
+} // namespace linglong::package
@@ -8,8 +8,12 @@
 
 #include "linglong/api/types/v1/Generators.hpp"
 #include "linglong/api/types/v1/LayerInfo.hpp"
+#include "linglong/common/error.h"
+#include "linglong/package/erofs_builder.h"
+#include "linglong/package/layer_index.h"
 #include "linglong/utils/cmd.h"
 #include "linglong/utils/file.h"
+#include "linglong/utils/finally/finally.h"
 #include "linglong/utils/log/log.h"
 
 #include <QDataStream>
@@ -19,6 +23,8 @@
 #include <fstream>
 #include <string>
 
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 namespace linglong::package {
@@ -148,14 +154,14 @@ LayerPackager::pack(const LayerDir &dir, const QString &layerFilePath) const
 
     // compress data with erofs
     const auto &compressedFilePath = this->workDir / "tmp.erofs";
-    // 使用-b统一指定block size为4096(2^12), 避免不同系统的兼容问题
-    // loongarch64默认使用(16384)2^14, 在x86和arm64不受支持, 会导致无法推包
-    auto ret = utils::Cmd("mkfs.erofs")
-                 .exec(std::vector<std::string>{ "-z" + compressor.toStdString(),
-                                                 "-b4096",
-                                                 compressedFilePath.string(),
-                                                 "--exclude-regex=minified*",
-                                                 dir.path() });
+    // block size is always 4096(2^12) to avoid compatibility issues between systems, see
+    // mkfsErofsArgs
+    ErofsBuildOptions options{ .compressor = compressor.toStdString(),
+                               .compressionLevel = compressionLevel,
+                               .clusterSize = clusterSize,
+                               .excludeRegex = { "minified*" },
+                               .workers = workers };
+    auto ret = buildErofsImage(compressedFilePath, dir.path(), options);
     if (!ret) {
         return LINGLONG_ERR(ret);
     }
@@ -165,6 +171,14 @@ LayerPackager::pack(const LayerDir &dir, const QString &layerFilePath) const
         return LINGLONG_ERR(res);
     }
 
+    // the index is optional, a layer file without it is still valid
+    res = this->appendIndex(layerFilePath.toStdString(),
+                            compressedFilePath,
+                            number + dataSizeBytes + data);
+    if (!res) {
+        LogW("skip index of layer file: {}", res.error());
+    }
+
     auto result = LayerFile::New(layerFilePath);
     if (!result) {
         return LINGLONG_ERR(result);
@@ -173,6 +187,54 @@ LayerPackager::pack(const LayerDir &dir, const QString &layerFilePath) const
     return result;
 }
 
+utils::error::Result<void> LayerPackager::appendIndex(const std::filesystem::path &layerFile,
+                                                      const std::filesystem::path &imageFile,
+                                                      const QByteArray &header) const
+{
+    LINGLONG_TRACE(fmt::format("append index to {}", layerFile));
+
+    auto fd = ::open(imageFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return LINGLONG_ERR(fmt::format("failed to open {}: {}",
+                                        imageFile,
+                                        common::error::errorString(errno)));
+    }
+    auto image = ErofsImage::open(fd);
+    ::close(fd);
+    if (!image) {
+        return LINGLONG_ERR(image);
+    }
+
+    auto index = LayerIndex::build(**image);
+    if (!index) {
+        return LINGLONG_ERR(index);
+    }
+
+    std::error_code ec;
+    auto imageSize = std::filesystem::file_size(imageFile, ec);
+    if (ec) {
+        return LINGLONG_ERR("failed to get size of erofs image", ec);
+    }
+
+    auto data = index->serialize();
+    LayerIndexFooter footer;
+    footer.count = static_cast<std::uint32_t>(index->entries().size());
+    footer.imageSize = imageSize;
+    footer.indexSize = data.size();
+    footer.headerSha256 = sha256Of({ header.constData(), static_cast<std::size_t>(header.size()) });
+    footer.indexSha256 = sha256Of(data);
+    data += footer.serialize();
+
+    std::ofstream out(layerFile, std::ios::binary | std::ios::app);
+    out.write(data.data(), static_cast<std::streamsize>(data.size()));
+    out.close();
+    if (!out) {
+        return LINGLONG_ERR(fmt::format("failed to write index to {}", layerFile));
+    }
+
+    return LINGLONG_OK;
+}
+
 // 判断fd是否可在其他进程读取
 bool LayerPackager::isFileReadable(const std::string &path) const
 {
@@ -186,27 +248,31 @@ utils::error::Result<void> LayerPackager::copyFile(LayerFile &file,
                                                    const int64_t offset) const
 {
     LINGLONG_TRACE("save file");
-    file.seek(offset);
-    std::ofstream ofs(toPath);
-    char buff[4096];
-    while (true) {
-        auto n = file.read(buff, 4096);
-        if (n < 0) {
-            return LINGLONG_ERR("Failed to read from layer file: "
-                                + file.errorString().toStdString());
-        }
-        if (n == 0) {
-            break;
-        }
-        ofs.write(buff, n);
-        if (ofs.fail()) {
-            return LINGLONG_ERR("Failed to write to temporary file");
-        }
+
+    struct stat st{};
+    if (::fstat(file.handle(), &st) == -1) {
+        return LINGLONG_ERR(
+          fmt::format("failed to stat layer file: {}", common::error::errorString(errno)));
+    }
+    if (st.st_size < offset) {
+        return LINGLONG_ERR("layer file is truncated");
+    }
+
+    auto out = ::open(toPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out == -1) {
+        return LINGLONG_ERR(fmt::format("failed to open {}: {}",
+                                        toPath,
+                                        common::error::errorString(errno)));
     }
-    ofs.close();
-    if (ofs.fail()) {
-        return LINGLONG_ERR("Failed to close temporary file");
+    auto closeOut = utils::finally::finally([out] {
+        ::close(out);
+    });
+
+    auto ret = utils::copyRange(file.handle(), offset, out, 0, st.st_size - offset);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
     }
+
     return LINGLONG_OK;
 }
 
@@ -252,6 +318,7 @@ utils::error::Result<LayerDir> LayerPackager::unpack(LayerFile &file)
         this->isMounted = true;
         return unpackDir;
     }
+
     // 判断fsck.erofs命令是否存在，fsck.erofs是erofs-utils的命令，可用于解压erofs文件
     // 在旧版本中fsck.erofs不支持offset参数，所以需要提前将erofs文件复制到临时目录
     auto erofsFscExistsRet = utils::Cmd("fsck.erofs").exists();
@@ -278,6 +345,21 @@ void LayerPackager::setCompressor(const QString &compressor) noexcept
     this->compressor = compressor;
 }
 
+void LayerPackager::setCompressionLevel(int level) noexcept
+{
+    this->compressionLevel = level;
+}
+
+void LayerPackager::setClusterSize(std::size_t size) noexcept
+{
+    this->clusterSize = size;
+}
+
+void LayerPackager::setWorkers(unsigned workers) noexcept
+{
+    this->workers = workers;
+}
+
 utils::error::Result<bool> LayerPackager::checkErofsFuseExists() const
 {
     return utils::Cmd("erofsfuse").exists();
@@ -15,6 +15,7 @@
 #include <QUuid>
 
 #include <filesystem>
+#include <optional>
 #include <string>
 
 namespace linglong::package {
@@ -34,16 +35,28 @@ public:
     ~LayerPackager() override;
     utils::error::Result<QSharedPointer<LayerFile>> pack(const LayerDir &dir,
                                                          const QString &layerFilePath) const;
+    // unpack the layer by erofs-utils, for images which LayerFile::openImage doesn't support
     utils::error::Result<LayerDir> unpack(LayerFile &file);
     void setCompressor(const QString &compressor) noexcept;
+    void setCompressionLevel(int level) noexcept;
+    void setClusterSize(std::size_t size) noexcept;
+    // 压缩线程数，0表示CPU数
+    void setWorkers(unsigned workers) noexcept;
     const std::filesystem::path &getWorkDir() const;
 
 private:
     std::filesystem::path workDir;
     QString compressor = "lzma";
+    std::optional<int> compressionLevel;
+    std::optional<std::size_t> clusterSize;
+    unsigned workers{ 0 };
     bool isMounted = false;
     // 初始化工作目录
     utils::error::Result<void> initWorkDir();
+    // 为layer文件追加索引，旧版本会忽略镜像后的索引
+    utils::error::Result<void> appendIndex(const std::filesystem::path &layerFile,
+                                           const std::filesystem::path &imageFile,
+                                           const QByteArray &header) const;
     // 检查erofs-fuse命令是否存在
     virtual utils::error::Result<bool> checkErofsFuseExists() const;
     // 创建目录，用于单元测试
@@ -0,0 +1,579 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/package/ld_cache.h"
+
+#include "linglong/common/strings.h"
+#include "linglong/utils/finally/finally.h"
+#include "linglong/utils/log/log.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
+#include <elf.h>
+#include <endian.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <unistd.h>
+
+namespace linglong::package {
+
+namespace {
+
+// see sysdeps/generic/dl-cache.h of glibc
+constexpr std::string_view cacheMagic = "glibc-ld.so.cache1.1";
+constexpr std::size_t headerSize = 48;
+constexpr std::size_t entrySize = 24;
+
+constexpr std::int32_t flagELFLibc6 = 0x0003;
+constexpr std::int32_t flagX8664Lib64 = 0x0300;
+constexpr std::int32_t flagMIPS64LibN64 = 0x0700;
+constexpr std::int32_t flagAArch64Lib64 = 0x0a00;
+constexpr std::int32_t flagMIPS64LibN64NaN2008 = 0x0e00;
+constexpr std::int32_t flagRISCVFloatABISoft = 0x0f00;
+constexpr std::int32_t flagRISCVFloatABIDouble = 0x1000;
+constexpr std::int32_t flagLArchFloatABISoft = 0x1100;
+constexpr std::int32_t flagLArchFloatABIDouble = 0x1200;
+
+// the loader doesn't follow more includes than this
+constexpr int maxIncludeDepth = 16;
+
+struct Library
+{
+    std::int32_t flags{ 0 };
+    std::string soname;
+};
+
+struct Entry
+{
+    std::string key;
+    std::string value;
+    std::int32_t flags{ 0 };
+};
+
+// the same order as _dl_cache_libcmp of glibc, digits are compared as numbers
+int libcmp(std::string_view lhs, std::string_view rhs) noexcept
+{
+    auto isDigit = [](char c) {
+        return c >= '0' && c <= '9';
+    };
+
+    std::size_t i{ 0 };
+    std::size_t j{ 0 };
+    while (i < lhs.size()) {
+        if (j >= rhs.size()) {
+            return 1;
+        }
+
+        if (isDigit(lhs[i])) {
+            if (!isDigit(rhs[j])) {
+                return 1;
+            }
+
+            std::uint64_t lval{ 0 };
+            std::uint64_t rval{ 0 };
+            while (i < lhs.size() && isDigit(lhs[i])) {
+                lval = lval * 10 + static_cast<std::uint64_t>(lhs[i++] - '0');
+            }
+            while (j < rhs.size() && isDigit(rhs[j])) {
+                rval = rval * 10 + static_cast<std::uint64_t>(rhs[j++] - '0');
+            }
+            if (lval != rval) {
+                return lval < rval ? -1 : 1;
+            }
+            continue;
+        }
+
+        if (isDigit(rhs[j])) {
+            return -1;
+        }
+
+        if (lhs[i] != rhs[j]) {
+            return static_cast<unsigned char>(lhs[i]) < static_cast<unsigned char>(rhs[j]) ? -1
+                                                                                             : 1;
+        }
+
+        ++i;
+        ++j;
+    }
+
+    return j < rhs.size() ? -1 : 0;
+}
+
+bool readAt(int fd, void *buf, std::size_t len, std::uint64_t offset) noexcept
+{
+    auto *p = static_cast<char *>(buf);
+    while (len > 0) {
+        auto ret = ::pread(fd, p, len, static_cast<off_t>(offset));
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+
+        p += ret;
+        len -= static_cast<std::size_t>(ret);
+        offset += static_cast<std::uint64_t>(ret);
+    }
+
+    return true;
+}
+
+// the flags of a library as readelflib.c of glibc computes them, nullopt if the library can't be
+// loaded by the dynamic linker of the architecture
+std::optional<std::int32_t> libraryFlags(const Elf64_Ehdr &ehdr, std::uint16_t machine) noexcept
+{
+    if (ehdr.e_machine != machine) {
+        return std::nullopt;
+    }
+
+    switch (machine) {
+    case EM_X86_64:
+        return flagX8664Lib64 | flagELFLibc6;
+    case EM_AARCH64:
+        return flagAArch64Lib64 | flagELFLibc6;
+    case EM_LOONGARCH:
+        switch (ehdr.e_flags & EF_LARCH_ABI_MODIFIER_MASK) {
+        case EF_LARCH_ABI_SOFT_FLOAT:
+            return flagLArchFloatABISoft | flagELFLibc6;
+        case EF_LARCH_ABI_DOUBLE_FLOAT:
+            return flagLArchFloatABIDouble | flagELFLibc6;
+        default:
+            return std::nullopt;
+        }
+    case EM_MIPS:
+        return ((ehdr.e_flags & EF_MIPS_NAN2008) != 0 ? flagMIPS64LibN64NaN2008 : flagMIPS64LibN64)
+          | flagELFLibc6;
+    case EM_RISCV:
+        switch (ehdr.e_flags & EF_RISCV_FLOAT_ABI) {
+        case EF_RISCV_FLOAT_ABI_SOFT:
+            return flagRISCVFloatABISoft | flagELFLibc6;
+        case EF_RISCV_FLOAT_ABI_DOUBLE:
+            return flagRISCVFloatABIDouble | flagELFLibc6;
+        default:
+            return std::nullopt;
+        }
+    default:
+        return std::nullopt;
+    }
+}
+
+// read the flags and the DT_SONAME of a shared library, the soname is empty if there is none,
+// nullopt if it isn't a shared library of the architecture
+std::optional<Library> readLibrary(const std::filesystem::path &path, std::uint16_t machine)
+{
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return std::nullopt;
+    }
+
+    auto closeFd = utils::finally::finally([fd] {
+        ::close(fd);
+    });
+
+    Elf64_Ehdr ehdr{};
+    if (!readAt(fd, &ehdr, sizeof(ehdr), 0)
+        || std::memcmp(ehdr.e_ident, ELFMAG, SELFMAG) != 0
+        || ehdr.e_ident[EI_CLASS] != ELFCLASS64
+        || ehdr.e_ident[EI_DATA] != (__BYTE_ORDER == __LITTLE_ENDIAN ? ELFDATA2LSB : ELFDATA2MSB)
+        || ehdr.e_type != ET_DYN || ehdr.e_phentsize != sizeof(Elf64_Phdr)) {
+        return std::nullopt;
+    }
+
+    auto flags = libraryFlags(ehdr, machine);
+    if (!flags) {
+        return std::nullopt;
+    }
+
+    std::vector<Elf64_Phdr> phdrs(ehdr.e_phnum);
+    if (!readAt(fd, phdrs.data(), phdrs.size() * sizeof(Elf64_Phdr), ehdr.e_phoff)) {
+        return std::nullopt;
+    }
+
+    Library library{ .flags = *flags };
+    auto dynamic = std::find_if(phdrs.begin(), phdrs.end(), [](const Elf64_Phdr &phdr) {
+        return phdr.p_type == PT_DYNAMIC;
+    });
+    if (dynamic == phdrs.end()) {
+        return library;
+    }
+
+    std::vector<Elf64_Dyn> dyns(dynamic->p_filesz / sizeof(Elf64_Dyn));
+    if (!readAt(fd, dyns.data(), dyns.size() * sizeof(Elf64_Dyn), dynamic->p_offset)) {
+        return std::nullopt;
+    }
+
+    std::optional<std::uint64_t> strtab;
+    std::optional<std::uint64_t> soname;
+    for (const auto &dyn : dyns) {
+        if (dyn.d_tag == DT_NULL) {
+            break;
+        }
+        if (dyn.d_tag == DT_STRTAB) {
+            strtab = dyn.d_un.d_ptr;
+        } else if (dyn.d_tag == DT_SONAME) {
+            soname = dyn.d_un.d_val;
+        }
+    }
+    if (!strtab || !soname) {
+        return library;
+    }
+
+    // DT_STRTAB is an address, find where it is in the file
+    for (const auto &phdr : phdrs) {
+        if (phdr.p_type != PT_LOAD || *strtab < phdr.p_vaddr
+            || *strtab - phdr.p_vaddr >= phdr.p_filesz) {
+            continue;
+        }
+
+        auto offset = *strtab - phdr.p_vaddr + phdr.p_offset + *soname;
+        std::string buf(256, '\0');
+        auto len = ::pread(fd, buf.data(), buf.size(), static_cast<off_t>(offset));
+        if (len <= 0) {
+            return std::nullopt;
+        }
+
+        buf.resize(static_cast<std::size_t>(len));
+        auto end = buf.find('\0');
+        if (end == std::string::npos) {
+            return std::nullopt;
+        }
+
+        buf.resize(end);
+        library.soname = std::move(buf);
+        break;
+    }
+
+    return library;
+}
+
+class Generator
+{
+public:
+    Generator(const std::vector<LDCacheRoot> &roots, std::uint16_t machine)
+        : roots(roots)
+        , machine(machine)
+    {
+    }
+
+    // the path of a container path on the host, nullopt if it isn't in any root
+    [[nodiscard]] std::optional<std::filesystem::path> toSource(const std::string &path) const
+    {
+        auto normalized = std::filesystem::path{ path }.lexically_normal();
+        for (const auto &root : this->roots) {
+            auto relative = normalized.lexically_relative(root.mountPoint);
+            if (relative.empty() || *relative.begin() == "..") {
+                continue;
+            }
+
+            return relative == "." ? root.source : root.source / relative;
+        }
+
+        return std::nullopt;
+    }
+
+    void addDirectory(const std::string &dir)
+    {
+        auto normalized = std::filesystem::path{ dir }.lexically_normal().string();
+        if (normalized.size() > 1 && normalized.back() == '/') {
+            normalized.pop_back();
+        }
+
+        if (std::find(this->dirs.begin(), this->dirs.end(), normalized) == this->dirs.end()) {
+            this->dirs.push_back(std::move(normalized));
+        }
+    }
+
+    // parse a ld.so.conf in the container like parse_conf of ldconfig
+    void parseConf(const std::string &conf, int depth)
+    {
+        if (depth > maxIncludeDepth) {
+            LogW("too many nested includes in {}", conf);
+            return;
+        }
+
+        auto source = this->toSource(conf);
+        if (!source) {
+            LogD("ignore {} which isn't in the bundle", conf);
+            return;
+        }
+
+        std::ifstream stream{ *source };
+        if (!stream.is_open()) {
+            return;
+        }
+
+        std::string line;
+        while (std::getline(stream, line)) {
+            if (auto comment = line.find('#'); comment != std::string::npos) {
+                line.resize(comment);
+            }
+            auto trimmed = common::strings::trim(line, " \t\r");
+            if (trimmed.empty()) {
+                continue;
+            }
+
+            if (common::strings::starts_with(trimmed, "include ")
+                || common::strings::starts_with(trimmed, "include\t")) {
+                auto patterns = common::strings::split(trimmed.substr(8),
+                                                       ' ',
+                                                       common::strings::splitOption::SkipEmpty);
+                for (auto pattern : patterns) {
+                    this->parseInclude(conf,
+                                       std::string{ common::strings::trim(pattern, "\t") },
+                                       depth);
+                }
+                continue;
+            }
+
+            if (common::strings::starts_with(trimmed, "hwcap")) {
+                continue;
+            }
+
+            this->addDirectory(std::string{ trimmed });
+        }
+    }
+
+    void parseInclude(const std::string &conf, const std::string &pattern, int depth)
+    {
+        if (pattern.empty()) {
+            return;
+        }
+
+        auto containerPattern = pattern.front() == '/'
+          ? pattern
+          : (std::filesystem::path{ conf }.parent_path() / pattern).string();
+        auto source = this->toSource(containerPattern);
+        if (!source) {
+            LogD("ignore {} which isn't in the bundle", containerPattern);
+            return;
+        }
+
+        glob_t result{};
+        if (::glob(source->c_str(), 0, nullptr, &result) != 0) {
+            ::globfree(&result);
+            return;
+        }
+
+        // map the matched files back to the container, the prefix is the same as the pattern
+        auto prefix = std::filesystem::path{ containerPattern }.parent_path();
+        auto sourcePrefix = source->parent_path();
+        std::vector<std::string> matches;
+        for (std::size_t i = 0; i < result.gl_pathc; ++i) {
+            std::filesystem::path matched{ result.gl_pathv[i] };
+            matches.push_back((prefix / matched.lexically_relative(sourcePrefix)).string());
+        }
+        ::globfree(&result);
+
+        for (const auto &match : matches) {
+            this->parseConf(match, depth + 1);
+        }
+    }
+
+    // follow a symlink in the container, absolute targets are resolved in the roots
+    [[nodiscard]] std::optional<std::filesystem::path>
+    resolve(const std::filesystem::path &containerPath) const
+    {
+        auto current = containerPath;
+        for (int i = 0; i < 40; ++i) {
+            auto source = this->toSource(current.string());
+            if (!source) {
+                return std::nullopt;
+            }
+
+            std::error_code ec;
+            auto status = std::filesystem::symlink_status(*source, ec);
+            if (ec) {
+                return std::nullopt;
+            }
+            if (!std::filesystem::is_symlink(status)) {
+                return std::filesystem::is_regular_file(status) ? source : std::nullopt;
+            }
+
+            auto target = std::filesystem::read_symlink(*source, ec);
+            if (ec) {
+                return std::nullopt;
+            }
+            current = target.is_absolute() ? target : current.parent_path() / target;
+        }
+
+        return std::nullopt;
+    }
+
+    void scanDirectory(const std::string &dir)
+    {
+        auto source = this->toSource(dir);
+        if (!source) {
+            LogD("ignore {} which isn't in the bundle", dir);
+            return;
+        }
+
+        std::error_code ec;
+        std::vector<std::string> names;
+        for (const auto &entry : std::filesystem::directory_iterator(*source, ec)) {
+            auto name = entry.path().filename().string();
+            if ((common::strings::starts_with(name, "lib")
+                 || common::strings::starts_with(name, "ld-"))
+                && name.find(".so") != std::string::npos) {
+                names.push_back(std::move(name));
+            }
+        }
+        if (ec) {
+            return;
+        }
+
+        // keep the cache reproducible
+        std::sort(names.begin(), names.end());
+
+        std::set<std::string> keys;
+        for (const auto &name : names) {
+            auto path = std::filesystem::path{ dir } / name;
+            auto real = this->resolve(path);
+            if (!real) {
+                continue;
+            }
+
+            auto library = readLibrary(*real, this->machine);
+            if (!library) {
+                continue;
+            }
+
+            // like ldconfig, the key is the soname, except the link for the linker, e.g. libfoo.so
+            // which points to libfoo.so.1, is a key too
+            auto key = library->soname.empty() ? name : library->soname;
+            if (std::filesystem::is_symlink(*this->toSource(path.string()), ec)
+                && common::strings::ends_with(name, ".so")
+                && common::strings::starts_with(key, name)) {
+                key = name;
+            }
+
+            if (!keys.insert(key).second) {
+                continue;
+            }
+
+            auto value = std::filesystem::path{ dir } / key;
+            if (!this->resolve(value)) {
+                // ldconfig would create the soname link, the bundle is read only
+                value = path;
+            }
+
+            this->entries.push_back(
+              Entry{ .key = std::move(key), .value = value.string(), .flags = library->flags });
+        }
+    }
+
+    [[nodiscard]] std::string serialize()
+    {
+        // ld.so searches entries by binary search, in the descending order of keys, and takes the
+        // first one which matches, so stable_sort keeps the precedence of directories
+        std::stable_sort(this->entries.begin(),
+                         this->entries.end(),
+                         [](const Entry &lhs, const Entry &rhs) {
+                             auto cmp = libcmp(lhs.key, rhs.key);
+                             if (cmp != 0) {
+                                 return cmp > 0;
+                             }
+                             return lhs.flags > rhs.flags;
+                         });
+
+        std::string strings;
+        std::unordered_map<std::string, std::uint32_t> offsets;
+        auto stringsOffset = headerSize + this->entries.size() * entrySize;
+        auto offsetOf = [&](const std::string &str) {
+            auto [it, inserted] = offsets.try_emplace(str, 0);
+            if (inserted) {
+                it->second = static_cast<std::uint32_t>(stringsOffset + strings.size());
+                strings.append(str);
+                strings.push_back('\0');
+            }
+            return it->second;
+        };
+
+        std::string out{ cacheMagic };
+        auto put = [&out](auto value) {
+            out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+
+        put(static_cast<std::uint32_t>(this->entries.size()));
+        auto lenStrings = out.size();
+        put(std::uint32_t{ 0 });
+        // flags, the endianness of the cache
+        put(static_cast<std::uint8_t>(__BYTE_ORDER == __LITTLE_ENDIAN ? 2 : 3));
+        out.append(3, '\0');
+        // extension_offset and unused
+        out.append(16, '\0');
+
+        for (const auto &entry : this->entries) {
+            put(entry.flags);
+            put(offsetOf(entry.key));
+            put(offsetOf(entry.value));
+            // osversion
+            put(std::uint32_t{ 0 });
+            // hwcap
+            put(std::uint64_t{ 0 });
+        }
+
+        auto len = static_cast<std::uint32_t>(strings.size());
+        std::memcpy(out.data() + lenStrings, &len, sizeof(len));
+        out.append(strings);
+        return out;
+    }
+
+    const std::vector<LDCacheRoot> &roots;
+    std::uint16_t machine;
+    std::vector<std::string> dirs;
+    std::vector<Entry> entries;
+};
+
+} // namespace
+
+utils::error::Result<std::string> generateLDCache(const std::vector<LDCacheRoot> &roots,
+                                                  const Architecture &arch) noexcept
+{
+    LINGLONG_TRACE(fmt::format("generate ld.so.cache for {}", arch.toString()));
+
+    std::uint16_t machine{ EM_NONE };
+    if (arch == Architecture(Architecture::X86_64)) {
+        machine = EM_X86_64;
+    } else if (arch == Architecture(Architecture::ARM64)) {
+        machine = EM_AARCH64;
+    } else if (arch == Architecture(Architecture::LOONG64)) {
+        machine = EM_LOONGARCH;
+    } else if (arch == Architecture(Architecture::MIPS64)) {
+        machine = EM_MIPS;
+    } else if (arch == Architecture(Architecture::RISCV64)) {
+        machine = EM_RISCV;
+    } else {
+        // the flags of the other dynamic linkers are unknown
+        return LINGLONG_ERR("unsupported architecture");
+    }
+
+    try {
+        Generator generator{ roots, machine };
+        auto triplet = arch.getTriplet();
+        for (const auto &root : roots) {
+            generator.addDirectory(root.mountPoint + "/lib");
+            generator.addDirectory(root.mountPoint + "/lib/" + triplet);
+            generator.parseConf(root.mountPoint + "/etc/ld.so.conf", 0);
+        }
+
+        for (const auto &dir : generator.dirs) {
+            generator.scanDirectory(dir);
+        }
+
+        return generator.serialize();
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+}
+
+} // namespace linglong::package
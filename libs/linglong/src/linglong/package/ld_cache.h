@@ -0,0 +1,32 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/package/architecture.h"
+#include "linglong/utils/error/error.h"
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace linglong::package {
+
+// LDCacheRoot is a directory which will be mounted at mountPoint in the container
+struct LDCacheRoot
+{
+    std::string mountPoint;
+    std::filesystem::path source;
+};
+
+// generateLDCache scans the library directories of every root like ldconfig does with the
+// configuration generated by ContainerCfgBuilder::ldConf, i.e. lib, lib/<triplet> and the
+// directories listed in etc/ld.so.conf, and returns an ld.so.cache in the glibc "new" format.
+//
+// All paths in the cache are paths in the container, directories which aren't in any root are
+// ignored. Earlier roots and directories take precedence over later ones, as in ld.so.conf.
+utils::error::Result<std::string> generateLDCache(const std::vector<LDCacheRoot> &roots,
+                                                  const Architecture &arch) noexcept;
+
+} // namespace linglong::package
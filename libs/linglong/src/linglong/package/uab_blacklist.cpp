@@ -0,0 +1,85 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/package/uab_blacklist.h"
+
+#include <algorithm>
+
+namespace linglong::package {
+
+namespace {
+
+bool lessCharacter(const std::pair<char, std::uint32_t> &child, char c) noexcept
+{
+    return child.first < c;
+}
+
+} // namespace
+
+UABBlacklist::UABBlacklist() noexcept
+    : nodes(1)
+{
+}
+
+bool UABBlacklist::insert(std::string_view entry)
+{
+    std::uint32_t current{ 0 };
+    for (auto c : entry) {
+        auto &children = nodes[current].children;
+        auto it = std::lower_bound(children.begin(), children.end(), c, lessCharacter);
+        if (it != children.end() && it->first == c) {
+            current = it->second;
+            continue;
+        }
+
+        auto next = static_cast<std::uint32_t>(nodes.size());
+        children.emplace(it, c, next);
+        // children is invalidated by growing nodes
+        nodes.emplace_back();
+        current = next;
+    }
+
+    if (nodes[current].terminal) {
+        return false;
+    }
+
+    nodes[current].terminal = true;
+    ++count;
+    return true;
+}
+
+const UABBlacklist::Node *UABBlacklist::child(const Node &node, char c) const noexcept
+{
+    auto it = std::lower_bound(node.children.begin(), node.children.end(), c, lessCharacter);
+    if (it == node.children.end() || it->first != c) {
+        return nullptr;
+    }
+
+    return &nodes[it->second];
+}
+
+bool UABBlacklist::matches(std::string_view fileName) const noexcept
+{
+    if (count == 0) {
+        return false;
+    }
+
+    const auto *node = &nodes.front();
+    for (auto c : fileName) {
+        // an entry is a prefix of the file name
+        if (node->terminal) {
+            return true;
+        }
+
+        node = child(*node, c);
+        if (node == nullptr) {
+            return false;
+        }
+    }
+
+    // the file name is a prefix of an entry, every node leads to at least one entry
+    return true;
+}
+
+} // namespace linglong::package
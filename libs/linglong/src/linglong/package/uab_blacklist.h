@@ -0,0 +1,44 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace linglong::package {
+
+// file names which are assumed to be present on the host and never bundled into an UAB.
+// A file name matches an entry if either of them is a prefix of the other, so that an entry
+// followed by a comment still matches. The entries are kept in a character trie, a lookup costs
+// the length of the file name, no matter how many entries there are.
+class UABBlacklist
+{
+public:
+    UABBlacklist() noexcept;
+
+    // returns false if the entry exists
+    bool insert(std::string_view entry);
+
+    [[nodiscard]] bool matches(std::string_view fileName) const noexcept;
+
+    [[nodiscard]] std::size_t size() const noexcept { return count; }
+
+private:
+    struct Node
+    {
+        // sorted by the character
+        std::vector<std::pair<char, std::uint32_t>> children;
+        bool terminal{ false };
+    };
+
+    [[nodiscard]] const Node *child(const Node &node, char c) const noexcept;
+
+    std::vector<Node> nodes;
+    std::size_t count{ 0 };
+};
+
+} // namespace linglong::package
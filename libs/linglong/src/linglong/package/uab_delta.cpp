@@ -0,0 +1,481 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/package/uab_delta.h"
+
+#include "linglong/common/error.h"
+#include "linglong/utils/file.h"
+#include "linglong/utils/sha256.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <endian.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace linglong::package {
+
+namespace {
+
+constexpr std::string_view deltaMagic = "LLUABDLT";
+
+enum class OperationKind : std::uint8_t {
+    Copy = 0,
+    Data = 1,
+    End = 2,
+};
+
+template <typename T>
+void put(std::string &out, T value)
+{
+    if constexpr (sizeof(T) == 1) {
+        // no byte order
+    } else if constexpr (sizeof(T) == 4) {
+        value = htole32(value);
+    } else {
+        value = htole64(value);
+    }
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+T get(const std::byte *p) noexcept
+{
+    T value{ 0 };
+    std::memcpy(&value, p, sizeof(value));
+    if constexpr (sizeof(T) == 1) {
+        return value;
+    } else if constexpr (sizeof(T) == 4) {
+        return le32toh(value);
+    } else {
+        return le64toh(value);
+    }
+}
+
+utils::error::Result<void>
+writeAt(int fd, std::uint64_t offset, const void *data, std::size_t size) noexcept
+{
+    LINGLONG_TRACE(fmt::format("write {} bytes at {}", size, offset));
+
+    const auto *p = static_cast<const char *>(data);
+    for (std::size_t done = 0; done < size;) {
+        auto ret = ::pwrite(fd, p + done, size - done, static_cast<off_t>(offset + done));
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ret == -1) {
+            return LINGLONG_ERR(common::error::errorString(errno));
+        }
+        done += static_cast<std::size_t>(ret);
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<void>
+readAt(int fd, std::uint64_t offset, void *data, std::size_t size) noexcept
+{
+    LINGLONG_TRACE(fmt::format("read {} bytes at {}", size, offset));
+
+    auto *p = static_cast<char *>(data);
+    for (std::size_t done = 0; done < size;) {
+        auto ret = ::pread(fd, p + done, size - done, static_cast<off_t>(offset + done));
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ret == -1) {
+            return LINGLONG_ERR(common::error::errorString(errno));
+        }
+        if (ret == 0) {
+            return LINGLONG_ERR("unexpected end of file");
+        }
+        done += static_cast<std::size_t>(ret);
+    }
+
+    return LINGLONG_OK;
+}
+
+// the whole file is mapped, the blocks of the old file are compared at random offsets
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (data != nullptr) {
+            ::munmap(const_cast<std::byte *>(data), size);
+        }
+    }
+
+    utils::error::Result<void> map(int fd) noexcept
+    {
+        LINGLONG_TRACE("map file");
+
+        struct stat st{};
+        if (::fstat(fd, &st) == -1) {
+            return LINGLONG_ERR(common::error::errorString(errno));
+        }
+
+        size = static_cast<std::uint64_t>(st.st_size);
+        if (size == 0) {
+            return LINGLONG_OK;
+        }
+
+        auto *mem = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mem == MAP_FAILED) {
+            return LINGLONG_ERR(common::error::errorString(errno));
+        }
+
+        data = static_cast<const std::byte *>(mem);
+        return LINGLONG_OK;
+    }
+
+    [[nodiscard]] std::string_view view(std::uint64_t offset, std::uint64_t length) const noexcept
+    {
+        return { reinterpret_cast<const char *>(data) + offset, length };
+    }
+
+    const std::byte *data{ nullptr };
+    std::uint64_t size{ 0 };
+};
+
+// appends operations to the delta, data isn't copied until it's written
+class DeltaWriter
+{
+public:
+    DeltaWriter(int fd, const MappedFile &newFile) noexcept
+        : fd(fd)
+        , newFile(newFile)
+        , offset(UABDeltaHeader::size)
+    {
+    }
+
+    utils::error::Result<void> copy(std::uint64_t oldOffset, std::uint64_t length) noexcept
+    {
+        LINGLONG_TRACE("append copy operation");
+
+        if (copyLength != 0 && copyOffset + copyLength == oldOffset) {
+            copyLength += length;
+            return LINGLONG_OK;
+        }
+
+        if (auto ret = flush(); !ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        copyOffset = oldOffset;
+        copyLength = length;
+        return LINGLONG_OK;
+    }
+
+    utils::error::Result<void> data(std::uint64_t newOffset, std::uint64_t length) noexcept
+    {
+        LINGLONG_TRACE("append data operation");
+
+        if (dataLength != 0 && dataOffset + dataLength == newOffset) {
+            dataLength += length;
+            return LINGLONG_OK;
+        }
+
+        if (auto ret = flush(); !ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        dataOffset = newOffset;
+        dataLength = length;
+        return LINGLONG_OK;
+    }
+
+    utils::error::Result<void> finish() noexcept
+    {
+        LINGLONG_TRACE("finish delta");
+
+        if (auto ret = flush(); !ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        std::string op;
+        put(op, static_cast<std::uint8_t>(OperationKind::End));
+        return writeAt(fd, offset, op.data(), op.size());
+    }
+
+    UABDeltaStat stat;
+
+private:
+    utils::error::Result<void> flush() noexcept
+    {
+        LINGLONG_TRACE("flush operation");
+
+        std::string op;
+        if (copyLength != 0) {
+            put(op, static_cast<std::uint8_t>(OperationKind::Copy));
+            put(op, copyLength);
+            put(op, copyOffset);
+            stat.copied += copyLength;
+            copyLength = 0;
+        } else if (dataLength != 0) {
+            put(op, static_cast<std::uint8_t>(OperationKind::Data));
+            put(op, dataLength);
+        } else {
+            return LINGLONG_OK;
+        }
+
+        if (auto ret = writeAt(fd, offset, op.data(), op.size()); !ret) {
+            return LINGLONG_ERR(ret);
+        }
+        offset += op.size();
+
+        if (dataLength != 0) {
+            if (auto ret = writeAt(fd, offset, newFile.data + dataOffset, dataLength); !ret) {
+                return LINGLONG_ERR(ret);
+            }
+            offset += dataLength;
+            stat.stored += dataLength;
+            dataLength = 0;
+        }
+
+        return LINGLONG_OK;
+    }
+
+    int fd;
+    const MappedFile &newFile;
+    std::uint64_t offset;
+    std::uint64_t copyOffset{ 0 };
+    std::uint64_t copyLength{ 0 };
+    std::uint64_t dataOffset{ 0 };
+    std::uint64_t dataLength{ 0 };
+};
+
+} // namespace
+
+std::string UABDeltaHeader::serialize() const
+{
+    std::string out{ deltaMagic };
+    put(out, this->version);
+    put(out, this->blockSize);
+    put(out, this->oldSize);
+    put(out, this->newSize);
+    out.append(reinterpret_cast<const char *>(this->newSha256.data()), this->newSha256.size());
+    return out;
+}
+
+std::optional<UABDeltaHeader> UABDeltaHeader::parse(const std::byte *data) noexcept
+{
+    if (std::memcmp(data, deltaMagic.data(), deltaMagic.size()) != 0) {
+        return std::nullopt;
+    }
+
+    UABDeltaHeader header;
+    header.version = get<std::uint32_t>(data + 8);
+    header.blockSize = get<std::uint32_t>(data + 12);
+    header.oldSize = get<std::uint64_t>(data + 16);
+    header.newSize = get<std::uint64_t>(data + 24);
+    std::memcpy(header.newSha256.data(), data + 32, header.newSha256.size());
+    return header;
+}
+
+utils::error::Result<UABDeltaStat> createUABDelta(int oldFd,
+                                                  std::uint64_t oldAlign,
+                                                  int newFd,
+                                                  std::uint64_t newAlign,
+                                                  int deltaFd) noexcept
+{
+    LINGLONG_TRACE("create uab delta");
+
+    constexpr std::uint64_t blockSize = uab_delta_block_size;
+    MappedFile oldFile;
+    MappedFile newFile;
+    if (auto ret = oldFile.map(oldFd); !ret) {
+        return LINGLONG_ERR("old file", ret);
+    }
+    if (auto ret = newFile.map(newFd); !ret) {
+        return LINGLONG_ERR("new file", ret);
+    }
+
+    // the first block of every content in the old file, hash collisions are resolved by
+    // comparing the blocks
+    std::unordered_map<std::size_t, std::uint64_t> blocks;
+    try {
+        blocks.reserve(oldFile.size / blockSize);
+        for (auto offset = oldAlign % blockSize; offset + blockSize <= oldFile.size;
+             offset += blockSize) {
+            blocks.emplace(std::hash<std::string_view>{}(oldFile.view(offset, blockSize)), offset);
+        }
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR("index blocks of old file", e);
+    }
+
+    DeltaWriter writer{ deltaFd, newFile };
+    digest::SHA256 sha256;
+    // the old offset of the block after the last copied one
+    std::optional<std::uint64_t> next;
+    for (std::uint64_t offset = 0; offset < newFile.size;) {
+        auto end = (offset + blockSize - newAlign % blockSize) / blockSize * blockSize
+          + newAlign % blockSize;
+        end = std::min(end, newFile.size);
+        auto length = end - offset;
+        auto block = newFile.view(offset, length);
+        sha256.update(newFile.data + offset, length);
+
+        // the old file is likely to continue with the same content
+        std::optional<std::uint64_t> source;
+        if (next && *next + length <= oldFile.size && oldFile.view(*next, length) == block) {
+            source = next;
+        } else if (length == blockSize) {
+            auto it = blocks.find(std::hash<std::string_view>{}(block));
+            if (it != blocks.end() && oldFile.view(it->second, length) == block) {
+                source = it->second;
+            }
+        }
+
+        auto ret = source ? writer.copy(*source, length) : writer.data(offset, length);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        next = source ? std::optional{ *source + length } : std::nullopt;
+        offset = end;
+    }
+
+    if (auto ret = writer.finish(); !ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    UABDeltaHeader header;
+    header.blockSize = blockSize;
+    header.oldSize = oldFile.size;
+    header.newSize = newFile.size;
+    sha256.final(header.newSha256.data());
+    auto serialized = header.serialize();
+    if (auto ret = writeAt(deltaFd, 0, serialized.data(), serialized.size()); !ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    return writer.stat;
+}
+
+utils::error::Result<void> applyUABDelta(int oldFd, int deltaFd, int outFd) noexcept
+{
+    LINGLONG_TRACE("apply uab delta");
+
+    std::array<std::byte, UABDeltaHeader::size> buf{};
+    if (auto ret = readAt(deltaFd, 0, buf.data(), buf.size()); !ret) {
+        return LINGLONG_ERR("read header of delta", ret);
+    }
+
+    auto header = UABDeltaHeader::parse(buf.data());
+    if (!header) {
+        return LINGLONG_ERR("not an uab delta");
+    }
+    if (header->version != UABDeltaHeader::currentVersion) {
+        return LINGLONG_ERR(fmt::format("unsupported version {} of delta", header->version));
+    }
+
+    struct stat st{};
+    if (::fstat(oldFd, &st) == -1) {
+        return LINGLONG_ERR(
+          fmt::format("stat old file: {}", common::error::errorString(errno)));
+    }
+    if (static_cast<std::uint64_t>(st.st_size) != header->oldSize) {
+        return LINGLONG_ERR(fmt::format("the delta is made for a file of {} bytes, not {}",
+                                        header->oldSize,
+                                        st.st_size));
+    }
+
+    std::uint64_t offset = UABDeltaHeader::size;
+    std::uint64_t written{ 0 };
+    while (true) {
+        std::array<std::byte, 1 + 8 + 8> op{};
+        if (auto ret = readAt(deltaFd, offset, op.data(), 1); !ret) {
+            return LINGLONG_ERR("read operation", ret);
+        }
+
+        auto kind = static_cast<OperationKind>(get<std::uint8_t>(op.data()));
+        if (kind == OperationKind::End) {
+            break;
+        }
+        if (kind != OperationKind::Copy && kind != OperationKind::Data) {
+            return LINGLONG_ERR(fmt::format("unknown operation {} at {}",
+                                            static_cast<unsigned>(kind),
+                                            offset));
+        }
+
+        auto size = kind == OperationKind::Copy ? op.size() : 1 + 8;
+        if (auto ret = readAt(deltaFd, offset, op.data(), size); !ret) {
+            return LINGLONG_ERR("read operation", ret);
+        }
+        offset += size;
+
+        auto length = get<std::uint64_t>(op.data() + 1);
+        if (length > header->newSize - written) {
+            return LINGLONG_ERR(fmt::format("operation at {} exceeds the new file", offset));
+        }
+
+        if (kind == OperationKind::Copy) {
+            auto source = get<std::uint64_t>(op.data() + 9);
+            if (source > header->oldSize || length > header->oldSize - source) {
+                return LINGLONG_ERR(fmt::format("operation at {} exceeds the old file", offset));
+            }
+
+            auto ret = utils::copyRange(oldFd,
+                                        static_cast<off_t>(source),
+                                        outFd,
+                                        static_cast<off_t>(written),
+                                        length);
+            if (!ret) {
+                return LINGLONG_ERR(ret);
+            }
+        } else {
+            auto ret = utils::copyRange(deltaFd,
+                                        static_cast<off_t>(offset),
+                                        outFd,
+                                        static_cast<off_t>(written),
+                                        length);
+            if (!ret) {
+                return LINGLONG_ERR(ret);
+            }
+            offset += length;
+        }
+
+        written += length;
+    }
+
+    if (written != header->newSize) {
+        return LINGLONG_ERR(
+          fmt::format("the delta writes {} of {} bytes", written, header->newSize));
+    }
+
+    // a corrupted delta or a different old file of the same size is detected here
+    digest::SHA256 sha256;
+    std::vector<std::byte> data(1024 * 1024);
+    for (std::uint64_t done = 0; done < written;) {
+        auto length = std::min<std::uint64_t>(data.size(), written - done);
+        if (auto ret = readAt(outFd, done, data.data(), length); !ret) {
+            return LINGLONG_ERR("read new file", ret);
+        }
+        sha256.update(data.data(), length);
+        done += length;
+    }
+
+    std::array<std::byte, 32> result{};
+    sha256.final(result.data());
+    if (result != header->newSha256) {
+        return LINGLONG_ERR("digest of the new file mismatched");
+    }
+
+    return LINGLONG_OK;
+}
+
+} // namespace linglong::package
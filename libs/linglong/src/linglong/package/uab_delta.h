@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/utils/error/error.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace linglong::package {
+
+// A delta turns an old file into a new one, it's a list of ranges of the new file which are
+// either copied from the old file or stored in the delta. Files are compared block by block, the
+// blocks of each file are aligned to an offset, e.g. the start of the erofs image of an UAB, so
+// that the same blocks of both images are found even if the images are at different offsets.
+//
+// The delta starts with a header:
+//   magic "LLUABDLT", version and block size (u32), sizes of the old and new file (u64),
+//   sha256 of the new file
+// followed by operations:
+//   copy: kind 0, length (u64), offset in the old file (u64)
+//   data: kind 1, length (u64), length bytes of data
+//   end:  kind 2
+// integers are little endian.
+struct UABDeltaHeader
+{
+    constexpr static std::size_t size = 64;
+    constexpr static std::uint32_t currentVersion = 1;
+
+    std::uint32_t version{ currentVersion };
+    std::uint32_t blockSize{ 0 };
+    std::uint64_t oldSize{ 0 };
+    std::uint64_t newSize{ 0 };
+    std::array<std::byte, 32> newSha256{};
+
+    [[nodiscard]] std::string serialize() const;
+    // nullopt if data doesn't start with the magic number of the delta
+    static std::optional<UABDeltaHeader> parse(const std::byte *data) noexcept;
+};
+
+struct UABDeltaStat
+{
+    std::uint64_t copied{ 0 };
+    std::uint64_t stored{ 0 };
+};
+
+constexpr std::uint32_t uab_delta_block_size = 4096;
+
+// write the delta from oldFd to newFd into deltaFd, blocks of the old and the new file are
+// aligned to oldAlign and newAlign
+utils::error::Result<UABDeltaStat> createUABDelta(int oldFd,
+                                                  std::uint64_t oldAlign,
+                                                  int newFd,
+                                                  std::uint64_t newAlign,
+                                                  int deltaFd) noexcept;
+
+// write the new file of the delta to outFd, the result is checked against the digest in the
+// delta, so a wrong old file is detected too
+utils::error::Result<void> applyUABDelta(int oldFd, int deltaFd, int outFd) noexcept;
+
+} // namespace linglong::package
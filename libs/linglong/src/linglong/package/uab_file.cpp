@@ -9,8 +9,10 @@
 #include "linglong/common/formatter.h"
 #include "linglong/utils/cmd.h"
 #include "linglong/utils/error/error.h"
+#include "linglong/utils/file.h"
 #include "linglong/utils/finally/finally.h"
 #include "linglong/utils/log/log.h"
+#include "linglong/utils/merkle.h"
 
 #include <nlohmann/json.hpp>
 
@@ -20,12 +22,14 @@
 #include <QStandardPaths>
 #include <QUuid>
 
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <random>
 #include <string_view>
 
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 namespace linglong::package {
@@ -159,6 +163,22 @@ utils::error::Result<bool> UABFile::verify() noexcept
           fmt::format("couldn't find bundle section which named {}", bundleSection));
     }
 
+    // leaves of the merkle tree are verified in parallel, bundles created by former versions
+    // only have the digest of the whole section
+    if (metaInfo.merkleTree) {
+        const auto &tree = *metaInfo.merkleTree;
+        if (tree.leafSize <= 0) {
+            return LINGLONG_ERR(fmt::format("invalid leaf size {} of merkle tree", tree.leafSize));
+        }
+
+        return digest::merkle_verify(handle(),
+                                     bundleSh->sh_offset,
+                                     bundleSh->sh_size,
+                                     tree.leafSize,
+                                     tree.leaves,
+                                     tree.root);
+    }
+
     std::array<char, 4096> buf{};
     std::string digest;
     QCryptographicHash cryptor{ QCryptographicHash::Sha256 };
@@ -228,7 +248,39 @@ utils::error::Result<std::filesystem::path> UABFile::unpack() noexcept
         }
     }
 
-    // 如果erofsfuse存在，则使用erofsfuse挂载
+    // 在进程内直接读取erofs镜像并解压
+    auto extracted = [this, &unpackPath]() -> utils::error::Result<void> {
+        LINGLONG_TRACE("extract uab bundle in process");
+
+        auto bundle = this->openBundle();
+        if (!bundle) {
+            return LINGLONG_ERR(bundle);
+        }
+
+        auto root = (*bundle)->root();
+        if (!root) {
+            return LINGLONG_ERR(root);
+        }
+
+        return (*bundle)->extract(*root, unpackPath);
+    }();
+    if (extracted) {
+        this->m_unpackPath = unpackPath;
+        return unpackPath;
+    }
+    LogW("failed to extract uab bundle in process, fallback to erofs-utils: {}",
+         extracted.error());
+    std::error_code ec;
+    std::filesystem::remove_all(unpackPath, ec);
+    if (ec) {
+        return LINGLONG_ERR("failed to clean " + unpackPath.string(), ec);
+    }
+    ret = this->mkdirDir(unpackPath);
+    if (!ret) {
+        return LINGLONG_ERR("failed to create directory " + unpackPath.string(), ret);
+    }
+
+    // 镜像使用了不支持的特性时，如果erofsfuse存在，则使用erofsfuse挂载
     if (this->checkCommandExists("erofsfuse")) {
         auto isFileReadable = this->isFileReadable(uabFile.toStdString());
         if (!isFileReadable) {
@@ -250,7 +302,8 @@ utils::error::Result<std::filesystem::path> UABFile::unpack() noexcept
         this->m_unpackPath = unpackPath;
         return unpackPath;
     }
-    // 如果erofsfuse不存在，则使用fsck.erofs解压erofs文件
+
+    // 否则使用fsck.erofs解压erofs文件
     if (this->checkCommandExists("fsck.erofs")) {
         uabFile = (unpackPath.parent_path() / "bundle.erofs").c_str();
         auto ret = this->saveErofsToFile(unpackPath.parent_path() / "bundle.erofs");
@@ -271,12 +324,131 @@ utils::error::Result<std::filesystem::path> UABFile::unpack() noexcept
       utils::error::ErrorCode::AppInstallErofsNotFound);
 }
 
+utils::error::Result<std::unique_ptr<ErofsImage>> UABFile::openBundle() noexcept
+{
+    LINGLONG_TRACE("open uab bundle")
+
+    auto metaInfoRet = getMetaInfo();
+    if (!metaInfoRet) {
+        return LINGLONG_ERR(metaInfoRet.error());
+    }
+
+    auto bundleSh = getSectionHeader(QString::fromStdString(metaInfo->sections.bundle));
+    if (!bundleSh) {
+        return LINGLONG_ERR(bundleSh.error());
+    }
+
+    auto image = ErofsImage::open(handle(), static_cast<off_t>(bundleSh->sh_offset));
+    if (!image) {
+        return LINGLONG_ERR(image);
+    }
+
+    return image;
+}
+
+utils::error::Result<UABDeltaStat> UABFile::createDelta(UABFile &newer,
+                                                        const std::filesystem::path &delta) noexcept
+{
+    LINGLONG_TRACE(fmt::format("create delta {}", delta));
+
+    std::array<std::uint64_t, 2> aligns{};
+    std::array<UABFile *, 2> files{ this, &newer };
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        auto metaInfo = files[i]->getMetaInfo();
+        if (!metaInfo) {
+            return LINGLONG_ERR(metaInfo);
+        }
+
+        auto bundleSh =
+          files[i]->getSectionHeader(QString::fromStdString(metaInfo->get().sections.bundle));
+        if (!bundleSh) {
+            return LINGLONG_ERR(bundleSh);
+        }
+        aligns[i] = bundleSh->sh_offset;
+    }
+
+    auto fd = ::open(delta.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return LINGLONG_ERR(fmt::format("open {}: {}", delta, common::error::errorString(errno)));
+    }
+    auto closeFd = utils::finally::finally([fd] {
+        ::close(fd);
+    });
+
+    auto stat = createUABDelta(handle(), aligns[0], newer.handle(), aligns[1], fd);
+    if (!stat) {
+        return LINGLONG_ERR(stat);
+    }
+
+    return stat;
+}
+
+utils::error::Result<std::unique_ptr<UABFile>>
+UABFile::applyDelta(const std::filesystem::path &delta, const std::filesystem::path &output) noexcept
+{
+    LINGLONG_TRACE(fmt::format("apply delta {} to {}", delta, output));
+
+    auto deltaFd = ::open(delta.c_str(), O_RDONLY | O_CLOEXEC);
+    if (deltaFd == -1) {
+        return LINGLONG_ERR(fmt::format("open {}: {}", delta, common::error::errorString(errno)));
+    }
+    auto closeDelta = utils::finally::finally([deltaFd] {
+        ::close(deltaFd);
+    });
+
+    // a unique file beside output, concurrent applies to the same output don't clobber each other
+    std::string tmp = output.parent_path() / ("." + output.filename().string() + ".XXXXXX");
+    auto fd = ::mkostemp(tmp.data(), O_CLOEXEC);
+    if (fd == -1) {
+        return LINGLONG_ERR(
+          fmt::format("mkostemp {}: {}", tmp, common::error::errorString(errno)));
+    }
+
+    auto removeTmp = utils::finally::finally([&tmp] {
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+    });
+
+    if (::fchmod(fd, 0755) == -1) {
+        auto error = common::error::errorString(errno);
+        ::close(fd);
+        return LINGLONG_ERR(fmt::format("fchmod {}: {}", tmp, error));
+    }
+
+    if (auto ret = applyUABDelta(handle(), deltaFd, fd); !ret) {
+        ::close(fd);
+        return LINGLONG_ERR(ret);
+    }
+
+    // the file is owned by the result
+    auto file = loadFromFile(fd);
+    if (!file) {
+        ::close(fd);
+        return LINGLONG_ERR(file);
+    }
+
+    // the digest of the whole file is checked already, the bundle is verified against its meta
+    // info as well, in case the delta was made for another file
+    auto verified = (*file)->verify();
+    if (!verified) {
+        return LINGLONG_ERR(verified);
+    }
+    if (!*verified) {
+        return LINGLONG_ERR("failed to verify the bundle of the new file");
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, output, ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("rename {} to {}", tmp, output), ec);
+    }
+
+    return file;
+}
+
 utils::error::Result<std::filesystem::path> UABFile::extractSignData() noexcept
 {
     LINGLONG_TRACE("extract sign data from uab")
-    if (m_unpackPath.empty()) {
-        return LINGLONG_ERR("uab is not mounted");
-    }
 
     auto signSection = getSectionHeader("linglong.bundle.sign");
     if (!signSection) {
@@ -327,44 +499,9 @@ utils::error::Result<std::filesystem::path> UABFile::extractSignData() noexcept
         }
     });
 
-    seek(signSection->sh_offset);
-    auto backToHead = utils::finally::finally([this] {
-        seek(0);
-    });
-
-    auto selfFd = handle();
-    auto totalBytes = signSection->sh_size;
-    std::array<unsigned char, 4096> buf{};
-    while (totalBytes > 0) {
-        auto bytesRead = totalBytes > buf.size() ? buf.size() : totalBytes;
-        auto readBytes = ::read(selfFd, buf.data(), bytesRead);
-        if (readBytes == -1) {
-            if (errno == EINTR) {
-                errno = 0;
-                continue;
-            }
-            return LINGLONG_ERR(
-              fmt::format("read from sign section error: {}", common::error::errorString(errno)));
-        }
-
-        while (true) {
-            auto writeBytes = ::write(tarFd, buf.data(), readBytes);
-            if (writeBytes == -1) {
-                if (errno == EINTR) {
-                    errno = 0;
-                    continue;
-                }
-                return LINGLONG_ERR(
-                  fmt::format("write to sign.tar error: {}", common::error::errorString(errno)));
-            }
-
-            if (writeBytes != readBytes) {
-                return LINGLONG_ERR("write to sign.tar failed: byte mismatch");
-            }
-
-            totalBytes -= writeBytes;
-            break;
-        }
+    auto ret = utils::copyRange(handle(), signSection->sh_offset, tarFd, 0, signSection->sh_size);
+    if (!ret) {
+        return LINGLONG_ERR("write to sign.tar error", ret);
     }
 
     if (::fsync(tarFd) == -1) {
@@ -379,9 +516,9 @@ utils::error::Result<std::filesystem::path> UABFile::extractSignData() noexcept
     }
     tarFd = -1;
 
-    auto ret = utils::Cmd("tar").exec({ "-xf", tarFile.string(), "-C", destination.string() });
-    if (!ret) {
-        return LINGLONG_ERR(ret);
+    auto untar = utils::Cmd("tar").exec({ "-xf", tarFile.string(), "-C", destination.string() });
+    if (!untar) {
+        return LINGLONG_ERR(untar);
     }
 
     return root;
@@ -406,31 +543,22 @@ utils::error::Result<void> UABFile::saveErofsToFile(const std::string &path)
     if (!bundleSh) {
         return LINGLONG_ERR(bundleSh.error());
     }
-    seek(bundleSh->sh_offset);
-    auto backToHead = utils::finally::finally([this] {
-        seek(0);
-    });
-    auto bundleLength = bundleSh->sh_size;
-    // 流式保存bundleSection到path
-    std::ofstream ofs(path, std::ios::binary);
-    std::array<char, 4096> buf{};
-    while (bundleLength > 0) {
-        auto readBytes = bundleLength > buf.size() ? buf.size() : bundleLength;
-        auto bytesRead = ::read(handle(), buf.data(), readBytes);
-        if (bytesRead == -1) {
-            return LINGLONG_ERR(
-              fmt::format("read from bundle section error: {}", common::error::errorString(errno)));
-        }
-        ofs.write(buf.data(), bytesRead);
-        if (ofs.fail()) {
-            return LINGLONG_ERR(fmt::format("write {} failed", path));
-        }
-        bundleLength -= bytesRead;
+    auto out = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out == -1) {
+        return LINGLONG_ERR(
+          fmt::format("open {} failed: {}", path, common::error::errorString(errno)));
     }
-    ofs.close();
-    if (ofs.fail()) {
-        return LINGLONG_ERR(fmt::format("close {} failed", path));
+    auto closeOut = utils::finally::finally([out] {
+        ::close(out);
+    });
+
+    // the extents of the bundle section are shared if the file system supports reflink, or
+    // copied in kernel
+    auto ret = utils::copyRange(handle(), bundleSh->sh_offset, out, 0, bundleSh->sh_size);
+    if (!ret) {
+        return LINGLONG_ERR(fmt::format("write {} failed", path), ret);
     }
+
     return LINGLONG_OK;
 }
 
@@ -5,6 +5,8 @@
 #pragma once
 
 #include "linglong/api/types/v1/UabMetaInfo.hpp"
+#include "linglong/package/erofs_image.h"
+#include "linglong/package/uab_delta.h"
 #include "linglong/utils/error/error.h"
 
 #include <gelf.h>
@@ -14,6 +16,7 @@
 #include <QString>
 
 #include <filesystem>
+#include <memory>
 #include <string>
 
 namespace linglong::package {
@@ -31,12 +34,24 @@ public:
 
     utils::error::Result<bool> verify() noexcept;
     utils::error::Result<std::filesystem::path> unpack() noexcept;
+    // read the bundle in process instead of unpacking it, it fails if the image isn't supported by
+    // ErofsImage
+    utils::error::Result<std::unique_ptr<ErofsImage>> openBundle() noexcept;
 
     // this method will extract sign data to a temporary directory, caller should remove it
     utils::error::Result<std::filesystem::path> extractSignData() noexcept;
     [[nodiscard]] utils::error::Result<std::reference_wrapper<const api::types::v1::UabMetaInfo>>
     getMetaInfo() noexcept;
 
+    // write the delta which turns this file into newer to delta, blocks of both files are
+    // aligned to their bundle sections, see createUABDelta
+    utils::error::Result<UABDeltaStat> createDelta(UABFile &newer,
+                                                   const std::filesystem::path &delta) noexcept;
+    // reconstruct the file of the delta from this file to output, output is replaced only if
+    // the result is verified
+    utils::error::Result<std::unique_ptr<UABFile>>
+    applyDelta(const std::filesystem::path &delta, const std::filesystem::path &output) noexcept;
+
 private:
     [[nodiscard]] utils::error::Result<GElf_Shdr>
     getSectionHeader(const QString &section) const noexcept;
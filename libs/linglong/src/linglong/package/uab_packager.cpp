@@ -8,24 +8,30 @@
 #include "linglong/api/types/v1/Generators.hpp"
 #include "linglong/api/types/v1/UabLayer.hpp"
 #include "linglong/api/types/v1/Version.hpp"
+#include "linglong/common/error.h"
 #include "linglong/package/architecture.h"
-#include "linglong/utils/cmd.h"
+#include "linglong/oci-cfg-generators/container_cfg_builder.h"
+#include "linglong/package/erofs_builder.h"
+#include "linglong/package/ld_cache.h"
 #include "linglong/utils/error/error.h"
 #include "linglong/utils/file.h"
+#include "linglong/utils/finally/finally.h"
 #include "linglong/utils/log/log.h"
+#include "linglong/utils/merkle.h"
+#include "linglong/utils/staging.h"
 
 #include <fmt/format.h>
 #include <qglobal.h>
 #include <yaml-cpp/yaml.h>
 
-#include <QCryptographicHash>
-#include <QFile>
 #include <QStandardPaths>
 #include <QUuid>
 
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <future>
+#include <optional>
 #include <unordered_set>
 #include <utility>
 
@@ -353,97 +359,93 @@ UABPackager::prepareExecutableBundle(const std::filesystem::path &bundleDir) noe
             return LINGLONG_ERR(fmt::format("couldn't create directory: {}", moduleFilesDir), ec);
         }
 
-        if (!files.empty()) {
-            struct stat moduleFilesDirStat{};
-            struct stat filesStat{};
-
-            if (stat(moduleFilesDir.c_str(), &moduleFilesDirStat) == -1) {
-                return LINGLONG_ERR("couldn't stat module files directory: "
-                                    + moduleFilesDir.string());
-            }
-
-            if (stat((*files.begin()).c_str(), &filesStat) == -1) {
-                return LINGLONG_ERR("couldn't stat files directory: "
-                                    + layer.filesDirPath().string());
+        // resolve symlinks and create directories first, which depend on each other, then stage
+        // the regular files in parallel
+        std::vector<utils::staging::Task> tasks;
+        std::unordered_set<std::string> destinations;
+        for (const std::filesystem::path source : files) {
+            auto sourceFile = source.lexically_relative(basePath);
+            auto ret = prepareSymlink(basePath, moduleFilesDir, sourceFile, symlinkCount);
+            if (!ret) {
+                return LINGLONG_ERR(ret);
             }
 
-            const bool shouldCopy = moduleFilesDirStat.st_dev != filesStat.st_dev;
-            for (const std::filesystem::path source : files) {
-                auto sourceFile = source.lexically_relative(basePath);
-                auto ret = prepareSymlink(basePath, moduleFilesDir, sourceFile, symlinkCount);
-                if (!ret) {
-                    return LINGLONG_ERR(ret);
+            auto [realSource, realDestination] = std::move(ret).value();
+            auto status = std::filesystem::symlink_status(realSource, ec);
+            if (ec) {
+                // if the source file is a broken symlink, just skip it
+                if (ec == std::errc::no_such_file_or_directory) {
+                    continue;
                 }
 
-                const auto &[realSource, realDestination] = *ret;
-                auto status = std::filesystem::symlink_status(realSource, ec);
-                if (ec) {
-                    // if the source file is a broken symlink, just skip it
-                    if (ec == std::errc::no_such_file_or_directory) {
-                        continue;
-                    }
-
-                    return LINGLONG_ERR(fmt::format("symlink_status error:{}", ec.message()));
-                }
+                return LINGLONG_ERR(fmt::format("symlink_status error:{}", ec.message()));
+            }
 
-                if (std::filesystem::is_directory(realSource)) {
-                    std::filesystem::create_directories(realDestination, ec);
-                    if (ec) {
-                        return LINGLONG_ERR(
-                          fmt::format("create_directories error:{}", ec.message()));
-                    }
+            if (std::filesystem::is_directory(realSource)) {
+                std::filesystem::create_directories(realDestination, ec);
+                if (ec) {
+                    return LINGLONG_ERR(fmt::format("create_directories error:{}", ec.message()));
                 }
+            }
 
-                // check destination exists or not
-                // 1. multiple symlinks point to the same file
-                // 2. the destination also is a symlink
-                status = std::filesystem::symlink_status(realDestination, ec);
-                if (!ec) {
-                    // no need to check the destination symlink point to which file, just skip it
-                    continue;
-                }
+            // check destination exists or not
+            // 1. multiple symlinks point to the same file
+            // 2. the destination also is a symlink
+            std::ignore = std::filesystem::symlink_status(realDestination, ec);
+            if (!ec) {
+                // no need to check the destination symlink point to which file, just skip it
+                continue;
+            }
 
-                if (ec && ec != std::errc::no_such_file_or_directory) {
-                    return LINGLONG_ERR(fmt::format("get symlink status of {} failed: {}",
-                                                    realDestination.string(),
-                                                    ec.message()));
-                }
+            if (ec && ec != std::errc::no_such_file_or_directory) {
+                return LINGLONG_ERR(fmt::format("get symlink status of {} failed: {}",
+                                                realDestination.string(),
+                                                ec.message()));
+            }
 
-                if (!std::filesystem::exists(realDestination.parent_path(), ec)
-                    && !std::filesystem::create_directories(realDestination.parent_path(), ec)
-                    && ec) {
-                    return LINGLONG_ERR(fmt::format("couldn't create directories {}:{}",
-                                                    realDestination.parent_path().string(),
-                                                    ec.message()));
-                }
+            // the file has been staged by another symlink
+            if (!destinations.insert(realDestination.string()).second) {
+                continue;
+            }
 
-                if (shouldCopy) {
-                    std::filesystem::copy(realSource, realDestination, ec);
-                    if (ec) {
-                        return LINGLONG_ERR(fmt::format("couldn't copy from {} to {} {}",
-                                                        source,
-                                                        realDestination,
-                                                        ec.message()));
-                    }
+            if (!std::filesystem::exists(realDestination.parent_path(), ec)
+                && !std::filesystem::create_directories(realDestination.parent_path(), ec) && ec) {
+                return LINGLONG_ERR(fmt::format("couldn't create directories {}:{}",
+                                                realDestination.parent_path().string(),
+                                                ec.message()));
+            }
 
-                    continue;
-                }
+            if (status.type() == std::filesystem::file_type::regular) {
+                tasks.push_back({ .source = std::move(realSource),
+                                  .destination = std::move(realDestination) });
+                continue;
+            }
 
-                std::filesystem::create_hard_link(realSource, realDestination, ec);
+            // special files are rare, link or copy them directly
+            std::filesystem::create_hard_link(realSource, realDestination, ec);
+            if (ec) {
+                std::filesystem::copy(realSource, realDestination, ec);
                 if (ec) {
-                    // fallback to copy if hard link fails, e.g. source and
-                    // destination are on different filesystems (EXDEV).
-                    std::filesystem::copy(realSource, realDestination, ec);
-                    if (ec) {
-                        return LINGLONG_ERR(fmt::format("couldn't link or copy from {} to {} {}",
-                                                        source,
-                                                        realDestination,
-                                                        ec.message()));
-                    }
+                    return LINGLONG_ERR(fmt::format("couldn't link or copy from {} to {} {}",
+                                                    source,
+                                                    realDestination,
+                                                    ec.message()));
                 }
             }
         }
 
+        auto staged = utils::staging::stageFiles(tasks);
+        if (!staged) {
+            return LINGLONG_ERR(staged);
+        }
+        LogD("staged {} files of {}: {} reflinked, {} hardlinked, {} copied ({} bytes)",
+             tasks.size(),
+             info.id,
+             staged->reflinked,
+             staged->hardlinked,
+             staged->copied,
+             staged->copiedBytes);
+
         auto &layerInfoRef = this->meta.layers.emplace_back(
           linglong::api::types::v1::UabLayer{ .info = info, .minified = minified });
 
@@ -482,14 +484,7 @@ UABPackager::prepareExecutableBundle(const std::filesystem::path &bundleDir) noe
               moduleFilesDir / "lib" / Architecture::currentCPUArchitecture().getTriplet();
 
             for (const std::filesystem::path file : this->neededFiles) {
-                auto fileName = file.filename().string();
-                auto it = std::find_if(this->blackList.begin(),
-                                       this->blackList.end(),
-                                       [&fileName](const std::string &entry) {
-                                           return entry.rfind(fileName, 0) == 0
-                                             || fileName.rfind(entry, 0) == 0;
-                                       });
-                if (it != this->blackList.end()) {
+                if (this->blackList.matches(file.filename().string())) {
                     continue;
                 }
 
@@ -623,6 +618,46 @@ UABPackager::prepareExecutableBundle(const std::filesystem::path &bundleDir) noe
         return LINGLONG_ERR(fmt::format("couldn't copy {} to {}", boxBin, extraDir / "ll-box"), ec);
     }
 
+    // prebuild ld.so.cache, so the loader doesn't have to run ldconfig at every launch. the base
+    // of an UAB is the host, the cache only has libraries of the bundled layers, and the loader
+    // still runs ldconfig if the host has libraries out of the default search paths.
+    // the loader mounts the runtime before the application and prefers the runtime module
+    std::vector<LDCacheRoot> roots;
+    for (const std::string kind : { "runtime", "app" }) {
+        for (const auto &layer : std::as_const(this->meta.layers)) {
+            const auto &info = layer.info;
+            if (info.kind != kind) {
+                continue;
+            }
+
+            auto mountPoint = kind == "runtime"
+              ? generator::ContainerCfgBuilder::runtimeMountPoint.string()
+              : generator::ContainerCfgBuilder::appMountPoint(info.id).string();
+            if (std::any_of(roots.cbegin(), roots.cend(), [&mountPoint](const LDCacheRoot &root) {
+                    return root.mountPoint == mountPoint;
+                })) {
+                continue;
+            }
+
+            auto files = layersDir / info.id / "runtime" / "files";
+            if (!std::filesystem::exists(files, ec)) {
+                files = layersDir / info.id / "binary" / "files";
+            }
+            roots.push_back({ .mountPoint = std::move(mountPoint), .source = std::move(files) });
+        }
+    }
+
+    auto ldCache = generateLDCache(roots, Architecture::currentCPUArchitecture());
+    if (!ldCache) {
+        LogW("skip prebuilt ld.so.cache, ldconfig will run at launch: {}", ldCache.error());
+        return LINGLONG_OK;
+    }
+
+    auto res = utils::writeFile(extraDir / "ld.so.cache", *ldCache);
+    if (!res) {
+        return LINGLONG_ERR(res);
+    }
+
     return LINGLONG_OK;
 }
 
@@ -639,12 +674,6 @@ UABPackager::prepareDistributedBundle(const std::filesystem::path &bundleDir) no
         return LINGLONG_ERR(fmt::format("couldn't create directory {}", layersDir.string()), ec);
     }
 
-    // check if we can use hard links for optimization (only need to check once)
-    struct stat layersDirStat{};
-    if (stat(layersDir.c_str(), &layersDirStat) == -1) {
-        return LINGLONG_ERR("couldn't stat layers directory: " + layersDir.string());
-    }
-
     for (const auto &layer : std::as_const(this->layers)) {
         auto info = layer.info();
         if (!info) {
@@ -659,93 +688,195 @@ UABPackager::prepareDistributedBundle(const std::filesystem::path &bundleDir) no
             return LINGLONG_ERR(fmt::format("couldn't create directory {}", modulePath), ec);
         }
 
-        // check if layer and target are on the same filesystem
-        struct stat layerStat{};
-        if (stat(layerPath.c_str(), &layerStat) == -1) {
-            return LINGLONG_ERR("couldn't stat layer directory: " + layerPath.string());
-        }
+        // create the directory tree and symlinks first, then stage the regular files in parallel,
+        // they are cloned, linked or copied depending on what the filesystems support
+        std::vector<utils::staging::Task> tasks;
+        for (const auto &entry : std::filesystem::recursive_directory_iterator(layerPath, ec)) {
+            if (ec) {
+                return LINGLONG_ERR(fmt::format("couldn't iterate directory {}", layerPath), ec);
+            }
 
-        const bool shouldCopy = layerStat.st_dev != layersDirStat.st_dev;
+            auto relativePath = entry.path().lexically_relative(layerPath);
+            auto destPath = modulePath / relativePath;
 
-        if (shouldCopy) {
-            // different filesystem, need to copy files
-            std::filesystem::copy(layerPath,
-                                  modulePath,
-                                  std::filesystem::copy_options::copy_symlinks
-                                    | std::filesystem::copy_options::recursive,
+            if (entry.is_directory() && !entry.is_symlink()) {
+                // create directory if it doesn't exist
+                std::filesystem::create_directories(destPath, ec);
+                if (ec) {
+                    return LINGLONG_ERR(fmt::format("couldn't create directory {}", destPath), ec);
+                }
+                continue;
+            }
+
+            // for non-directory files, create parent directories first
+            std::filesystem::create_directories(destPath.parent_path(), ec);
+            if (ec) {
+                return LINGLONG_ERR(
+                  fmt::format("couldn't create directories {}", destPath.parent_path()),
+                  ec);
+            }
+
+            if (entry.is_regular_file() && !entry.is_symlink()) {
+                tasks.push_back({ .source = entry.path(), .destination = std::move(destPath) });
+                continue;
+            }
+
+            // handle symlinks - copy them directly to preserve the link target
+            std::filesystem::copy(entry.path(),
+                                  destPath,
+                                  std::filesystem::copy_options::copy_symlinks,
                                   ec);
             if (ec) {
                 return LINGLONG_ERR(
-                  fmt::format("couldn't copy from {} to {}", layerPath, modulePath),
+                  fmt::format("couldn't copy from {} to {}", entry.path(), destPath),
                   ec);
             }
-        } else {
-            // same filesystem, can use hard links for optimization
-            // use recursive directory iterator to process all files
+        }
 
-            // iterate through all files and directories recursively
-            for (const auto &entry : std::filesystem::recursive_directory_iterator(layerPath, ec)) {
-                if (ec) {
-                    return LINGLONG_ERR(fmt::format("couldn't iterate directory {}", layerPath),
-                                        ec);
-                }
+        auto staged = utils::staging::stageFiles(tasks);
+        if (!staged) {
+            return LINGLONG_ERR(staged);
+        }
+        LogD("staged {} files of {}: {} reflinked, {} hardlinked, {} copied ({} bytes)",
+             tasks.size(),
+             info->id,
+             staged->reflinked,
+             staged->hardlinked,
+             staged->copied,
+             staged->copiedBytes);
 
-                auto relativePath = entry.path().lexically_relative(layerPath);
-                auto destPath = modulePath / relativePath;
+        // add layer info to meta
+        this->meta.layers.emplace_back(
+          linglong::api::types::v1::UabLayer{ .info = *info, .minified = false });
+    }
 
-                if (entry.is_directory()) {
-                    // create directory if it doesn't exist
-                    std::filesystem::create_directories(destPath, ec);
-                    if (ec) {
-                        return LINGLONG_ERR(fmt::format("couldn't create directory {}", destPath),
-                                            ec);
-                    }
-                    continue;
-                }
+    return LINGLONG_OK;
+}
 
-                // for non-directory files, create parent directories first
-                std::filesystem::create_directories(destPath.parent_path(), ec);
-                if (ec) {
-                    return LINGLONG_ERR(
-                      fmt::format("couldn't create directories {}", destPath.parent_path()),
-                      ec);
-                }
+utils::error::Result<void> addBundleSection(ElfHandler &uab,
+                                            const std::filesystem::path &bundleFile,
+                                            const std::string &section,
+                                            api::types::v1::UabMetaInfo &meta) noexcept
+{
+    LINGLONG_TRACE(fmt::format("add {} to uab as section {}", bundleFile, section))
 
-                if (entry.is_symlink()) {
-                    // handle symlinks - copy them directly to preserve the link target
-                    std::filesystem::copy(entry.path(),
-                                          destPath,
-                                          std::filesystem::copy_options::copy_symlinks,
-                                          ec);
-                    if (ec) {
-                        return LINGLONG_ERR(fmt::format("couldn't copy symlink from {} to {}",
-                                                        entry.path(),
-                                                        destPath),
-                                            ec);
-                    }
-                    continue;
-                }
+    auto fd = ::open(bundleFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return LINGLONG_ERR(fmt::format("failed to open bundle file {}: {}",
+                                        bundleFile,
+                                        common::error::errorString(errno)));
+    }
+    auto closeFd = utils::finally::finally([fd] {
+        ::close(fd);
+    });
 
-                // regular file - try to create hard link, fallback to copy if failed
-                std::filesystem::create_hard_link(entry.path(), destPath, ec);
-                if (ec) {
-                    // fallback to copy if hard link fails
-                    std::filesystem::copy(entry.path(),
-                                          destPath,
-                                          std::filesystem::copy_options::copy_symlinks,
-                                          ec);
-                    if (ec) {
-                        return LINGLONG_ERR(
-                          fmt::format("couldn't copy from {} to {}", entry.path(), destPath),
-                          ec);
-                    }
-                }
-            }
+    struct stat st{};
+    if (::fstat(fd, &st) == -1) {
+        return LINGLONG_ERR(
+          fmt::format("failed to stat {}: {}", bundleFile, common::error::errorString(errno)));
+    }
+
+    auto size = static_cast<std::size_t>(st.st_size);
+    if (size == 0) {
+        return LINGLONG_ERR(fmt::format("bundle file {} is empty", bundleFile));
+    }
+
+    auto *mem = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mem == MAP_FAILED) {
+        return LINGLONG_ERR(
+          fmt::format("failed to mmap {}: {}", bundleFile, common::error::errorString(errno)));
+    }
+    auto unmap = utils::finally::finally([mem, size] {
+        ::munmap(mem, size);
+    });
+    ::madvise(mem, size, MADV_WILLNEED);
+    const auto *data = static_cast<const std::byte *>(mem);
+
+    // the digest, the merkle tree and the section are produced from the same mapping at the same
+    // time, so the image is read from the disk once
+    std::future<std::string> sectionDigest;
+    std::future<std::optional<std::vector<std::string>>> leafDigests;
+    try {
+        sectionDigest = std::async(std::launch::async, [data, size] {
+            digest::SHA256 sha256;
+            std::array<std::byte, 32> result{};
+            sha256.update(data, size);
+            sha256.final(result.data());
+            return digest::to_hex(result);
+        });
+        leafDigests = std::async(std::launch::async, [data, size] {
+            return digest::merkle_leaves(data, size);
+        });
+    } catch (const std::system_error &e) {
+        return LINGLONG_ERR("failed to start hashing", e);
+    }
+
+    auto ret = uab.addSection(section, static_cast<const char *>(mem), size);
+    // wait for hashing before the mapping is released
+    meta.digest = sectionDigest.get();
+    auto tree = leafDigests.get();
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+    if (!tree) {
+        return LINGLONG_ERR(fmt::format("failed to calculate merkle tree of {}", bundleFile));
+    }
+
+    auto root = digest::merkle_root(*tree);
+    meta.merkleTree = api::types::v1::UabMerkleTree{
+        .leafSize = static_cast<int64_t>(digest::merkle_leaf_size),
+        .leaves = std::move(tree).value(),
+        .root = std::move(root),
+    };
+    meta.sections.bundle = section;
+
+    return LINGLONG_OK;
+}
+
+// keep the bundle image as the cached one, the cache only keeps the image of the last export as
+// images are large
+utils::error::Result<void> storeBundleImage(const std::filesystem::path &bundleFile,
+                                            const std::filesystem::path &cached) noexcept
+{
+    LINGLONG_TRACE(fmt::format("store {} as {}", bundleFile, cached))
+
+    const auto cacheDir = cached.parent_path();
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("couldn't create directory {}", cacheDir), ec);
+    }
+
+    for (const auto &entry : std::filesystem::directory_iterator(cacheDir, ec)) {
+        const auto extension = entry.path().extension();
+        if (extension != ".ef" && extension != ".tmp") {
+            continue;
         }
 
-        // add layer info to meta
-        this->meta.layers.emplace_back(
-          linglong::api::types::v1::UabLayer{ .info = *info, .minified = false });
+        std::error_code removeEc;
+        std::filesystem::remove(entry.path(), removeEc);
+        if (removeEc) {
+            return LINGLONG_ERR(fmt::format("couldn't remove image {}", entry.path()), removeEc);
+        }
+    }
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("couldn't list images in {}", cacheDir), ec);
+    }
+
+    // the image is linked if the cache is on the same filesystem, it's written once and never
+    // changed
+    auto tmp = cacheDir / (cached.filename().string() + ".tmp");
+    std::filesystem::create_hard_link(bundleFile, tmp, ec);
+    if (ec) {
+        std::filesystem::copy_file(bundleFile, tmp, ec);
+        if (ec) {
+            return LINGLONG_ERR(fmt::format("couldn't copy {} to {}", bundleFile, tmp), ec);
+        }
+    }
+
+    std::filesystem::rename(tmp, cached, ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("couldn't rename {} to {}", tmp, cached), ec);
     }
 
     return LINGLONG_OK;
@@ -772,43 +903,73 @@ utils::error::Result<void> UABPackager::packBundle(bool distributedOnly) noexcep
         return ret;
     }
 
-    if (bundleCB) {
+    // https://github.com/erofs/erofs-utils/blob/b526c0d7da46b14f1328594cf1d1b2401770f59b/README#L171-L183
+    // all files of the image have the same timestamp, SOURCE_DATE_EPOCH or 0, so the image is
+    // reproducible and doesn't depend on when the bundle is staged
+    ErofsBuildOptions options{ .compressor = compressor,
+                               .compressionLevel = compressionLevel,
+                               .clusterSize = clusterSize,
+                               .features = { "fragments", "dedupe", "ztailpacking" },
+                               .timestamp = sourceDateEpoch() };
+
+    // mkfs.erofs gives every image a random uuid, the uuid is derived from the staged bundle
+    // instead, so the same bundle always gets the same image
+    std::optional<std::string> treeDigest;
+    if (!bundleCB || !bundleCache.empty()) {
+        auto bundleDigest = erofsTreeDigest(bundleDir);
+        if (bundleDigest) {
+            treeDigest = std::move(bundleDigest).value();
+            options.uuid = erofsUuid(*treeDigest);
+        } else {
+            LogW("bundle image isn't reproducible and isn't cached: {}", bundleDigest.error());
+        }
+    }
+
+    // the image is a function of the staged bundle and the tool which builds it, if both are the
+    // same as the last export, e.g. it's exported again without rebuilding or with another icon,
+    // the image of the last export is reused instead of compressing everything again. the number
+    // of workers doesn't change the image, it isn't a part of the key, the uuid is.
+    auto tool = bundleCB ? bundleTool : std::string{};
+    if (!bundleCB && !mkfsErofsVersion().empty()) {
+        tool = fmt::format("{} {}",
+                           mkfsErofsVersion(),
+                           fmt::join(mkfsErofsArgs(options, {}, {}, false), " "));
+    }
+
+    std::filesystem::path cached;
+    if (!bundleCache.empty() && !tool.empty() && treeDigest) {
+        auto key = tool + "\n" + *treeDigest;
+        digest::SHA256 sha256;
+        std::array<std::byte, 32> result{};
+        sha256.update(reinterpret_cast<const std::byte *>(key.data()), key.size());
+        sha256.final(result.data());
+        cached = bundleCache / (digest::to_hex(result) + ".ef");
+    }
+
+    if (!cached.empty() && std::filesystem::exists(cached, ec)) {
+        LogI("bundle is unchanged, reuse image {}", cached);
+        bundleFile = cached;
+    } else if (bundleCB) {
         ret = bundleCB(bundleFile, bundleDir);
         if (!ret) {
             return LINGLONG_ERR("bundle error", ret);
         }
     } else {
-        // https://github.com/erofs/erofs-utils/blob/b526c0d7da46b14f1328594cf1d1b2401770f59b/README#L171-L183
-        if (auto ret = utils::Cmd("mkfs.erofs")
-                         .exec({ "-z" + compressor,
-                                 "-Efragments,dedupe,ztailpacking",
-                                 "-C1048576",
-                                 "-b4096", // force 4096 block size, default is page size
-                                 bundleFile,
-                                 bundleDir });
-            !ret) {
+        if (auto ret = buildErofsImage(bundleFile, bundleDir, options); !ret) {
             return LINGLONG_ERR(ret);
         }
     }
 
-    // calculate digest
-    QFile bundle{ QString::fromStdString(bundleFile.string()) };
-    if (!bundle.open(QIODevice::ReadOnly | QIODevice::ExistingOnly)) {
-        return LINGLONG_ERR(fmt::format("failed to open bundle file {}", bundleFile));
+    if (!cached.empty() && bundleFile != cached) {
+        if (auto ret = storeBundleImage(bundleFile, cached); !ret) {
+            LogW("failed to cache bundle image: {}", ret.error());
+        }
     }
 
-    QCryptographicHash cryptor{ QCryptographicHash::Sha256 };
-    if (!cryptor.addData(&bundle)) {
-        return LINGLONG_ERR(fmt::format("failed to calculate digest from {}: {}",
-                                        bundleFile,
-                                        bundle.errorString().toStdString()));
-    }
-    this->meta.digest = cryptor.result().toHex().toStdString();
     const auto *bundleSection = "linglong.bundle";
-    if (auto ret = this->uab->addSection(bundleSection, bundleFile); !ret) {
+    if (auto ret = addBundleSection(*this->uab, bundleFile, bundleSection, this->meta); !ret) {
         return LINGLONG_ERR(ret);
     }
-    this->meta.sections.bundle = bundleSection;
 
     return LINGLONG_OK;
 }
@@ -914,14 +1075,58 @@ UABPackager::filteringFiles(const LayerDir &layer) const noexcept
         }
     }
 
+    // the files of an excluded directory have been collected by expandPaths, so the directory is
+    // pruned from the walk instead of checking every file in it
+    std::unordered_set<std::string> excludedDirs;
+    for (const auto &entry : excludeFiles) {
+        auto relative = std::filesystem::path{ entry.substr(1) }.lexically_normal();
+        if (!relative.has_filename()) {
+            relative = relative.parent_path();
+        }
+
+        auto status = std::filesystem::symlink_status(filesDir / relative, ec);
+        if (!ec && status.type() == std::filesystem::file_type::directory) {
+            excludedDirs.insert(relative.string());
+        }
+    }
+
+    // the layer is minified if any file which would be bundled is excluded
+    bool minified{ false };
+    for (const auto &entry : expandedExcludes) {
+        std::filesystem::path filePath{ entry };
+        if (this->blackList.matches(filePath.filename().string())) {
+            continue;
+        }
+
+        auto status = std::filesystem::symlink_status(filePath, ec);
+        if (!ec
+            && (status.type() == std::filesystem::file_type::regular
+                || status.type() == std::filesystem::file_type::symlink)) {
+            minified = true;
+            break;
+        }
+    }
+
     auto iterator = std::filesystem::recursive_directory_iterator(filesDir, ec);
     if (ec) {
         return LINGLONG_ERR(ec.message());
     }
 
-    bool minified{ false };
     std::unordered_set<std::string> allFiles;
-    for (const auto &file : iterator) {
+    for (const auto end = std::filesystem::recursive_directory_iterator{}; iterator != end;
+         iterator.increment(ec)) {
+        if (ec) {
+            return LINGLONG_ERR(fmt::format("failed to iterate {}: {}", filesDir, ec.message()));
+        }
+
+        const auto &file = *iterator;
+        if (!excludedDirs.empty() && !file.is_symlink(ec) && file.is_directory(ec)
+            && excludedDirs.find(file.path().lexically_relative(filesDir).string())
+              != excludedDirs.cend()) {
+            iterator.disable_recursion_pending();
+            continue;
+        }
+
         // only process regular file and symlink
         // relay on the short circuit evaluation, do not change the order of the conditions
         if (!(file.is_symlink(ec) || file.is_regular_file(ec))) {
@@ -934,19 +1139,11 @@ UABPackager::filteringFiles(const LayerDir &layer) const noexcept
         }
 
         const auto &filePath = file.path();
-        auto fileName = filePath.filename().string();
-        auto it =
-          std::find_if(this->blackList.begin(),
-                       this->blackList.end(),
-                       [&fileName](const std::string &entry) {
-                           return entry.rfind(fileName, 0) == 0 || fileName.rfind(entry, 0) == 0;
-                       });
-        if (it != this->blackList.end()) {
+        if (this->blackList.matches(filePath.filename().string())) {
             continue;
         }
 
         if (expandedExcludes.find(filePath) != expandedExcludes.cend()) {
-            minified = true;
             continue;
         }
 
@@ -988,8 +1185,7 @@ utils::error::Result<void> UABPackager::loadBlackList() noexcept
             continue;
         }
 
-        auto [_, success] = this->blackList.emplace(line);
-        if (!success) {
+        if (!this->blackList.insert(line)) {
             LogW("duplicate entry: {}", line);
         }
     }
@@ -1046,6 +1242,16 @@ void UABPackager::setCompressor(std::string compressor) noexcept
     this->compressor = std::move(compressor);
 }
 
+void UABPackager::setCompressionLevel(int level) noexcept
+{
+    this->compressionLevel = level;
+}
+
+void UABPackager::setClusterSize(std::size_t size) noexcept
+{
+    this->clusterSize = size;
+}
+
 void UABPackager::setDefaultHeader(std::filesystem::path header) noexcept
 {
     this->defaultHeader = std::move(header);
@@ -1063,9 +1269,16 @@ void UABPackager::setDefaultBox(std::filesystem::path box) noexcept
 
 void UABPackager::setBundleCB(
   std::function<utils::error::Result<void>(const std::filesystem::path &,
-                                           const std::filesystem::path &)> bundleCB) noexcept
+                                           const std::filesystem::path &)> bundleCB,
+  std::string tool) noexcept
 {
     this->bundleCB = std::move(bundleCB);
+    this->bundleTool = std::move(tool);
+}
+
+void UABPackager::setBundleCache(std::filesystem::path dir) noexcept
+{
+    this->bundleCache = std::move(dir);
 }
 
 } // namespace linglong::package
@@ -7,6 +7,7 @@
 #include "linglong/api/types/v1/UabMetaInfo.hpp"
 #include "linglong/package/elf_handler.h"
 #include "linglong/package/layer_dir.h"
+#include "linglong/package/uab_blacklist.h"
 #include "linglong/utils/error/error.h"
 
 #include <filesystem>
@@ -15,6 +16,13 @@
 
 namespace linglong::package {
 
+// append the bundle image to uab as section, the digest and the merkle tree of meta are
+// calculated in the same pass over the image
+utils::error::Result<void> addBundleSection(ElfHandler &uab,
+                                            const std::filesystem::path &bundleFile,
+                                            const std::string &section,
+                                            api::types::v1::UabMetaInfo &meta) noexcept;
+
 class UABPackager
 {
 public:
@@ -33,12 +41,20 @@ public:
     utils::error::Result<void> loadNeededFiles() noexcept;
     void setLoader(std::filesystem::path loader) noexcept;
     void setCompressor(std::string compressor) noexcept;
+    void setCompressionLevel(int level) noexcept;
+    void setClusterSize(std::size_t size) noexcept;
     void setDefaultHeader(std::filesystem::path header) noexcept;
     void setDefaultLoader(std::filesystem::path loader) noexcept;
     void setDefaultBox(std::filesystem::path box) noexcept;
+    // bundleCB builds the bundle image instead of the mkfs.erofs in PATH, tool identifies the
+    // program and its arguments for the bundle cache, which isn't used if it's empty
     void setBundleCB(
       std::function<utils::error::Result<void>(const std::filesystem::path &,
-                                               const std::filesystem::path &)> bundleCB) noexcept;
+                                               const std::filesystem::path &)> bundleCB,
+      std::string tool = {}) noexcept;
+    // reuse the bundle image of the last export from dir if the bundle and the tool which builds
+    // it are the same
+    void setBundleCache(std::filesystem::path dir) noexcept;
 
 private:
     [[nodiscard]] utils::error::Result<void> packIcon() noexcept;
@@ -56,18 +72,22 @@ private:
     std::unordered_set<std::string> excludeFiles;
     std::unordered_set<std::string> includeFiles;
     std::unordered_set<std::string> neededFiles;
-    std::unordered_set<std::string> blackList;
+    UABBlacklist blackList;
     std::optional<std::filesystem::path> icon;
     api::types::v1::UabMetaInfo meta;
     std::filesystem::path buildDir;
     std::filesystem::path workDir;
     std::filesystem::path loader;
     std::string compressor = "lz4";
+    std::optional<int> compressionLevel;
+    std::size_t clusterSize = 1024 * 1024;
     std::filesystem::path defaultHeader;
     std::filesystem::path defaultLoader;
     std::filesystem::path defaultBox;
     std::function<utils::error::Result<void>(const std::filesystem::path &,
                                              const std::filesystem::path &)>
       bundleCB;
+    std::string bundleTool;
+    std::filesystem::path bundleCache;
 };
 } // namespace linglong::package
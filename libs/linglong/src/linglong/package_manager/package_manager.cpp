@@ -21,7 +21,9 @@
 #include "linglong/common/serialize/json.h"
 #include "linglong/common/strings.h"
 #include "linglong/extension/extension.h"
+#include "linglong/package/erofs_image.h"
 #include "linglong/package/layer_file.h"
+#include "linglong/package/layer_image.h"
 #include "linglong/package/layer_packager.h"
 #include "linglong/package/reference.h"
 #include "linglong/package_manager/package_task.h"
@@ -31,6 +33,7 @@
 #include "linglong/package_manager/uab_installation.h"
 #include "linglong/repo/ostree_repo.h"
 #include "linglong/runtime/container_builder.h"
+#include "linglong/runtime/container_registry.h"
 #include "linglong/runtime/run_context.h"
 #include "linglong/utils/cmd.h"
 #include "linglong/utils/error/error.h"
@@ -232,50 +235,15 @@ PackageManager::getAllRunningContainers() noexcept
 {
     LINGLONG_TRACE("get all running containers");
 
-    std::error_code ec;
-    auto user_iterator = std::filesystem::directory_iterator{ "/run/linglong", ec };
-    if (ec) {
-        return LINGLONG_ERR("failed to list /run/linglong", ec);
+    auto registered = runtime::ContainerRegistry{}.list();
+    if (!registered) {
+        return LINGLONG_ERR(registered);
     }
 
     std::vector<api::types::v1::ContainerProcessStateInfo> result;
-    for (const auto &entry : user_iterator) {
-        if (!entry.is_directory()) {
-            continue;
-        }
-
-        auto process_iterator = std::filesystem::directory_iterator{ entry.path(), ec };
-        if (ec) {
-            return LINGLONG_ERR(fmt::format("failed to list {}", entry.path()), ec);
-        }
-
-        for (const auto &process_entry : process_iterator) {
-            if (!process_entry.is_regular_file()) {
-                continue;
-            }
-
-            auto pid = process_entry.path().filename().string();
-            if (auto procDir = "/proc/" + pid; !std::filesystem::exists(procDir, ec)) {
-                if (ec) {
-                    return LINGLONG_ERR(fmt::format("failed to get state of {}", procDir), ec);
-                }
-
-                LogI("ignore {} because corresponding process is not found",
-                     process_entry.path().c_str());
-                continue;
-            }
-
-            auto content =
-              utils::serialize::LoadJSONFile<api::types::v1::ContainerProcessStateInfo>(
-                process_entry.path());
-            if (!content) {
-                return LINGLONG_ERR(
-                  fmt::format("failed to load info from {}", process_entry.path()),
-                  content);
-            }
-
-            result.emplace_back(std::move(content).value());
-        }
+    result.reserve(registered->size());
+    for (auto &container : *registered) {
+        result.emplace_back(std::move(container.info));
     }
 
     return result;
@@ -666,14 +634,25 @@ QVariantMap PackageManager::installFromLayer(const QDBusUnixFileDescriptor &fd,
           taskRef.updateState(linglong::api::types::v1::State::Processing, "installing layer");
 
           taskRef.updateProgress(10);
+          // the layer is imported from the image directly, it's unpacked only if the image isn't
+          // supported by ErofsImage
           package::LayerPackager layerPackager;
-          auto layerDir = layerPackager.unpack(*layerFile);
-          if (!layerDir) {
-              taskRef.reportError(std::move(layerDir).error());
-              return;
+          std::unique_ptr<package::ErofsImage> image;
+          std::optional<package::LayerDir> layerDir;
+          auto imageRet = layerFile->openImage();
+          if (imageRet) {
+              image = std::move(imageRet).value();
+          } else {
+              LogW("failed to open layer image, fallback to unpack it: {}", imageRet.error());
+              auto unpacked = layerPackager.unpack(*layerFile);
+              if (!unpacked) {
+                  taskRef.reportError(std::move(unpacked).error());
+                  return;
+              }
+              layerDir = std::move(unpacked).value();
           }
 
-          auto info = (*layerDir).info();
+          auto info = image ? package::LayerImage{ *image }.info() : layerDir->info();
           if (!info) {
               taskRef.reportError(std::move(info).error());
               return;
@@ -689,7 +668,8 @@ QVariantMap PackageManager::installFromLayer(const QDBusUnixFileDescriptor &fd,
           }
 
           taskRef.updateProgress(60);
-          auto result = this->repo->importLayerDir(*layerDir);
+          auto result = image ? this->repo->importLayerImage(package::LayerImage{ *image })
+                              : this->repo->importLayerDir(*layerDir);
           if (!result) {
               taskRef.reportError(std::move(result).error());
               return;
@@ -4,6 +4,7 @@
 
 #include "uab_installation.h"
 
+#include "linglong/package/layer_image.h"
 #include "linglong/utils/log/log.h"
 
 namespace linglong::service {
@@ -301,11 +302,19 @@ utils::error::Result<void> UabInstallationAction::install([[maybe_unused]] Packa
 
     task.updateProgress(10);
 
-    auto mountPoint = uabFile->unpack();
-    if (!mountPoint) {
-        return LINGLONG_ERR(mountPoint);
+    // layers are imported from the bundle directly, it's unpacked only if the bundle isn't
+    // supported by ErofsImage
+    auto bundle = uabFile->openBundle();
+    if (bundle) {
+        uabBundle = std::move(bundle).value();
+    } else {
+        LogW("failed to open uab bundle, fallback to unpack it: {}", bundle.error());
+        auto mountPoint = uabFile->unpack();
+        if (!mountPoint) {
+            return LINGLONG_ERR(mountPoint);
+        }
+        uabMountPoint = std::move(mountPoint).value();
     }
-    uabMountPoint = std::move(mountPoint).value();
 
     task.updateProgress(15);
 
@@ -354,17 +363,27 @@ utils::error::Result<void> UabInstallationAction::installUabLayer(
     LINGLONG_TRACE("install uab layers from single package");
 
     for (const auto &layer : layers) {
-        std::error_code ec;
-        auto layerDirPath =
-          uabMountPoint / "layers" / layer.info.id / layer.info.packageInfoV2Module;
-        if (!std::filesystem::exists(layerDirPath, ec)) {
-            if (ec) {
-                auto msg = fmt::format("get status of {} failed: {}", layerDirPath, ec.message());
+        auto layerPath =
+          std::filesystem::path{ "layers" } / layer.info.id / layer.info.packageInfoV2Module;
+        auto layerDirPath = uabMountPoint / layerPath;
+        if (uabBundle) {
+            auto inode = uabBundle->lookup(layerPath);
+            if (!inode) {
+                auto msg = fmt::format("layer directory {} doesn't exist in bundle", layerPath);
+                return LINGLONG_ERR(msg, inode);
+            }
+        } else {
+            std::error_code ec;
+            if (!std::filesystem::exists(layerDirPath, ec)) {
+                if (ec) {
+                    auto msg =
+                      fmt::format("get status of {} failed: {}", layerDirPath, ec.message());
+                    return LINGLONG_ERR(msg);
+                }
+
+                auto msg = fmt::format("layer directory {} doesn't exist", layerDirPath);
                 return LINGLONG_ERR(msg);
             }
-
-            auto msg = fmt::format("layer directory {} doesn't exist", layerDirPath);
-            return LINGLONG_ERR(msg);
         }
 
         std::vector<std::filesystem::path> overlays;
@@ -381,7 +400,11 @@ utils::error::Result<void> UabInstallationAction::installUabLayer(
             return LINGLONG_ERR(ref);
         }
 
-        auto ret = this->repo.importLayerDir(package::LayerDir{ layerDirPath }, overlays, subRef);
+        auto ret = uabBundle
+          ? this->repo.importLayerImage(package::LayerImage{ *uabBundle, layerPath },
+                                        overlays,
+                                        subRef)
+          : this->repo.importLayerDir(package::LayerDir{ layerDirPath }, overlays, subRef);
         if (!ret) {
             return LINGLONG_ERR(ret);
         }
@@ -7,6 +7,7 @@
 #include "linglong/api/types/v1/InteractionMessageType.hpp"
 #include "linglong/api/types/v1/PackageManager1RequestInteractionAdditionalMessage.hpp"
 #include "linglong/api/types/v1/UabLayer.hpp"
+#include "linglong/package/erofs_image.h"
 #include "linglong/package/uab_file.h"
 #include "linglong/package_manager/action.h"
 #include "linglong/package_manager/package_manager.h"
@@ -66,6 +67,8 @@ private:
     CheckedLayers checkedLayers;
     std::unique_ptr<package::UABFile> uabFile;
     utils::Transaction transaction;
+    // the bundle read in process, uabMountPoint is used if it's not supported
+    std::unique_ptr<package::ErofsImage> uabBundle;
     std::filesystem::path uabMountPoint;
 };
 
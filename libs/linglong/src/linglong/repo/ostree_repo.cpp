@@ -17,7 +17,9 @@
 #include "linglong/common/gkeyfile_wrapper.h"
 #include "linglong/common/strings.h"
 #include "linglong/package/fuzzy_reference.h"
+#include "linglong/package/erofs_image.h"
 #include "linglong/package/layer_dir.h"
+#include "linglong/package/layer_image.h"
 #include "linglong/package/reference.h"
 #include "linglong/package_manager/package_task.h"
 #include "linglong/repo/config.h"
@@ -47,23 +49,29 @@
 #include <QtGlobal>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <climits>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <system_error>
 #include <thread>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include <fcntl.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 namespace linglong::repo {
@@ -175,11 +183,13 @@ ostreeSpecFromReferenceV2(const package::Reference &ref,
     return ret + "_" + subRef.value();
 }
 
-utils::error::Result<QString> commitDirToRepo(std::vector<GFile *> dirs,
-                                              OstreeRepo *repo,
-                                              const char *refspec) noexcept
+// fill writes the content of the commit to the mutable tree in the transaction
+using MutableTreeFiller =
+  std::function<utils::error::Result<void>(OstreeMutableTree *, OstreeRepoCommitModifier *)>;
+
+utils::error::Result<QString>
+commitToRepo(OstreeRepo *repo, const char *refspec, const MutableTreeFiller &fill) noexcept
 {
-    Q_ASSERT(dirs.size() >= 1);
     Q_ASSERT(repo != nullptr);
 
     LINGLONG_TRACE("commit to ostree linglong repo");
@@ -209,12 +219,9 @@ utils::error::Result<QString> commitDirToRepo(std::vector<GFile *> dirs,
         return LINGLONG_ERR("ostree_repo_commit_modifier_new return a nullptr");
     }
 
-    for (auto *dir : dirs) {
-        if (ostree_repo_write_directory_to_mtree(repo, dir, mtree, modifier, nullptr, &gErr)
-            == FALSE) {
-            return LINGLONG_ERR(
-              fmt::format("ostree_repo_write_directory_to_mtree {}", ptr_view(gErr)));
-        }
+    auto filled = fill(mtree, modifier);
+    if (!filled) {
+        return LINGLONG_ERR(filled);
     }
 
     g_autoptr(GFile) file = nullptr;
@@ -247,6 +254,367 @@ utils::error::Result<QString> commitDirToRepo(std::vector<GFile *> dirs,
     return commit;
 }
 
+utils::error::Result<void> writeDirsToMtree(OstreeRepo *repo,
+                                            const std::vector<GFile *> &dirs,
+                                            OstreeMutableTree *mtree,
+                                            OstreeRepoCommitModifier *modifier) noexcept
+{
+    LINGLONG_TRACE("write directories to mutable tree");
+
+    g_autoptr(GError) gErr = nullptr;
+    for (auto *dir : dirs) {
+        if (ostree_repo_write_directory_to_mtree(repo, dir, mtree, modifier, nullptr, &gErr)
+            == FALSE) {
+            return LINGLONG_ERR(
+              fmt::format("ostree_repo_write_directory_to_mtree {}", ptr_view(gErr)));
+        }
+    }
+
+    return LINGLONG_OK;
+}
+
+#if OSTREE_CHECK_VERSION(2021, 2)
+// ErofsMtreeWriter writes a directory of an erofs image to a mutable tree, the same as
+// ostree_repo_write_directory_to_mtree with the canonical permissions modifier. Content objects are
+// streamed from the image, so the image needn't be mounted or extracted.
+class ErofsMtreeWriter
+{
+public:
+    ErofsMtreeWriter(OstreeRepo *repo, const package::ErofsImage &image) noexcept
+        : repo(repo)
+        , image(image)
+    {
+    }
+
+    utils::error::Result<void> write(const package::ErofsInode &dir,
+                                     OstreeMutableTree *mtree) noexcept;
+
+private:
+    struct File
+    {
+        package::ErofsInode inode;
+        OstreeMutableTree *parent{ nullptr };
+        std::string name;
+    };
+
+    utils::error::Result<void>
+    walk(const package::ErofsInode &dir, OstreeMutableTree *mtree, std::size_t depth) noexcept;
+    utils::error::Result<void> setDirMeta(std::uint32_t mode, OstreeMutableTree *mtree) noexcept;
+    utils::error::Result<std::string> writeFile(const package::ErofsInode &inode) const noexcept;
+    utils::error::Result<void> writeFiles() noexcept;
+
+    OstreeRepo *repo;
+    const package::ErofsImage &image;
+    // directories of the same mode share the dirmeta object
+    std::unordered_map<std::uint32_t, std::string> dirMetas;
+    std::vector<File> files;
+    std::vector<OstreeMutableTree *> subtrees;
+    // directories can't be hard linked, a directory which is reached twice is linked by a crafted
+    // entry, e.g. to its ancestor, and it would be walked forever
+    std::unordered_set<std::uint64_t> walkedDirs;
+};
+
+utils::error::Result<void> ErofsMtreeWriter::write(const package::ErofsInode &dir,
+                                                   OstreeMutableTree *mtree) noexcept
+{
+    LINGLONG_TRACE("write erofs image to mutable tree");
+
+    auto unrefSubtrees = utils::finally::finally([this] {
+        std::for_each(this->subtrees.begin(), this->subtrees.end(), [](OstreeMutableTree *tree) {
+            g_object_unref(tree);
+        });
+        this->subtrees.clear();
+    });
+
+    auto ret = this->walk(dir, mtree, 0);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    ret = this->writeFiles();
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<void> ErofsMtreeWriter::setDirMeta(std::uint32_t mode,
+                                                        OstreeMutableTree *mtree) noexcept
+{
+    LINGLONG_TRACE("write dirmeta");
+
+    mode = S_IFDIR | (mode & 0755);
+    auto it = this->dirMetas.find(mode);
+    if (it == this->dirMetas.end()) {
+        g_autoptr(GFileInfo) info = g_file_info_new();
+        g_file_info_set_attribute_uint32(info, "unix::uid", 0);
+        g_file_info_set_attribute_uint32(info, "unix::gid", 0);
+        g_file_info_set_attribute_uint32(info, "unix::mode", mode);
+        g_autoptr(GVariant) dirMeta = ostree_create_directory_metadata(info, nullptr);
+
+        g_autoptr(GError) gErr = nullptr;
+        g_autofree guchar *csum = nullptr;
+        if (ostree_repo_write_metadata(this->repo,
+                                       OSTREE_OBJECT_TYPE_DIR_META,
+                                       nullptr,
+                                       dirMeta,
+                                       &csum,
+                                       nullptr,
+                                       &gErr)
+            == FALSE) {
+            return LINGLONG_ERR(fmt::format("ostree_repo_write_metadata {}", ptr_view(gErr)));
+        }
+
+        g_autofree char *checksum = ostree_checksum_from_bytes(csum);
+        it = this->dirMetas.emplace(mode, checksum).first;
+    }
+
+    ostree_mutable_tree_set_metadata_checksum(mtree, it->second.c_str());
+    return LINGLONG_OK;
+}
+
+utils::error::Result<void> ErofsMtreeWriter::walk(const package::ErofsInode &dir,
+                                                  OstreeMutableTree *mtree,
+                                                  std::size_t depth) noexcept
+{
+    LINGLONG_TRACE(fmt::format("walk directory {} of erofs image", dir.nid));
+
+    // a deeper path couldn't be checked out anyway, it only exhausts the stack
+    constexpr std::size_t maxDepth = PATH_MAX / 2;
+    if (depth > maxDepth) {
+        return LINGLONG_ERR(fmt::format("directories are nested deeper than {}", maxDepth));
+    }
+    try {
+        if (!this->walkedDirs.insert(dir.nid).second) {
+            return LINGLONG_ERR("directory is linked more than once");
+        }
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    auto ret = this->setDirMeta(dir.mode, mtree);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    auto entries = this->image.readDir(dir);
+    if (!entries) {
+        return LINGLONG_ERR(entries);
+    }
+
+    g_autoptr(GError) gErr = nullptr;
+    for (const auto &entry : *entries) {
+        auto inode = this->image.inode(entry.nid);
+        if (!inode) {
+            return LINGLONG_ERR(inode);
+        }
+
+        if (S_ISDIR(inode->mode)) {
+            OstreeMutableTree *subtree = nullptr;
+            if (ostree_mutable_tree_ensure_dir(mtree, entry.name.c_str(), &subtree, &gErr)
+                == FALSE) {
+                return LINGLONG_ERR(
+                  fmt::format("ostree_mutable_tree_ensure_dir {}", ptr_view(gErr)));
+            }
+            this->subtrees.push_back(subtree);
+
+            ret = this->walk(*inode, subtree, depth + 1);
+            if (!ret) {
+                return LINGLONG_ERR(ret);
+            }
+            continue;
+        }
+
+        if (S_ISLNK(inode->mode)) {
+            auto target = this->image.readLink(*inode);
+            if (!target) {
+                return LINGLONG_ERR(target);
+            }
+
+            g_autofree char *checksum = ostree_repo_write_symlink(this->repo,
+                                                                  nullptr,
+                                                                  0,
+                                                                  0,
+                                                                  nullptr,
+                                                                  target->c_str(),
+                                                                  nullptr,
+                                                                  &gErr);
+            if (checksum == nullptr) {
+                return LINGLONG_ERR(fmt::format("ostree_repo_write_symlink {}", ptr_view(gErr)));
+            }
+
+            if (ostree_mutable_tree_replace_file(mtree, entry.name.c_str(), checksum, &gErr)
+                == FALSE) {
+                return LINGLONG_ERR(
+                  fmt::format("ostree_mutable_tree_replace_file {}", ptr_view(gErr)));
+            }
+            continue;
+        }
+
+        if (!S_ISREG(inode->mode)) {
+            // ostree refuses special files as well
+            return LINGLONG_ERR(fmt::format("unsupported file type of {}", entry.name));
+        }
+
+        try {
+            this->files.push_back({ *inode, mtree, entry.name });
+        } catch (const std::exception &e) {
+            return LINGLONG_ERR(e);
+        }
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<std::string>
+ErofsMtreeWriter::writeFile(const package::ErofsInode &inode) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("write content of inode {}", inode.nid));
+
+    g_autoptr(GError) gErr = nullptr;
+    auto *writer = ostree_repo_write_regfile(this->repo,
+                                             nullptr,
+                                             0,
+                                             0,
+                                             S_IFREG | (inode.mode & 0755),
+                                             inode.size,
+                                             nullptr,
+                                             &gErr);
+    if (writer == nullptr) {
+        return LINGLONG_ERR(fmt::format("ostree_repo_write_regfile {}", ptr_view(gErr)));
+    }
+    auto unrefWriter = utils::finally::finally([writer] {
+        g_object_unref(writer);
+    });
+
+    package::ErofsFile file{ this->image, inode };
+    std::vector<std::byte> buf(1024 * 1024);
+    std::uint64_t offset{ 0 };
+    while (offset < inode.size) {
+        auto len = file.read(offset, buf.data(), buf.size());
+        if (!len) {
+            return LINGLONG_ERR(len);
+        }
+        if (*len == 0) {
+            return LINGLONG_ERR("unexpected end of file");
+        }
+
+        if (g_output_stream_write_all(G_OUTPUT_STREAM(writer),
+                                      buf.data(),
+                                      *len,
+                                      nullptr,
+                                      nullptr,
+                                      &gErr)
+            == FALSE) {
+            return LINGLONG_ERR(fmt::format("g_output_stream_write_all {}", ptr_view(gErr)));
+        }
+        offset += *len;
+    }
+
+    g_autofree char *checksum = ostree_content_writer_finish(writer, nullptr, &gErr);
+    if (checksum == nullptr) {
+        return LINGLONG_ERR(fmt::format("ostree_content_writer_finish {}", ptr_view(gErr)));
+    }
+
+    return std::string{ checksum };
+}
+
+utils::error::Result<void> ErofsMtreeWriter::writeFiles() noexcept
+{
+    LINGLONG_TRACE(fmt::format("write {} files of erofs image", this->files.size()));
+
+    // hard links are written once
+    std::unordered_map<std::uint64_t, std::size_t> nids;
+    std::vector<std::size_t> unique;
+    std::vector<std::size_t> sources(this->files.size());
+    try {
+        for (std::size_t i = 0; i < this->files.size(); ++i) {
+            auto [it, inserted] = nids.try_emplace(this->files[i].inode.nid, unique.size());
+            if (inserted) {
+                unique.push_back(i);
+            }
+            sources[i] = it->second;
+        }
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(e);
+    }
+
+    std::vector<std::string> checksums(unique.size());
+    std::atomic_size_t next{ 0 };
+    std::atomic_bool failed{ false };
+    std::mutex mutex;
+    utils::error::Result<void> failure = LINGLONG_OK;
+
+    auto worker = [&]() noexcept {
+        for (auto index = next++; index < unique.size() && !failed; index = next++) {
+            auto checksum = this->writeFile(this->files[unique[index]].inode);
+            if (checksum) {
+                checksums[index] = std::move(*checksum);
+                continue;
+            }
+
+            std::lock_guard lock(mutex);
+            if (!failed.exchange(true)) {
+                failure = LINGLONG_ERR(checksum);
+            }
+        }
+    };
+
+    auto threads = std::max(1U, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, unique.size()));
+
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(worker);
+        }
+    } catch (...) {
+        // fewer threads are fine
+    }
+
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    if (!failure) {
+        return LINGLONG_ERR(failure);
+    }
+
+    // mutable trees aren't thread safe
+    g_autoptr(GError) gErr = nullptr;
+    for (std::size_t i = 0; i < this->files.size(); ++i) {
+        const auto &file = this->files[i];
+        if (ostree_mutable_tree_replace_file(file.parent,
+                                             file.name.c_str(),
+                                             checksums[sources[i]].c_str(),
+                                             &gErr)
+            == FALSE) {
+            return LINGLONG_ERR(
+              fmt::format("ostree_mutable_tree_replace_file {}", ptr_view(gErr)));
+        }
+    }
+
+    return LINGLONG_OK;
+}
+#endif
+
+utils::error::Result<QString> commitDirToRepo(std::vector<GFile *> dirs,
+                                              OstreeRepo *repo,
+                                              const char *refspec) noexcept
+{
+    Q_ASSERT(dirs.size() >= 1);
+
+    return commitToRepo(repo,
+                        refspec,
+                        [repo, &dirs](OstreeMutableTree *mtree,
+                                      OstreeRepoCommitModifier *modifier) noexcept
+                          -> utils::error::Result<void> {
+                            return writeDirsToMtree(repo, dirs, mtree, modifier);
+                        });
+}
+
 utils::error::Result<void>
 updateOstreeRepoConfig(OstreeRepo *repo,
                        const linglong::api::types::v1::RepoConfigV2 &config,
@@ -898,10 +1266,119 @@ OSTreeRepo::importLayerDir(const package::LayerDir &dir,
         return LINGLONG_ERR(commitID);
     }
 
+    auto layerDir = this->addLocalLayer(commitID->toStdString(), *info);
+    if (!layerDir) {
+        return LINGLONG_ERR(layerDir);
+    }
+
+    return layerDir;
+}
+
+utils::error::Result<package::LayerDir>
+OSTreeRepo::importLayerImage(const package::LayerImage &layer,
+                             std::vector<std::filesystem::path> overlays,
+                             const std::optional<std::string> &subRef) noexcept
+{
+    LINGLONG_TRACE(fmt::format("import layer {} of erofs image", layer.path()));
+
+    if (!layer.valid()) {
+        return LINGLONG_ERR(fmt::format("invalid layer {} of erofs image", layer.path()));
+    }
+
+    auto root = layer.image().lookup(layer.path());
+    if (!root) {
+        return LINGLONG_ERR(root);
+    }
+
+#if OSTREE_CHECK_VERSION(2021, 2)
+    auto info = layer.info();
+    if (!info) {
+        return LINGLONG_ERR(info);
+    }
+
+    auto reference = package::Reference::fromPackageInfo(*info);
+    if (!reference) {
+        return LINGLONG_ERR(reference);
+    }
+
+    std::vector<GFile *> dirs;
+    auto cleanRes = utils::finally::finally([&dirs] {
+        std::for_each(dirs.begin(), dirs.end(), [](GFile *file) {
+            g_object_unref(file);
+        });
+    });
+
+    for (const auto &overlay : overlays) {
+        auto *gFile = g_file_new_for_path(overlay.c_str());
+        if (gFile == nullptr) {
+            return LINGLONG_ERR(fmt::format("g_file_new_for_path {} failed", overlay));
+        }
+        dirs.push_back(gFile);
+    }
+
+    auto *repo = this->ostreeRepo.get();
+    auto refspec =
+      ostreeSpecFromReferenceV2(*reference, std::nullopt, info->packageInfoV2Module, subRef);
+    auto commitID = commitToRepo(
+      repo,
+      refspec.c_str(),
+      [repo, &layer, &root, &dirs](OstreeMutableTree *mtree,
+                                   OstreeRepoCommitModifier *modifier) noexcept
+        -> utils::error::Result<void> {
+          LINGLONG_TRACE("write layer to mutable tree");
+
+          ErofsMtreeWriter writer{ repo, layer.image() };
+          auto ret = writer.write(*root, mtree);
+          if (!ret) {
+              return LINGLONG_ERR(ret);
+          }
+
+          return writeDirsToMtree(repo, dirs, mtree, modifier);
+      });
+    if (!commitID) {
+        return LINGLONG_ERR(commitID);
+    }
+
+    auto layerDir = this->addLocalLayer(commitID->toStdString(), *info);
+    if (!layerDir) {
+        return LINGLONG_ERR(layerDir);
+    }
+
+    return layerDir;
+#else
+    // content objects can't be streamed to the repo, extract the layer first
+    QTemporaryDir tmpDir(
+      QString::fromStdString((this->ostreeRepoDir() / "tmp/layer-XXXXXX").string()));
+    if (!tmpDir.isValid()) {
+        return LINGLONG_ERR(tmpDir.errorString().toStdString());
+    }
+
+    auto ret = layer.image().extract(*root, tmpDir.path().toStdString());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    auto layerDir = this->importLayerDir(package::LayerDir{ tmpDir.path().toStdString() },
+                                         std::move(overlays),
+                                         subRef);
+    if (!layerDir) {
+        return LINGLONG_ERR(layerDir);
+    }
+
+    return layerDir;
+#endif
+}
+
+utils::error::Result<package::LayerDir>
+OSTreeRepo::addLocalLayer(const std::string &commit,
+                          const api::types::v1::PackageInfoV2 &info) noexcept
+{
+    LINGLONG_TRACE(fmt::format("add local layer {}", commit));
+
     api::types::v1::RepositoryCacheLayersItem item;
 
-    item.commit = (*commitID).toStdString();
-    item.info = *info;
+    item.commit = commit;
+    item.info = info;
     item.repo = "local";
 
     auto layerDir = this->ensureEmptyLayerDir(item.commit);
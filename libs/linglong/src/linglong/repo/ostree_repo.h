@@ -11,6 +11,7 @@
 #include "linglong/api/types/v1/RepoConfigV2.hpp"
 #include "linglong/package/fuzzy_reference.h"
 #include "linglong/package/layer_dir.h"
+#include "linglong/package/layer_image.h"
 #include "linglong/package/reference.h"
 #include "linglong/package_manager/package_task.h"
 #include "linglong/repo/client_factory.h"
@@ -99,6 +100,11 @@ public:
     importLayerDir(const package::LayerDir &dir,
                    std::vector<std::filesystem::path> overlays = {},
                    const std::optional<std::string> &subRef = std::nullopt) noexcept;
+    // the same as importLayerDir, but the layer is read from an erofs image without mounting it
+    utils::error::Result<package::LayerDir>
+    importLayerImage(const package::LayerImage &layer,
+                     std::vector<std::filesystem::path> overlays = {},
+                     const std::optional<std::string> &subRef = std::nullopt) noexcept;
 
     virtual utils::error::Result<package::LayerDir>
     getLayerDir(const package::Reference &ref,
@@ -209,6 +215,8 @@ public:
     }
 
     [[nodiscard]] const std::filesystem::path &getRepoDir() const noexcept { return repoDir; }
+    // states.json, it's rewritten on every change of the repo cache
+    [[nodiscard]] std::filesystem::path cacheFilePath() const noexcept;
 
     virtual utils::error::Result<std::vector<api::types::v1::PackageInfoV2>>
     listLocalApps() const noexcept;
@@ -229,12 +237,13 @@ private:
 
     utils::error::Result<void> updateConfig(const api::types::v1::RepoConfigV2 &newCfg) noexcept;
     std::filesystem::path ostreeRepoDir() const noexcept;
-    std::filesystem::path cacheFilePath() const noexcept;
     std::filesystem::path configFilePath() const noexcept;
     [[nodiscard]] utils::error::Result<QDir>
     ensureEmptyLayerDir(const std::string &commit) const noexcept;
     utils::error::Result<void> handleRepositoryUpdate(
       QDir layerDir, const api::types::v1::RepositoryCacheLayersItem &layer) noexcept;
+    utils::error::Result<package::LayerDir>
+    addLocalLayer(const std::string &commit, const api::types::v1::PackageInfoV2 &info) noexcept;
     utils::error::Result<void> removeOstreeRef(const std::string &remote,
                                                const std::string &ref,
                                                const std::string &commit) noexcept;
@@ -9,12 +9,14 @@
 #include "configure.h"
 #include "linglong/common/dir.h"
 #include "linglong/runtime/container_builder.h"
+#include "linglong/runtime/container_registry.h"
 #include "linglong/runtime/overlayfs_driver.h"
 #include "linglong/runtime/run_context.h"
 #include "linglong/utils/bash_command_helper.h"
 #include "linglong/utils/file.h"
 #include "linglong/utils/log/log.h"
 #include "linglong/utils/overlayfs.h"
+#include "linglong/utils/tracing.h"
 #include "ocppi/runtime/RunOption.hpp"
 #include "ocppi/runtime/config/types/Generators.hpp"
 
@@ -332,6 +334,26 @@ utils::error::Result<void> Container::run(const ocppi::runtime::config::types::P
       .type = "bind",
     });
 
+    if (utils::tracing::enabled()) {
+        // ll-init appends its events to the same trace file
+        auto traceFile = std::filesystem::absolute(::getenv(utils::tracing::TraceFileEnv), ec);
+        if (!ec && std::filesystem::exists(traceFile, ec)) {
+            constexpr auto containerTraceFile = "/run/linglong/startup-trace.json";
+            this->cfg.mounts->push_back(ocppi::runtime::config::types::Mount{
+              .destination = containerTraceFile,
+              .options = { { "rbind" } },
+              .source = traceFile,
+              .type = "bind",
+            });
+
+            auto env = this->cfg.process->env.value_or(std::vector<std::string>{});
+            env.emplace_back(fmt::format("{}={}", utils::tracing::TraceFileEnv, containerTraceFile));
+            env.emplace_back(
+              fmt::format("{}={}", utils::tracing::LaunchIDEnv, utils::tracing::launchID()));
+            this->cfg.process->env = std::move(env);
+        }
+    }
+
     auto cmd = utils::BashCommandHelper::generateExecCommand(entrypointPath);
     this->cfg.process->args = cmd;
     res = utils::writeFile(bundleDir / "config.json", nlohmann::json(this->cfg).dump());
@@ -342,7 +364,12 @@ utils::error::Result<void> Container::run(const ocppi::runtime::config::types::P
     LogD("run container with bundle {}", bundleDir);
     // 禁用crun自己创建cgroup，便于AM识别和管理玲珑应用
     opt.GlobalOption::extra.emplace_back("--cgroup-manager=disabled");
+    // `ll-cli ps` reads the pid of container from it instead of asking the runtime
+    for (auto &option : ContainerRegistry::containerPidFileOptions(this->cli.bin(), bundleDir)) {
+        opt.RunOption::extra.emplace_back(std::move(option));
+    }
 
+    utils::tracing::instant("spawn oci runtime");
     auto result = this->cli.run(this->context->getContainerID(), bundleDir, opt);
     if (!result) {
         return LINGLONG_ERR("cli run", result.error());
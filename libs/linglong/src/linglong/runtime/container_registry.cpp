@@ -0,0 +1,356 @@
+/*
+ * SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "linglong/runtime/container_registry.h"
+
+#include "linglong/api/types/v1/Generators.hpp"
+#include "linglong/common/error.h"
+#include "linglong/utils/file.h"
+#include "linglong/utils/log/log.h"
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <array>
+#include <charconv>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace linglong::runtime {
+
+namespace {
+
+template <typename T>
+std::optional<T> parseNumber(std::string_view str) noexcept
+{
+    T value{};
+    const auto *end = str.data() + str.size();
+    auto [ptr, ec] = std::from_chars(str.data(), end, value);
+    if (ec != std::errc{} || ptr != end) {
+        return std::nullopt;
+    }
+
+    return value;
+}
+
+std::optional<std::string> readAll(int fd) noexcept
+{
+    std::string content;
+    std::array<char, 4096> buf{};
+    off_t offset = 0;
+    while (true) {
+        auto n = ::pread(fd, buf.data(), buf.size(), offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return std::nullopt;
+        }
+
+        if (n == 0) {
+            break;
+        }
+
+        content.append(buf.data(), static_cast<std::size_t>(n));
+        offset += n;
+    }
+
+    return content;
+}
+
+} // namespace
+
+ContainerRegistry::Entry::Entry(int fd, std::filesystem::path path) noexcept
+    : fd(fd)
+    , entryPath(std::move(path))
+{
+}
+
+ContainerRegistry::Entry::Entry(Entry &&other) noexcept
+    : fd(other.fd)
+    , entryPath(std::move(other.entryPath))
+{
+    other.fd = -1;
+}
+
+ContainerRegistry::Entry &ContainerRegistry::Entry::operator=(Entry &&other) noexcept
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    std::swap(fd, other.fd);
+    std::swap(entryPath, other.entryPath);
+    return *this;
+}
+
+ContainerRegistry::Entry::~Entry()
+{
+    if (fd < 0) {
+        return;
+    }
+
+    // remove the entry before releasing the lock, nobody could see an unlocked entry of a
+    // living process
+    std::error_code ec;
+    if (!std::filesystem::remove(entryPath, ec) && ec) {
+        LogE("failed to remove file {}: {}", entryPath, ec.message());
+    }
+
+    ::close(fd);
+}
+
+utils::error::Result<void>
+ContainerRegistry::Entry::update(const api::types::v1::ContainerProcessStateInfo &info) noexcept
+{
+    LINGLONG_TRACE(fmt::format("update container registry entry {}", entryPath));
+
+    // the lock is bound to this fd, the entry must not be reopened and closed by its owner
+    auto content = nlohmann::json(info).dump();
+    std::size_t written = 0;
+    while (written < content.size()) {
+        auto n = ::pwrite(fd,
+                          content.data() + written,
+                          content.size() - written,
+                          static_cast<off_t>(written));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return LINGLONG_ERR(fmt::format("pwrite: {}", common::error::errorString(errno)));
+        }
+        written += static_cast<std::size_t>(n);
+    }
+
+    if (::ftruncate(fd, static_cast<off_t>(content.size())) != 0) {
+        return LINGLONG_ERR(fmt::format("ftruncate: {}", common::error::errorString(errno)));
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<ContainerRegistry::Entry> ContainerRegistry::create(uid_t uid) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("register container process for user {}", uid));
+
+    auto userDir = root / std::to_string(uid);
+    auto ret = utils::ensureDirectory(userDir);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    auto pid = ::getpid();
+    auto entryPath = userDir / std::to_string(pid);
+
+    // an entry named by our pid may be left by a dead process with the same pid, or it may
+    // belong to a process in another pid namespace
+    auto existing = ::open(entryPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (existing != -1) {
+        auto locked = ::flock(existing, LOCK_SH | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+        ::close(existing);
+        if (locked) {
+            return LINGLONG_ERR(fmt::format("{} is owned by another process", entryPath));
+        }
+    }
+
+    // lock the entry before it's visible, so that it's never mistaken for a stale one
+    auto tmpPath = userDir / fmt::format(".{}.tmp", pid);
+    auto mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH;
+    auto fd = ::open(tmpPath.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (fd == -1) {
+        return LINGLONG_ERR(
+          fmt::format("failed to create {}: {}", tmpPath, common::error::errorString(errno)));
+    }
+
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        auto err = errno;
+        ::close(fd);
+        ::unlink(tmpPath.c_str());
+        return LINGLONG_ERR(
+          fmt::format("failed to lock {}: {}", tmpPath, common::error::errorString(err)));
+    }
+
+    if (::rename(tmpPath.c_str(), entryPath.c_str()) != 0) {
+        auto err = errno;
+        ::close(fd);
+        ::unlink(tmpPath.c_str());
+        return LINGLONG_ERR(fmt::format("failed to rename {} to {}: {}",
+                                        tmpPath,
+                                        entryPath,
+                                        common::error::errorString(err)));
+    }
+
+    return Entry{ fd, std::move(entryPath) };
+}
+
+utils::error::Result<std::vector<RegisteredContainer>>
+ContainerRegistry::list(std::optional<uid_t> uid) const noexcept
+{
+    LINGLONG_TRACE("list registered containers");
+
+    std::vector<RegisteredContainer> result;
+    if (uid) {
+        auto ret = listUser(root / std::to_string(*uid), *uid, result);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+        return result;
+    }
+
+    std::error_code ec;
+    auto iter = std::filesystem::directory_iterator{ root, ec };
+    if (ec) {
+        if (ec == std::errc::no_such_file_or_directory) {
+            return result;
+        }
+        return LINGLONG_ERR(fmt::format("failed to list {}", root), ec);
+    }
+
+    for (const auto &entry : iter) {
+        auto userUid = parseNumber<uid_t>(entry.path().filename().string());
+        if (!userUid || !entry.is_directory(ec)) {
+            continue;
+        }
+
+        auto ret = listUser(entry.path(), *userUid, result);
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+    }
+
+    return result;
+}
+
+utils::error::Result<void>
+ContainerRegistry::listUser(const std::filesystem::path &userDir,
+                            uid_t uid,
+                            std::vector<RegisteredContainer> &result) const noexcept
+{
+    LINGLONG_TRACE(fmt::format("list registered containers in {}", userDir));
+
+    std::error_code ec;
+    auto iter = std::filesystem::directory_iterator{ userDir, ec };
+    if (ec) {
+        if (ec == std::errc::no_such_file_or_directory) {
+            return LINGLONG_OK;
+        }
+        return LINGLONG_ERR(fmt::format("failed to list {}", userDir), ec);
+    }
+
+    for (const auto &entry : iter) {
+        const auto &path = entry.path();
+        auto owner = parseNumber<pid_t>(path.filename().string());
+        if (!owner || !entry.is_regular_file(ec)) {
+            continue;
+        }
+
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd == -1) {
+            // the owner exited meanwhile
+            if (errno != ENOENT) {
+                LogW("failed to open {}: {}", path, common::error::errorString(errno));
+            }
+            continue;
+        }
+
+        auto locked = ::flock(fd, LOCK_SH | LOCK_NB) != 0 && errno == EWOULDBLOCK;
+        if (!locked && !std::filesystem::exists("/proc/" + std::to_string(*owner), ec)) {
+            LogD("remove stale entry {}", path);
+            ::unlink(path.c_str());
+            ::close(fd);
+            continue;
+        }
+
+        auto content = readAll(fd);
+        ::close(fd);
+        if (!content) {
+            LogW("failed to read {}", path);
+            continue;
+        }
+
+        // the owner hasn't started its container yet
+        if (content->empty()) {
+            continue;
+        }
+
+        try {
+            result.push_back(RegisteredContainer{
+              .owner = *owner,
+              .uid = uid,
+              .info =
+                nlohmann::json::parse(*content).get<api::types::v1::ContainerProcessStateInfo>(),
+            });
+        } catch (const std::exception &e) {
+            LogW("invalid entry {}: {}", path, e.what());
+        }
+    }
+
+    return LINGLONG_OK;
+}
+
+std::filesystem::path
+ContainerRegistry::containerPidFile(const std::filesystem::path &bundle) noexcept
+{
+    return bundle / "container.pid";
+}
+
+std::optional<pid_t> ContainerRegistry::containerPid(const std::filesystem::path &bundle) noexcept
+{
+    auto content = utils::readFile(containerPidFile(bundle));
+    if (!content) {
+        return std::nullopt;
+    }
+
+    auto str = std::string_view{ *content };
+    while (!str.empty() && (str.back() == '\n' || str.back() == '\0')) {
+        str.remove_suffix(1);
+    }
+
+    return parseNumber<pid_t>(str);
+}
+
+utils::error::Result<void> ContainerRegistry::saveContainerPid(const std::filesystem::path &bundle,
+                                                               pid_t pid) noexcept
+{
+    LINGLONG_TRACE(fmt::format("save pid of container to {}", bundle));
+
+    // written to a temporary file first, readers never see a partial pid
+    auto pidFile = containerPidFile(bundle);
+    auto tmpPath = pidFile.string() + ".tmp";
+    auto ret = utils::writeFile(tmpPath, std::to_string(pid));
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    if (::rename(tmpPath.c_str(), pidFile.c_str()) != 0) {
+        auto err = errno;
+        ::unlink(tmpPath.c_str());
+        return LINGLONG_ERR(fmt::format("failed to rename {} to {}: {}",
+                                        tmpPath,
+                                        pidFile,
+                                        common::error::errorString(err)));
+    }
+
+    return LINGLONG_OK;
+}
+
+std::vector<std::string>
+ContainerRegistry::containerPidFileOptions(const std::filesystem::path &runtime,
+                                           const std::filesystem::path &bundle) noexcept
+{
+    auto name = runtime.filename();
+    if (name != "crun" && name != "runc") {
+        return {};
+    }
+
+    return { fmt::format("--pid-file={}", containerPidFile(bundle).string()) };
+}
+
+} // namespace linglong::runtime
@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "linglong/api/types/v1/ContainerProcessStateInfo.hpp"
+#include "linglong/utils/error/error.h"
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+namespace linglong::runtime {
+
+struct RegisteredContainer
+{
+    // pid of the `ll-cli run` process which owns the entry
+    pid_t owner;
+    uid_t uid;
+    api::types::v1::ContainerProcessStateInfo info;
+};
+
+// ContainerRegistry records the containers started by `ll-cli run`. Every run owns an entry at
+// <root>/<uid>/<pid>, the layout is the same as the state files written by former versions.
+// The owner holds an exclusive flock on its entry until it exits, the kernel drops the lock
+// when the process dies, so a query only needs to open the entry and probe the lock, instead
+// of checking /proc and asking the OCI runtime to list containers.
+// Entries without a lock (written by former versions) fall back to checking /proc/<pid>.
+class ContainerRegistry
+{
+public:
+    // an entry of current process, it's removed on destruction
+    class Entry
+    {
+    public:
+        Entry(const Entry &) = delete;
+        Entry &operator=(const Entry &) = delete;
+        Entry(Entry &&other) noexcept;
+        Entry &operator=(Entry &&other) noexcept;
+        ~Entry();
+
+        utils::error::Result<void>
+        update(const api::types::v1::ContainerProcessStateInfo &info) noexcept;
+
+        [[nodiscard]] const std::filesystem::path &path() const noexcept { return entryPath; }
+
+    private:
+        friend class ContainerRegistry;
+        Entry(int fd, std::filesystem::path path) noexcept;
+
+        int fd{ -1 };
+        std::filesystem::path entryPath;
+    };
+
+    explicit ContainerRegistry(std::filesystem::path root = "/run/linglong") noexcept
+        : root(std::move(root))
+    {
+    }
+
+    // register current process for uid, the entry is empty until it's updated
+    [[nodiscard]] utils::error::Result<Entry> create(uid_t uid) const noexcept;
+
+    // containers started by uid, or by all users if uid is std::nullopt
+    [[nodiscard]] utils::error::Result<std::vector<RegisteredContainer>>
+    list(std::optional<uid_t> uid = std::nullopt) const noexcept;
+
+    // pid of the container process, which is written by the OCI runtime to the bundle
+    static std::filesystem::path containerPidFile(const std::filesystem::path &bundle) noexcept;
+
+    static std::optional<pid_t> containerPid(const std::filesystem::path &bundle) noexcept;
+
+    // write the pid which is taken from `state` to containerPidFile, for runtimes which don't
+    // write it, so that the runtime is asked once per container
+    static utils::error::Result<void> saveContainerPid(const std::filesystem::path &bundle,
+                                                       pid_t pid) noexcept;
+
+    // the options of `run` which make the OCI runtime write containerPidFile. It's empty for
+    // runtimes which don't support --pid-file, e.g. ll-box, see saveContainerPid.
+    static std::vector<std::string>
+    containerPidFileOptions(const std::filesystem::path &runtime,
+                            const std::filesystem::path &bundle) noexcept;
+
+private:
+    utils::error::Result<void> listUser(const std::filesystem::path &userDir,
+                                        uid_t uid,
+                                        std::vector<RegisteredContainer> &result) const noexcept;
+
+    std::filesystem::path root;
+};
+
+} // namespace linglong::runtime
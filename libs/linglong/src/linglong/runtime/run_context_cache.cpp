@@ -0,0 +1,269 @@
+/*
+ * SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "linglong/runtime/run_context_cache.h"
+
+#include "configure.h"
+#include "linglong/api/types/v1/Generators.hpp"
+#include "linglong/common/dir.h"
+#include "linglong/extension/extension.h"
+#include "linglong/utils/file.h"
+#include "linglong/utils/log/log.h"
+#include "linglong/utils/sha256.h"
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+namespace linglong::runtime {
+
+namespace {
+
+constexpr auto cacheEntryVersion = "1";
+
+std::string fileStamp(const std::filesystem::path &path) noexcept
+{
+    struct stat st{};
+    if (::stat(path.c_str(), &st) != 0) {
+        return "-";
+    }
+
+    return fmt::format("{}:{}:{}:{}.{}",
+                       st.st_dev,
+                       st.st_ino,
+                       st.st_size,
+                       st.st_mtim.tv_sec,
+                       st.st_mtim.tv_nsec);
+}
+
+// everything that RunContext::resolve reads besides the resolve options, any change of them
+// must produce a different stamp
+std::string makeStamp(const repo::OSTreeRepo &repo) noexcept
+{
+    std::string kernelRelease;
+    struct utsname uts{};
+    if (::uname(&uts) == 0) {
+        kernelRelease = uts.release;
+    }
+
+    std::error_code ec;
+    auto localtime = std::filesystem::read_symlink("/etc/localtime", ec);
+
+    const auto *tzdir = std::getenv("TZDIR");
+
+    // the extensions which are enabled depend on the host, e.g. the version of the NVIDIA driver
+    return fmt::format("{}|{}|{}|{}|{}|{}",
+                       LINGLONG_VERSION,
+                       fileStamp(repo.cacheFilePath()),
+                       kernelRelease,
+                       localtime.string(),
+                       tzdir == nullptr ? "" : tzdir,
+                       extension::ExtensionFactory::hostState());
+}
+
+nlohmann::json optionsToJson(const ResolveOptions &opts)
+{
+    nlohmann::json json;
+    json["appModules"] = opts.appModules;
+    json["baseRef"] = opts.baseRef;
+    json["cdiDevices"] = opts.cdiDevices;
+    json["depsExcludeDev"] = opts.depsExcludeDev;
+    json["extensionRefs"] = opts.extensionRefs;
+    json["externalExtensionDefs"] = opts.externalExtensionDefs;
+    json["instance"] = opts.instance;
+    json["mounts"] = opts.mounts;
+    json["runtimeRef"] = opts.runtimeRef;
+    return json;
+}
+
+std::string entryKey(const package::Reference &runnable, const ResolveOptions &opts)
+{
+    auto factor = runnable.toString() + '\0' + optionsToJson(opts).dump();
+
+    digest::SHA256 sha256;
+    sha256.update(reinterpret_cast<const std::byte *>(factor.data()), factor.size());
+    std::array<std::byte, 32> digest{};
+    sha256.final(digest.data());
+
+    std::stringstream stream;
+    stream << std::setfill('0') << std::hex;
+    for (auto v : digest) {
+        stream << std::setw(2) << static_cast<unsigned int>(v);
+    }
+
+    return stream.str();
+}
+
+} // namespace
+
+std::filesystem::path RunContextCache::defaultCacheDir() noexcept
+{
+    return common::dir::getUserCacheDir() / "run-context";
+}
+
+bool RunContextCache::cacheable(const ResolveOptions &opts) noexcept
+{
+    // the defines of external extensions, e.g. their allowEnv, aren't part of the resolved
+    // config, a context restored from it would differ from a resolved one
+    auto externalExtensions = opts.externalExtensionDefs
+      && std::any_of(opts.externalExtensionDefs->cbegin(),
+                     opts.externalExtensionDefs->cend(),
+                     [](const auto &defs) {
+                         return !defs.second.empty();
+                     });
+    return !opts.depsExcludeDev && (!opts.appModules || opts.appModules->empty())
+      && !externalExtensions;
+}
+
+std::filesystem::path RunContextCache::entryPath(const package::Reference &runnable,
+                                                 const ResolveOptions &opts) const noexcept
+{
+    return cacheDir / (entryKey(runnable, opts) + ".json");
+}
+
+utils::error::Result<std::optional<api::types::v1::RunContextConfig>>
+RunContextCache::load(const repo::OSTreeRepo &repo,
+                      const package::Reference &runnable,
+                      const ResolveOptions &opts) const noexcept
+{
+    LINGLONG_TRACE("load cached run context of " + runnable.toString());
+
+    auto entryFile = entryPath(runnable, opts);
+    std::error_code ec;
+    if (!std::filesystem::exists(entryFile, ec)) {
+        if (ec) {
+            return LINGLONG_ERR(fmt::format("failed to check {}", entryFile), ec);
+        }
+        return std::nullopt;
+    }
+
+    auto content = utils::readFile(entryFile);
+    if (!content) {
+        return LINGLONG_ERR(content);
+    }
+
+    try {
+        auto entry = nlohmann::json::parse(*content);
+        if (entry.at("version").get<std::string>() != cacheEntryVersion
+            || entry.at("ref").get<std::string>() != runnable.toString()
+            || entry.at("stamp").get<std::string>() != makeStamp(repo)) {
+            LogD("cached run context of {} is stale", runnable.toString());
+            return std::nullopt;
+        }
+
+        return entry.at("config").get<api::types::v1::RunContextConfig>();
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR(fmt::format("invalid cache entry {}", entryFile), e);
+    }
+}
+
+utils::error::Result<void>
+RunContextCache::save(const repo::OSTreeRepo &repo,
+                      const package::Reference &runnable,
+                      const ResolveOptions &opts,
+                      const api::types::v1::RunContextConfig &config) const noexcept
+{
+    LINGLONG_TRACE("save run context of " + runnable.toString() + " to cache");
+
+    auto ret = utils::ensureDirectory(cacheDir);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    nlohmann::json entry;
+    entry["version"] = cacheEntryVersion;
+    entry["ref"] = runnable.toString();
+    entry["stamp"] = makeStamp(repo);
+    entry["config"] = config;
+
+    // write to a temporary file first, concurrent launches must never see a partial entry
+    auto entryFile = entryPath(runnable, opts);
+    auto tmpFile = entryFile;
+    tmpFile += fmt::format(".{}.tmp", ::getpid());
+    ret = utils::writeFile(tmpFile, entry.dump());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpFile, entryFile, ec);
+    if (ec) {
+        std::filesystem::remove(tmpFile, ec);
+        return LINGLONG_ERR(fmt::format("failed to rename {} to {}", tmpFile, entryFile), ec);
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<void> RunContextCache::remove(const package::Reference &runnable,
+                                                   const ResolveOptions &opts) const noexcept
+{
+    LINGLONG_TRACE("remove cached run context of " + runnable.toString());
+
+    auto entryFile = entryPath(runnable, opts);
+    std::error_code ec;
+    std::filesystem::remove(entryFile, ec);
+    if (ec) {
+        return LINGLONG_ERR(fmt::format("failed to remove {}", entryFile), ec);
+    }
+
+    return LINGLONG_OK;
+}
+
+utils::error::Result<std::unique_ptr<RunContext>>
+resolveRunContext(repo::OSTreeRepo &repo,
+                  const package::Reference &runnable,
+                  const ResolveOptions &opts,
+                  const RunContextCache *cache) noexcept
+{
+    LINGLONG_TRACE("resolve run context of " + runnable.toString());
+
+    if (cache != nullptr && !RunContextCache::cacheable(opts)) {
+        cache = nullptr;
+    }
+
+    if (cache != nullptr) {
+        auto cached = cache->load(repo, runnable, opts);
+        if (!cached) {
+            LogW("failed to load cached run context: {}", cached.error());
+        } else if (cached->has_value()) {
+            auto context = std::make_unique<RunContext>(repo);
+            auto res = context->resolve(**cached);
+            if (res) {
+                LogD("reuse cached run context of {}", runnable.toString());
+                return context;
+            }
+
+            LogW("cached run context of {} is unusable: {}", runnable.toString(), res.error());
+        }
+    }
+
+    auto context = std::make_unique<RunContext>(repo);
+    auto res = context->resolve(runnable, opts);
+    if (!res) {
+        return LINGLONG_ERR(res);
+    }
+
+    if (cache != nullptr) {
+        auto ret = cache->save(repo, runnable, opts, context->getConfig());
+        if (!ret) {
+            LogW("failed to cache run context: {}", ret.error());
+        }
+    }
+
+    return context;
+}
+
+} // namespace linglong::runtime
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include "linglong/api/types/v1/RunContextConfig.hpp"
+#include "linglong/package/reference.h"
+#include "linglong/repo/ostree_repo.h"
+#include "linglong/runtime/run_context.h"
+#include "linglong/utils/error/error.h"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace linglong::runtime {
+
+// RunContextCache persists the RunContextConfig resolved for a runnable, so that the next
+// `ll-cli run` of the same runnable can skip the full resolution. An entry is keyed by the
+// runnable and the resolve options, and it is only reused if the stamp recorded alongside it
+// (generation of the repo cache, host kernel, local timezone, host state read by extensions) still
+// matches. Checking the stamp
+// only costs a few stat calls.
+class RunContextCache
+{
+public:
+    explicit RunContextCache(std::filesystem::path cacheDir) noexcept
+        : cacheDir(std::move(cacheDir))
+    {
+    }
+
+    // $XDG_CACHE_HOME/linglong/run-context
+    static std::filesystem::path defaultCacheDir() noexcept;
+
+    // RunContext::resolve(RunContextConfig) ignores module selection and the defines of external
+    // extensions, contexts resolved with these options can't be restored from a cached config.
+    static bool cacheable(const ResolveOptions &opts) noexcept;
+
+    [[nodiscard]] utils::error::Result<std::optional<api::types::v1::RunContextConfig>>
+    load(const repo::OSTreeRepo &repo,
+         const package::Reference &runnable,
+         const ResolveOptions &opts) const noexcept;
+
+    utils::error::Result<void> save(const repo::OSTreeRepo &repo,
+                                    const package::Reference &runnable,
+                                    const ResolveOptions &opts,
+                                    const api::types::v1::RunContextConfig &config) const noexcept;
+
+    utils::error::Result<void> remove(const package::Reference &runnable,
+                                      const ResolveOptions &opts) const noexcept;
+
+    [[nodiscard]] const std::filesystem::path &path() const noexcept { return cacheDir; }
+
+private:
+    [[nodiscard]] std::filesystem::path entryPath(const package::Reference &runnable,
+                                                  const ResolveOptions &opts) const noexcept;
+
+    std::filesystem::path cacheDir;
+};
+
+// resolve a RunContext for runnable, the cached config is reused if it is still valid, otherwise
+// the context is resolved from scratch and the result is written back to cache.
+// cache could be nullptr, which means always resolving from scratch.
+utils::error::Result<std::unique_ptr<RunContext>>
+resolveRunContext(repo::OSTreeRepo &repo,
+                  const package::Reference &runnable,
+                  const ResolveOptions &opts,
+                  const RunContextCache *cache) noexcept;
+
+} // namespace linglong::runtime
@@ -0,0 +1,104 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "bench.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace linglong::bench {
+
+namespace {
+
+// nearest-rank percentile of sorted samples
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+
+    auto rank = static_cast<std::size_t>(std::ceil(p / 100.0 * static_cast<double>(sorted.size())));
+    rank = std::clamp<std::size_t>(rank, 1, sorted.size());
+    return sorted[rank - 1];
+}
+
+} // namespace
+
+Stats summarize(std::string name, std::vector<double> samples)
+{
+    Stats stats;
+    stats.name = std::move(name);
+    stats.iterations = samples.size();
+    if (samples.empty()) {
+        return stats;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    stats.min = samples.front();
+    stats.max = samples.back();
+    stats.mean =
+      std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    stats.p50 = percentile(samples, 50);
+    stats.p95 = percentile(samples, 95);
+    stats.p99 = percentile(samples, 99);
+
+    return stats;
+}
+
+void Context::fail(const std::string &name, const std::string &reason)
+{
+    failures.emplace_back(name, reason);
+}
+
+void Context::skip(const std::string &name, const std::string &reason)
+{
+    skipped.emplace_back(name, reason);
+}
+
+nlohmann::json Context::report() const
+{
+    nlohmann::json stages = nlohmann::json::array();
+    for (const auto &stats : results) {
+        nlohmann::json stage{
+            { "name", stats.name }, { "iterations", stats.iterations },
+            { "unit", "us" },       { "min", stats.min },
+            { "mean", stats.mean }, { "p50", stats.p50 },
+            { "p95", stats.p95 },   { "p99", stats.p99 },
+            { "max", stats.max },
+        };
+        if (!stats.extra.empty()) {
+            stage["extra"] = stats.extra;
+        }
+        stages.push_back(std::move(stage));
+    }
+
+    auto toJson = [](const std::vector<std::pair<std::string, std::string>> &items) {
+        nlohmann::json array = nlohmann::json::array();
+        for (const auto &[name, reason] : items) {
+            array.push_back({ { "name", name }, { "reason", reason } });
+        }
+        return array;
+    };
+
+    return nlohmann::json{
+        { "stages", std::move(stages) },
+        { "failures", toJson(failures) },
+        { "skipped", toJson(skipped) },
+    };
+}
+
+std::vector<Benchmark> &registry()
+{
+    static std::vector<Benchmark> benchmarks;
+    return benchmarks;
+}
+
+bool registerBenchmark(std::string name, BenchFunc func)
+{
+    registry().push_back(Benchmark{ std::move(name), std::move(func) });
+    return true;
+}
+
+} // namespace linglong::bench
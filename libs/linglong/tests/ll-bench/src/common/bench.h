@@ -0,0 +1,112 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <nlohmann/json.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace linglong::bench {
+
+// statistics of one measured stage, durations are in microseconds
+struct Stats
+{
+    std::string name;
+    std::size_t iterations{ 0 };
+    double min{ 0 };
+    double mean{ 0 };
+    double p50{ 0 };
+    double p95{ 0 };
+    double p99{ 0 };
+    double max{ 0 };
+    // extra numbers reported by the stage itself, e.g. throughput
+    nlohmann::json extra = nlohmann::json::object();
+};
+
+Stats summarize(std::string name, std::vector<double> samples);
+
+// size of the synthetic repo used by benchmarks
+struct Scale
+{
+    std::size_t apps{ 1 };
+    std::size_t extensions{ 0 };
+};
+
+class Context
+{
+public:
+    Context(std::size_t iterations, std::filesystem::path workDir, Scale scale = {})
+        : iterations(iterations)
+        , workDir(std::move(workDir))
+        , scale(scale)
+    {
+    }
+
+    // run fn for the configured iterations and record the wall time of each run
+    template <typename Fn>
+    Stats &measure(const std::string &name, Fn &&fn)
+    {
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for (std::size_t i = 0; i < iterations; ++i) {
+            auto begin = std::chrono::steady_clock::now();
+            fn();
+            auto end = std::chrono::steady_clock::now();
+            samples.push_back(
+              std::chrono::duration<double, std::micro>(end - begin).count());
+        }
+
+        return results.emplace_back(summarize(name, std::move(samples)));
+    }
+
+    // record a failure of a stage, it will be reported but doesn't abort other benchmarks
+    void fail(const std::string &name, const std::string &reason);
+
+    // skip a stage which can't run in current environment
+    void skip(const std::string &name, const std::string &reason);
+
+    [[nodiscard]] const std::filesystem::path &getWorkDir() const noexcept { return workDir; }
+
+    [[nodiscard]] std::size_t getIterations() const noexcept { return iterations; }
+
+    [[nodiscard]] const Scale &getScale() const noexcept { return scale; }
+
+    [[nodiscard]] nlohmann::json report() const;
+
+    [[nodiscard]] bool failed() const noexcept { return !failures.empty(); }
+
+private:
+    std::size_t iterations;
+    std::filesystem::path workDir;
+    Scale scale;
+    std::vector<Stats> results;
+    std::vector<std::pair<std::string, std::string>> failures;
+    std::vector<std::pair<std::string, std::string>> skipped;
+};
+
+using BenchFunc = std::function<void(Context &)>;
+
+struct Benchmark
+{
+    std::string name;
+    BenchFunc func;
+};
+
+std::vector<Benchmark> &registry();
+
+bool registerBenchmark(std::string name, BenchFunc func);
+
+} // namespace linglong::bench
+
+#define LL_BENCH(name)                                                   \
+    static void name##_bench(linglong::bench::Context &ctx);             \
+    static const bool name##_registered =                                \
+      linglong::bench::registerBenchmark(#name, name##_bench); /*NOLINT*/ \
+    static void name##_bench(linglong::bench::Context &ctx)
@@ -0,0 +1,157 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "repo_fixture.h"
+
+#include "linglong/api/types/v1/Generators.hpp"
+#include "linglong/package/architecture.h"
+#include "linglong/utils/file.h"
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+namespace linglong::bench {
+
+namespace {
+
+constexpr auto fixtureChannel = "main";
+constexpr auto baseId = "org.linglong.bench.base";
+constexpr auto runtimeId = "org.linglong.bench.runtime";
+constexpr auto fixtureVersion = "1.0.0.0";
+
+api::types::v1::PackageInfoV2 makeInfo(const std::string &id, const std::string &kind)
+{
+    api::types::v1::PackageInfoV2 info;
+    info.arch = { package::Architecture::currentCPUArchitecture().toString() };
+    info.base = fmt::format("{}:{}/{}", fixtureChannel, baseId, fixtureVersion);
+    info.channel = fixtureChannel;
+    info.id = id;
+    info.kind = kind;
+    info.packageInfoV2Module = "binary";
+    info.name = id;
+    info.schemaVersion = "1.0";
+    info.size = 0;
+    info.version = fixtureVersion;
+    return info;
+}
+
+} // namespace
+
+utils::error::Result<std::unique_ptr<RepoFixture>>
+RepoFixture::create(const std::filesystem::path &root, const RepoFixtureOptions &options) noexcept
+{
+    LINGLONG_TRACE(fmt::format("create repo fixture at {}", root));
+
+    std::unique_ptr<RepoFixture> fixture(new RepoFixture());
+    fixture->stagingDir = root / "staging";
+
+    auto repoRoot = root / "repo";
+    auto ret = utils::ensureDirectory(repoRoot);
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    auto repo = repo::OSTreeRepo::create(repoRoot,
+                                         api::types::v1::RepoConfigV2{
+                                           .defaultRepo = "local",
+                                           .repos = { api::types::v1::Repo{
+                                             .name = "local",
+                                             .priority = 0,
+                                             .url = "file:///nonexistent" } },
+                                           .version = 2,
+                                         });
+    if (!repo) {
+        return LINGLONG_ERR(repo);
+    }
+    fixture->ostreeRepo = std::move(repo).value();
+
+    auto base = fixture->importLayer(makeInfo(baseId, "base"),
+                                     { "etc/os-release", "usr/lib/libc.so.6", "usr/bin/sh" });
+    if (!base) {
+        return LINGLONG_ERR(base);
+    }
+    fixture->baseRef = std::move(base).value();
+
+    auto runtimeInfo = makeInfo(runtimeId, "runtime");
+    std::vector<api::types::v1::ExtensionDefine> extensionDefines;
+    for (std::size_t i = 0; i < options.extensions; ++i) {
+        auto id = fmt::format("org.linglong.bench.ext{}", i);
+        auto extension = fixture->importLayer(makeInfo(id, "extension"),
+                                              { fmt::format("lib/libext{}.so", i) });
+        if (!extension) {
+            return LINGLONG_ERR(extension);
+        }
+        fixture->extensionRefs.push_back(std::move(extension).value());
+
+        extensionDefines.push_back(api::types::v1::ExtensionDefine{
+          .directory = "/opt/extensions/" + id,
+          .name = id,
+          .version = "",
+        });
+    }
+    if (!extensionDefines.empty()) {
+        runtimeInfo.extensions = std::move(extensionDefines);
+    }
+
+    auto runtime =
+      fixture->importLayer(runtimeInfo, { "lib/libQt5Core.so.5", "share/fonts/bench.ttf" });
+    if (!runtime) {
+        return LINGLONG_ERR(runtime);
+    }
+    fixture->runtimeRef = std::move(runtime).value();
+
+    for (std::size_t i = 0; i < options.apps; ++i) {
+        auto id = fmt::format("org.linglong.bench.app{}", i);
+        auto info = makeInfo(id, "app");
+        info.runtime = fmt::format("{}:{}/{}", fixtureChannel, runtimeId, fixtureVersion);
+        info.command = std::vector<std::string>{ "/opt/apps/" + id + "/files/bin/app" };
+        auto app = fixture->importLayer(info, { "bin/app", "share/applications/" + id + ".desktop" });
+        if (!app) {
+            return LINGLONG_ERR(app);
+        }
+        fixture->appRefs.push_back(std::move(app).value());
+    }
+
+    return fixture;
+}
+
+utils::error::Result<package::Reference>
+RepoFixture::importLayer(const api::types::v1::PackageInfoV2 &info,
+                         const std::vector<std::string> &files) noexcept
+{
+    LINGLONG_TRACE(fmt::format("import layer {}", info.id));
+
+    auto layerDir = stagingDir / info.id;
+    for (const auto &file : files) {
+        auto path = layerDir / "files" / file;
+        auto ret = utils::ensureDirectory(path.parent_path());
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+
+        ret = utils::writeFile(path, fmt::format("{} of {}\n", file, info.id));
+        if (!ret) {
+            return LINGLONG_ERR(ret);
+        }
+    }
+
+    auto ret = utils::writeFile(layerDir / "info.json", nlohmann::json(info).dump());
+    if (!ret) {
+        return LINGLONG_ERR(ret);
+    }
+
+    auto imported = ostreeRepo->importLayerDir(package::LayerDir{ layerDir });
+    if (!imported) {
+        return LINGLONG_ERR(imported);
+    }
+
+    auto ref = package::Reference::fromPackageInfo(info);
+    if (!ref) {
+        return LINGLONG_ERR(ref);
+    }
+
+    return std::move(ref).value();
+}
+
+} // namespace linglong::bench
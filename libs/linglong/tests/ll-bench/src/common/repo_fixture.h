@@ -0,0 +1,62 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/package/reference.h"
+#include "linglong/repo/ostree_repo.h"
+#include "linglong/utils/error/error.h"
+
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace linglong::bench {
+
+struct RepoFixtureOptions
+{
+    std::size_t apps{ 1 };
+    // extensions declared by the runtime, they are resolved by every app
+    std::size_t extensions{ 0 };
+};
+
+// RepoFixture builds a local repo with a tiny base, a tiny runtime, some extensions of the
+// runtime and some apps depending on them, all layers are committed through
+// OSTreeRepo::importLayerDir, no network is required.
+class RepoFixture
+{
+public:
+    static utils::error::Result<std::unique_ptr<RepoFixture>>
+    create(const std::filesystem::path &root, const RepoFixtureOptions &options = {}) noexcept;
+
+    [[nodiscard]] repo::OSTreeRepo &repo() const noexcept { return *ostreeRepo; }
+
+    [[nodiscard]] const package::Reference &base() const noexcept { return *baseRef; }
+
+    [[nodiscard]] const package::Reference &runtime() const noexcept { return *runtimeRef; }
+
+    [[nodiscard]] const std::vector<package::Reference> &extensions() const noexcept
+    {
+        return extensionRefs;
+    }
+
+    [[nodiscard]] const std::vector<package::Reference> &apps() const noexcept { return appRefs; }
+
+private:
+    RepoFixture() = default;
+
+    utils::error::Result<package::Reference>
+    importLayer(const api::types::v1::PackageInfoV2 &info,
+                const std::vector<std::string> &files) noexcept;
+
+    std::filesystem::path stagingDir;
+    std::unique_ptr<repo::OSTreeRepo> ostreeRepo;
+    std::optional<package::Reference> baseRef;
+    std::optional<package::Reference> runtimeRef;
+    std::vector<package::Reference> extensionRefs;
+    std::vector<package::Reference> appRefs;
+};
+
+} // namespace linglong::bench
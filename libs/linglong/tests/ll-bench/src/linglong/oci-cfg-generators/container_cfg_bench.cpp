@@ -0,0 +1,237 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "../../common/bench.h"
+#include "linglong/api/types/v1/Generators.hpp"
+#include "linglong/oci-cfg-generators/container_cfg_builder.h"
+#include "ocppi/runtime/config/types/Generators.hpp"
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <fstream>
+
+using namespace linglong;
+
+namespace {
+
+constexpr auto benchAppId = "org.linglong.bench.app";
+constexpr auto patchCount = 8;
+
+// a base with a typical top level layout
+bool makeBaseTree(const std::filesystem::path &base)
+{
+    std::error_code ec;
+    for (const auto *dir : { "etc", "usr/bin", "usr/lib", "usr/share", "var", "opt" }) {
+        std::filesystem::create_directories(base / dir, ec);
+        if (ec) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// small JSON patches like the ones shipped by distributions, each adds a mount
+bool makePatches(const std::filesystem::path &patchDir)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(patchDir, ec);
+    if (ec) {
+        return false;
+    }
+
+    for (int i = 0; i < patchCount; ++i) {
+        nlohmann::json patch{
+            { "ociVersion", "1.0.1" },
+            { "patch",
+              nlohmann::json::array({ {
+                { "op", "add" },
+                { "path", "/mounts/-" },
+                { "value",
+                  { { "destination", fmt::format("/run/bench/patch{}", i) },
+                    { "type", "tmpfs" },
+                    { "source", "tmpfs" },
+                    { "options", { "nodev", "nosuid" } } } },
+              } }) },
+        };
+        std::ofstream ofs(patchDir / fmt::format("{:02}-bench.json", i));
+        ofs << patch.dump();
+        if (!ofs) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+generator::ContainerCfgBuilder makeBuilder(const std::filesystem::path &base,
+                                           const std::filesystem::path &bundle,
+                                           const std::filesystem::path &patchDir)
+{
+    generator::ContainerCfgBuilder builder;
+    builder.setAppId(benchAppId)
+      .setBasePath(base)
+      .setBundlePath(bundle)
+      .setPatchDir(patchDir)
+      .bindDefault()
+      .bindCgroup()
+      .bindRun()
+      .bindTmp()
+      .forwardDefaultEnv();
+
+    return builder;
+}
+
+// mount sets seen on desktops: fonts, icons and themes from the host, extensions and device
+// nodes, a part of the destinations doesn't exist in the base and has to be fixed
+std::vector<ocppi::runtime::config::types::Mount>
+makeDesktopMounts(const std::filesystem::path &base, const std::filesystem::path &host, int count)
+{
+    std::vector<ocppi::runtime::config::types::Mount> mounts;
+    std::error_code ec;
+    for (int i = 0; i < count; ++i) {
+        std::string destination;
+        switch (i % 5) {
+        case 0:
+            destination = fmt::format("/usr/share/fonts/family{}", i);
+            break;
+        case 1:
+            destination = fmt::format("/usr/share/icons/theme{}", i);
+            break;
+        case 2:
+            destination = fmt::format("/usr/share/themes/theme{}/gtk-3.0", i);
+            break;
+        case 3:
+            destination = fmt::format("/opt/extensions/org.bench.ext{}", i);
+            break;
+        default:
+            destination = fmt::format("/dev/dri/renderD{}", 128 + i);
+            break;
+        }
+
+        // every third destination already exists in the base
+        if (i % 3 == 0) {
+            std::filesystem::create_directories(base / destination.substr(1), ec);
+        }
+
+        auto source = host / fmt::format("source{}", i);
+        std::filesystem::create_directories(source, ec);
+        mounts.push_back(ocppi::runtime::config::types::Mount{
+          .destination = destination,
+          .options = std::vector<std::string>{ "rbind", "ro" },
+          .source = source.string(),
+          .type = "bind" });
+    }
+
+    return mounts;
+}
+
+} // namespace
+
+LL_BENCH(self_adjusting_mount)
+{
+    for (int count : { 64, 256, 1024 }) {
+        auto stage = fmt::format("container_cfg.self_adjusting_mount/mounts={}", count);
+        auto dir = ctx.getWorkDir() / std::to_string(count);
+        auto base = dir / "base";
+        auto bundle = dir / "bundle";
+        std::error_code ec;
+        std::filesystem::create_directories(bundle, ec);
+        if (ec || !makeBaseTree(base)) {
+            ctx.fail(stage, "failed to create fixture");
+            return;
+        }
+        auto mounts = makeDesktopMounts(base, dir / "host", count);
+
+        std::string error;
+        std::size_t generated{ 0 };
+        auto &stats = ctx.measure(stage, [&] {
+            generator::ContainerCfgBuilder builder;
+            builder.setAppId(benchAppId)
+              .setBasePath(base)
+              .setBundlePath(bundle)
+              .disablePatch()
+              .enableSelfAdjustingMount()
+              .bindDefault()
+              .addExtraMounts(mounts);
+            auto res = builder.build();
+            if (!res && error.empty()) {
+                error = res.error().message();
+            }
+            generated = builder.getConfig().mounts ? builder.getConfig().mounts->size() : 0;
+        });
+        if (!error.empty()) {
+            ctx.fail(stage, error);
+            return;
+        }
+        stats.extra["generated_mounts"] = generated;
+    }
+}
+
+LL_BENCH(container_cfg_build)
+{
+    const auto buildStage = std::string{ "container_cfg.build" };
+    const auto patchedStage = fmt::format("container_cfg.build/patches={}", patchCount);
+    const auto roundTripStage = fmt::format("container_cfg.patch/round_trip_each={}", patchCount);
+    const auto serializeStage = std::string{ "container_cfg.serialize" };
+
+    auto base = ctx.getWorkDir() / "base";
+    auto bundle = ctx.getWorkDir() / "bundle";
+    auto emptyPatchDir = ctx.getWorkDir() / "no-patches";
+    auto patchDir = ctx.getWorkDir() / "config.d";
+    std::error_code ec;
+    std::filesystem::create_directories(bundle, ec);
+    if (ec || !makeBaseTree(base) || !makePatches(patchDir)) {
+        ctx.fail(buildStage, "failed to create fixture");
+        return;
+    }
+
+    auto measureBuild = [&](const std::string &stage, const std::filesystem::path &patches) {
+        std::string error;
+        ctx.measure(stage, [&] {
+            auto builder = makeBuilder(base, bundle, patches);
+            auto res = builder.build();
+            if (!res && error.empty()) {
+                error = res.error().message();
+            }
+        });
+        if (!error.empty()) {
+            ctx.fail(stage, error);
+            return false;
+        }
+        return true;
+    };
+
+    if (!measureBuild(buildStage, emptyPatchDir) || !measureBuild(patchedStage, patchDir)) {
+        return;
+    }
+
+    auto builder = makeBuilder(base, bundle, emptyPatchDir);
+    if (auto res = builder.build(); !res) {
+        ctx.fail(serializeStage, res.error().message());
+        return;
+    }
+    const auto &config = builder.getConfig();
+
+    // reference: converting the config back and forth for every patch
+    std::vector<nlohmann::json> patches;
+    for (int i = 0; i < patchCount; ++i) {
+        std::ifstream ifs(patchDir / fmt::format("{:02}-bench.json", i));
+        patches.push_back(nlohmann::json::parse(ifs).at("patch"));
+    }
+    ctx.measure(roundTripStage, [&] {
+        auto patched = config;
+        for (const auto &patch : patches) {
+            patched = nlohmann::json(patched).patch(patch).get<ocppi::runtime::config::types::Config>();
+        }
+    });
+
+    std::size_t bytes{ 0 };
+    auto &stats = ctx.measure(serializeStage, [&] {
+        bytes = nlohmann::json(config).dump().size();
+    });
+    stats.extra["bytes"] = bytes;
+    stats.extra["mounts"] = config.mounts ? config.mounts->size() : 0;
+}
@@ -0,0 +1,222 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "../../common/bench.h"
+#include "linglong/api/types/v1/Generators.hpp"
+#include "linglong/package/elf_handler.h"
+#include "linglong/package/uab_blacklist.h"
+#include "linglong/package/uab_packager.h"
+#include "linglong/utils/staging.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <fstream>
+#include <optional>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace linglong;
+
+namespace {
+
+// bytes which are really fetched from the storage by this process
+std::optional<std::uint64_t> storageReadBytes()
+{
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    std::uint64_t value{ 0 };
+    while (io >> key >> value) {
+        if (key == "read_bytes:") {
+            return value;
+        }
+    }
+
+    return std::nullopt;
+}
+
+} // namespace
+
+// the bundle image is appended to the uab, with the digest and the merkle tree of meta
+LL_BENCH(uab_add_bundle_section)
+{
+    constexpr auto stage = "uab.add_bundle_section";
+    constexpr std::size_t size = 256 * 1024 * 1024;
+
+    if (!storageReadBytes()) {
+        ctx.skip(stage, "/proc/self/io is not available");
+        return;
+    }
+
+    auto bundleFile = ctx.getWorkDir() / "bundle.ef";
+    {
+        std::ofstream bundle(bundleFile, std::ios::binary);
+        std::string block(1024 * 1024, '\0');
+        for (std::size_t i = 0; i < size / block.size(); ++i) {
+            for (std::size_t j = 0; j < block.size(); j += 64) {
+                block[j] = static_cast<char>(i + j);
+            }
+            bundle.write(block.data(), static_cast<std::streamsize>(block.size()));
+        }
+        if (!bundle) {
+            ctx.fail(stage, fmt::format("failed to write {}", bundleFile.string()));
+            return;
+        }
+    }
+
+    auto fd = ::open(bundleFile.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1 || ::fsync(fd) == -1) {
+        ctx.fail(stage, fmt::format("failed to sync {}", bundleFile.string()));
+        return;
+    }
+
+    auto uabFile = ctx.getWorkDir() / "bench.uab";
+    std::uint64_t readBytes{ 0 };
+    std::string error;
+    auto &stats = ctx.measure(stage, [&] {
+        std::error_code ec;
+        std::filesystem::copy_file("/proc/self/exe",
+                                   uabFile,
+                                   std::filesystem::copy_options::overwrite_existing,
+                                   ec);
+        auto uab = package::ElfHandler::create(uabFile);
+        if (ec || !uab) {
+            error = fmt::format("failed to create {}", uabFile.string());
+            return;
+        }
+
+        // start with a cold cache, like an image which is just written by mkfs.erofs
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        auto before = storageReadBytes().value_or(0);
+        api::types::v1::UabMetaInfo meta;
+        auto ret = package::addBundleSection(**uab, bundleFile, "linglong.bundle", meta);
+        if (!ret && error.empty()) {
+            error = ret.error().message();
+        }
+        readBytes += storageReadBytes().value_or(before) - before;
+    });
+    ::close(fd);
+    if (!error.empty()) {
+        ctx.fail(stage, error);
+        return;
+    }
+
+    stats.extra["bytes"] = size;
+    // it's 0 if the work directory isn't backed by a block device, e.g. tmpfs
+    stats.extra["read_bytes_per_packed_byte"] =
+      static_cast<double>(readBytes) / static_cast<double>(size * stats.iterations);
+}
+
+// the layer files are staged into the bundle directory before mkfs.erofs, hardlinks are disabled
+// to measure the clone or copy path
+LL_BENCH(uab_stage_files)
+{
+    constexpr auto serialStage = "uab.stage_files/serial";
+    constexpr auto parallelStage = "uab.stage_files/parallel";
+    constexpr std::size_t files = 1000;
+    constexpr std::size_t fileSize = 32 * 1024;
+
+    auto source = ctx.getWorkDir() / "layer";
+    std::error_code ec;
+    std::filesystem::create_directories(source, ec);
+    if (ec) {
+        ctx.fail(serialStage, ec.message());
+        return;
+    }
+
+    std::string content(fileSize, '\0');
+    for (std::size_t i = 0; i < files; ++i) {
+        content[i % fileSize] = static_cast<char>(i);
+        std::ofstream(source / std::to_string(i), std::ios::binary) << content;
+    }
+
+    for (auto [stage, threads] : { std::pair{ serialStage, 1U }, std::pair{ parallelStage, 0U } }) {
+        std::size_t run{ 0 };
+        std::string error;
+        utils::staging::Summary summary;
+        auto &stats = ctx.measure(stage, [&] {
+            auto destination = ctx.getWorkDir() / fmt::format("{}-{}", threads, run++);
+            std::filesystem::create_directories(destination, ec);
+            std::vector<utils::staging::Task> tasks;
+            tasks.reserve(files);
+            for (std::size_t i = 0; i < files; ++i) {
+                tasks.push_back({ .source = source / std::to_string(i),
+                                  .destination = destination / std::to_string(i) });
+            }
+
+            auto ret =
+              utils::staging::stageFiles(tasks, { .hardlink = false, .threads = threads });
+            if (!ret) {
+                if (error.empty()) {
+                    error = ret.error().message();
+                }
+                return;
+            }
+            summary = *ret;
+        });
+        if (!error.empty()) {
+            ctx.fail(stage, error);
+            return;
+        }
+
+        stats.extra["files"] = files;
+        stats.extra["reflinked"] = summary.reflinked;
+        stats.extra["copied"] = summary.copied;
+        for (std::size_t i = 0; i < run; ++i) {
+            std::filesystem::remove_all(ctx.getWorkDir() / fmt::format("{}-{}", threads, i), ec);
+        }
+    }
+}
+
+// the blacklist is checked for every file of the layers, the linear scan is what it replaced
+LL_BENCH(uab_blacklist_match)
+{
+    constexpr auto linearStage = "uab.blacklist_match/linear";
+    constexpr auto trieStage = "uab.blacklist_match/trie";
+    constexpr std::size_t entries = 300;
+    constexpr std::size_t files = 200000;
+
+    std::vector<std::string> list;
+    package::UABBlacklist blackList;
+    for (std::size_t i = 0; i < entries; ++i) {
+        list.push_back(fmt::format("lib{}.so.{}", i * 7919 % 100000, i % 5));
+        blackList.insert(list.back());
+    }
+
+    std::vector<std::string> fileNames;
+    fileNames.reserve(files);
+    for (std::size_t i = 0; i < files; ++i) {
+        fileNames.push_back(i % 2 == 0 ? fmt::format("lib{}.so.{}.0", i % 100000, i % 5)
+                                       : fmt::format("icon-{}.png", i));
+    }
+
+    std::size_t linearMatched{ 0 };
+    auto &linear = ctx.measure(linearStage, [&] {
+        linearMatched = 0;
+        for (const auto &fileName : fileNames) {
+            linearMatched += std::any_of(list.begin(), list.end(), [&](const std::string &entry) {
+                return entry.rfind(fileName, 0) == 0 || fileName.rfind(entry, 0) == 0;
+            });
+        }
+    });
+    linear.extra["files"] = files;
+    linear.extra["matched"] = linearMatched;
+
+    std::size_t trieMatched{ 0 };
+    auto &trie = ctx.measure(trieStage, [&] {
+        trieMatched = 0;
+        for (const auto &fileName : fileNames) {
+            trieMatched += blackList.matches(fileName);
+        }
+    });
+    trie.extra["files"] = files;
+    trie.extra["matched"] = trieMatched;
+
+    if (trieMatched != linearMatched) {
+        ctx.fail(trieStage,
+                 fmt::format("matched {} files, expected {}", trieMatched, linearMatched));
+    }
+}
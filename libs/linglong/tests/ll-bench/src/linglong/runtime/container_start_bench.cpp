@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "../../common/bench.h"
+#include "../../common/repo_fixture.h"
+#include "configure.h"
+#include "linglong/common/strings.h"
+#include "linglong/oci-cfg-generators/container_cfg_builder.h"
+#include "linglong/runtime/run_context.h"
+#include "linglong/utils/file.h"
+#include "ocppi/cli/crun/Crun.hpp"
+#include "ocppi/runtime/RunOption.hpp"
+#include "ocppi/runtime/config/types/Generators.hpp"
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+#include <cstdlib>
+
+#include <unistd.h>
+
+using namespace linglong;
+
+namespace {
+
+std::optional<std::filesystem::path> findExecutable(const std::string &name)
+{
+    auto executable = [](const std::filesystem::path &path) {
+        return ::access(path.c_str(), X_OK) == 0;
+    };
+
+    if (name.find('/') != std::string::npos) {
+        if (executable(name)) {
+            return name;
+        }
+        return std::nullopt;
+    }
+
+    const auto *pathEnv = ::getenv("PATH");
+    auto dirs = common::strings::split(pathEnv == nullptr ? "" : pathEnv, ':');
+    dirs.emplace_back(BINDIR);
+    for (const auto &dir : dirs) {
+        if (dir.empty()) {
+            continue;
+        }
+
+        auto candidate = std::filesystem::path{ dir } / name;
+        if (executable(candidate)) {
+            return candidate;
+        }
+    }
+
+    return std::nullopt;
+}
+
+} // namespace
+
+// the config generation of `ll-cli run`: a resolved run context is filled into the builder
+LL_BENCH(container_cfg_from_run_context)
+{
+    constexpr auto buildStage = "container_cfg.build/run_context";
+    constexpr auto serializeStage = "container_cfg.serialize/run_context";
+
+    const auto &scale = ctx.getScale();
+    auto fixture = bench::RepoFixture::create(ctx.getWorkDir(),
+                                              { .apps = scale.apps,
+                                                .extensions = scale.extensions });
+    if (!fixture) {
+        ctx.fail(buildStage, fixture.error().message());
+        return;
+    }
+
+    runtime::RunContext context((*fixture)->repo());
+    auto res = context.resolve((*fixture)->apps().back(), runtime::ResolveOptions{});
+    if (!res) {
+        ctx.fail(buildStage, res.error().message());
+        return;
+    }
+
+    auto bundle = ctx.getWorkDir() / "bundle";
+    // host patches are not part of what we measure
+    auto patchDir = ctx.getWorkDir() / "config.d";
+    for (const auto &dir : { bundle, patchDir }) {
+        auto ret = utils::ensureDirectory(dir);
+        if (!ret) {
+            ctx.fail(buildStage, ret.error().message());
+            return;
+        }
+    }
+
+    auto uid = ::getuid();
+    auto gid = ::getgid();
+    std::string error;
+    ocppi::runtime::config::types::Config config;
+    auto &stats = ctx.measure(buildStage, [&] {
+        generator::ContainerCfgBuilder builder;
+        auto res = context.fillContextCfg(builder, bundle);
+        if (res) {
+            builder.setAppId(context.getTargetID())
+              .setBundlePath(bundle)
+              .setPatchDir(patchDir)
+              .addUIdMapping(uid, uid, 1)
+              .addGIdMapping(gid, gid, 1)
+              .bindDefault()
+              .bindCgroup();
+            res = builder.build();
+        }
+        if (!res) {
+            if (error.empty()) {
+                error = res.error().message();
+            }
+            return;
+        }
+        config = builder.getConfig();
+    });
+    if (!error.empty()) {
+        ctx.fail(buildStage, error);
+        return;
+    }
+    stats.extra["mounts"] = config.mounts ? config.mounts->size() : 0;
+
+    std::size_t size{ 0 };
+    auto &serialized = ctx.measure(serializeStage, [&] {
+        size = nlohmann::json(config).dump().size();
+    });
+    serialized.extra["bytes"] = size;
+}
+
+// spawn of the OCI runtime with a container which does nothing, it's the floor of every launch
+LL_BENCH(container_start_noop)
+{
+    constexpr auto stage = "container.start/noop";
+
+    const auto *runtimeEnv = ::getenv("LINGLONG_OCI_RUNTIME");
+    std::string runtimeName =
+      runtimeEnv == nullptr || *runtimeEnv == '\0' ? LINGLONG_DEFAULT_OCI_RUNTIME : runtimeEnv;
+    auto runtimePath = findExecutable(runtimeName);
+    if (!runtimePath) {
+        ctx.skip(stage, fmt::format("{} not found", runtimeName));
+        return;
+    }
+
+    auto trueBin = findExecutable("true");
+    if (!trueBin) {
+        ctx.skip(stage, "true not found");
+        return;
+    }
+
+    auto cli = ocppi::cli::crun::Crun::New(*runtimePath);
+    if (!cli) {
+        ctx.fail(stage, fmt::format("failed to create oci runtime {}", runtimePath->string()));
+        return;
+    }
+
+    auto bundle = ctx.getWorkDir() / "bundle";
+    auto patchDir = ctx.getWorkDir() / "config.d";
+    for (const auto &dir : { bundle, patchDir }) {
+        auto ret = utils::ensureDirectory(dir);
+        if (!ret) {
+            ctx.fail(stage, ret.error().message());
+            return;
+        }
+    }
+
+    // the host root is used as the base, so that the process can be executed
+    auto uid = ::getuid();
+    auto gid = ::getgid();
+    generator::ContainerCfgBuilder builder;
+    builder.setAppId("org.linglong.bench.noop")
+      .setBasePath("/")
+      .setBundlePath(bundle)
+      .setPatchDir(patchDir)
+      .addUIdMapping(uid, uid, 1)
+      .addGIdMapping(gid, gid, 1)
+      .bindDefault();
+    auto res = builder.build();
+    if (!res) {
+        ctx.fail(stage, res.error().message());
+        return;
+    }
+
+    auto config = builder.getConfig();
+    auto process = config.process.value_or(ocppi::runtime::config::types::Process{});
+    process.args = std::vector<std::string>{ trueBin->string() };
+    process.cwd = "/";
+    process.terminal = false;
+    process.user = ocppi::runtime::config::types::User{ .gid = gid, .uid = uid };
+    config.process = std::move(process);
+    auto ret = utils::writeFile(bundle / "config.json", nlohmann::json(config).dump());
+    if (!ret) {
+        ctx.fail(stage, ret.error().message());
+        return;
+    }
+
+    std::size_t run{ 0 };
+    std::string error;
+    ctx.measure(stage, [&] {
+        ocppi::runtime::RunOption opt{};
+        opt.GlobalOption::extra.emplace_back("--cgroup-manager=disabled");
+        auto result =
+          (*cli)->run(fmt::format("ll-bench-noop-{}-{}", ::getpid(), run++), bundle, opt);
+        if (!result && error.empty()) {
+            try {
+                std::rethrow_exception(result.error());
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+        }
+    });
+    if (!error.empty()) {
+        ctx.fail(stage, error);
+    }
+}
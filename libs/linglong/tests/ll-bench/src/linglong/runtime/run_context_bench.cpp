@@ -0,0 +1,61 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "../../common/bench.h"
+#include "../../common/repo_fixture.h"
+#include "linglong/runtime/run_context.h"
+#include "linglong/runtime/run_context_cache.h"
+
+#include <fmt/format.h>
+
+using namespace linglong;
+
+LL_BENCH(run_context_resolve)
+{
+    constexpr auto coldStage = "run_context.resolve/cold";
+    constexpr auto cachedStage = "run_context.resolve/cached";
+
+    auto fixture = bench::RepoFixture::create(ctx.getWorkDir(),
+                                              { .apps = ctx.getScale().apps,
+                                                .extensions = ctx.getScale().extensions });
+    if (!fixture) {
+        ctx.fail(coldStage, fixture.error().message());
+        return;
+    }
+
+    auto &repo = (*fixture)->repo();
+    // resolve the last one, so that a lookup can't stop at the first app of the repo
+    const auto app = (*fixture)->apps().back();
+
+    std::string error;
+    ctx.measure(coldStage, [&] {
+        runtime::RunContext context(repo);
+        auto res = context.resolve(app, runtime::ResolveOptions{});
+        if (!res && error.empty()) {
+            error = res.error().message();
+        }
+    });
+    if (!error.empty()) {
+        ctx.fail(coldStage, error);
+        return;
+    }
+
+    runtime::RunContextCache cache(ctx.getWorkDir() / "run-context");
+    // prime the cache, the first launch after an upgrade always pays the cold cost
+    auto primed = runtime::resolveRunContext(repo, app, runtime::ResolveOptions{}, &cache);
+    if (!primed) {
+        ctx.fail(cachedStage, primed.error().message());
+        return;
+    }
+
+    ctx.measure(cachedStage, [&] {
+        auto res = runtime::resolveRunContext(repo, app, runtime::ResolveOptions{}, &cache);
+        if (!res && error.empty()) {
+            error = res.error().message();
+        }
+    });
+    if (!error.empty()) {
+        ctx.fail(cachedStage, error);
+    }
+}
@@ -0,0 +1,147 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "../../common/bench.h"
+#include "linglong/utils/file.h"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <fstream>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace linglong;
+
+namespace {
+
+const char *methodName(utils::CopyMethod method)
+{
+    switch (method) {
+    case utils::CopyMethod::Reflink:
+        return "reflink";
+    case utils::CopyMethod::CopyFileRange:
+        return "copy_file_range";
+    case utils::CopyMethod::Sendfile:
+        return "sendfile";
+    case utils::CopyMethod::Buffer:
+        return "buffer";
+    }
+
+    return "unknown";
+}
+
+// how the layer and bundle files were copied before copyRange
+bool copyBy4KBuffer(int in, off_t offset, int out, std::uint64_t length)
+{
+    std::array<char, 4096> buf{};
+    while (length > 0) {
+        auto len = ::pread(in, buf.data(), std::min<std::uint64_t>(length, buf.size()), offset);
+        if (len <= 0 || ::write(out, buf.data(), len) != len) {
+            return false;
+        }
+        offset += len;
+        length -= len;
+    }
+
+    return true;
+}
+
+} // namespace
+
+// the bundle section of an UAB or the image of a layer is copied out of the file, the offset of
+// the image in a layer file is not aligned
+LL_BENCH(file_copy_range)
+{
+    constexpr std::size_t size = 256 * 1024 * 1024;
+    constexpr off_t unaligned = 4099;
+
+    auto source = ctx.getWorkDir() / "source";
+    {
+        std::ofstream file(source, std::ios::binary);
+        std::string block(1024 * 1024, '\0');
+        for (std::size_t i = 0; i < size / block.size(); ++i) {
+            for (std::size_t j = 0; j < block.size(); j += 64) {
+                block[j] = static_cast<char>(i + j);
+            }
+            file.write(block.data(), static_cast<std::streamsize>(block.size()));
+        }
+        if (!file) {
+            ctx.fail("copy_range", fmt::format("failed to write {}", source.string()));
+            return;
+        }
+    }
+
+    auto in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in == -1) {
+        ctx.fail("copy_range", fmt::format("failed to open {}", source.string()));
+        return;
+    }
+
+    struct Case
+    {
+        std::string stage;
+        std::filesystem::path target;
+        off_t offset;
+        bool baseline;
+    };
+
+    std::vector<Case> cases{
+        { "copy_range/4k_buffer", ctx.getWorkDir() / "target", unaligned, true },
+        { "copy_range/same_fs", ctx.getWorkDir() / "target", 0, false },
+        { "copy_range/same_fs_unaligned", ctx.getWorkDir() / "target", unaligned, false },
+    };
+
+    // a file system other than the work directory, e.g. extracting to /tmp on tmpfs
+    struct stat workStat{};
+    struct stat shmStat{};
+    if (::stat(ctx.getWorkDir().c_str(), &workStat) == 0 && ::stat("/dev/shm", &shmStat) == 0
+        && workStat.st_dev != shmStat.st_dev && ::access("/dev/shm", W_OK) == 0) {
+        cases.push_back({ "copy_range/cross_fs",
+                          fmt::format("/dev/shm/ll-bench-copy-range-{}", ::getpid()),
+                          unaligned,
+                          false });
+    } else {
+        ctx.skip("copy_range/cross_fs", "no other writable file system");
+    }
+
+    for (const auto &item : cases) {
+        const auto length = size - item.offset;
+        std::string error;
+        auto method = utils::CopyMethod::Buffer;
+        auto &stats = ctx.measure(item.stage, [&] {
+            auto out = ::open(item.target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (out == -1) {
+                error = fmt::format("failed to open {}", item.target.string());
+                return;
+            }
+
+            if (item.baseline) {
+                if (!copyBy4KBuffer(in, item.offset, out, length)) {
+                    error = "failed to copy";
+                }
+            } else if (auto ret = utils::copyRange(in, item.offset, out, 0, length); ret) {
+                method = *ret;
+            } else if (error.empty()) {
+                error = ret.error().message();
+            }
+            ::close(out);
+        });
+        std::filesystem::remove(item.target);
+        if (!error.empty()) {
+            ctx.fail(item.stage, error);
+            continue;
+        }
+
+        stats.extra["bytes"] = length;
+        // bytes per microsecond is MB/s
+        stats.extra["GB/s"] = stats.p50 > 0 ? static_cast<double>(length) / stats.p50 / 1000 : 0;
+        stats.extra["method"] = item.baseline ? "4k_buffer" : methodName(method);
+    }
+
+    ::close(in);
+}
@@ -0,0 +1,42 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "../../common/bench.h"
+#include "linglong/utils/sha256.h"
+
+#include <fmt/format.h>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// throughput of every backend which is supported by current CPU
+LL_BENCH(sha256)
+{
+    // large enough to stream from memory rather than cache, like the bundle of an UAB
+    constexpr std::size_t size = 256 * 1024 * 1024;
+    std::vector<std::byte> data(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<std::byte>(i * 31 + (i >> 12));
+    }
+
+    for (auto backend : { digest::Backend::Scalar, digest::Backend::SHANI, digest::Backend::ARMv8 }) {
+        auto stage = fmt::format("sha256/{}", digest::backend_name(backend));
+        if (!digest::backend_supported(backend)) {
+            ctx.skip(stage, "not supported by current CPU");
+            continue;
+        }
+
+        std::array<std::byte, 32> digest{};
+        auto &stats = ctx.measure(stage, [&] {
+            digest::SHA256 sha256(backend);
+            sha256.update(data.data(), data.size());
+            sha256.final(digest.data());
+        });
+        // bytes per microsecond is MB/s
+        stats.extra["bytes"] = size;
+        stats.extra["GB/s"] = stats.p50 > 0 ? static_cast<double>(size) / stats.p50 / 1000 : 0;
+        stats.extra["default"] = backend == digest::default_backend();
+    }
+}
@@ -0,0 +1,107 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "common/bench.h"
+#include "configure.h"
+#include "linglong/common/global/initialize.h"
+
+#include <CLI/CLI.hpp>
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <unistd.h>
+
+namespace {
+
+std::filesystem::path makeWorkDir(const std::filesystem::path &parent, const std::string &name)
+{
+    auto pattern = (parent / ("ll-bench-" + name + "-XXXXXX")).string();
+    if (::mkdtemp(pattern.data()) == nullptr) {
+        return {};
+    }
+
+    return pattern;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    linglong::common::global::initLinyapsLogSystem(linglong::utils::log::LogBackend::Console);
+
+    std::size_t iterations{ 50 };
+    std::string filter;
+    std::string output;
+    std::string workDir = std::filesystem::temp_directory_path().string();
+    bool keepWorkDir{ false };
+    linglong::bench::Scale scale{ .apps = 16, .extensions = 4 };
+
+    CLI::App app{ "linyaps launch path benchmarks" };
+    app.add_option("-n,--iterations", iterations, "Iterations of each measured stage")
+      ->check(CLI::PositiveNumber);
+    app.add_option("-f,--filter", filter, "Only run benchmarks whose name contains FILTER");
+    app.add_option("-o,--output", output, "Write the JSON report to FILE instead of stdout");
+    app.add_option("--work-dir", workDir, "Directory to create temporary fixtures in");
+    app.add_flag("--keep", keepWorkDir, "Keep the fixtures after running");
+    app.add_option("--apps", scale.apps, "Apps in the synthetic repo")
+      ->check(CLI::PositiveNumber);
+    app.add_option("--extensions", scale.extensions, "Extensions in the synthetic repo");
+    CLI11_PARSE(app, argc, argv);
+
+    nlohmann::json benchmarks = nlohmann::json::array();
+    bool failed{ false };
+    for (const auto &benchmark : linglong::bench::registry()) {
+        if (!filter.empty() && benchmark.name.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        auto dir = makeWorkDir(workDir, benchmark.name);
+        if (dir.empty()) {
+            std::cerr << fmt::format("failed to create work directory in {}: {}",
+                                     workDir,
+                                     ::strerror(errno))
+                      << std::endl;
+            return -1;
+        }
+
+        linglong::bench::Context ctx(iterations, dir, scale);
+        benchmark.func(ctx);
+
+        auto result = ctx.report();
+        result["name"] = benchmark.name;
+        benchmarks.push_back(std::move(result));
+        failed = failed || ctx.failed();
+
+        if (!keepWorkDir) {
+            std::error_code ec;
+            std::filesystem::remove_all(dir, ec);
+        }
+    }
+
+    nlohmann::json report{
+        { "version", LINGLONG_VERSION },
+        { "iterations", iterations },
+        { "apps", scale.apps },
+        { "extensions", scale.extensions },
+        { "benchmarks", std::move(benchmarks) },
+    };
+
+    if (output.empty()) {
+        std::cout << report.dump(2) << std::endl;
+    } else {
+        std::ofstream ofs(output);
+        ofs << report.dump(2) << std::endl;
+        if (!ofs) {
+            std::cerr << "failed to write " << output << std::endl;
+            return -1;
+        }
+    }
+
+    return failed ? 1 : 0;
+}
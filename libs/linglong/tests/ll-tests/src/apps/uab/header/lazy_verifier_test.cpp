@@ -0,0 +1,170 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "common/tempdir.h"
+#include "lazy_verifier.h"
+#include "linglong/utils/merkle.h"
+#include "linglong/utils/sha256.h"
+
+#include <array>
+#include <cerrno>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t leafSize = 1U << 20;
+constexpr std::size_t prefixSize = 4096;
+
+// reads of the bundle by the verifier, every leaf is read once when it's hashed
+std::size_t bundleReads{ 0 }; // NOLINT
+
+ssize_t countedRead(int fd, void *buf, std::size_t count, off64_t offset)
+{
+    ++bundleReads;
+    return ::pread64(fd, buf, count, offset);
+}
+
+std::string sha256(const std::string &data)
+{
+    digest::SHA256 sha256;
+    sha256.update(reinterpret_cast<const std::byte *>(data.data()), data.size());
+    std::array<std::byte, 32> result{};
+    sha256.final(result.data());
+    return digest::to_hex(result);
+}
+
+// an UAB whose bundle of three leaves follows the ELF part, the second leaf is tampered after the
+// merkle tree is made
+class LazyVerifierTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(dir.isValid());
+        bundleReads = 0;
+
+        auto path = dir.path() / "app.uab";
+        bundle = std::string(leafSize, 'a') + std::string(leafSize, 'b')
+          + std::string(leafSize / 2, 'c');
+        std::vector<std::string> leaves;
+        for (std::size_t begin = 0; begin < bundle.size(); begin += leafSize) {
+            leaves.push_back(sha256(bundle.substr(begin, leafSize)));
+        }
+
+        bundle[leafSize + 10] = 'x';
+        std::ofstream{ path, std::ios::binary } << std::string(prefixSize, 'e') << bundle;
+
+        fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        ASSERT_NE(fd, -1);
+        struct stat st{};
+        ASSERT_EQ(::fstat(fd, &st), 0);
+        verifier.prepare(st, prefixSize, bundle.size(), leafSize, std::move(leaves));
+        verifier.active.store(true);
+    }
+
+    void TearDown() override
+    {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+
+    // read the bundle like erofsfuse does
+    ssize_t read(std::uint64_t offset, std::string &out, std::size_t count)
+    {
+        out.assign(count, '\0');
+        return verifier.pread(fd,
+                              out.data(),
+                              count,
+                              static_cast<off64_t>(prefixSize + offset),
+                              ::pread64);
+    }
+
+    TempDir dir{ "linglong-uab-lazy-verifier-test-" };
+    uab::LazyVerifier verifier{ countedRead };
+    std::string bundle;
+    int fd{ -1 };
+};
+
+TEST_F(LazyVerifierTest, TamperedLeafFailsWithEIO)
+{
+    std::string out;
+    errno = 0;
+    EXPECT_EQ(read(leafSize + 100, out, 100), -1);
+    EXPECT_EQ(errno, EIO);
+
+    // a read which crosses into the tampered leaf fails too
+    errno = 0;
+    EXPECT_EQ(read(leafSize - 10, out, 20), -1);
+    EXPECT_EQ(errno, EIO);
+}
+
+TEST_F(LazyVerifierTest, UntamperedRangesAreRead)
+{
+    std::string out;
+    ASSERT_EQ(read(10, out, 100), 100);
+    EXPECT_EQ(out, bundle.substr(10, 100));
+
+    // the last leaf is shorter than the others
+    ASSERT_EQ(read(2 * leafSize + 10, out, 100), 100);
+    EXPECT_EQ(out, bundle.substr(2 * leafSize + 10, 100));
+
+    // the ELF part before the bundle isn't verified
+    out.assign(10, '\0');
+    ASSERT_EQ(verifier.pread(fd, out.data(), out.size(), 0, ::pread64), 10);
+    EXPECT_EQ(out, std::string(10, 'e'));
+    EXPECT_EQ(bundleReads, 2);
+}
+
+TEST_F(LazyVerifierTest, VerifiedLeafIsNotHashedAgain)
+{
+    std::string out;
+    ASSERT_EQ(read(0, out, 100), 100);
+    EXPECT_EQ(bundleReads, 1);
+    ASSERT_EQ(read(leafSize - 100, out, 100), 100);
+    EXPECT_EQ(bundleReads, 1);
+
+    // nor a mismatched one
+    EXPECT_EQ(read(leafSize, out, 100), -1);
+    EXPECT_EQ(bundleReads, 2);
+    EXPECT_EQ(read(leafSize + 100, out, 100), -1);
+    EXPECT_EQ(bundleReads, 2);
+}
+
+TEST_F(LazyVerifierTest, OtherFilesAreNotVerified)
+{
+    auto other = dir.path() / "other";
+    std::ofstream{ other } << std::string(prefixSize + leafSize + 100, 'o');
+    auto otherFd = ::open(other.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_NE(otherFd, -1);
+
+    std::string out(10, '\0');
+    EXPECT_EQ(verifier.pread(otherFd,
+                             out.data(),
+                             out.size(),
+                             static_cast<off64_t>(prefixSize + leafSize),
+                             ::pread64),
+              10);
+    EXPECT_EQ(bundleReads, 0);
+    ::close(otherFd);
+}
+
+TEST_F(LazyVerifierTest, InactiveOutsideOfErofsfuse)
+{
+    verifier.active.store(false);
+    std::string out;
+    EXPECT_EQ(read(leafSize + 100, out, 100), 100);
+    EXPECT_EQ(bundleReads, 0);
+}
+
+} // namespace
@@ -0,0 +1,88 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "common/tempdir.h"
+#include "shared_mount.h"
+
+#include <filesystem>
+
+namespace {
+
+// a launch of a bundle which is shared by a mount, mounting fails if the bundle is corrupted
+class SharedMountTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(dir.isValid());
+        lock = dir.path() / "digest.lock";
+        ref = dir.path() / "digest.ref";
+    }
+
+    int launch(int &refFd, bool corrupted)
+    {
+        int lockFd{ -1 };
+        return uab::acquireSharedMount(
+          lock,
+          ref,
+          lockFd,
+          refFd,
+          [this] {
+              return mounted;
+          },
+          [this, corrupted] {
+              ++mounts;
+              if (corrupted) {
+                  return 1;
+              }
+
+              mounted = true;
+              return 0;
+          });
+    }
+
+    TempDir dir{ "linglong-uab-shared-mount-test-" };
+    std::filesystem::path lock;
+    std::filesystem::path ref;
+    bool mounted{ false };
+    int mounts{ 0 };
+};
+
+TEST_F(SharedMountTest, MountIsReused)
+{
+    int first{ -1 };
+    ASSERT_EQ(launch(first, false), 0);
+    ASSERT_NE(first, -1);
+
+    int second{ -1 };
+    ASSERT_EQ(launch(second, false), 0);
+    EXPECT_NE(second, -1);
+    EXPECT_EQ(mounts, 1);
+
+    ::close(first);
+    ::close(second);
+}
+
+TEST_F(SharedMountTest, CorruptedBundleFailsOnSecondLaunch)
+{
+    // the first launch is verified in the background, it fails after the bundle is mounted
+    int first{ -1 };
+    ASSERT_EQ(launch(first, false), 0);
+    ASSERT_TRUE(uab::invalidateSharedMount(lock, [this] {
+        mounted = false;
+        return true;
+    }));
+
+    // the second launch mustn't reuse the mount, it's mounted and verified again
+    int second{ -1 };
+    EXPECT_NE(launch(second, true), 0);
+    EXPECT_EQ(second, -1);
+    EXPECT_EQ(mounts, 2);
+
+    ::close(first);
+}
+
+} // namespace
@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include <sys/stat.h>
+
+// Write an uncompressed erofs image by hand, whose entry /files/up links back to the root:
+//   /info.json
+//   /files/up -> /
+// mkfs.erofs never makes such an image, readers must refuse it rather than walk it forever.
+inline bool writeLoopedErofsImage(const std::filesystem::path &path, const std::string &info)
+{
+    constexpr std::size_t blockSize = 4096;
+    constexpr std::size_t metaBlock = 1;
+    constexpr std::uint16_t flatInline = 2;
+    constexpr std::uint8_t typeFile = 1;
+    constexpr std::uint8_t typeDir = 2;
+
+    std::string image(2 * blockSize, '\0');
+    auto put = [&image](std::size_t pos, auto value) {
+        std::memcpy(image.data() + pos, &value, sizeof(value));
+    };
+
+    // compact inodes of 32 bytes, the content is inlined after the inode
+    auto writeInode = [&](std::uint64_t nid, std::uint16_t mode, const std::string &content) {
+        auto pos = metaBlock * blockSize + nid * 32;
+        put(pos, static_cast<std::uint16_t>(flatInline << 1));
+        put(pos + 4, mode);
+        put(pos + 6, static_cast<std::uint16_t>(1));
+        put(pos + 8, static_cast<std::uint32_t>(content.size()));
+        image.replace(pos + 32, content.size(), content);
+    };
+
+    // entries are sorted by their names, the names follow the array of erofs_dirent
+    using Entry = std::tuple<std::string, std::uint64_t, std::uint8_t>;
+    auto dir = [](const std::vector<Entry> &entries) {
+        std::string dirents;
+        std::string names;
+        for (const auto &[name, nid, type] : entries) {
+            auto nameOffset = static_cast<std::uint16_t>(entries.size() * 12 + names.size());
+            dirents.append(reinterpret_cast<const char *>(&nid), sizeof(nid));
+            dirents.append(reinterpret_cast<const char *>(&nameOffset), sizeof(nameOffset));
+            dirents.push_back(static_cast<char>(type));
+            dirents.push_back('\0');
+            names += name;
+        }
+        return dirents + names;
+    };
+
+    constexpr std::uint64_t rootNid = 0;
+    constexpr std::uint64_t filesNid = 4;
+    constexpr std::uint64_t infoNid = 7;
+    if (metaBlock * blockSize + infoNid * 32 + 32 + info.size() > image.size()) {
+        return false;
+    }
+
+    writeInode(rootNid,
+               S_IFDIR | 0755,
+               dir({ { ".", rootNid, typeDir },
+                     { "..", rootNid, typeDir },
+                     { "files", filesNid, typeDir },
+                     { "info.json", infoNid, typeFile } }));
+    writeInode(filesNid,
+               S_IFDIR | 0755,
+               dir({ { ".", filesNid, typeDir },
+                     { "..", rootNid, typeDir },
+                     { "up", rootNid, typeDir } }));
+    writeInode(infoNid, S_IFREG | 0644, info);
+
+    constexpr std::size_t superBlock = 1024;
+    put(superBlock, static_cast<std::uint32_t>(0xE0F5E1E2));
+    image[superBlock + 12] = 12; // block size bits
+    put(superBlock + 14, static_cast<std::uint16_t>(rootNid));
+    put(superBlock + 36, static_cast<std::uint32_t>(image.size() / blockSize));
+    put(superBlock + 40, static_cast<std::uint32_t>(metaBlock));
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << image;
+    return static_cast<bool>(out.flush());
+}
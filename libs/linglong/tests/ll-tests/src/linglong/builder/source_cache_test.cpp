@@ -0,0 +1,216 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "common/tempdir.h"
+#include "linglong/builder/source_cache.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <string>
+
+using namespace linglong;
+using namespace linglong::builder;
+
+namespace {
+
+// sha256 of "hello"
+constexpr auto helloDigest = "2cf24dba5fb0a30e26e83b2ac5b9e29e1b161e5c1fa7425e73043362938b9824";
+
+class SourceCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override { ASSERT_TRUE(this->dir.isValid()); }
+
+    // create an archive entry, which is used at the time
+    std::filesystem::path archive(const std::string &name,
+                                  const std::string &content,
+                                  std::filesystem::file_time_type time)
+    {
+        auto entry = this->cache.open(name);
+        EXPECT_TRUE(entry) << entry.error().message();
+        if (!entry) {
+            return {};
+        }
+
+        std::filesystem::create_directories(entry->path() / "src");
+        std::ofstream{ entry->path() / "src" / "main.c" } << content;
+        EXPECT_TRUE(entry->commit());
+        std::filesystem::last_write_time(entry->path().string() + ".digest", time);
+        return entry->path();
+    }
+
+    TempDir dir{ "linglong-source-cache-test-" };
+    SourceCache cache{ dir.path() / "cache" };
+};
+
+TEST(SourceCacheEntryNameTest, Keys)
+{
+    api::types::v1::BuilderProjectSource source;
+    source.kind = "archive";
+    source.url = "https://example.com/src.tar.gz";
+    source.digest = helloDigest;
+    EXPECT_EQ(SourceCache::entryName(source), std::string{ "archive_" } + helloDigest);
+
+    source.kind = "file";
+    EXPECT_EQ(SourceCache::entryName(source), std::string{ "file_" } + helloDigest);
+
+    // the digest is a part of path, it must be a sha256
+    source.digest = "../../etc";
+    EXPECT_FALSE(SourceCache::entryName(source));
+
+    source.kind = "git";
+    source.url = "https://example.com/repo.git";
+    source.commit = "0e6b48b4522855f1a52629877246ca64f61a4ba1";
+    EXPECT_EQ(SourceCache::entryName(source),
+              "git_3f71ca0a9a455fa908a2efa64f43dd6bf7ed6d77de8d06bdcdef5aeaf099bf80_"
+              "0e6b48b4522855f1a52629877246ca64f61a4ba1");
+    source.submodules = false;
+    EXPECT_EQ(SourceCache::entryName(source),
+              "git_3f71ca0a9a455fa908a2efa64f43dd6bf7ed6d77de8d06bdcdef5aeaf099bf80_"
+              "0e6b48b4522855f1a52629877246ca64f61a4ba1_nosubmodules");
+
+    // branches may be moved
+    source.commit = "master";
+    EXPECT_FALSE(SourceCache::entryName(source));
+}
+
+TEST_F(SourceCacheTest, ReuseEntry)
+{
+    auto path = this->archive("archive_0001",
+                              "int main() {}",
+                              std::filesystem::file_time_type::clock::now()
+                                - std::chrono::hours(1));
+    ASSERT_FALSE(path.empty());
+    EXPECT_TRUE(std::filesystem::exists(path.string() + ".digest"));
+
+    auto before = std::filesystem::last_write_time(path.string() + ".digest");
+    auto entry = this->cache.open("archive_0001");
+    ASSERT_TRUE(entry) << entry.error().message();
+    EXPECT_TRUE(std::filesystem::exists(entry->path() / "src" / "main.c"));
+
+    // reusing the entry updates its last use
+    ASSERT_TRUE(entry->commit());
+    EXPECT_GT(std::filesystem::last_write_time(path.string() + ".digest"), before);
+}
+
+TEST_F(SourceCacheTest, CorruptedEntryIsRemoved)
+{
+    auto path = this->archive("archive_0001",
+                              "int main() {}",
+                              std::filesystem::file_time_type::clock::now());
+    ASSERT_FALSE(path.empty());
+    // e.g. the build changed the tree through a hardlink
+    std::ofstream{ path / "src" / "main.c", std::ios::app } << "// patched";
+
+    auto entry = this->cache.open("archive_0001");
+    ASSERT_TRUE(entry) << entry.error().message();
+    EXPECT_FALSE(std::filesystem::exists(path));
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".digest"));
+}
+
+TEST_F(SourceCacheTest, FileIsCheckedByItsName)
+{
+    std::filesystem::create_directories(this->cache.directory());
+    auto good = this->cache.directory() / (std::string{ "file_" } + helloDigest);
+    std::ofstream{ good } << "hello";
+    auto bad = this->cache.directory() / ("file_" + std::string(64, '0'));
+    std::ofstream{ bad } << "hello";
+
+    ASSERT_TRUE(this->cache.open(good.filename()));
+    EXPECT_TRUE(std::filesystem::exists(good));
+    ASSERT_TRUE(this->cache.open(bad.filename()));
+    EXPECT_FALSE(std::filesystem::exists(bad));
+}
+
+TEST_F(SourceCacheTest, UnrecordedTreeIsRemoved)
+{
+    // e.g. the build was interrupted before the entry was recorded
+    auto path = this->cache.directory() / "archive_0001";
+    std::filesystem::create_directories(path / "src");
+    std::ofstream{ path / "src" / "main.c" } << "int main() {}";
+
+    auto entry = this->cache.open("archive_0001");
+    ASSERT_TRUE(entry) << entry.error().message();
+    EXPECT_FALSE(std::filesystem::exists(path));
+
+    // nothing is recorded unless it's fetched again
+    ASSERT_TRUE(entry->commit());
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".digest"));
+}
+
+TEST_F(SourceCacheTest, StaleTemporariesAreRemoved)
+{
+    auto used = std::string(64, '1');
+    auto entry = this->cache.open("archive_" + used);
+    ASSERT_TRUE(entry) << entry.error().message();
+
+    auto content = std::string(1U << 10, 'a'); // NOLINT
+    auto fetching = this->cache.directory() / ("tmp_" + used);
+    auto stale = this->cache.directory() / ("tmp_" + std::string(64, '2'));
+    auto checkout = this->cache.directory() / "git_0001.tmp";
+    auto record = this->cache.directory() / "archive_0001.digest.tmp";
+    for (const auto &dir : { fetching, stale, checkout }) {
+        std::filesystem::create_directories(dir / "src");
+        std::ofstream{ dir / "src" / "main.c" } << content;
+    }
+    std::ofstream{ record } << helloDigest;
+
+    auto freed = this->cache.evict(std::numeric_limits<std::uint64_t>::max());
+    ASSERT_TRUE(freed) << freed.error().message();
+    EXPECT_GE(*freed, 2 * content.size());
+    EXPECT_TRUE(std::filesystem::exists(fetching));
+    EXPECT_FALSE(std::filesystem::exists(stale));
+    EXPECT_FALSE(std::filesystem::exists(checkout));
+    EXPECT_FALSE(std::filesystem::exists(record));
+}
+
+TEST_F(SourceCacheTest, EvictLeastRecentlyUsed)
+{
+    auto now = std::filesystem::file_time_type::clock::now();
+    // directories take some space too
+    auto content = std::string(1U << 20, 'a'); // NOLINT
+    auto oldest = this->archive("archive_0001", content, now - std::chrono::hours(3));
+    auto older = this->archive("archive_0002", content, now - std::chrono::hours(2));
+    auto newest = this->archive("archive_0003", content, now - std::chrono::hours(1));
+
+    auto freed = this->cache.evict(5U << 19); // NOLINT
+    ASSERT_TRUE(freed) << freed.error().message();
+    EXPECT_GE(*freed, 1U << 20);
+    EXPECT_FALSE(std::filesystem::exists(oldest));
+    EXPECT_TRUE(std::filesystem::exists(older));
+    EXPECT_TRUE(std::filesystem::exists(newest));
+}
+
+TEST_F(SourceCacheTest, EntriesInUseAreKept)
+{
+    auto now = std::filesystem::file_time_type::clock::now();
+    auto used = this->archive("archive_0001", "used", now - std::chrono::hours(2));
+    auto unused = this->archive("archive_0002", "unused", now - std::chrono::hours(1));
+
+    auto entry = this->cache.open("archive_0001");
+    ASSERT_TRUE(entry) << entry.error().message();
+    ASSERT_TRUE(this->cache.evict(0));
+    EXPECT_TRUE(std::filesystem::exists(used));
+    EXPECT_FALSE(std::filesystem::exists(unused));
+}
+
+TEST(SourceCacheSizeTest, Parse)
+{
+    EXPECT_EQ(parseCacheSize("1024"), 1024);
+    EXPECT_EQ(parseCacheSize("512M"), 512ULL << 20);
+    EXPECT_EQ(parseCacheSize("10g"), 10ULL << 30);
+    EXPECT_EQ(parseCacheSize("1T"), 1ULL << 40);
+    EXPECT_FALSE(parseCacheSize(""));
+    EXPECT_FALSE(parseCacheSize("G"));
+    EXPECT_FALSE(parseCacheSize("10GB"));
+    EXPECT_FALSE(parseCacheSize("-1"));
+    EXPECT_FALSE(parseCacheSize("99999999999999999999"));
+    EXPECT_FALSE(parseCacheSize("16777216T"));
+}
+
+} // namespace
@@ -8,6 +8,11 @@
 #include "linglong/utils/error/error.h"
 
 #include <QDir>
+#include <QTemporaryDir>
+
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 using namespace linglong;
 
@@ -249,4 +254,135 @@ TEST_F(SourceFetcherTest, FetchNoSetName)
     EXPECT_TRUE(ret.has_value());
 }
 
+// 记录并发获取的过程
+struct FetchRecord
+{
+    std::mutex mutex;
+    int running{ 0 };
+    int maxRunning{ 0 };
+    std::vector<std::string> events;
+};
+
+class FakeCommand : public linglong::utils::Cmd
+{
+public:
+    FakeCommand(FetchRecord &record, std::string name, int duration, int errorCode = 0)
+        : Cmd("fake")
+        , record(record)
+        , name(std::move(name))
+        , duration(duration)
+        , errorCode(errorCode)
+    {
+    }
+
+    utils::error::Result<std::string> exec(const std::vector<std::string> &) noexcept override
+    {
+        LINGLONG_TRACE("fake fetch " + name);
+        {
+            std::lock_guard lock(record.mutex);
+            record.maxRunning = std::max(record.maxRunning, ++record.running);
+            record.events.push_back("start " + name);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(duration));
+        {
+            std::lock_guard lock(record.mutex);
+            --record.running;
+            record.events.push_back("finish " + name);
+        }
+        if (errorCode != 0) {
+            return LINGLONG_ERR("failed", errorCode);
+        }
+        return "ok";
+    }
+
+    Cmd &setEnv(const std::string &, const std::string &) noexcept override { return *this; }
+
+private:
+    FetchRecord &record;
+    std::string name;
+    int duration;
+    int errorCode;
+};
+
+class FetchSourcesTest : public ::testing::Test
+{
+protected:
+    void add(const std::string &name,
+             const std::string &digest,
+             int duration,
+             int errorCode = 0)
+    {
+        api::types::v1::BuilderProjectSource source;
+        source.kind = "file";
+        source.url = "file:///sources/" + name;
+        source.digest = digest;
+        source.name = name;
+
+        auto &fetcher = fetchers.emplace_back(source, QDir(cacheDir.path()));
+        fetcher.setCommand(std::make_shared<FakeCommand>(record, name, duration, errorCode));
+    }
+
+    QTemporaryDir cacheDir;
+    QTemporaryDir destination;
+    FetchRecord record;
+    std::vector<SourceFetcher> fetchers;
+};
+
+// 测试并发获取源码
+// 场景：6个互不相关的源码，最多同时获取3个
+// 预期：同时获取的源码数不超过3个，所有源码都被获取
+TEST_F(FetchSourcesTest, Concurrently)
+{
+    for (int i = 0; i < 6; ++i) {
+        add("source" + std::to_string(i), "digest" + std::to_string(i), 50);
+    }
+
+    auto ret = fetchSources(fetchers, QDir(destination.path()), 3);
+    ASSERT_TRUE(ret.has_value()) << ret.error().message();
+    EXPECT_EQ(record.maxRunning, 3);
+    EXPECT_EQ(record.events.size(), 12);
+}
+
+// 测试写入相同位置的源码
+// 场景：两个源码的digest相同，会写入同一个缓存文件；两个源码的名称相同，会写入同一个目录
+// 预期：它们按顺序获取，不会同时获取
+TEST_F(FetchSourcesTest, SameOutputsInOrder)
+{
+    add("a", "same", 50);
+    add("b", "same", 10);
+    add("c", "other", 50);
+    add("c", "another", 10);
+
+    auto ret = fetchSources(fetchers, QDir(destination.path()), 4);
+    ASSERT_TRUE(ret.has_value()) << ret.error().message();
+    EXPECT_EQ(record.maxRunning, 2);
+
+    auto index = [this](const std::string &event) {
+        auto it = std::find(record.events.begin(), record.events.end(), event);
+        EXPECT_NE(it, record.events.end()) << event;
+        return it - record.events.begin();
+    };
+    EXPECT_LT(index("finish a"), index("start b"));
+    // the second c starts after the first one finishes
+    auto firstFinish = std::find(record.events.begin(), record.events.end(), "finish c");
+    EXPECT_LT(index("start c"), firstFinish - record.events.begin());
+    EXPECT_NE(std::find(firstFinish, record.events.end(), "start c"), record.events.end());
+}
+
+// 测试获取失败的源码
+// 场景：第2个源码获取得慢且失败，第3个源码获取得快且失败
+// 预期：与逐个获取相同，返回第2个源码的错误，最后一个源码不再获取
+TEST_F(FetchSourcesTest, FirstFailureInOrder)
+{
+    add("source0", "digest0", 100);
+    add("source1", "digest1", 150, -2);
+    add("source2", "digest2", 10, -3);
+    add("source3", "digest3", 10);
+
+    auto ret = fetchSources(fetchers, QDir(destination.path()), 3);
+    ASSERT_FALSE(ret.has_value());
+    EXPECT_EQ(ret.error().code(), -2);
+    EXPECT_EQ(std::count(record.events.begin(), record.events.end(), "start source3"), 0);
+}
+
 } // namespace linglong::builder
@@ -0,0 +1,276 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "../../common/tempdir.h"
+#include "linglong/oci-cfg-generators/container_cfg_builder.h"
+
+#include <fstream>
+
+using namespace linglong;
+
+namespace {
+
+class ContainerCfgPatchTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        tempDir = std::make_unique<TempDir>();
+        ASSERT_TRUE(tempDir->isValid());
+
+        basePath = tempDir->path() / "base";
+        bundlePath = tempDir->path() / "bundle";
+        patchDir = tempDir->path() / "config.d";
+        std::filesystem::create_directories(basePath);
+        std::filesystem::create_directories(bundlePath);
+        std::filesystem::create_directories(patchDir / appId);
+    }
+
+    void writePatch(const std::filesystem::path &path,
+                    const std::string &patch,
+                    const std::string &ociVersion = "1.0.1")
+    {
+        std::ofstream(path) << R"({"ociVersion":")" << ociVersion << R"(","patch":)" << patch
+                            << "}";
+    }
+
+    utils::error::Result<ocppi::runtime::config::types::Config> build()
+    {
+        generator::ContainerCfgBuilder builder;
+        builder.setAppId(appId).setBasePath(basePath).setBundlePath(bundlePath).setPatchDir(
+          patchDir);
+
+        auto res = builder.build();
+        if (!res) {
+            return tl::unexpected(std::move(res).error());
+        }
+
+        return builder.getConfig();
+    }
+
+    const std::string appId{ "org.example.app" };
+    std::unique_ptr<TempDir> tempDir;
+    std::filesystem::path basePath;
+    std::filesystem::path bundlePath;
+    std::filesystem::path patchDir;
+};
+
+TEST_F(ContainerCfgPatchTest, AppliedInOrder)
+{
+    writePatch(patchDir / "20-second.json",
+               R"([{"op":"replace","path":"/hostname","value":"second"}])");
+    writePatch(patchDir / "10-first.json",
+               R"([{"op":"replace","path":"/hostname","value":"first"},)"
+               R"({"op":"add","path":"/annotations","value":{"first":"1"}}])");
+    writePatch(patchDir / appId / "00-app.json",
+               R"([{"op":"test","path":"/hostname","value":"second"},)"
+               R"({"op":"replace","path":"/hostname","value":"app"}])");
+
+    auto config = build();
+    ASSERT_TRUE(config.has_value()) << config.error().message();
+    EXPECT_EQ(config->hostname, "app");
+    ASSERT_TRUE(config->annotations.has_value());
+    EXPECT_EQ(config->annotations->at("first"), "1");
+}
+
+TEST_F(ContainerCfgPatchTest, FailedPatchIsSkipped)
+{
+    writePatch(patchDir / "10-version.json",
+               R"([{"op":"replace","path":"/hostname","value":"version"}])",
+               "0.0.1");
+    writePatch(patchDir / "20-missing.json",
+               R"([{"op":"replace","path":"/hostname","value":"missing"},)"
+               R"({"op":"remove","path":"/nonexistent"}])");
+    writePatch(patchDir / "30-valid.json",
+               R"([{"op":"add","path":"/annotations","value":{"valid":"1"}}])");
+    std::ofstream(patchDir / "40-unknown.txt") << "not a patch";
+
+    auto config = build();
+    ASSERT_TRUE(config.has_value()) << config.error().message();
+    EXPECT_EQ(config->hostname, "linglong");
+    ASSERT_TRUE(config->annotations.has_value());
+    EXPECT_EQ(config->annotations->at("valid"), "1");
+}
+
+TEST_F(ContainerCfgPatchTest, PatchResultingInvalidConfigIsSkipped)
+{
+    writePatch(patchDir / "10-valid.json",
+               R"([{"op":"replace","path":"/hostname","value":"valid"}])");
+    writePatch(patchDir / "20-invalid.json",
+               R"([{"op":"replace","path":"/root","value":"not an object"}])");
+    writePatch(patchDir / "30-valid.json",
+               R"([{"op":"add","path":"/annotations","value":{"valid":"1"}}])");
+
+    auto config = build();
+    ASSERT_TRUE(config.has_value()) << config.error().message();
+    EXPECT_EQ(config->hostname, "valid");
+    ASSERT_TRUE(config->root.has_value());
+    EXPECT_EQ(config->root->path, basePath);
+    ASSERT_TRUE(config->annotations.has_value());
+    EXPECT_EQ(config->annotations->at("valid"), "1");
+}
+
+TEST_F(ContainerCfgPatchTest, ExecutablePatch)
+{
+    writePatch(patchDir / "10-first.json",
+               R"([{"op":"replace","path":"/hostname","value":"first"}])");
+
+    auto script = patchDir / "20-exec";
+    std::ofstream(script) << "#!/bin/sh\nexec sed -e 's/\"hostname\":\"first\"/\"hostname\":\"exec\"/'\n";
+    std::filesystem::permissions(script, std::filesystem::perms::owner_all);
+
+    auto config = build();
+    ASSERT_TRUE(config.has_value()) << config.error().message();
+    EXPECT_EQ(config->hostname, "exec");
+}
+
+TEST_F(ContainerCfgPatchTest, ExecutablePatchRunsOnceWithInvalidPatch)
+{
+    writePatch(patchDir / "10-first.json",
+               R"([{"op":"replace","path":"/hostname","value":"first"}])");
+
+    auto counter = tempDir->path() / "counter";
+    auto script = patchDir / "20-exec";
+    std::ofstream(script) << "#!/bin/sh\necho run >> " << counter
+                          << "\nexec sed -e 's/\"hostname\":\"first\"/\"hostname\":\"exec\"/'\n";
+    std::filesystem::permissions(script, std::filesystem::perms::owner_all);
+
+    writePatch(patchDir / "30-invalid.json",
+               R"([{"op":"replace","path":"/root","value":"not an object"}])");
+    writePatch(patchDir / "40-last.json",
+               R"([{"op":"add","path":"/annotations","value":{"last":"1"}}])");
+
+    // the changes of the executable patch are kept without running it again
+    auto config = build();
+    ASSERT_TRUE(config.has_value()) << config.error().message();
+    EXPECT_EQ(config->hostname, "exec");
+    ASSERT_TRUE(config->annotations.has_value());
+    EXPECT_EQ(config->annotations->at("last"), "1");
+
+    std::ifstream stream(counter);
+    std::string line;
+    std::size_t runs = 0;
+    while (std::getline(stream, line)) {
+        ++runs;
+    }
+    EXPECT_EQ(runs, 1);
+}
+
+class ContainerCfgSelfAdjustTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        tempDir = std::make_unique<TempDir>();
+        ASSERT_TRUE(tempDir->isValid());
+
+        basePath = tempDir->path() / "base";
+        bundlePath = tempDir->path() / "bundle";
+        hostPath = tempDir->path() / "host";
+        std::filesystem::create_directories(basePath / "usr/share/fonts");
+        std::filesystem::create_directories(basePath / "usr/bin");
+        std::filesystem::create_directories(bundlePath);
+        std::filesystem::create_directories(hostPath);
+    }
+
+    ocppi::runtime::config::types::Mount bindMount(const std::string &destination,
+                                                   const std::string &source)
+    {
+        std::filesystem::create_directories(hostPath / source);
+        return ocppi::runtime::config::types::Mount{
+            .destination = destination,
+            .options = std::vector<std::string>{ "rbind" },
+            .source = (hostPath / source).string(),
+            .type = "bind",
+        };
+    }
+
+    utils::error::Result<ocppi::runtime::config::types::Config>
+    build(const std::vector<ocppi::runtime::config::types::Mount> &extra)
+    {
+        generator::ContainerCfgBuilder builder;
+        builder.setAppId("org.example.app")
+          .setBasePath(basePath)
+          .setBundlePath(bundlePath)
+          .disablePatch()
+          .enableSelfAdjustingMount()
+          .addExtraMounts(extra);
+
+        auto res = builder.build();
+        if (!res) {
+            return tl::unexpected(std::move(res).error());
+        }
+
+        return builder.getConfig();
+    }
+
+    static std::vector<ocppi::runtime::config::types::Mount>
+    find(const ocppi::runtime::config::types::Config &config, const std::string &destination)
+    {
+        std::vector<ocppi::runtime::config::types::Mount> found;
+        for (const auto &mount : config.mounts.value_or(decltype(config.mounts)::value_type{})) {
+            if (mount.destination == destination) {
+                found.push_back(mount);
+            }
+        }
+        return found;
+    }
+
+    std::unique_ptr<TempDir> tempDir;
+    std::filesystem::path basePath;
+    std::filesystem::path bundlePath;
+    std::filesystem::path hostPath;
+};
+
+TEST_F(ContainerCfgSelfAdjustTest, MissingDestinationIsFixed)
+{
+    auto config = build({ bindMount("/usr/share/themes/example", "theme") });
+    ASSERT_TRUE(config.has_value()) << config.error().message();
+    ASSERT_TRUE(config->root.has_value());
+    EXPECT_EQ(config->root->path, "rootfs");
+
+    // the nearest existing ancestor becomes tmpfs, its original content is bound back
+    auto share = find(*config, "/usr/share");
+    ASSERT_EQ(share.size(), 1);
+    EXPECT_EQ(share[0].type, "tmpfs");
+
+    auto fonts = find(*config, "/usr/share/fonts");
+    ASSERT_EQ(fonts.size(), 1);
+    EXPECT_EQ(fonts[0].source, (basePath / "usr/share/fonts").string());
+
+    auto theme = find(*config, "/usr/share/themes/example");
+    ASSERT_EQ(theme.size(), 1);
+    EXPECT_EQ(theme[0].source, (hostPath / "theme").string());
+
+    EXPECT_TRUE(find(*config, "/usr/bin").empty());
+}
+
+TEST_F(ContainerCfgSelfAdjustTest, ExistingDestinationIsKept)
+{
+    auto config = build({ bindMount("/usr/bin", "bin") });
+    ASSERT_TRUE(config.has_value()) << config.error().message();
+
+    // top level directories of the base are bound into the new rootfs as is
+    auto usr = find(*config, "/usr");
+    ASSERT_EQ(usr.size(), 1);
+    EXPECT_EQ(usr[0].type, "bind");
+    EXPECT_EQ(usr[0].source, (basePath / "usr").string());
+    auto bin = find(*config, "/usr/bin");
+    ASSERT_EQ(bin.size(), 1);
+    EXPECT_EQ(bin[0].source, (hostPath / "bin").string());
+}
+
+TEST_F(ContainerCfgSelfAdjustTest, DuplicatedDestinationFirstWins)
+{
+    auto config = build({ bindMount("/opt/example", "first"), bindMount("/opt/example", "second") });
+    ASSERT_TRUE(config.has_value()) << config.error().message();
+
+    auto mounts = find(*config, "/opt/example");
+    ASSERT_EQ(mounts.size(), 1);
+    EXPECT_EQ(mounts[0].source, (hostPath / "first").string());
+}
+
+} // namespace
@@ -0,0 +1,211 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "common/tempdir.h"
+#include "linglong/package/erofs_builder.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+using namespace linglong::package;
+
+namespace {
+
+TEST(ErofsBuilderTest, DefaultArgs)
+{
+    ErofsBuildOptions options{ .compressor = "lz4" };
+    auto args = mkfsErofsArgs(options, "image.ef", "dir", false);
+    EXPECT_EQ(args, (std::vector<std::string>{ "-zlz4", "-b4096", "image.ef", "dir" }));
+
+    options.compressor.clear();
+    args = mkfsErofsArgs(options, "image.ef", "dir", false);
+    EXPECT_EQ(args, (std::vector<std::string>{ "-b4096", "image.ef", "dir" }));
+}
+
+TEST(ErofsBuilderTest, AllArgs)
+{
+    ErofsBuildOptions options{ .compressor = "lz4hc",
+                               .compressionLevel = 12,
+                               .clusterSize = 1048576,
+                               .features = { "fragments", "dedupe", "ztailpacking" },
+                               .excludeRegex = { "minified*" },
+                               .workers = 4 };
+    auto args = mkfsErofsArgs(options, "image.ef", "dir", true);
+    EXPECT_EQ(args,
+              (std::vector<std::string>{ "-zlz4hc,12",
+                                         "-Efragments,dedupe,ztailpacking",
+                                         "-C1048576",
+                                         "-b4096",
+                                         "--workers=4",
+                                         "--exclude-regex=minified*",
+                                         "image.ef",
+                                         "dir" }));
+}
+
+TEST(ErofsBuilderTest, Workers)
+{
+    ErofsBuildOptions options{ .compressor = "lz4" };
+    auto args = mkfsErofsArgs(options, "image.ef", "dir", true);
+    ASSERT_EQ(args.size(), 5);
+    EXPECT_EQ(args[2].rfind("--workers=", 0), 0);
+    EXPECT_NE(args[2], "--workers=0");
+
+    // a single worker is passed too, mkfs.erofs may use all CPUs by default
+    options.workers = 1;
+    args = mkfsErofsArgs(options, "image.ef", "dir", true);
+    EXPECT_EQ(args,
+              (std::vector<std::string>{ "-zlz4", "-b4096", "--workers=1", "image.ef", "dir" }));
+
+    // ignored if mkfs.erofs doesn't support it
+    options.workers = 4;
+    args = mkfsErofsArgs(options, "image.ef", "dir", false);
+    EXPECT_EQ(args, (std::vector<std::string>{ "-zlz4", "-b4096", "image.ef", "dir" }));
+}
+
+TEST(ErofsBuilderTest, Timestamp)
+{
+    ErofsBuildOptions options{ .compressor = "lz4", .timestamp = 0 };
+    auto args = mkfsErofsArgs(options, "image.ef", "dir", false);
+    EXPECT_EQ(args, (std::vector<std::string>{ "-zlz4", "-b4096", "-T0", "image.ef", "dir" }));
+
+    ::unsetenv("SOURCE_DATE_EPOCH");
+    EXPECT_EQ(sourceDateEpoch(), 0);
+    ::setenv("SOURCE_DATE_EPOCH", "1700000000", 1);
+    EXPECT_EQ(sourceDateEpoch(), 1700000000);
+    ::setenv("SOURCE_DATE_EPOCH", "yesterday", 1);
+    EXPECT_EQ(sourceDateEpoch(), 0);
+    ::unsetenv("SOURCE_DATE_EPOCH");
+}
+
+TEST(ErofsBuilderTest, Uuid)
+{
+    ErofsBuildOptions options{ .compressor = "lz4",
+                               .uuid = "01234567-89ab-8cde-bf01-23456789abcd" };
+    auto args = mkfsErofsArgs(options, "image.ef", "dir", false);
+    EXPECT_EQ(args,
+              (std::vector<std::string>{ "-zlz4",
+                                         "-b4096",
+                                         "-U01234567-89ab-8cde-bf01-23456789abcd",
+                                         "image.ef",
+                                         "dir" }));
+
+    auto digest = std::string{ "0123456789abcdef0123456789abcdef" } + std::string(32, 'f');
+    EXPECT_EQ(erofsUuid(digest), "01234567-89ab-8def-8123-456789abcdef");
+    EXPECT_EQ(erofsUuid(digest), erofsUuid(digest));
+    EXPECT_NE(erofsUuid(digest), erofsUuid(std::string(64, '0')));
+}
+
+class ErofsTreeDigestTest : public ::testing::Test
+{
+protected:
+    void SetUp() override { ASSERT_TRUE(this->dir.isValid()); }
+
+    std::filesystem::path tree(const std::string &name)
+    {
+        auto root = this->dir.path() / name;
+        std::filesystem::create_directories(root / "files" / "lib");
+        std::ofstream{ root / "files" / "lib" / "libfoo.so.1" } << "foo";
+        std::ofstream{ root / "files" / "app" } << "app";
+        std::filesystem::permissions(root / "files" / "app", std::filesystem::perms(0755));
+        std::filesystem::create_symlink("libfoo.so.1", root / "files" / "lib" / "libfoo.so");
+        return root;
+    }
+
+    static std::string digest(const std::filesystem::path &root)
+    {
+        auto ret = erofsTreeDigest(root);
+        EXPECT_TRUE(ret) << ret.error().message();
+        return ret ? *ret : std::string{};
+    }
+
+    TempDir dir{ "linglong-erofs-tree-digest-test-" };
+};
+
+TEST_F(ErofsTreeDigestTest, SameTree)
+{
+    auto a = this->tree("a");
+    auto b = this->tree("b");
+    // timestamps aren't part of the digest
+    std::filesystem::last_write_time(b / "files" / "app",
+                                     std::filesystem::file_time_type::clock::now()
+                                       - std::chrono::hours{ 1 });
+
+    EXPECT_EQ(digest(a).size(), 64);
+    EXPECT_EQ(digest(a), digest(b));
+}
+
+TEST_F(ErofsTreeDigestTest, ChangedTree)
+{
+    auto base = digest(this->tree("base"));
+
+    auto content = this->tree("content");
+    std::ofstream{ content / "files" / "app" } << "app2";
+    EXPECT_NE(digest(content), base);
+
+    auto mode = this->tree("mode");
+    std::filesystem::permissions(mode / "files" / "app", std::filesystem::perms(0644));
+    EXPECT_NE(digest(mode), base);
+
+    auto symlink = this->tree("symlink");
+    std::filesystem::remove(symlink / "files" / "lib" / "libfoo.so");
+    std::filesystem::create_symlink("../app", symlink / "files" / "lib" / "libfoo.so");
+    EXPECT_NE(digest(symlink), base);
+
+    auto added = this->tree("added");
+    std::filesystem::create_directory(added / "files" / "share");
+    EXPECT_NE(digest(added), base);
+}
+
+TEST_F(ErofsTreeDigestTest, Hardlinks)
+{
+    auto copied = this->tree("copied");
+    std::filesystem::copy_file(copied / "files" / "app", copied / "files" / "app2");
+
+    auto linked = this->tree("linked");
+    std::filesystem::create_hard_link(linked / "files" / "app", linked / "files" / "app2");
+
+    // hardlinks are one inode of the image
+    EXPECT_NE(digest(copied), digest(linked));
+}
+
+TEST_F(ErofsTreeDigestTest, MissingTree)
+{
+    EXPECT_FALSE(erofsTreeDigest(this->dir.path() / "missing"));
+}
+
+TEST_F(ErofsTreeDigestTest, ReproducibleImage)
+{
+    if (mkfsErofsVersion().empty()) {
+        GTEST_SKIP() << "mkfs.erofs is required";
+    }
+
+    // the same tree staged twice at different times, built like the bundle of an UAB
+    auto a = this->tree("a");
+    auto b = this->tree("b");
+    std::filesystem::last_write_time(b / "files" / "app",
+                                     std::filesystem::file_time_type::clock::now()
+                                       - std::chrono::hours{ 1 });
+
+    auto image = [this](const std::filesystem::path &source) {
+        ErofsBuildOptions options{ .compressor = "lz4hc",
+                                   .features = { "fragments", "dedupe", "ztailpacking" },
+                                   .timestamp = 0,
+                                   .uuid = erofsUuid(digest(source)) };
+        auto path = source.string() + ".ef";
+        auto ret = buildErofsImage(path, source, options);
+        EXPECT_TRUE(ret) << ret.error().message();
+
+        std::ifstream in{ path, std::ios::binary };
+        return std::string{ std::istreambuf_iterator<char>(in), {} };
+    };
+
+    auto first = image(a);
+    EXPECT_FALSE(first.empty());
+    EXPECT_EQ(first, image(b));
+}
+
+} // namespace
@@ -0,0 +1,271 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "common/erofs_image.h"
+#include "common/tempdir.h"
+#include "linglong/package/erofs_builder.h"
+#include "linglong/package/erofs_image.h"
+#include "linglong/utils/cmd.h"
+#include "linglong/utils/file.h"
+
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <random>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace linglong;
+using namespace linglong::package;
+
+namespace {
+
+std::string readAll(const std::filesystem::path &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return { std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>() };
+}
+
+void writeAll(const std::filesystem::path &path, const std::string &content)
+{
+    std::ofstream out(path, std::ios::binary);
+    out << content;
+}
+
+class ErofsImageTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        if (!utils::Cmd("mkfs.erofs").exists()) {
+            GTEST_SKIP() << "mkfs.erofs is required";
+        }
+
+        ASSERT_TRUE(this->dir.isValid());
+        this->source = this->dir.path() / "source";
+        std::filesystem::create_directories(this->source / "files" / "bin");
+        std::filesystem::create_directories(this->source / "files" / "share" / "empty");
+
+        // text compresses well, random bytes don't, so both compressed and plain pclusters exist
+        std::mt19937 rng(42);
+        std::string text;
+        while (text.size() < 300 * 1024) {
+            text += "linglong " + std::to_string(rng() % 1000) + "\n";
+        }
+        std::string random(200 * 1024, '\0');
+        for (auto &c : random) {
+            c = static_cast<char>(rng());
+        }
+
+        this->files = {
+            { "info.json", R"({"id":"org.test.app"})" },
+            { "files/empty", "" },
+            { "files/small", "hello" },
+            { "files/block", text.substr(0, 4096) },
+            { "files/text", text },
+            { "files/random", random },
+            { "files/mixed", text.substr(0, 70000) + random.substr(0, 70000) + text },
+            { "files/share/copy", text },
+        };
+        for (const auto &[path, content] : this->files) {
+            writeAll(this->source / path, content);
+        }
+
+        ASSERT_EQ(::chmod((this->source / "files/random").c_str(), 0755), 0);
+        ASSERT_EQ(::chmod((this->source / "files/share").c_str(), 0750), 0);
+        std::filesystem::create_symlink("../text", this->source / "files/bin/link");
+        std::filesystem::create_hard_link(this->source / "files/small",
+                                          this->source / "files/bin/small");
+        this->files.emplace("files/bin/small", "hello");
+    }
+
+    std::unique_ptr<ErofsImage> build(const ErofsBuildOptions &options, off_t offset = 0)
+    {
+        auto image = this->dir.path() / "image.erofs";
+        std::filesystem::remove(image);
+        auto ret = buildErofsImage(image, this->source, options);
+        EXPECT_TRUE(ret) << ret.error().message();
+        if (!ret) {
+            return nullptr;
+        }
+
+        auto fd = ::open(image.c_str(), O_RDWR | O_CLOEXEC);
+        EXPECT_NE(fd, -1);
+        if (offset != 0) {
+            // the image is embedded in a larger file, like a layer file or an UAB
+            auto prefixed = this->dir.path() / "prefixed";
+            auto out = ::open(prefixed.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            EXPECT_NE(out, -1);
+            EXPECT_EQ(::ftruncate(out, offset), 0);
+            EXPECT_TRUE(utils::copyRange(fd, 0, out, offset, std::filesystem::file_size(image)));
+            ::close(fd);
+            fd = out;
+        }
+
+        auto opened = ErofsImage::open(fd, offset);
+        ::close(fd);
+        EXPECT_TRUE(opened) << opened.error().message();
+        if (!opened) {
+            return nullptr;
+        }
+
+        return std::move(opened).value();
+    }
+
+    void check(const ErofsImage &image)
+    {
+        for (const auto &[path, content] : this->files) {
+            auto inode = image.lookup(path);
+            ASSERT_TRUE(inode) << path << ": " << inode.error().message();
+            ASSERT_EQ(inode->size, content.size()) << path;
+
+            // read in chunks which aren't aligned to blocks
+            ErofsFile file{ image, *inode };
+            std::string data(content.size(), '\0');
+            std::uint64_t offset{ 0 };
+            while (offset < data.size()) {
+                auto len = std::min<std::size_t>(3000, data.size() - offset);
+                auto ret =
+                  file.readFully(offset, reinterpret_cast<std::byte *>(data.data()) + offset, len);
+                ASSERT_TRUE(ret) << path << ": " << ret.error().message();
+                offset += len;
+            }
+            EXPECT_TRUE(data == content) << path;
+        }
+
+        auto info = image.lookup("info.json");
+        ASSERT_TRUE(info);
+        auto content = image.readFile(*info);
+        ASSERT_TRUE(content) << content.error().message();
+        EXPECT_EQ(*content, this->files["info.json"]);
+
+        auto link = image.lookup("files/bin/link");
+        ASSERT_TRUE(link);
+        auto target = image.readLink(*link);
+        ASSERT_TRUE(target) << target.error().message();
+        EXPECT_EQ(*target, "../text");
+
+        auto root = image.root();
+        ASSERT_TRUE(root);
+        auto entries = image.readDir(*root);
+        ASSERT_TRUE(entries) << entries.error().message();
+        EXPECT_EQ(entries->size(), 2);
+
+        EXPECT_FALSE(image.lookup("files/missing"));
+        EXPECT_FALSE(image.lookup("info.json/files"));
+
+        auto destination = this->dir.path() / "extracted";
+        std::filesystem::remove_all(destination);
+        std::filesystem::create_directory(destination);
+        auto ret = image.extract(*root, destination, 4);
+        ASSERT_TRUE(ret) << ret.error().message();
+        for (const auto &[path, content] : this->files) {
+            EXPECT_TRUE(readAll(destination / path) == content) << path;
+        }
+        EXPECT_EQ(std::filesystem::read_symlink(destination / "files/bin/link"), "../text");
+        EXPECT_TRUE(std::filesystem::is_directory(destination / "files/share/empty"));
+        EXPECT_TRUE(std::filesystem::equivalent(destination / "files/small",
+                                                destination / "files/bin/small"));
+
+        struct stat st{};
+        ASSERT_EQ(::stat((destination / "files/random").c_str(), &st), 0);
+        EXPECT_EQ(st.st_mode & 0777, 0755);
+        ASSERT_EQ(::stat((destination / "files/share").c_str(), &st), 0);
+        EXPECT_EQ(st.st_mode & 0777, 0750);
+    }
+
+    TempDir dir{ "linglong-erofs-image-test-" };
+    std::filesystem::path source;
+    std::map<std::string, std::string> files;
+};
+
+TEST_F(ErofsImageTest, Uncompressed)
+{
+    auto image = this->build({});
+    ASSERT_TRUE(image);
+    this->check(*image);
+}
+
+TEST_F(ErofsImageTest, LZ4)
+{
+    auto image = this->build({ .compressor = "lz4" });
+    ASSERT_TRUE(image);
+    this->check(*image);
+}
+
+TEST_F(ErofsImageTest, LZ4HCWithTailPacking)
+{
+    auto image = this->build({ .compressor = "lz4hc", .features = { "ztailpacking" } });
+    ASSERT_TRUE(image);
+    this->check(*image);
+}
+
+TEST_F(ErofsImageTest, LZMABigPCluster)
+{
+    auto image = this->build({ .compressor = "lzma", .clusterSize = 65536 });
+    ASSERT_TRUE(image);
+    this->check(*image);
+}
+
+TEST_F(ErofsImageTest, LZMAFragmentsAndDedupe)
+{
+    auto image = this->build(
+      { .compressor = "lzma", .clusterSize = 65536, .features = { "fragments", "dedupe" } });
+    ASSERT_TRUE(image);
+    this->check(*image);
+}
+
+TEST_F(ErofsImageTest, Offset)
+{
+    auto image = this->build({ .compressor = "lz4" }, 8192 + 44);
+    ASSERT_TRUE(image);
+    this->check(*image);
+}
+
+TEST(ErofsImageOpenTest, NotErofs)
+{
+    TempDir dir{ "linglong-erofs-image-test-" };
+    ASSERT_TRUE(dir.isValid());
+    writeAll(dir.path() / "file", std::string(8192, 'x'));
+
+    auto fd = ::open((dir.path() / "file").c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_NE(fd, -1);
+    EXPECT_FALSE(ErofsImage::open(fd));
+    // truncated
+    EXPECT_FALSE(ErofsImage::open(fd, 8000));
+    ::close(fd);
+}
+
+TEST(ErofsImageLoopTest, DirectoryLinkedToItsAncestor)
+{
+    TempDir dir{ "linglong-erofs-image-test-" };
+    ASSERT_TRUE(dir.isValid());
+    auto path = dir.path() / "looped.erofs";
+    ASSERT_TRUE(writeLoopedErofsImage(path, R"({"id":"org.test.app"})"));
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_NE(fd, -1);
+    auto image = ErofsImage::open(fd);
+    ::close(fd);
+    ASSERT_TRUE(image) << image.error().message();
+
+    auto info = (*image)->lookup("files/up/info.json");
+    ASSERT_TRUE(info) << info.error().message();
+    EXPECT_EQ((*image)->readFile(*info), R"({"id":"org.test.app"})");
+
+    auto root = (*image)->root();
+    ASSERT_TRUE(root) << root.error().message();
+    auto destination = dir.path() / "extracted";
+    std::filesystem::create_directories(destination);
+    EXPECT_FALSE((*image)->extract(*root, destination));
+    // the loop is refused at once, rather than extracted until the path is too long
+    EXPECT_FALSE(std::filesystem::exists(destination / "files" / "up" / "files"));
+}
+
+} // namespace
@@ -20,6 +20,8 @@
 #include <memory>
 #include <string>
 
+#include <sys/stat.h>
+
 using namespace linglong;
 
 namespace linglong::package {
@@ -162,6 +164,96 @@ TEST_F(LayerPackagerTest, LayerPackagerUnpackFsck)
       << "'hello' not found in unpack dir" << filesDir;
 }
 
+TEST_F(LayerPackagerTest, Index)
+{
+    auto layerFileRet = package::LayerFile::New(layerFilePath.string().c_str());
+    ASSERT_TRUE(layerFileRet.has_value()) << layerFileRet.error().message();
+    auto layerFile = *layerFileRet;
+    auto info = layerFile->metaInfo();
+    ASSERT_TRUE(info.has_value()) << info.error().message();
+
+    auto index = layerFile->index();
+    ASSERT_TRUE(index.has_value()) << index.error().message();
+    ASSERT_TRUE(index->has_value()) << "layer file has no index";
+    EXPECT_NE((*index)->find("info.json"), nullptr);
+    EXPECT_NE((*index)->find("files"), nullptr);
+    EXPECT_EQ((*index)->find("files/missing"), nullptr);
+    const auto *hello = (*index)->find("files/hello");
+    ASSERT_NE(hello, nullptr);
+    EXPECT_TRUE(S_ISREG(hello->mode));
+    EXPECT_EQ(hello->size, 13);
+    EXPECT_EQ(hello->sha256, sha256Of("Hello, World!"));
+
+    TempDir dir("linglong-layer-extract-");
+    ASSERT_TRUE(dir.isValid());
+    auto ret = layerFile->extract("files/hello", dir.path() / "hello");
+    ASSERT_TRUE(ret.has_value()) << ret.error().message();
+    std::ifstream helloFile(dir.path() / "hello");
+    std::stringstream buffer;
+    buffer << helloFile.rdbuf();
+    EXPECT_EQ(buffer.str(), "Hello, World!");
+
+    ret = layerFile->extract("files", dir.path() / "files");
+    ASSERT_TRUE(ret.has_value()) << ret.error().message();
+    EXPECT_TRUE(std::filesystem::exists(dir.path() / "files" / "hello"));
+
+    EXPECT_FALSE(layerFile->extract("files/missing", dir.path() / "missing").has_value());
+}
+
+TEST_F(LayerPackagerTest, IndexDetectsCorruptedHeader)
+{
+    TempDir dir("linglong-layer-corrupted-");
+    ASSERT_TRUE(dir.isValid());
+    auto corrupted = dir.path() / "corrupted.layer";
+    std::filesystem::copy_file(layerFilePath, corrupted);
+    {
+        // change the meta info without changing its length
+        std::fstream file(corrupted, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(44);
+        file.put(' ');
+    }
+
+    auto layerFileRet = package::LayerFile::New(corrupted.string().c_str());
+    ASSERT_TRUE(layerFileRet.has_value()) << layerFileRet.error().message();
+    EXPECT_FALSE((*layerFileRet)->index().has_value());
+}
+
+TEST_F(LayerPackagerTest, OldFormatWithoutIndex)
+{
+    TempDir dir("linglong-layer-old-");
+    ASSERT_TRUE(dir.isValid());
+    auto old = dir.path() / "old.layer";
+    std::filesystem::copy_file(layerFilePath, old);
+    {
+        auto layerFileRet = package::LayerFile::New(old.string().c_str());
+        ASSERT_TRUE(layerFileRet.has_value()) << layerFileRet.error().message();
+        auto index = (*layerFileRet)->index();
+        ASSERT_TRUE(index.has_value() && index->has_value());
+        // strip the index and its footer
+        auto size = std::filesystem::file_size(old) - LayerIndexFooter::size;
+        std::string footer(LayerIndexFooter::size, '\0');
+        std::ifstream in(old, std::ios::binary);
+        in.seekg(static_cast<std::streamoff>(size));
+        in.read(footer.data(), static_cast<std::streamsize>(footer.size()));
+        auto parsed = LayerIndexFooter::parse(reinterpret_cast<const std::byte *>(footer.data()));
+        ASSERT_TRUE(parsed.has_value());
+        std::filesystem::resize_file(old, size - parsed->indexSize);
+    }
+
+    auto layerFileRet = package::LayerFile::New(old.string().c_str());
+    ASSERT_TRUE(layerFileRet.has_value()) << layerFileRet.error().message();
+    auto layerFile = *layerFileRet;
+    auto info = layerFile->metaInfo();
+    ASSERT_TRUE(info.has_value()) << info.error().message();
+    auto index = layerFile->index();
+    ASSERT_TRUE(index.has_value()) << index.error().message();
+    EXPECT_FALSE(index->has_value());
+
+    auto ret = layerFile->extract("files/hello", dir.path() / "hello");
+    ASSERT_TRUE(ret.has_value()) << ret.error().message();
+    EXPECT_TRUE(std::filesystem::exists(dir.path() / "hello"));
+}
+
 TEST_F(LayerPackagerTest, InitWorkDir)
 {
     TempDir tmpDir("linglong-layer-");
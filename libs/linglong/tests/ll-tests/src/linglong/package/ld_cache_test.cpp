@@ -0,0 +1,134 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "common/tempdir.h"
+#include "linglong/package/architecture.h"
+#include "linglong/package/ld_cache.h"
+#include "linglong/utils/cmd.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include <dlfcn.h>
+
+using namespace linglong;
+using namespace linglong::package;
+
+namespace {
+
+class LDCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        auto arch = Architecture::currentCPUArchitecture();
+        if (arch != Architecture(Architecture::X86_64)
+            && arch != Architecture(Architecture::ARM64)) {
+            GTEST_SKIP() << "the flags of libraries are only checked on x86_64 and arm64";
+        }
+
+        // the libc of the test is a library of the current architecture
+        Dl_info info{};
+        ASSERT_NE(::dladdr(reinterpret_cast<void *>(&::dladdr), &info), 0);
+        this->library = std::filesystem::canonical(info.dli_fname);
+        this->triplet = arch.getTriplet();
+
+        ASSERT_TRUE(this->dir.isValid());
+        this->runtime = this->dir.path() / "runtime";
+        this->app = this->dir.path() / "app";
+        std::filesystem::create_directories(this->runtime / "lib" / this->triplet);
+        std::filesystem::create_directories(this->runtime / "etc");
+        std::filesystem::create_directories(this->app / "lib");
+        std::filesystem::create_directories(this->app / "plugins");
+        std::filesystem::create_directories(this->app / "etc" / "ld.so.conf.d");
+    }
+
+    std::string cache(const std::vector<LDCacheRoot> &roots)
+    {
+        auto ret = generateLDCache(roots, Architecture::currentCPUArchitecture());
+        EXPECT_TRUE(ret) << ret.error().message();
+        if (!ret) {
+            return {};
+        }
+
+        if (!utils::Cmd("ldconfig").exists()) {
+            return {};
+        }
+
+        // list the cache by ldconfig itself
+        auto file = this->dir.path() / "ld.so.cache";
+        std::ofstream{ file, std::ios::binary } << *ret;
+        auto output = utils::Cmd("ldconfig").exec({ "-p", "-C", file.string() });
+        EXPECT_TRUE(output) << output.error().message();
+        return output ? *output : std::string{};
+    }
+
+    TempDir dir{ "linglong-ld-cache-test-" };
+    std::filesystem::path library;
+    std::string triplet;
+    std::filesystem::path runtime;
+    std::filesystem::path app;
+};
+
+TEST_F(LDCacheTest, Generate)
+{
+    std::filesystem::copy_file(this->library, this->runtime / "lib" / this->triplet / "libc.so.6");
+    // the link for the linker is a key too, the text file isn't a library
+    std::filesystem::create_symlink("libc.so.6", this->runtime / "lib" / this->triplet / "libc.so");
+    std::ofstream{ this->runtime / "lib" / "libtext.so" } << "INPUT(libc.so.6)";
+    // the soname link is missing
+    std::filesystem::copy_file(this->library, this->app / "plugins" / "libplugin.so.6.1");
+
+    std::ofstream{ this->app / "etc" / "ld.so.conf" } << "# comment\ninclude ld.so.conf.d/*.conf\n";
+    std::ofstream{ this->app / "etc" / "ld.so.conf.d" / "plugins.conf" }
+      << "/opt/apps/org.test/files/plugins\n/usr/lib/outside\n";
+
+    auto output =
+      this->cache({ { .mountPoint = "/runtime", .source = this->runtime },
+                    { .mountPoint = "/opt/apps/org.test/files", .source = this->app } });
+    if (output.empty()) {
+        GTEST_SKIP() << "ldconfig is required to check the cache";
+    }
+
+    EXPECT_NE(output.find("3 libs found in cache"), std::string::npos) << output;
+    EXPECT_NE(output.find("=> /runtime/lib/" + this->triplet + "/libc.so.6\n"), std::string::npos)
+      << output;
+    EXPECT_NE(output.find("=> /runtime/lib/" + this->triplet + "/libc.so\n"), std::string::npos)
+      << output;
+    // the key is the soname, the value is the file
+    EXPECT_NE(output.find("=> /opt/apps/org.test/files/plugins/libplugin.so.6.1\n"),
+              std::string::npos)
+      << output;
+    EXPECT_EQ(output.find("libtext"), std::string::npos) << output;
+}
+
+TEST_F(LDCacheTest, Precedence)
+{
+    std::filesystem::copy_file(this->library, this->runtime / "lib" / this->triplet / "libc.so.6");
+    std::filesystem::copy_file(this->library, this->app / "lib" / "libc.so.6");
+
+    auto output =
+      this->cache({ { .mountPoint = "/runtime", .source = this->runtime },
+                    { .mountPoint = "/opt/apps/org.test/files", .source = this->app } });
+    if (output.empty()) {
+        GTEST_SKIP() << "ldconfig is required to check the cache";
+    }
+
+    // the dynamic linker takes the first one
+    auto first = output.find("=> /runtime/lib/" + this->triplet + "/libc.so.6\n");
+    auto second = output.find("=> /opt/apps/org.test/files/lib/libc.so.6\n");
+    ASSERT_NE(first, std::string::npos) << output;
+    ASSERT_NE(second, std::string::npos) << output;
+    EXPECT_LT(first, second);
+}
+
+TEST(LDCacheUnsupportedTest, SW64)
+{
+    EXPECT_FALSE(generateLDCache({}, Architecture(Architecture::SW64)));
+}
+
+} // namespace
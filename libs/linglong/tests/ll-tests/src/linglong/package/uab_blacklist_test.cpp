@@ -0,0 +1,90 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "linglong/package/uab_blacklist.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+using linglong::package::UABBlacklist;
+
+namespace {
+
+// the matching which the blacklist replaces
+bool linearMatches(const std::vector<std::string> &entries, const std::string &fileName)
+{
+    return std::any_of(entries.begin(), entries.end(), [&fileName](const std::string &entry) {
+        return entry.rfind(fileName, 0) == 0 || fileName.rfind(entry, 0) == 0;
+    });
+}
+
+TEST(UABBlacklistTest, Empty)
+{
+    UABBlacklist blackList;
+    EXPECT_EQ(blackList.size(), 0);
+    EXPECT_FALSE(blackList.matches("libc.so.6"));
+    EXPECT_FALSE(blackList.matches(""));
+}
+
+TEST(UABBlacklistTest, Insert)
+{
+    UABBlacklist blackList;
+    EXPECT_TRUE(blackList.insert("libc.so.6"));
+    EXPECT_TRUE(blackList.insert("libc.so"));
+    EXPECT_FALSE(blackList.insert("libc.so.6"));
+    EXPECT_EQ(blackList.size(), 2);
+}
+
+TEST(UABBlacklistTest, MatchesPrefixInBothDirections)
+{
+    UABBlacklist blackList;
+    blackList.insert("libGL.so.1");
+    blackList.insert("libpthread.so.0 # merged into libc");
+
+    EXPECT_TRUE(blackList.matches("libGL.so.1"));
+    // the entry is a prefix of the file name
+    EXPECT_TRUE(blackList.matches("libGL.so.1.7.0"));
+    // the file name is a prefix of the entry
+    EXPECT_TRUE(blackList.matches("libGL.so"));
+    EXPECT_TRUE(blackList.matches("libpthread.so.0"));
+
+    EXPECT_FALSE(blackList.matches("libGLX.so.0"));
+    EXPECT_FALSE(blackList.matches("libpthread.so.1"));
+    EXPECT_FALSE(blackList.matches("xlibGL.so.1"));
+}
+
+TEST(UABBlacklistTest, SameAsLinearMatching)
+{
+    std::mt19937 rng(42);
+    auto randomName = [&rng](std::size_t maxLength) {
+        // a small alphabet makes shared prefixes likely
+        std::uniform_int_distribution<int> length(1, static_cast<int>(maxLength));
+        std::uniform_int_distribution<int> character('a', 'e');
+        std::string name(length(rng), '\0');
+        for (auto &c : name) {
+            c = static_cast<char>(character(rng));
+        }
+        return name;
+    };
+
+    UABBlacklist blackList;
+    std::vector<std::string> entries;
+    for (int i = 0; i < 300; ++i) {
+        auto entry = randomName(8);
+        if (blackList.insert(entry)) {
+            entries.push_back(entry);
+        }
+    }
+
+    for (int i = 0; i < 10000; ++i) {
+        auto fileName = randomName(10);
+        EXPECT_EQ(blackList.matches(fileName), linearMatches(entries, fileName)) << fileName;
+    }
+}
+
+} // namespace
@@ -11,6 +11,7 @@
 #include "linglong/package/uab_file.h"
 #include "linglong/package/uab_packager.h"
 #include "linglong/utils/cmd.h"
+#include "linglong/utils/merkle.h"
 
 #include <QCryptographicHash>
 #include <QFileInfo>
@@ -18,6 +19,7 @@
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <sstream>
 #include <string>
 
 #include <fcntl.h>
@@ -107,6 +109,40 @@ protected:
 
     static void TearDownTestCase() { testDir.reset(); }
 
+    // an UAB of the bundle image whose app is of version
+    static std::filesystem::path createUab(const std::string &name,
+                                           const std::filesystem::path &bundleFile,
+                                           const std::string &version)
+    {
+        auto path = testDir->path() / (name + ".uab");
+        std::filesystem::copy_file("/proc/self/exe", path);
+        auto elf = ElfHandler::create(path);
+        EXPECT_TRUE(elf.has_value());
+
+        api::types::v1::PackageInfoV2 packageInfo;
+        packageInfo.id = "hello";
+        packageInfo.version = version;
+        api::types::v1::UabMetaInfo meta;
+        meta.version = api::types::v1::Version::The1;
+        meta.uuid = "b2f33c7b-615c-4d7d-9181-e1a22010a749";
+        meta.layers.push_back(api::types::v1::UabLayer{ packageInfo, false });
+        EXPECT_TRUE(addBundleSection(**elf, bundleFile, "linglong.bundle", meta).has_value());
+        auto metaFile = testDir->path() / (name + ".json");
+        std::ofstream(metaFile) << nlohmann::json(meta).dump();
+        EXPECT_TRUE((*elf)->addSection("linglong.meta", metaFile).has_value());
+        return path;
+    }
+
+    static bool sameContent(const std::filesystem::path &lhs, const std::filesystem::path &rhs)
+    {
+        std::ifstream expected(lhs, std::ios::binary);
+        std::ifstream actual(rhs, std::ios::binary);
+        return std::equal(std::istreambuf_iterator<char>(expected),
+                          std::istreambuf_iterator<char>(),
+                          std::istreambuf_iterator<char>(actual),
+                          std::istreambuf_iterator<char>());
+    }
+
     void SetUp() override { }
 
     void TearDown() override { }
@@ -190,6 +226,224 @@ TEST_F(UabFileTest, Verify)
     ASSERT_TRUE(*verifyRet) << "Verify failed";
 }
 
+TEST_F(UabFileTest, VerifyMerkleTree)
+{
+    auto bundleFile = testDir->path() / "merkle.bundle";
+    {
+        std::ofstream bundle(bundleFile, std::ios::binary);
+        for (int i = 0; i < 3 * 4096 + 10; ++i) {
+            bundle.put(static_cast<char>(i * 7));
+        }
+    }
+
+    auto fd = ::open(bundleFile.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_NE(fd, -1);
+    auto leaves = digest::merkle_leaves(fd, 0, std::filesystem::file_size(bundleFile), 4096);
+    ::close(fd);
+    ASSERT_TRUE(leaves.has_value());
+
+    auto createUab = [&](const std::string &name, const std::string &root) {
+        auto path = testDir->path() / name;
+        std::filesystem::copy_file("/proc/self/exe", path);
+        auto uab = ElfHandler::create(path);
+        EXPECT_TRUE(uab.has_value());
+        EXPECT_TRUE((*uab)->addSection("linglong.bundle", bundleFile).has_value());
+
+        api::types::v1::UabMetaInfo meta;
+        meta.version = api::types::v1::Version::The1;
+        meta.uuid = "b2f33c7b-615c-4d7d-9181-e1a22010a749";
+        meta.sections.bundle = "linglong.bundle";
+        // the tree takes precedence over the digest of the whole section
+        meta.digest = "unused";
+        meta.merkleTree =
+          api::types::v1::UabMerkleTree{ .leafSize = 4096, .leaves = *leaves, .root = root };
+        auto metaFile = testDir->path() / (name + ".json");
+        std::ofstream(metaFile) << nlohmann::json(meta).dump();
+        EXPECT_TRUE((*uab)->addSection("linglong.meta", metaFile).has_value());
+        return path.string();
+    };
+
+    auto valid = MockUabFile(createUab("merkle.uab", digest::merkle_root(*leaves)));
+    auto verifyRet = valid.verify();
+    ASSERT_TRUE(verifyRet.has_value()) << verifyRet.error().message();
+    EXPECT_TRUE(*verifyRet);
+
+    auto forged = MockUabFile(createUab("forged.uab", std::string(64, '0')));
+    verifyRet = forged.verify();
+    ASSERT_TRUE(verifyRet.has_value()) << verifyRet.error().message();
+    EXPECT_FALSE(*verifyRet);
+}
+
+TEST_F(UabFileTest, AddBundleSection)
+{
+    // leaves of merkle tree are 1 MiB, the last one is shorter
+    auto bundleFile = testDir->path() / "large.bundle";
+    {
+        std::ofstream bundle(bundleFile, std::ios::binary);
+        for (int i = 0; i < 5 * 512 * 1024 + 3; ++i) {
+            bundle.put(static_cast<char>(i * 13 + (i >> 16)));
+        }
+    }
+
+    auto path = testDir->path() / "large.uab";
+    std::filesystem::copy_file("/proc/self/exe", path);
+    auto elf = ElfHandler::create(path);
+    ASSERT_TRUE(elf.has_value());
+
+    api::types::v1::UabMetaInfo meta;
+    meta.version = api::types::v1::Version::The1;
+    meta.uuid = "b2f33c7b-615c-4d7d-9181-e1a22010a749";
+    auto ret = addBundleSection(**elf, bundleFile, "linglong.bundle", meta);
+    ASSERT_TRUE(ret.has_value()) << ret.error().message();
+    EXPECT_EQ(meta.sections.bundle, "linglong.bundle");
+    ASSERT_TRUE(meta.merkleTree.has_value());
+    EXPECT_EQ(meta.merkleTree->leaves.size(), 3);
+
+    QFile bundle{ bundleFile.c_str() };
+    ASSERT_TRUE(bundle.open(QIODevice::ReadOnly | QIODevice::ExistingOnly));
+    QCryptographicHash cryptor{ QCryptographicHash::Sha256 };
+    ASSERT_TRUE(cryptor.addData(&bundle));
+    EXPECT_EQ(meta.digest, cryptor.result().toHex().toStdString());
+
+    auto metaFile = testDir->path() / "large.json";
+    std::ofstream(metaFile) << nlohmann::json(meta).dump();
+    ASSERT_TRUE((*elf)->addSection("linglong.meta", metaFile).has_value());
+
+    auto uab = MockUabFile(path.string());
+    auto verifyRet = uab.verify();
+    ASSERT_TRUE(verifyRet.has_value()) << verifyRet.error().message();
+    EXPECT_TRUE(*verifyRet);
+}
+
+TEST_F(UabFileTest, Delta)
+{
+    // the runtime part of both bundles is the same, the app part is changed and grows
+    auto createUab = [](const std::string &name, int appVersion, int appBlocks) {
+        auto bundleFile = testDir->path() / (name + ".bundle");
+        {
+            std::ofstream bundle(bundleFile, std::ios::binary);
+            for (int i = 0; i < 64 * 4096; ++i) {
+                bundle.put(static_cast<char>(i * 13 + (i >> 12)));
+            }
+            for (int i = 0; i < appBlocks * 4096; ++i) {
+                bundle.put(static_cast<char>(i * appVersion));
+            }
+        }
+
+        return createUab(name, bundleFile, std::to_string(appVersion));
+    };
+
+    auto oldPath = createUab("delta-old", 3, 4);
+    auto newPath = createUab("delta-new", 5, 6);
+    auto delta = testDir->path() / "delta";
+
+    auto oldFile = MockUabFile(oldPath.string());
+    auto newFile = MockUabFile(newPath.string());
+    auto stat = oldFile.createDelta(newFile, delta);
+    ASSERT_TRUE(stat.has_value()) << stat.error().message();
+    EXPECT_EQ(stat->copied + stat->stored, std::filesystem::file_size(newPath));
+    // at least the runtime part is copied
+    EXPECT_GE(stat->copied, 64 * 4096);
+    EXPECT_LT(std::filesystem::file_size(delta), std::filesystem::file_size(newPath));
+
+    auto output = testDir->path() / "delta-applied.uab";
+    auto applied = oldFile.applyDelta(delta, output);
+    ASSERT_TRUE(applied.has_value()) << applied.error().message();
+    auto meta = (*applied)->getMetaInfo();
+    ASSERT_TRUE(meta.has_value()) << meta.error().message();
+    EXPECT_EQ(meta->get().layers.front().info.version, "5");
+
+    EXPECT_TRUE(sameContent(newPath, output));
+
+    // the delta can't be applied to another file
+    std::filesystem::remove(output);
+    auto other = MockUabFile(newPath.string());
+    EXPECT_FALSE(other.applyDelta(delta, output).has_value());
+    EXPECT_FALSE(std::filesystem::exists(output));
+
+    // a corrupted delta is detected
+    {
+        std::fstream file(delta, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-2, std::ios::end);
+        file.put('\x7f');
+    }
+    EXPECT_FALSE(oldFile.applyDelta(delta, output).has_value());
+    EXPECT_FALSE(std::filesystem::exists(output));
+
+    // nor is the temporary file left
+    for (const auto &entry : std::filesystem::directory_iterator(testDir->path())) {
+        EXPECT_NE(entry.path().filename().string().rfind(".delta-applied.uab.", 0), 0)
+          << entry.path();
+    }
+}
+
+TEST_F(UabFileTest, DeltaOfImages)
+{
+    if (!utils::Cmd("mkfs.erofs").exists()) {
+        GTEST_SKIP() << "mkfs.erofs is required";
+    }
+
+    // the bundles differ by one file of the app
+    auto createImageUab = [](const std::string &name, char appContent, const std::string &version) {
+        auto bundleDir = testDir->path() / (name + ".dir");
+        auto libDir = bundleDir / "layers" / "runtime" / "binary" / "files" / "lib";
+        auto binDir = bundleDir / "layers" / "hello" / "binary" / "files" / "bin";
+        std::filesystem::create_directories(libDir);
+        std::filesystem::create_directories(binDir);
+        {
+            std::ofstream lib(libDir / "libruntime.so", std::ios::binary);
+            for (int i = 0; i < 256 * 4096; ++i) {
+                lib.put(static_cast<char>(i * 13 + (i >> 12)));
+            }
+        }
+        std::ofstream(binDir / "hello", std::ios::binary) << std::string(4096, appContent);
+        std::ofstream(binDir / "README") << "hello";
+
+        // the timestamps and the uuid are fixed, so the images only differ in the changed file
+        auto bundleFile = testDir->path() / (name + ".erofs");
+        auto ret = utils::Cmd("mkfs.erofs")
+                     .exec({ "-T0",
+                             "-U6e1f3a52-0c4d-4b8e-9a7f-2d5c8b1e0f34",
+                             "--all-root",
+                             bundleFile.string(),
+                             bundleDir.string() });
+        EXPECT_TRUE(ret.has_value()) << ret.error().message();
+        return createUab(name, bundleFile, version);
+    };
+
+    auto oldPath = createImageUab("image-delta-old", 'a', "1");
+    auto newPath = createImageUab("image-delta-new", 'b', "2");
+    auto delta = testDir->path() / "image-delta";
+
+    auto oldFile = MockUabFile(oldPath.string());
+    auto newFile = MockUabFile(newPath.string());
+    auto stat = oldFile.createDelta(newFile, delta);
+    ASSERT_TRUE(stat.has_value()) << stat.error().message();
+    EXPECT_EQ(stat->copied + stat->stored, std::filesystem::file_size(newPath));
+    // blocks of the delta are aligned to the image, only the block of the changed file is stored
+    // from the image. the rest of the UAB which isn't in the test binary, i.e. the padding before
+    // the image, the meta info and the section headers, may be stored as a whole, plus the blocks
+    // it shares with the image
+    auto imageSize = std::filesystem::file_size(testDir->path() / "image-delta-new.erofs");
+    auto tail = std::filesystem::file_size(newPath) - std::filesystem::file_size("/proc/self/exe")
+      - imageSize;
+    EXPECT_GE(stat->stored, uab_delta_block_size);
+    EXPECT_LE(stat->stored, 3 * uab_delta_block_size + tail);
+    EXPECT_LT(stat->stored, imageSize / 16);
+
+    auto output = testDir->path() / "image-delta-applied.uab";
+    auto applied = oldFile.applyDelta(delta, output);
+    ASSERT_TRUE(applied.has_value()) << applied.error().message();
+    EXPECT_TRUE(sameContent(newPath, output));
+
+    auto unpacked = (*applied)->unpack();
+    ASSERT_TRUE(unpacked.has_value()) << unpacked.error().message();
+    std::ifstream hello(*unpacked / "layers" / "hello" / "binary" / "files" / "bin" / "hello");
+    std::stringstream content;
+    content << hello.rdbuf();
+    EXPECT_EQ(content.str(), std::string(4096, 'b'));
+}
+
 TEST_F(UabFileTest, ExtractSignData)
 {
     auto uab = MockUabFile(uabFile);
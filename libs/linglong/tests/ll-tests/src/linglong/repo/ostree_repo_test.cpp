@@ -7,8 +7,12 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include "../../common/erofs_image.h"
 #include "../../common/tempdir.h"
 #include "../mocks/ostree_repo_mock.h"
+#include "linglong/api/types/v1/Generators.hpp"
+#include "linglong/package/erofs_image.h"
+#include "linglong/package/layer_image.h"
 #include "linglong/package/reference.h"
 #include "linglong/repo/client_factory.h"
 #include "linglong/repo/config.h"
@@ -22,6 +26,9 @@
 #include <memory>
 #include <string>
 
+#include <fcntl.h>
+#include <unistd.h>
+
 namespace linglong::repo::test {
 
 namespace fs = std::filesystem;
@@ -186,6 +193,42 @@ TEST_F(RepoTest, loadFromPathFailsWhenCacheIsMissingButCreateCanRepairIt)
     EXPECT_TRUE(fs::exists(repoRoot / "states.json"));
 }
 
+TEST_F(RepoTest, importLayerImageRefusesLoopedDirectory)
+{
+    TempDir tempDir;
+    ASSERT_TRUE(tempDir.isValid());
+
+    auto repoRoot = tempDir.path() / "repo-root";
+    ASSERT_TRUE(fs::create_directories(repoRoot));
+    auto repo = OSTreeRepo::create(repoRoot, createRepoConfig());
+    ASSERT_TRUE(repo.has_value()) << repo.error().message();
+
+    // files/up links back to the root of the layer
+    auto info = api::types::v1::PackageInfoV2{
+        .arch = std::vector<std::string>{ "x86_64" },
+        .base = "main:org.deepin.base/23.1.0/x86_64",
+        .channel = "main",
+        .id = "org.example.looped",
+        .kind = "app",
+        .packageInfoV2Module = "binary",
+        .name = "looped",
+        .schemaVersion = "1.0",
+        .size = 0,
+        .version = "1.0.0.0",
+    };
+    auto path = tempDir.path() / "looped.erofs";
+    ASSERT_TRUE(writeLoopedErofsImage(path, nlohmann::json(info).dump()));
+
+    auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_NE(fd, -1);
+    auto image = package::ErofsImage::open(fd);
+    ::close(fd);
+    ASSERT_TRUE(image.has_value()) << image.error().message();
+
+    auto imported = (*repo)->importLayerImage(package::LayerImage{ **image });
+    EXPECT_FALSE(imported.has_value());
+}
+
 TEST_F(RepoTest, exportDir)
 {
     // 准备测试环境
@@ -0,0 +1,207 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "../../common/tempdir.h"
+#include "linglong/api/types/v1/Generators.hpp"
+#include "linglong/runtime/container_registry.h"
+
+#include <array>
+#include <fstream>
+#include <tuple>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace linglong;
+
+namespace {
+
+using ContainerRegistry = linglong::runtime::ContainerRegistry;
+
+constexpr uid_t testUid = 1000;
+
+class ContainerRegistryTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        tempDir = std::make_unique<TempDir>();
+        ASSERT_TRUE(tempDir->isValid());
+        info.app = "main:org.example.app/1.0.0/x86_64";
+        info.base = "main:org.deepin.base/23.0.0/x86_64";
+        info.containerID = "0123456789abcdef";
+    }
+
+    void writeLegacyEntry(pid_t pid)
+    {
+        auto dir = tempDir->path() / std::to_string(testUid);
+        std::filesystem::create_directories(dir);
+        std::ofstream(dir / std::to_string(pid)) << nlohmann::json(info).dump();
+    }
+
+    std::unique_ptr<TempDir> tempDir;
+    api::types::v1::ContainerProcessStateInfo info;
+};
+
+TEST_F(ContainerRegistryTest, ListedAfterUpdate)
+{
+    ContainerRegistry registry(tempDir->path());
+    auto entry = registry.create(testUid);
+    ASSERT_TRUE(entry.has_value()) << entry.error().message();
+    EXPECT_EQ(entry->path(), tempDir->path() / std::to_string(testUid) / std::to_string(getpid()));
+
+    // the entry is empty until its container is started
+    auto listed = registry.list(testUid);
+    ASSERT_TRUE(listed.has_value()) << listed.error().message();
+    EXPECT_TRUE(listed->empty());
+
+    ASSERT_TRUE(entry->update(info).has_value());
+    listed = registry.list(testUid);
+    ASSERT_TRUE(listed.has_value()) << listed.error().message();
+    ASSERT_EQ(listed->size(), 1);
+    EXPECT_EQ(listed->front().owner, getpid());
+    EXPECT_EQ(listed->front().uid, testUid);
+    EXPECT_EQ(listed->front().info.containerID, info.containerID);
+    EXPECT_EQ(listed->front().info.app, info.app);
+
+    // a shorter state must not leave the tail of the former one
+    info.app = "a";
+    ASSERT_TRUE(entry->update(info).has_value());
+    listed = registry.list();
+    ASSERT_TRUE(listed.has_value()) << listed.error().message();
+    ASSERT_EQ(listed->size(), 1);
+    EXPECT_EQ(listed->front().info.app, "a");
+}
+
+TEST_F(ContainerRegistryTest, RemovedWithEntry)
+{
+    ContainerRegistry registry(tempDir->path());
+    std::filesystem::path path;
+    {
+        auto entry = registry.create(testUid);
+        ASSERT_TRUE(entry.has_value()) << entry.error().message();
+        ASSERT_TRUE(entry->update(info).has_value());
+        path = entry->path();
+        EXPECT_TRUE(std::filesystem::exists(path));
+    }
+
+    EXPECT_FALSE(std::filesystem::exists(path));
+    auto listed = registry.list(testUid);
+    ASSERT_TRUE(listed.has_value()) << listed.error().message();
+    EXPECT_TRUE(listed->empty());
+}
+
+TEST_F(ContainerRegistryTest, LivenessFollowsOwnerProcess)
+{
+    ContainerRegistry registry(tempDir->path());
+
+    std::array<int, 2> fds{};
+    ASSERT_EQ(::pipe(fds.data()), 0);
+    auto child = ::fork();
+    ASSERT_NE(child, -1);
+    if (child == 0) {
+        ::close(fds[0]);
+        auto entry = registry.create(testUid);
+        if (!entry || !entry->update(info)) {
+            ::_exit(1);
+        }
+        // the entry is left behind as if the owner is killed
+        std::ignore = ::write(fds[1], "x", 1);
+        ::pause();
+        ::_exit(0);
+    }
+
+    ::close(fds[1]);
+    char c{};
+    ASSERT_EQ(::read(fds[0], &c, 1), 1);
+    ::close(fds[0]);
+
+    auto listed = registry.list(testUid);
+    ASSERT_TRUE(listed.has_value()) << listed.error().message();
+    ASSERT_EQ(listed->size(), 1);
+    EXPECT_EQ(listed->front().owner, child);
+
+    ::kill(child, SIGKILL);
+    ::waitpid(child, nullptr, 0);
+
+    auto entryPath = tempDir->path() / std::to_string(testUid) / std::to_string(child);
+    EXPECT_TRUE(std::filesystem::exists(entryPath));
+    listed = registry.list(testUid);
+    ASSERT_TRUE(listed.has_value()) << listed.error().message();
+    EXPECT_TRUE(listed->empty());
+    // stale entries are cleaned up
+    EXPECT_FALSE(std::filesystem::exists(entryPath));
+}
+
+TEST_F(ContainerRegistryTest, LegacyEntryOfLivingProcess)
+{
+    // entries written by former versions are not locked, they are checked through /proc
+    writeLegacyEntry(getpid());
+
+    ContainerRegistry registry(tempDir->path());
+    auto listed = registry.list();
+    ASSERT_TRUE(listed.has_value()) << listed.error().message();
+    ASSERT_EQ(listed->size(), 1);
+    EXPECT_EQ(listed->front().info.containerID, info.containerID);
+}
+
+TEST_F(ContainerRegistryTest, OwnedEntryIsNotReplaced)
+{
+    ContainerRegistry registry(tempDir->path());
+    auto entry = registry.create(testUid);
+    ASSERT_TRUE(entry.has_value()) << entry.error().message();
+
+    auto another = registry.create(testUid);
+    EXPECT_FALSE(another.has_value());
+    EXPECT_TRUE(std::filesystem::exists(entry->path()));
+}
+
+TEST_F(ContainerRegistryTest, ContainerPid)
+{
+    auto bundle = tempDir->path() / "bundle";
+    std::filesystem::create_directories(bundle);
+    EXPECT_FALSE(ContainerRegistry::containerPid(bundle).has_value());
+
+    std::ofstream(ContainerRegistry::containerPidFile(bundle)) << "1234\n";
+    auto pid = ContainerRegistry::containerPid(bundle);
+    ASSERT_TRUE(pid.has_value());
+    EXPECT_EQ(*pid, 1234);
+
+    std::ofstream(ContainerRegistry::containerPidFile(bundle)) << "invalid";
+    EXPECT_FALSE(ContainerRegistry::containerPid(bundle).has_value());
+}
+
+TEST_F(ContainerRegistryTest, SavedContainerPid)
+{
+    auto bundle = tempDir->path() / "bundle";
+    std::filesystem::create_directories(bundle);
+
+    ASSERT_TRUE(ContainerRegistry::saveContainerPid(bundle, 1234).has_value());
+    EXPECT_EQ(ContainerRegistry::containerPid(bundle), 1234);
+    EXPECT_FALSE(std::filesystem::exists(ContainerRegistry::containerPidFile(bundle).string()
+                                         + ".tmp"));
+
+    // the bundle is removed when the container exits
+    EXPECT_FALSE(
+      ContainerRegistry::saveContainerPid(tempDir->path() / "removed", 1234).has_value());
+}
+
+TEST(ContainerRegistryPidFileTest, OnlyPassedToSupportedRuntimes)
+{
+    std::filesystem::path bundle = "/run/user/1000/linglong/bundle";
+
+    // ll-box, the default runtime, doesn't accept --pid-file
+    EXPECT_TRUE(ContainerRegistry::containerPidFileOptions("/usr/bin/ll-box", bundle).empty());
+    EXPECT_TRUE(ContainerRegistry::containerPidFileOptions("ll-box", bundle).empty());
+
+    auto expected =
+      std::vector<std::string>{ "--pid-file=/run/user/1000/linglong/bundle/container.pid" };
+    EXPECT_EQ(ContainerRegistry::containerPidFileOptions("/usr/bin/crun", bundle), expected);
+    EXPECT_EQ(ContainerRegistry::containerPidFileOptions("/usr/sbin/runc", bundle), expected);
+}
+
+} // namespace
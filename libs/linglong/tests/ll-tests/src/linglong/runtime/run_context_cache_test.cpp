@@ -0,0 +1,190 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "../../common/tempdir.h"
+#include "linglong/repo/ostree_repo.h"
+#include "linglong/runtime/run_context_cache.h"
+
+#include <fstream>
+
+using namespace linglong;
+
+namespace {
+
+using RunContextCache = linglong::runtime::RunContextCache;
+using ResolveOptions = linglong::runtime::ResolveOptions;
+
+class StubRepo : public repo::OSTreeRepo
+{
+public:
+    explicit StubRepo(const std::filesystem::path &path)
+        : repo::OSTreeRepo(
+            path, api::types::v1::RepoConfigV2{ .defaultRepo = "", .repos = {}, .version = 2 })
+    {
+    }
+};
+
+class RunContextCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        tempDir = std::make_unique<TempDir>();
+        ASSERT_TRUE(tempDir->isValid());
+        repo = std::make_unique<StubRepo>(tempDir->path());
+        writeStates("{}");
+
+        auto ref = package::Reference::parse("stable:org.example.app/1.0.0/x86_64");
+        ASSERT_TRUE(ref.has_value()) << ref.error().message();
+        appRef = std::move(ref).value();
+
+        config.version = "1";
+        config.base = "stable:org.deepin.base/23.0.0/x86_64";
+        config.app = appRef->toString();
+        config.timezone = "UTC";
+    }
+
+    void TearDown() override
+    {
+        repo.reset();
+        tempDir.reset();
+    }
+
+    void writeStates(const std::string &content)
+    {
+        std::ofstream ofs(repo->cacheFilePath());
+        ofs << content;
+    }
+
+    std::unique_ptr<TempDir> tempDir;
+    std::unique_ptr<StubRepo> repo;
+    std::optional<package::Reference> appRef;
+    api::types::v1::RunContextConfig config;
+};
+
+TEST_F(RunContextCacheTest, missWhenEmpty)
+{
+    RunContextCache cache(tempDir->path() / "cache");
+
+    auto loaded = cache.load(*repo, *appRef, ResolveOptions{});
+    ASSERT_TRUE(loaded.has_value()) << loaded.error().message();
+    EXPECT_FALSE(loaded->has_value());
+}
+
+TEST_F(RunContextCacheTest, saveThenLoad)
+{
+    RunContextCache cache(tempDir->path() / "cache");
+    ResolveOptions opts;
+
+    auto saved = cache.save(*repo, *appRef, opts, config);
+    ASSERT_TRUE(saved.has_value()) << saved.error().message();
+
+    auto loaded = cache.load(*repo, *appRef, opts);
+    ASSERT_TRUE(loaded.has_value()) << loaded.error().message();
+    ASSERT_TRUE(loaded->has_value());
+    EXPECT_EQ((*loaded)->app, config.app);
+    EXPECT_EQ((*loaded)->base, config.base);
+    EXPECT_EQ((*loaded)->timezone, config.timezone);
+}
+
+TEST_F(RunContextCacheTest, invalidatedByRepoCacheChange)
+{
+    RunContextCache cache(tempDir->path() / "cache");
+    ResolveOptions opts;
+
+    ASSERT_TRUE(cache.save(*repo, *appRef, opts, config).has_value());
+
+    // states.json is replaced by rename on update, emulate it
+    auto tmp = tempDir->path() / "temp-states.json";
+    {
+        std::ofstream ofs(tmp);
+        ofs << R"({"layers":[]})";
+    }
+    std::filesystem::rename(tmp, repo->cacheFilePath());
+
+    auto loaded = cache.load(*repo, *appRef, opts);
+    ASSERT_TRUE(loaded.has_value()) << loaded.error().message();
+    EXPECT_FALSE(loaded->has_value());
+}
+
+TEST_F(RunContextCacheTest, keyedByOptions)
+{
+    RunContextCache cache(tempDir->path() / "cache");
+    ResolveOptions opts;
+
+    ASSERT_TRUE(cache.save(*repo, *appRef, opts, config).has_value());
+
+    ResolveOptions other;
+    other.extensionRefs = std::vector<std::string>{ "org.example.ext" };
+    auto loaded = cache.load(*repo, *appRef, other);
+    ASSERT_TRUE(loaded.has_value()) << loaded.error().message();
+    EXPECT_FALSE(loaded->has_value());
+
+    other = ResolveOptions{};
+    other.instance = "second";
+    loaded = cache.load(*repo, *appRef, other);
+    ASSERT_TRUE(loaded.has_value()) << loaded.error().message();
+    EXPECT_FALSE(loaded->has_value());
+}
+
+TEST_F(RunContextCacheTest, removeEntry)
+{
+    RunContextCache cache(tempDir->path() / "cache");
+    ResolveOptions opts;
+
+    ASSERT_TRUE(cache.save(*repo, *appRef, opts, config).has_value());
+    ASSERT_TRUE(cache.remove(*appRef, opts).has_value());
+
+    auto loaded = cache.load(*repo, *appRef, opts);
+    ASSERT_TRUE(loaded.has_value()) << loaded.error().message();
+    EXPECT_FALSE(loaded->has_value());
+}
+
+TEST_F(RunContextCacheTest, corruptedEntryIsError)
+{
+    RunContextCache cache(tempDir->path() / "cache");
+    ResolveOptions opts;
+
+    ASSERT_TRUE(cache.save(*repo, *appRef, opts, config).has_value());
+    for (const auto &entry : std::filesystem::directory_iterator(cache.path())) {
+        std::ofstream ofs(entry.path(), std::ios::trunc);
+        ofs << "not json";
+    }
+
+    auto loaded = cache.load(*repo, *appRef, opts);
+    EXPECT_FALSE(loaded.has_value());
+}
+
+TEST_F(RunContextCacheTest, moduleSelectionIsNotCacheable)
+{
+    ResolveOptions opts;
+    EXPECT_TRUE(RunContextCache::cacheable(opts));
+
+    opts.appModules = std::vector<std::string>{ "binary", "develop" };
+    EXPECT_FALSE(RunContextCache::cacheable(opts));
+
+    opts = ResolveOptions{};
+    opts.depsExcludeDev = true;
+    EXPECT_FALSE(RunContextCache::cacheable(opts));
+}
+
+TEST_F(RunContextCacheTest, externalExtensionsAreNotCacheable)
+{
+    ResolveOptions opts;
+    opts.externalExtensionDefs =
+      std::map<std::string, std::vector<api::types::v1::ExtensionDefine>>{ { "org.example.app",
+                                                                            {} } };
+    EXPECT_TRUE(RunContextCache::cacheable(opts));
+
+    api::types::v1::ExtensionDefine define;
+    define.name = "org.example.ext";
+    define.directory = "/opt/extensions/org.example.ext";
+    define.allowEnv = std::map<std::string, std::string>{ { "EXT_PATH", "/usr" } };
+    (*opts.externalExtensionDefs)["org.example.app"].push_back(define);
+    EXPECT_FALSE(RunContextCache::cacheable(opts));
+}
+
+} // namespace
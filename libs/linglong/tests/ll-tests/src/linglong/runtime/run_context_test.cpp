@@ -11,6 +11,7 @@
 #include "linglong/package/fuzzy_reference.h"
 #include "linglong/repo/ostree_repo.h"
 #include "linglong/runtime/run_context.h"
+#include "linglong/runtime/run_context_cache.h"
 
 #include <QCryptographicHash>
 #include <QFile>
@@ -19,6 +20,7 @@
 
 using namespace linglong;
 using ::testing::AtLeast;
+using ::testing::Invoke;
 using ::testing::Return;
 
 namespace {
@@ -1155,4 +1157,150 @@ TEST(ResolveOptionsTest, ApplyCliRunOptionsSkipsEmptyExtensions)
     EXPECT_FALSE(opts.extensionRefs.has_value());
 }
 
+// the extensions of a context and their defines, to compare contexts
+std::vector<std::string> extensionsOf(const RunContext &context)
+{
+    std::vector<std::string> result;
+    for (const auto &layer : context.getExtensionLayers()) {
+        const auto &info = layer.getExtensionInfo();
+        if (!info) {
+            result.emplace_back(layer.getReference().toString());
+            continue;
+        }
+
+        std::string allowEnv;
+        for (const auto &[key, value] : info->extensionInfo.allowEnv.value_or(
+               std::map<std::string, std::string>{})) {
+            allowEnv += key + "=" + value + ";";
+        }
+        result.emplace_back(fmt::format("{} for {} at {} allow {}",
+                                        layer.getReference().toString(),
+                                        info->forRef,
+                                        info->extensionInfo.directory,
+                                        allowEnv));
+    }
+    return result;
+}
+
+class RunContextCacheEquivalenceTest : public RunContextTest
+{
+protected:
+    void SetUp() override
+    {
+        RunContextTest::SetUp();
+
+        appRef = *package::Reference::parse("stable:org.example.app/1.0.0/x86_64");
+        baseRef = *package::Reference::parse("stable:org.deepin.base/23.0.0/x86_64");
+        extensionRef = *package::Reference::parse("stable:org.example.extension/1.0.0/x86_64");
+
+        appItem.info.id = "org.example.app";
+        appItem.info.version = "1.0.0";
+        appItem.info.kind = "app";
+        appItem.info.channel = "stable";
+        appItem.info.arch = { std::string{ "x86_64" } };
+        appItem.info.base = "org.deepin.base/23.0.0";
+
+        baseItem.info.id = "org.deepin.base";
+        baseItem.info.version = "23.0.0";
+        baseItem.info.kind = "base";
+        baseItem.info.channel = "stable";
+        baseItem.info.arch = { std::string{ "x86_64" } };
+
+        extensionItem.info.id = "org.example.extension";
+        extensionItem.info.version = "1.0.0";
+        extensionItem.info.kind = "extension";
+        extensionItem.info.channel = "stable";
+        extensionItem.info.arch = { std::string{ "x86_64" } };
+
+        extensionDefine.name = "org.example.extension";
+        extensionDefine.directory = "/opt/extensions/org.example.extension";
+        extensionDefine.allowEnv = std::map<std::string, std::string>{ { "EXT_PATH", "/usr" } };
+    }
+
+    // the repo is resolved any number of times, both by cold resolves and cached ones
+    void expectRepo()
+    {
+        using LayerItem = api::types::v1::RepositoryCacheLayersItem;
+        EXPECT_CALL(*repo, getLayerItem(testing::_, testing::_, testing::_))
+          .WillRepeatedly(Invoke([this](const package::Reference &ref,
+                                        const std::string &,
+                                        const std::optional<std::string> &)
+                                   -> utils::error::Result<LayerItem> {
+              if (ref == *appRef) {
+                  return appItem;
+              }
+              if (ref == *baseRef) {
+                  return baseItem;
+              }
+              return extensionItem;
+          }));
+        EXPECT_CALL(*repo, clearReferenceLocal(testing::_, testing::_))
+          .WillRepeatedly(Invoke([this](const package::FuzzyReference &fuzzy,
+                                        bool) -> utils::error::Result<package::Reference> {
+              if (fuzzy.id == baseRef->id) {
+                  return *baseRef;
+              }
+              return *extensionRef;
+          }));
+        package::LayerDir mockLayerDir(tempDir->path() / "merged");
+        EXPECT_CALL(*repo, getMergedModuleDir(testing::_, testing::_, testing::_))
+          .WillRepeatedly(Return(utils::error::Result<package::LayerDir>(mockLayerDir)));
+    }
+
+    std::optional<package::Reference> appRef;
+    std::optional<package::Reference> baseRef;
+    std::optional<package::Reference> extensionRef;
+    api::types::v1::RepositoryCacheLayersItem appItem;
+    api::types::v1::RepositoryCacheLayersItem baseItem;
+    api::types::v1::RepositoryCacheLayersItem extensionItem;
+    api::types::v1::ExtensionDefine extensionDefine;
+};
+
+TEST_F(RunContextCacheEquivalenceTest, cachedContextIsTheSame)
+{
+    appItem.info.extensions = std::vector<api::types::v1::ExtensionDefine>{ extensionDefine };
+    expectRepo();
+
+    RunContext cold(*this->repo);
+    ASSERT_TRUE(cold.resolve(*appRef));
+
+    runtime::RunContextCache cache(tempDir->path() / "run-context");
+    auto first = runtime::resolveRunContext(*this->repo, *appRef, ResolveOptions{}, &cache);
+    ASSERT_TRUE(first) << first.error().message();
+    auto cached = cache.load(*this->repo, *appRef, ResolveOptions{});
+    ASSERT_TRUE(cached && cached->has_value());
+
+    auto second = runtime::resolveRunContext(*this->repo, *appRef, ResolveOptions{}, &cache);
+    ASSERT_TRUE(second) << second.error().message();
+    EXPECT_EQ(extensionsOf(**second), extensionsOf(cold));
+    EXPECT_EQ((*second)->getConfig().extensions, cold.getConfig().extensions);
+    EXPECT_FALSE(extensionsOf(cold).empty());
+}
+
+TEST_F(RunContextCacheEquivalenceTest, externalExtensionsAreResolvedEveryTime)
+{
+    expectRepo();
+    ResolveOptions opts;
+    opts.externalExtensionDefs =
+      std::map<std::string, std::vector<api::types::v1::ExtensionDefine>>{
+          { "org.example.app", { extensionDefine } }
+      };
+
+    RunContext cold(*this->repo);
+    ASSERT_TRUE(cold.resolve(*appRef, opts));
+    ASSERT_FALSE(extensionsOf(cold).empty());
+
+    runtime::RunContextCache cache(tempDir->path() / "run-context");
+    for (int i = 0; i < 2; ++i) {
+        auto context = runtime::resolveRunContext(*this->repo, *appRef, opts, &cache);
+        ASSERT_TRUE(context) << context.error().message();
+        EXPECT_EQ(extensionsOf(**context), extensionsOf(cold));
+    }
+
+    // the directory and allowEnv of external extensions can't be restored from a cached config
+    auto cached = cache.load(*this->repo, *appRef, opts);
+    ASSERT_TRUE(cached) << cached.error().message();
+    EXPECT_FALSE(cached->has_value());
+}
+
 } // namespace
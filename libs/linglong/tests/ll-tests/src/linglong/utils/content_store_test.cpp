@@ -0,0 +1,132 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "../../common/tempdir.h"
+#include "linglong/utils/content_store.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+class ContentStoreTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        tempDir = std::make_unique<TempDir>();
+        ASSERT_TRUE(tempDir->isValid());
+        std::filesystem::create_directories(tempDir->path() / "bundle");
+        std::filesystem::create_directories(tempDir->path() / "a");
+        std::filesystem::create_directories(tempDir->path() / "b");
+    }
+
+    std::filesystem::path source(const std::string &name,
+                                 const std::string &content,
+                                 std::filesystem::perms perms = std::filesystem::perms(0644))
+    {
+        auto path = tempDir->path() / "bundle" / name;
+        std::ofstream(path) << content;
+        std::filesystem::permissions(path, perms);
+        return path;
+    }
+
+    static struct stat status(const std::filesystem::path &path)
+    {
+        struct stat st{};
+        EXPECT_EQ(::stat(path.c_str(), &st), 0);
+        return st;
+    }
+
+    static std::string read(const std::filesystem::path &path)
+    {
+        std::ifstream in(path);
+        std::stringstream content;
+        content << in.rdbuf();
+        return content.str();
+    }
+
+    std::unique_ptr<TempDir> tempDir;
+};
+
+TEST_F(ContentStoreTest, SameContentIsShared)
+{
+    digest::ContentStore store(tempDir->path() / "store");
+    auto lib = source("libQt.so", "qt");
+
+    bool shared{ true };
+    ASSERT_TRUE(store.checkout(lib, tempDir->path() / "a" / "libQt.so", &shared));
+    EXPECT_FALSE(shared);
+    ASSERT_TRUE(store.checkout(lib, tempDir->path() / "b" / "libQt.so", &shared));
+    EXPECT_TRUE(shared);
+
+    auto a = status(tempDir->path() / "a" / "libQt.so");
+    auto b = status(tempDir->path() / "b" / "libQt.so");
+    EXPECT_EQ(a.st_ino, b.st_ino);
+    EXPECT_EQ(a.st_nlink, 3);
+    EXPECT_EQ(read(tempDir->path() / "b" / "libQt.so"), "qt");
+    // objects are read-only
+    EXPECT_EQ(a.st_mode & 07777, 0444);
+
+    auto usage = store.usage();
+    EXPECT_EQ(usage.objects, 1);
+    EXPECT_EQ(usage.size, 2);
+    EXPECT_EQ(usage.logicalSize, 4);
+    EXPECT_EQ(usage.unreferenced, 0);
+}
+
+TEST_F(ContentStoreTest, ModeIsPartOfTheKey)
+{
+    digest::ContentStore store(tempDir->path() / "store");
+    ASSERT_TRUE(store.checkout(source("data", "same"), tempDir->path() / "a" / "data"));
+    ASSERT_TRUE(store.checkout(source("exec", "same", std::filesystem::perms(0755)),
+                               tempDir->path() / "a" / "exec"));
+
+    EXPECT_NE(status(tempDir->path() / "a" / "data").st_ino,
+              status(tempDir->path() / "a" / "exec").st_ino);
+    EXPECT_EQ(status(tempDir->path() / "a" / "exec").st_mode & 07777, 0555);
+    EXPECT_EQ(store.usage().objects, 2);
+}
+
+TEST_F(ContentStoreTest, SpecialBitsAreDropped)
+{
+    digest::ContentStore store(tempDir->path() / "store");
+    ASSERT_TRUE(store.checkout(source("setuid", "same", std::filesystem::perms(06755)),
+                               tempDir->path() / "a" / "setuid"));
+    ASSERT_TRUE(store.checkout(source("exec", "same", std::filesystem::perms(0755)),
+                               tempDir->path() / "a" / "exec"));
+
+    EXPECT_EQ(status(tempDir->path() / "a" / "setuid").st_mode & 07777, 0555);
+    EXPECT_EQ(status(tempDir->path() / "a" / "setuid").st_ino,
+              status(tempDir->path() / "a" / "exec").st_ino);
+    EXPECT_EQ(store.usage().objects, 1);
+}
+
+TEST_F(ContentStoreTest, PruneUnreferencedObjects)
+{
+    digest::ContentStore store(tempDir->path() / "store");
+    ASSERT_TRUE(store.checkout(source("kept", "kept"), tempDir->path() / "a" / "kept"));
+    ASSERT_TRUE(store.checkout(source("removed", "removed"), tempDir->path() / "b" / "removed"));
+    std::filesystem::remove_all(tempDir->path() / "b");
+
+    EXPECT_EQ(store.usage().unreferenced, 1);
+    store.prune();
+
+    auto usage = store.usage();
+    EXPECT_EQ(usage.objects, 1);
+    EXPECT_EQ(usage.unreferenced, 0);
+    EXPECT_EQ(read(tempDir->path() / "a" / "kept"), "kept");
+}
+
+TEST_F(ContentStoreTest, OnlyRegularFiles)
+{
+    digest::ContentStore store(tempDir->path() / "store");
+    EXPECT_FALSE(store.checkout(tempDir->path() / "bundle", tempDir->path() / "a" / "dir"));
+    EXPECT_FALSE(store.checkout(tempDir->path() / "missing", tempDir->path() / "a" / "missing"));
+    EXPECT_EQ(store.usage().objects, 0);
+}
+
+} // namespace
@@ -0,0 +1,128 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "../../common/tempdir.h"
+#include "linglong/utils/digest_cache.h"
+
+#include <array>
+#include <fstream>
+#include <thread>
+
+namespace {
+
+constexpr auto digest = "0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef";
+
+class VerifiedCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        tempDir = std::make_unique<TempDir>();
+        ASSERT_TRUE(tempDir->isValid());
+        file = tempDir->path() / "app.uab";
+        std::ofstream(file) << "header|bundle|tail";
+    }
+
+    struct stat status() const
+    {
+        struct stat st{};
+        EXPECT_EQ(::stat(file.c_str(), &st), 0);
+        return st;
+    }
+
+    // verified files aren't recorded within the racy window, it's disabled for most tests, wait
+    // for a while before changing the file, so that timestamps change even if they are coarse
+    static void waitForTick() { std::this_thread::sleep_for(std::chrono::milliseconds(50)); }
+
+    std::unique_ptr<TempDir> tempDir;
+    std::filesystem::path file;
+};
+
+TEST_F(VerifiedCacheTest, UnchangedFileHits)
+{
+    digest::VerifiedCache cache(tempDir->path() / "cache", std::chrono::nanoseconds{ 0 });
+    auto st = status();
+    EXPECT_FALSE(cache.contains(st, 7, 6, digest));
+
+    cache.insert(st, 7, 6, digest);
+    EXPECT_TRUE(cache.contains(status(), 7, 6, digest));
+    // another range or digest isn't verified
+    EXPECT_FALSE(cache.contains(status(), 0, 6, digest));
+    EXPECT_FALSE(cache.contains(status(), 7, 5, digest));
+    EXPECT_FALSE(cache.contains(status(), 7, 6, "tampered"));
+
+    // a new cache with the same directory, like the next launch
+    digest::VerifiedCache another(tempDir->path() / "cache");
+    EXPECT_TRUE(another.contains(status(), 7, 6, digest));
+}
+
+TEST_F(VerifiedCacheTest, TamperedInPlace)
+{
+    digest::VerifiedCache cache(tempDir->path() / "cache", std::chrono::nanoseconds{ 0 });
+    cache.insert(status(), 7, 6, digest);
+    ASSERT_TRUE(cache.contains(status(), 7, 6, digest));
+
+    waitForTick();
+    // the same size, and the mtime is restored
+    auto before = status();
+    {
+        std::fstream stream(file, std::ios::in | std::ios::out | std::ios::binary);
+        stream.seekp(7);
+        stream << "BUNDLE";
+    }
+    std::array<struct timespec, 2> times{ before.st_atim, before.st_mtim };
+    ASSERT_EQ(::utimensat(AT_FDCWD, file.c_str(), times.data(), 0), 0);
+
+    auto after = status();
+    EXPECT_EQ(after.st_size, before.st_size);
+    EXPECT_EQ(after.st_ino, before.st_ino);
+    EXPECT_FALSE(cache.contains(after, 7, 6, digest));
+}
+
+TEST_F(VerifiedCacheTest, TamperedByReplacing)
+{
+    digest::VerifiedCache cache(tempDir->path() / "cache", std::chrono::nanoseconds{ 0 });
+    cache.insert(status(), 7, 6, digest);
+    ASSERT_TRUE(cache.contains(status(), 7, 6, digest));
+
+    auto replacement = tempDir->path() / "replacement";
+    std::ofstream(replacement) << "header|BUNDLE|tail";
+    std::filesystem::rename(replacement, file);
+    EXPECT_FALSE(cache.contains(status(), 7, 6, digest));
+}
+
+TEST_F(VerifiedCacheTest, RecentlyChangedFileIsNotRecorded)
+{
+    // the file is just written, another write in the same tick can't be detected
+    digest::VerifiedCache cache(tempDir->path() / "cache", std::chrono::hours{ 1 });
+    cache.insert(status(), 7, 6, digest);
+    EXPECT_FALSE(cache.contains(status(), 7, 6, digest));
+}
+
+TEST_F(VerifiedCacheTest, Erase)
+{
+    digest::VerifiedCache cache(tempDir->path() / "cache", std::chrono::nanoseconds{ 0 });
+    cache.insert(status(), 7, 6, digest);
+    ASSERT_TRUE(cache.contains(status(), 7, 6, digest));
+
+    cache.erase(status());
+    EXPECT_FALSE(cache.contains(status(), 7, 6, digest));
+}
+
+TEST_F(VerifiedCacheTest, CorruptedEntry)
+{
+    auto cacheDir = tempDir->path() / "cache";
+    digest::VerifiedCache cache(cacheDir, std::chrono::nanoseconds{ 0 });
+    cache.insert(status(), 7, 6, digest);
+    ASSERT_TRUE(cache.contains(status(), 7, 6, digest));
+
+    for (const auto &entry : std::filesystem::directory_iterator(cacheDir)) {
+        std::ofstream(entry.path(), std::ios::app) << "trailing";
+    }
+    EXPECT_FALSE(cache.contains(status(), 7, 6, digest));
+}
+
+} // namespace
@@ -13,6 +13,7 @@
 #include <memory>
 #include <string>
 
+#include <fcntl.h>
 #include <unistd.h>
 
 namespace fs = std::filesystem;
@@ -599,3 +600,57 @@ TEST_F(FileTest, ConcatFile_ErrorCases)
     ASSERT_TRUE(read_empty_source.has_value()) << read_empty_source.error().message();
     EXPECT_EQ(*read_empty_source, "target content");
 }
+
+TEST_F(FileTest, CopyRange)
+{
+    // larger than the buffer of the fallback, and not aligned to blocks
+    std::string content(3 * 1024 * 1024 + 123, '\0');
+    for (std::size_t i = 0; i < content.size(); ++i) {
+        content[i] = static_cast<char>(i * 7 + (i >> 10));
+    }
+    fs::path source = dest_dir / "range_source";
+    std::ofstream(source, std::ios::binary) << content;
+
+    auto in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_NE(in, -1);
+    fs::path target = dest_dir / "range_target";
+    auto out = ::open(target.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    ASSERT_NE(out, -1);
+    ASSERT_EQ(::write(out, "head", 4), 4);
+
+    constexpr off_t offset = 4099;
+    const auto length = content.size() - offset;
+    auto ret = linglong::utils::copyRange(in, offset, out, 4, length);
+    ASSERT_TRUE(ret.has_value()) << ret.error().message();
+
+    // the file offsets are untouched
+    EXPECT_EQ(::lseek(in, 0, SEEK_CUR), 0);
+    EXPECT_EQ(::lseek(out, 0, SEEK_CUR), 4);
+    ::close(in);
+    ::close(out);
+
+    auto copied = linglong::utils::readFile(target);
+    ASSERT_TRUE(copied.has_value()) << copied.error().message();
+    EXPECT_EQ(copied->size(), length + 4);
+    EXPECT_TRUE(*copied == "head" + content.substr(offset));
+}
+
+TEST_F(FileTest, CopyRange_ErrorCases)
+{
+    fs::path source = dest_dir / "short_source";
+    std::ofstream(source, std::ios::binary) << "short";
+
+    auto in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    ASSERT_NE(in, -1);
+    auto out = ::open((dest_dir / "short_target").c_str(),
+                      O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                      0644);
+    ASSERT_NE(out, -1);
+
+    // the source is shorter than the range
+    EXPECT_FALSE(linglong::utils::copyRange(in, 0, out, 0, 100).has_value());
+    EXPECT_FALSE(linglong::utils::copyRange(-1, 0, out, 0, 5).has_value());
+    EXPECT_TRUE(linglong::utils::copyRange(in, 0, out, 0, 0).has_value());
+    ::close(in);
+    ::close(out);
+}
@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "../../common/tempdir.h"
+#include "linglong/utils/merkle.h"
+
+#include <fstream>
+#include <random>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr std::size_t leafSize = 4096;
+// a prefix and a suffix around the range, like the bundle section in an UAB
+constexpr std::size_t prefix = 100;
+constexpr std::size_t length = leafSize * 7 + 123;
+
+class MerkleTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        tempDir = std::make_unique<TempDir>();
+        ASSERT_TRUE(tempDir->isValid());
+
+        std::mt19937 gen(7);
+        content.resize(prefix + length + 50);
+        for (auto &c : content) {
+            c = static_cast<char>(gen());
+        }
+
+        file = tempDir->path() / "file";
+        std::ofstream(file, std::ios::binary) << content;
+        fd = ::open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        ASSERT_NE(fd, -1);
+    }
+
+    void TearDown() override
+    {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+
+    void tamper(std::size_t offset)
+    {
+        auto writeFd = ::open(file.c_str(), O_WRONLY | O_CLOEXEC);
+        ASSERT_NE(writeFd, -1);
+        char c = static_cast<char>(~content[offset]);
+        ASSERT_EQ(::pwrite(writeFd, &c, 1, static_cast<off_t>(offset)), 1);
+        ::close(writeFd);
+    }
+
+    std::unique_ptr<TempDir> tempDir;
+    std::filesystem::path file;
+    std::string content;
+    int fd{ -1 };
+};
+
+TEST_F(MerkleTest, LeavesAreDigestsOfChunks)
+{
+    auto leaves = digest::merkle_leaves(fd, prefix, length, leafSize);
+    ASSERT_TRUE(leaves.has_value());
+    ASSERT_EQ(leaves->size(), 8);
+
+    for (std::size_t i = 0; i < leaves->size(); ++i) {
+        auto len = std::min(leafSize, length - i * leafSize);
+        digest::SHA256 sha256;
+        std::array<std::byte, 32> expected{};
+        sha256.update(reinterpret_cast<const std::byte *>(content.data() + prefix + i * leafSize),
+                      len);
+        sha256.final(expected.data());
+        EXPECT_EQ(leaves->at(i), digest::to_hex(expected)) << "leaf " << i;
+    }
+
+    // the result doesn't depend on the number of threads
+    auto single = digest::merkle_leaves(fd, prefix, length, leafSize, 1);
+    ASSERT_TRUE(single.has_value());
+    EXPECT_EQ(*single, *leaves);
+
+    // and whether the range is read from the file or in memory
+    auto memory = digest::merkle_leaves(reinterpret_cast<const std::byte *>(content.data() + prefix),
+                                        length,
+                                        leafSize);
+    ASSERT_TRUE(memory.has_value());
+    EXPECT_EQ(*memory, *leaves);
+}
+
+TEST_F(MerkleTest, Verify)
+{
+    auto leaves = digest::merkle_leaves(fd, prefix, length, leafSize);
+    ASSERT_TRUE(leaves.has_value());
+    auto root = digest::merkle_root(*leaves);
+
+    EXPECT_TRUE(digest::merkle_verify(fd, prefix, length, leafSize, *leaves, root));
+    EXPECT_TRUE(digest::merkle_verify(fd, prefix, length, leafSize, *leaves, root, 1));
+
+    // the tree must match the range
+    EXPECT_FALSE(digest::merkle_verify(fd, prefix, length + leafSize, leafSize, *leaves, root));
+    EXPECT_FALSE(digest::merkle_verify(fd, prefix + 1, length, leafSize, *leaves, root));
+    EXPECT_FALSE(digest::merkle_verify(fd, prefix, length, leafSize * 2, *leaves, root));
+    EXPECT_FALSE(digest::merkle_verify(fd, prefix, length, 0, *leaves, root));
+
+    // leaves which don't match the root
+    auto forged = *leaves;
+    std::swap(forged[0], forged[1]);
+    EXPECT_FALSE(digest::merkle_verify(fd, prefix, length, leafSize, forged, root));
+}
+
+TEST_F(MerkleTest, TamperedLeaf)
+{
+    auto leaves = digest::merkle_leaves(fd, prefix, length, leafSize);
+    ASSERT_TRUE(leaves.has_value());
+    auto root = digest::merkle_root(*leaves);
+
+    // bytes out of the range aren't covered
+    tamper(prefix - 1);
+    tamper(prefix + length);
+    EXPECT_TRUE(digest::merkle_verify(fd, prefix, length, leafSize, *leaves, root));
+
+    // the last byte of the shorter last leaf
+    tamper(prefix + length - 1);
+    EXPECT_FALSE(digest::merkle_verify(fd, prefix, length, leafSize, *leaves, root));
+}
+
+TEST_F(MerkleTest, ShortFile)
+{
+    EXPECT_FALSE(digest::merkle_leaves(fd, prefix, content.size(), leafSize).has_value());
+
+    auto empty = digest::merkle_leaves(fd, prefix, 0, leafSize);
+    ASSERT_TRUE(empty.has_value());
+    EXPECT_TRUE(empty->empty());
+    EXPECT_TRUE(digest::merkle_verify(fd, prefix, 0, leafSize, {}, digest::merkle_root({})));
+}
+
+} // namespace
@@ -10,6 +10,7 @@
 #include <openssl/sha.h>
 
 #include <random>
+#include <vector>
 
 TEST(sha256, same_as_openssl)
 {
@@ -40,3 +41,61 @@ TEST(sha256, same_as_openssl)
     ASSERT_NE(ret, 0);
     EXPECT_EQ(digest1, digest2);
 }
+
+TEST(sha256, backends_same_as_scalar)
+{
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<> dist(0, 255);
+    std::vector<std::byte> data(100003);
+    std::generate(data.begin(), data.end(), [&gen, &dist]() {
+        return static_cast<std::byte>(dist(gen));
+    });
+
+    auto hash = [&data](digest::Backend backend, std::size_t len, std::size_t chunk) {
+        std::array<std::byte, 32> digest{};
+        digest::SHA256 sha256(backend);
+        for (std::size_t off = 0; off < len; off += chunk) {
+            sha256.update(data.data() + off, std::min(chunk, len - off));
+        }
+        sha256.final(digest.data());
+        return digest;
+    };
+
+    for (auto backend : { digest::Backend::SHANI, digest::Backend::ARMv8 }) {
+        if (!digest::backend_supported(backend)) {
+            continue;
+        }
+
+        SCOPED_TRACE(digest::backend_name(backend));
+        // lengths around the padding boundaries and inputs which aren't aligned to blocks
+        for (std::size_t len : { 0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 4095, 100003 }) {
+            for (std::size_t chunk : { 1, 7, 64, 1000, 100003 }) {
+                EXPECT_EQ(hash(backend, len, chunk), hash(digest::Backend::Scalar, len, chunk))
+                  << "length " << len << ", chunk " << chunk;
+            }
+        }
+    }
+}
+
+TEST(sha256, unsupported_backend_falls_back)
+{
+    EXPECT_TRUE(digest::backend_supported(digest::Backend::Scalar));
+    EXPECT_TRUE(digest::backend_supported(digest::default_backend()));
+    // at most one of the hardware backends is built in
+    EXPECT_FALSE(digest::backend_supported(digest::Backend::SHANI)
+                 && digest::backend_supported(digest::Backend::ARMv8));
+
+    const std::array<std::byte, 3> data{ std::byte{ 'a' }, std::byte{ 'b' }, std::byte{ 'c' } };
+    std::array<std::byte, 32> expected{};
+    digest::SHA256 scalar(digest::Backend::Scalar);
+    scalar.update(data.data(), data.size());
+    scalar.final(expected.data());
+
+    for (auto backend : { digest::Backend::SHANI, digest::Backend::ARMv8 }) {
+        std::array<std::byte, 32> digest{};
+        digest::SHA256 sha256(backend);
+        sha256.update(data.data(), data.size());
+        sha256.final(digest.data());
+        EXPECT_EQ(digest, expected) << digest::backend_name(backend);
+    }
+}
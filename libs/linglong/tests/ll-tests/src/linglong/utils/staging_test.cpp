@@ -0,0 +1,131 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "common/tempdir.h"
+#include "linglong/utils/file.h"
+#include "linglong/utils/staging.h"
+
+#include <fstream>
+
+#include <sys/stat.h>
+
+using namespace linglong::utils;
+
+namespace {
+
+class StagingTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        ASSERT_TRUE(tempDir.isValid());
+        source = tempDir.path() / "source";
+        destination = tempDir.path() / "destination";
+        std::filesystem::create_directories(source);
+        std::filesystem::create_directories(destination);
+    }
+
+    std::filesystem::path writeSource(const std::string &name, const std::string &content)
+    {
+        auto path = source / name;
+        std::ofstream(path, std::ios::binary) << content;
+        return path;
+    }
+
+    TempDir tempDir;
+    std::filesystem::path source;
+    std::filesystem::path destination;
+};
+
+TEST_F(StagingTest, StageFileKeepsContentAndMode)
+{
+    std::string content(3 * 1024 * 1024 + 7, 'x');
+    auto file = writeSource("file", content);
+    std::filesystem::permissions(file, std::filesystem::perms{ 0750 });
+
+    for (bool hardlink : { true, false }) {
+        auto target = destination / (hardlink ? "linked" : "copied");
+        auto method = staging::stageFile(file, target, { .hardlink = hardlink });
+        ASSERT_TRUE(method.has_value()) << method.error().message();
+        if (!hardlink) {
+            EXPECT_NE(*method, staging::Method::Hardlink);
+        }
+
+        auto staged = readFile(target);
+        ASSERT_TRUE(staged.has_value());
+        EXPECT_EQ(*staged, content);
+
+        struct stat st{};
+        ASSERT_EQ(::stat(target.c_str(), &st), 0);
+        EXPECT_EQ(st.st_mode & 07777, 0750);
+    }
+}
+
+TEST_F(StagingTest, StageFileWithoutHardlinkIsPrivate)
+{
+    auto file = writeSource("file", "origin");
+    auto target = destination / "file";
+    auto method = staging::stageFile(file, target, { .hardlink = false });
+    ASSERT_TRUE(method.has_value()) << method.error().message();
+
+    std::ofstream(target, std::ios::binary | std::ios::trunc) << "modified";
+    auto content = readFile(file);
+    ASSERT_TRUE(content.has_value());
+    EXPECT_EQ(*content, "origin");
+}
+
+TEST_F(StagingTest, StageFileFailsIfDestinationExists)
+{
+    auto file = writeSource("file", "content");
+    std::ofstream(destination / "file") << "existed";
+    EXPECT_FALSE(staging::stageFile(file, destination / "file").has_value());
+
+    auto content = readFile(destination / "file");
+    ASSERT_TRUE(content.has_value());
+    EXPECT_EQ(*content, "existed");
+}
+
+TEST_F(StagingTest, StageFileRejectsSymlink)
+{
+    auto file = writeSource("file", "content");
+    std::filesystem::create_symlink(file, source / "link");
+    EXPECT_FALSE(staging::stageFile(source / "link", destination / "link").has_value());
+}
+
+TEST_F(StagingTest, StageFilesInParallel)
+{
+    std::vector<staging::Task> tasks;
+    for (int i = 0; i < 64; ++i) {
+        auto name = "file" + std::to_string(i);
+        tasks.push_back({ .source = writeSource(name, std::string(i * 1000, 'a' + i % 26)),
+                          .destination = destination / name });
+    }
+
+    auto summary = staging::stageFiles(tasks, { .hardlink = false, .threads = 4 });
+    ASSERT_TRUE(summary.has_value()) << summary.error().message();
+    EXPECT_EQ(summary->reflinked + summary->hardlinked + summary->copied, tasks.size());
+    EXPECT_EQ(summary->hardlinked, 0);
+
+    for (const auto &task : tasks) {
+        auto expected = readFile(task.source);
+        auto staged = readFile(task.destination);
+        ASSERT_TRUE(expected.has_value() && staged.has_value());
+        EXPECT_EQ(*staged, *expected) << task.destination;
+    }
+}
+
+TEST_F(StagingTest, StageFilesReportsFailure)
+{
+    std::vector<staging::Task> tasks{
+        { .source = writeSource("file", "content"), .destination = destination / "file" },
+        { .source = source / "missing", .destination = destination / "missing" },
+    };
+
+    EXPECT_FALSE(staging::stageFiles(tasks).has_value());
+    EXPECT_TRUE(staging::stageFiles({}).has_value());
+}
+
+} // namespace
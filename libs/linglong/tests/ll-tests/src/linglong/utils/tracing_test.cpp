@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include <gtest/gtest.h>
+
+#include "../../common/tempdir.h"
+#include "linglong/utils/file.h"
+#include "linglong/utils/tracing.h"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdlib>
+
+using namespace linglong::utils;
+
+namespace {
+
+TEST(TracingTest, AppendChromeTraceEvents)
+{
+    // whether tracing is enabled is decided once per process, the events are written by a new
+    // process of this test, which inherits the trace file from environment
+    ::testing::FLAGS_gtest_death_test_style = "threadsafe";
+    std::unique_ptr<TempDir> tempDir;
+    if (::getenv(tracing::TraceFileEnv) == nullptr) {
+        tempDir = std::make_unique<TempDir>();
+        ASSERT_TRUE(tempDir->isValid());
+        ::setenv(tracing::TraceFileEnv, (tempDir->path() / "trace.json").c_str(), 1);
+        ::setenv(tracing::LaunchIDEnv, "test-launch", 1);
+    }
+    std::filesystem::path traceFile = ::getenv(tracing::TraceFileEnv);
+
+    EXPECT_EXIT(
+      {
+          {
+              tracing::Span span{ "span" };
+          }
+          tracing::Span ended{ "ended" };
+          ended.end();
+          tracing::instant("instant");
+          std::exit(0);
+      },
+      ::testing::ExitedWithCode(0),
+      "");
+
+    ::unsetenv(tracing::TraceFileEnv);
+    ::unsetenv(tracing::LaunchIDEnv);
+
+    auto content = readFile(traceFile);
+    ASSERT_TRUE(content.has_value()) << content.error().message();
+    ASSERT_EQ(content->rfind("[\n", 0), 0);
+
+    // the closing bracket is omitted, complete it to parse as a strict JSON array
+    auto pos = content->find_last_of(',');
+    ASSERT_NE(pos, std::string::npos);
+    auto events = nlohmann::json::parse(content->substr(0, pos) + "]");
+    ASSERT_EQ(events.size(), 3);
+
+    EXPECT_EQ(events[0]["name"], "span");
+    EXPECT_EQ(events[0]["ph"], "X");
+    EXPECT_GE(events[0]["dur"].get<std::int64_t>(), 0);
+    EXPECT_EQ(events[1]["name"], "ended");
+    EXPECT_EQ(events[2]["name"], "instant");
+    EXPECT_EQ(events[2]["ph"], "i");
+    EXPECT_LE(events[0]["ts"].get<std::int64_t>(), events[2]["ts"].get<std::int64_t>());
+    for (const auto &event : events) {
+        EXPECT_EQ(event["args"]["launch"], "test-launch");
+    }
+}
+
+TEST(TracingTest, DisabledByDefault)
+{
+    if (::getenv(tracing::TraceFileEnv) != nullptr) {
+        GTEST_SKIP() << "tracing is enabled in environment";
+    }
+
+    EXPECT_FALSE(tracing::enabled());
+    // no-op without trace file
+    tracing::Span span{ "span" };
+    tracing::instant("instant");
+}
+
+} // namespace
@@ -30,6 +30,7 @@
 #include <iomanip>
 #include <iostream>
 #include <sstream>
+#include <tuple>
 #include <vector>
 
 #include <grp.h>
@@ -1621,20 +1622,17 @@ Network={}
     return LINGLONG_OK;
 }
 
-utils::error::Result<void> ContainerCfgBuilder::applyPatch() noexcept
+utils::error::Result<std::vector<std::filesystem::path>>
+ContainerCfgBuilder::collectPatchFiles() const noexcept
 {
-    LINGLONG_TRACE("apply patches");
-
-    if (!applyPatchEnabled) {
-        return LINGLONG_OK;
-    }
+    LINGLONG_TRACE("collect patch files");
 
-    std::filesystem::path containerConfigPath{ LINGLONG_INSTALL_PREFIX
-                                               "/lib/linglong/container/config.d" };
+    std::filesystem::path containerConfigPath =
+      patchDir.value_or(LINGLONG_INSTALL_PREFIX "/lib/linglong/container/config.d");
     std::error_code ec;
     if (!std::filesystem::exists(containerConfigPath, ec)) {
         // if no-exists or failed to check exists, ignore it
-        return LINGLONG_OK;
+        return std::vector<std::filesystem::path>{};
     }
 
     std::vector<std::filesystem::path> globalPatchFiles;
@@ -1673,25 +1671,130 @@ utils::error::Result<void> ContainerCfgBuilder::applyPatch() noexcept
     std::sort(globalPatchFiles.begin(), globalPatchFiles.end());
     std::sort(appPatchFiles.begin(), appPatchFiles.end());
 
-    auto doPatch = [this](const std::vector<std::filesystem::path> &patchFiles) {
-        for (const auto &patchFile : patchFiles) {
-            // skip if failed to apply
-            auto result = applyPatchFile(patchFile);
-            if (!result) {
-                std::cerr << "skip applying failed patch " << patchFile << ": "
-                          << result.error().message() << std::endl;
-            }
-        }
-    };
+    // global patches are applied first
+    std::move(appPatchFiles.begin(), appPatchFiles.end(), std::back_inserter(globalPatchFiles));
+    return globalPatchFiles;
+}
+
+utils::error::Result<void> ContainerCfgBuilder::applyPatch() noexcept
+{
+    LINGLONG_TRACE("apply patches");
+
+    if (!applyPatchEnabled) {
+        return LINGLONG_OK;
+    }
 
-    doPatch(globalPatchFiles);
-    doPatch(appPatchFiles);
+    auto patchFiles = collectPatchFiles();
+    if (!patchFiles) {
+        return LINGLONG_ERR(patchFiles);
+    }
+
+    if (patchFiles->empty()) {
+        return LINGLONG_OK;
+    }
+
+    nlohmann::json raw;
+    try {
+        raw = nlohmann::json(config);
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR("Failed to serialize config", e);
+    }
+
+    // All patches work on the JSON document, convert the configuration only once instead of
+    // once per patch. If the result turns out to be invalid, redo it from the unpatched document
+    // and check after each patch to skip the broken ones.
+    auto patched = raw;
+    std::vector<PatchResult> results;
+    applyPatchFiles(patched, *patchFiles, results);
+    try {
+        config = patched.get<Config>();
+        return LINGLONG_OK;
+    } catch (const std::exception &e) {
+        std::cerr << "patched config is invalid, check patches one by one: " << e.what()
+                  << std::endl;
+    }
+
+    applyValidPatchFiles(raw, *patchFiles, results);
+    try {
+        config = raw.get<Config>();
+    } catch (const std::exception &e) {
+        return LINGLONG_ERR("Failed to convert patched config", e);
+    }
 
     return LINGLONG_OK;
 }
 
+// results tell whether each patch is applied, and what an executable patch changed. documents
+// between patches aren't kept, JSON patch files are applied again when they're needed.
+void ContainerCfgBuilder::applyPatchFiles(nlohmann::json &raw,
+                                          const std::vector<std::filesystem::path> &patchFiles,
+                                          std::vector<PatchResult> &results) noexcept
+{
+    results.clear();
+    results.resize(patchFiles.size());
+    for (std::size_t i = 0; i < patchFiles.size(); ++i) {
+        // skip if failed to apply, a failed patch leaves raw untouched
+        nlohmann::json changes;
+        auto result = applyPatchFile(raw, patchFiles[i], &changes);
+        if (!result) {
+            std::cerr << "skip applying failed patch " << patchFiles[i] << ": "
+                      << result.error().message() << std::endl;
+            continue;
+        }
+
+        results[i].applied = true;
+        if (!changes.is_null()) {
+            results[i].changes = std::move(changes);
+        }
+    }
+}
+
+// As long as every patch before is kept, a patch gets the same document as in applyPatchFiles,
+// the recorded changes of an executable patch are applied instead of running it again, it may
+// have side effects.
+void ContainerCfgBuilder::applyValidPatchFiles(
+  nlohmann::json &raw,
+  const std::vector<std::filesystem::path> &patchFiles,
+  const std::vector<PatchResult> &results) noexcept
+{
+    bool reusable = results.size() == patchFiles.size();
+    for (std::size_t i = 0; i < patchFiles.size(); ++i) {
+        const auto &patchFile = patchFiles[i];
+        // a failed patch was reported by applyPatchFiles already
+        if (reusable && !results[i].applied) {
+            continue;
+        }
+
+        nlohmann::json patched;
+        try {
+            if (reusable && results[i].changes) {
+                patched = raw.patch(*results[i].changes);
+            } else {
+                patched = raw;
+                auto result = applyPatchFile(patched, patchFile);
+                if (!result) {
+                    std::cerr << "skip applying failed patch " << patchFile << ": "
+                              << result.error().message() << std::endl;
+                    continue;
+                }
+            }
+
+            std::ignore = patched.get<Config>();
+        } catch (const std::exception &e) {
+            std::cerr << "skip applying patch " << patchFile
+                      << " which results in invalid config: " << e.what() << std::endl;
+            reusable = false;
+            continue;
+        }
+
+        raw = std::move(patched);
+    }
+}
+
 utils::error::Result<void>
-ContainerCfgBuilder::applyPatchFile(const std::filesystem::path &patchFile) noexcept
+ContainerCfgBuilder::applyPatchFile(nlohmann::json &raw,
+                                    const std::filesystem::path &patchFile,
+                                    nlohmann::json *changes) noexcept
 {
     LINGLONG_TRACE(fmt::format("apply patch file: {}", patchFile));
 
@@ -1706,18 +1809,19 @@ ContainerCfgBuilder::applyPatchFile(const std::filesystem::path &patchFile) noex
           != std::filesystem::perms::none
         || (status.permissions() & std::filesystem::perms::others_exec)
           != std::filesystem::perms::none) {
-        return applyExecutablePatch(patchFile);
+        return applyExecutablePatch(raw, patchFile, changes);
     }
 
     if (patchFile.extension() == ".json") {
-        return applyJsonPatchFile(patchFile);
+        return applyJsonPatchFile(raw, patchFile);
     }
 
     return LINGLONG_ERR("Patch file is not an executable or a JSON patch file");
 }
 
 utils::error::Result<void>
-ContainerCfgBuilder::applyJsonPatchFile(const std::filesystem::path &patchFile) noexcept
+ContainerCfgBuilder::applyJsonPatchFile(nlohmann::json &raw,
+                                        const std::filesystem::path &patchFile) noexcept
 {
     LINGLONG_TRACE(fmt::format("apply JSON patch file: {}", patchFile));
 
@@ -1730,13 +1834,11 @@ ContainerCfgBuilder::applyJsonPatchFile(const std::filesystem::path &patchFile)
         auto json = nlohmann::json::parse(file);
         auto patchContent = json.get<linglong::api::types::v1::OciConfigurationPatch>();
 
-        if (config.ociVersion != patchContent.ociVersion) {
+        if (raw.value("ociVersion", "") != patchContent.ociVersion) {
             return LINGLONG_ERR("ociVersion mismatched");
         }
 
-        auto raw = nlohmann::json(config);
-        auto patchedJson = raw.patch(patchContent.patch);
-        config = patchedJson.get<Config>();
+        raw = raw.patch(patchContent.patch);
     } catch (const std::exception &e) {
         return LINGLONG_ERR(fmt::format("Failed to apply JSON patch {}", patchFile), e);
     }
@@ -1745,13 +1847,15 @@ ContainerCfgBuilder::applyJsonPatchFile(const std::filesystem::path &patchFile)
 }
 
 utils::error::Result<void>
-ContainerCfgBuilder::applyExecutablePatch(const std::filesystem::path &patchFile) noexcept
+ContainerCfgBuilder::applyExecutablePatch(nlohmann::json &raw,
+                                          const std::filesystem::path &patchFile,
+                                          nlohmann::json *changes) noexcept
 {
     LINGLONG_TRACE(fmt::format("apply executable patch: {}", patchFile));
 
     std::string inputJsonStr;
     try {
-        inputJsonStr = nlohmann::json(config).dump();
+        inputJsonStr = raw.dump();
     } catch (const std::exception &e) {
         return LINGLONG_ERR("Failed to serialize config", e);
     }
@@ -1762,7 +1866,11 @@ ContainerCfgBuilder::applyExecutablePatch(const std::filesystem::path &patchFile
     }
 
     try {
-        config = nlohmann::json::parse(*output).get<Config>();
+        auto patched = nlohmann::json::parse(*output);
+        if (changes != nullptr) {
+            *changes = nlohmann::json::diff(raw, patched);
+        }
+        raw = std::move(patched);
     } catch (const std::exception &e) {
         return LINGLONG_ERR(fmt::format("Failed to process output from {}: {}. Output: {}",
                                         patchFile.string(),
@@ -1954,23 +2062,46 @@ utils::error::Result<void> ContainerCfgBuilder::mergeMount() noexcept
     return LINGLONG_OK;
 }
 
+const ContainerCfgBuilder::HostFileStatus &
+ContainerCfgBuilder::hostFileStatus(const std::filesystem::path &path) noexcept
+{
+    auto [it, inserted] = hostFileStatusCache.try_emplace(path.string());
+    if (!inserted) {
+        return it->second;
+    }
+
+    // same as std::filesystem::exists and std::filesystem::is_symlink, with at most two syscalls
+    struct stat st{};
+    if (::lstat(path.c_str(), &st) != 0) {
+        it->second = HostFileStatus{ .exists = false, .isSymlink = false };
+    } else if (S_ISLNK(st.st_mode)) {
+        it->second = HostFileStatus{ .exists = ::stat(path.c_str(), &st) == 0, .isSymlink = true };
+    } else {
+        it->second = HostFileStatus{ .exists = true, .isSymlink = false };
+    }
+
+    return it->second;
+}
+
 int ContainerCfgBuilder::findChild(int parent, const std::string &name) noexcept
 {
-    for (auto idx : mountpoints[parent].childs_idx) {
-        if (mountpoints[idx].name == name) {
-            return idx;
-        }
+    auto it = mountpointChildren.find(std::make_pair(parent, name));
+    if (it == mountpointChildren.end()) {
+        return -1;
     }
 
-    return -1;
+    return it->second;
 }
 
 int ContainerCfgBuilder::insertChild(int parent, MountNode node) noexcept
 {
     node.parent_idx = parent;
+    auto name = node.name;
     mountpoints.emplace_back(std::move(node));
     int child = mountpoints.size() - 1;
     mountpoints[parent].childs_idx.push_back(child);
+    // keep the first one if names are duplicated, as a linear search does
+    mountpointChildren.try_emplace(std::make_pair(parent, std::move(name)), child);
     return child;
 }
 
@@ -2048,7 +2179,6 @@ bool ContainerCfgBuilder::shouldFix(int node, std::filesystem::path &fixPath) no
     }
 
     auto hostPath = std::filesystem::path{ root } / getRelativePath(mounted, node);
-    std::error_code ec;
 
     auto isCopySymlink = [this](int node) {
         const auto &mount = mounts[mountpoints[node].mount_idx];
@@ -2061,8 +2191,9 @@ bool ContainerCfgBuilder::shouldFix(int node, std::filesystem::path &fixPath) no
     // 1. is /etc/localtime or
     // 2. is not exist or
     // 3. is not a symlink but mount with option copy-symlink
-    if (getRelativePath(0, node) == "etc/localtime" || !std::filesystem::exists(hostPath, ec)
-        || ((!std::filesystem::is_symlink(hostPath, ec)) && isCopySymlink(node))) {
+    const auto &status = hostFileStatus(hostPath);
+    if (getRelativePath(0, node) == "etc/localtime" || !status.exists
+        || (!status.isSymlink && isCopySymlink(node))) {
         fixPath = std::move(hostPath);
         return true;
     }
@@ -2072,21 +2203,26 @@ bool ContainerCfgBuilder::shouldFix(int node, std::filesystem::path &fixPath) no
 
 std::string ContainerCfgBuilder::getRelativePath(int parent, int node) noexcept
 {
-    std::filesystem::path path;
+    std::vector<const std::string *> names;
     while (node != parent) {
         if (node <= 0) {
             break;
         }
 
         const auto &mp = mountpoints[node];
-        if (path.empty())
-            path = mp.name;
-        else
-            path = mp.name / path;
+        names.push_back(&mp.name);
         node = mp.parent_idx;
     }
 
-    return path.string();
+    std::string path;
+    for (auto it = names.rbegin(); it != names.rend(); ++it) {
+        if (!path.empty()) {
+            path.push_back('/');
+        }
+        path.append(**it);
+    }
+
+    return path;
 }
 
 void ContainerCfgBuilder::adjustNode(int node,
@@ -2222,8 +2358,7 @@ void ContainerCfgBuilder::tryFixMountpointsTree() noexcept
             while (path.has_relative_path()) {
                 path = path.parent_path();
                 node = mountpoints[node].parent_idx;
-                std::error_code ec;
-                if (std::filesystem::exists(path, ec)) {
+                if (hostFileStatus(path).exists) {
                     adjustNode(node, path, fixPath);
                     break;
                 }
@@ -2263,6 +2398,7 @@ utils::error::Result<void> ContainerCfgBuilder::selfAdjustingMount() noexcept
     }
 
     mounts = std::move(config.mounts).value();
+    hostFileStatusCache.clear();
 
     // Some apps depends on files which doesn't exist in runtime layer or base layer, we have to
     // mount host files to container, or create the file on demand, but the layer is readonly.
@@ -12,7 +12,10 @@
 #include "ocppi/runtime/config/types/IdMapping.hpp"
 #include "ocppi/runtime/config/types/Mount.hpp"
 
+#include <nlohmann/json.hpp>
+
 #include <filesystem>
+#include <optional>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -189,6 +192,13 @@ public:
         return *this;
     }
 
+    // defaults to LINGLONG_INSTALL_PREFIX/lib/linglong/container/config.d
+    ContainerCfgBuilder &setPatchDir(std::filesystem::path dir) noexcept
+    {
+        patchDir = std::move(dir);
+        return *this;
+    }
+
     ContainerCfgBuilder &setCapabilities(std::vector<std::string> caps) noexcept
     {
         capabilities = std::move(caps);
@@ -228,11 +238,30 @@ private:
     utils::error::Result<void> buildEnv() noexcept;
     utils::error::Result<void> buildContainerInfo() noexcept;
     utils::error::Result<void> buildHooks() noexcept;
+    utils::error::Result<std::vector<std::filesystem::path>> collectPatchFiles() const noexcept;
     utils::error::Result<void> applyPatch() noexcept;
-    utils::error::Result<void> applyPatchFile(const std::filesystem::path &patchFile) noexcept;
-    utils::error::Result<void> applyJsonPatchFile(const std::filesystem::path &patchFile) noexcept;
-    utils::error::Result<void>
-    applyExecutablePatch(const std::filesystem::path &patchFile) noexcept;
+    // how a patch file changed the document in applyPatchFiles
+    struct PatchResult
+    {
+        bool applied{ false };
+        // the changes of an executable patch as a JSON patch, so it isn't run again
+        std::optional<nlohmann::json> changes;
+    };
+    static void applyPatchFiles(nlohmann::json &raw,
+                                const std::vector<std::filesystem::path> &patchFiles,
+                                std::vector<PatchResult> &results) noexcept;
+    static void applyValidPatchFiles(nlohmann::json &raw,
+                                     const std::vector<std::filesystem::path> &patchFiles,
+                                     const std::vector<PatchResult> &results) noexcept;
+    static utils::error::Result<void> applyPatchFile(nlohmann::json &raw,
+                                                     const std::filesystem::path &patchFile,
+                                                     nlohmann::json *changes = nullptr) noexcept;
+    static utils::error::Result<void>
+    applyJsonPatchFile(nlohmann::json &raw, const std::filesystem::path &patchFile) noexcept;
+    static utils::error::Result<void>
+    applyExecutablePatch(nlohmann::json &raw,
+                         const std::filesystem::path &patchFile,
+                         nlohmann::json *changes = nullptr) noexcept;
     utils::error::Result<void> mergeMount() noexcept;
     utils::error::Result<void> finalize() noexcept;
 
@@ -241,6 +270,21 @@ private:
     mountBind(const ocppi::runtime::config::types::Mount &mount) noexcept;
 
     // adjust mount
+    struct HostFileStatus
+    {
+        bool exists;
+        bool isSymlink;
+    };
+
+    struct MountNodeKeyHash
+    {
+        std::size_t operator()(const std::pair<int, std::string> &key) const noexcept
+        {
+            return std::hash<std::string>{}(key.second) ^ (std::hash<int>{}(key.first) << 1);
+        }
+    };
+
+    const HostFileStatus &hostFileStatus(const std::filesystem::path &path) noexcept;
     int findChild(int parent, const std::string &name) noexcept;
     int insertChild(int parent, MountNode node) noexcept;
     int insertChildRecursively(const std::filesystem::path &path, bool &inserted) noexcept;
@@ -334,6 +378,10 @@ private:
     // .mount_idx > 0 represents the path is a mount point, and it's the subscript of the array
     // mounts
     std::vector<MountNode> mountpoints;
+    // (parent index, name) -> index of the child in mountpoints
+    std::unordered_map<std::pair<int, std::string>, int, MountNodeKeyHash> mountpointChildren;
+    // host files are checked many times while fixing the tree, they are not changed meanwhile
+    std::unordered_map<std::string, HostFileStatus> hostFileStatusCache;
     // this 'mounts' is used internally, distinct from config.mounts
     std::vector<ocppi::runtime::config::types::Mount> mounts;
     std::optional<PipewireMountOption> pipewireMountOption;
@@ -344,6 +392,7 @@ private:
     bool disableUserNamespaceEnabled = false;
     std::optional<XdpOption> xdpOption;
     bool applyPatchEnabled = true;
+    std::optional<std::filesystem::path> patchDir;
     bool isolateTmp{ false };
     bool devPassthru{ false };
 
@@ -0,0 +1,255 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+// A store of file contents keyed by sha256. Files which are checked out from the store are
+// hardlinks of its objects, so that the same file in many places, e.g. the same runtime extracted
+// from many UAB, takes disk space and page cache only once.
+//
+// An object is keyed by the digest and the permission bits of the file, like an object of an
+// ostree repository. Objects are read-only, a checked out file mustn't be changed in place.
+// The number of links of an object tells how many files share it, objects which aren't linked by
+// any file any more are removed by prune.
+//
+// It's header-only and depends on the standard library only, as it's used by the static
+// uab-header.
+
+#pragma once
+
+#include "linglong/utils/merkle.h"
+#include "linglong/utils/sha256.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace digest {
+
+class ContentStore
+{
+public:
+    struct Usage
+    {
+        // objects in the store and their size
+        std::uint64_t objects{ 0 };
+        std::uint64_t size{ 0 };
+        // the size of all files which are linked to objects, as if every one was a copy
+        std::uint64_t logicalSize{ 0 };
+        // objects which aren't linked by any file
+        std::uint64_t unreferenced{ 0 };
+    };
+
+    explicit ContentStore(std::filesystem::path dir) noexcept
+        : dir(std::move(dir))
+    {
+    }
+
+    // $XDG_CACHE_HOME/linglong/store, it's per user
+    static std::optional<std::filesystem::path> default_directory() noexcept
+    {
+        std::filesystem::path cacheHome;
+        if (const auto *xdg = ::getenv("XDG_CACHE_HOME"); xdg != nullptr && xdg[0] == '/') {
+            cacheHome = xdg;
+        } else if (const auto *home = ::getenv("HOME"); home != nullptr && home[0] == '/') {
+            cacheHome = std::filesystem::path{ home } / ".cache";
+        } else {
+            return std::nullopt;
+        }
+
+        return cacheHome / "linglong" / "store";
+    }
+
+    [[nodiscard]] const std::filesystem::path &directory() const noexcept { return dir; }
+
+    // create destination with the content and permission bits of the regular file source, as a
+    // hardlink of the object in the store, the object is added if it doesn't exist yet.
+    // shared is set if the object existed. It fails if destination can't be linked to the store,
+    // e.g. they are on different filesystems, the caller should copy the file instead.
+    bool checkout(const std::filesystem::path &source,
+                  const std::filesystem::path &destination,
+                  bool *shared = nullptr) const noexcept
+    {
+        auto fd = ::open(source.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if (fd == -1) {
+            return false;
+        }
+
+        struct stat st{};
+        auto hex = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) ? digestOf(fd) : std::nullopt;
+        if (!hex) {
+            ::close(fd);
+            return false;
+        }
+
+        std::error_code ec;
+        auto object = objectPath(*hex, st.st_mode);
+        auto existed = std::filesystem::exists(object, ec);
+        auto added = !existed && !ec && addObject(fd, object, st.st_mode);
+        ::close(fd);
+        if (!existed && !added) {
+            return false;
+        }
+
+        if (shared != nullptr) {
+            *shared = existed;
+        }
+
+        return ::link(object.c_str(), destination.c_str()) == 0;
+    }
+
+    [[nodiscard]] Usage usage() const noexcept
+    {
+        Usage result;
+        forEachObject([&result](const std::filesystem::path &, const struct stat &st) {
+            ++result.objects;
+            result.size += st.st_size;
+            result.logicalSize += st.st_size * (st.st_nlink - 1);
+            if (st.st_nlink == 1) {
+                ++result.unreferenced;
+            }
+        });
+        return result;
+    }
+
+    // remove objects which aren't linked by any file, and temporary files of interrupted
+    // checkouts
+    void prune() const noexcept
+    {
+        forEachObject([](const std::filesystem::path &path, const struct stat &st) {
+            if (st.st_nlink == 1) {
+                ::unlink(path.c_str());
+            }
+        });
+
+        try {
+            std::error_code ec;
+            for (const auto &entry : std::filesystem::directory_iterator{ dir / "tmp", ec }) {
+                ::unlink(entry.path().c_str());
+            }
+        } catch (...) {
+            // the directory is changed meanwhile, the rest is removed next time
+        }
+    }
+
+private:
+    [[nodiscard]] std::filesystem::path objectPath(std::string_view hex, mode_t mode) const
+    {
+        constexpr std::string_view digits = "01234567";
+        auto name = std::string{ hex.substr(2) } + ".";
+        for (auto shift : { 9, 6, 3, 0 }) {
+            name.push_back(digits[(objectMode(mode) >> shift) & 7]);
+        }
+        return dir / "objects" / std::string{ hex.substr(0, 2) } / name;
+    }
+
+    // objects are read-only, and never setuid or setgid, they're shared by all bundles
+    static mode_t objectMode(mode_t mode) noexcept { return mode & 0555; }
+
+    static std::optional<std::string> digestOf(int fd) noexcept
+    {
+        SHA256 sha256;
+        std::vector<std::byte> buf(1024 * 1024);
+        for (std::uint64_t offset = 0;;) {
+            auto ret = ::pread(fd, buf.data(), buf.size(), static_cast<off_t>(offset));
+            if (ret == -1 && errno == EINTR) {
+                continue;
+            }
+            if (ret == -1) {
+                return std::nullopt;
+            }
+            if (ret == 0) {
+                break;
+            }
+
+            sha256.update(buf.data(), static_cast<std::size_t>(ret));
+            offset += static_cast<std::uint64_t>(ret);
+        }
+
+        std::array<std::byte, 32> result{};
+        sha256.final(result.data());
+        return to_hex(result);
+    }
+
+    // write the content of fd to a temporary file, then link it as the object, another process
+    // may add the same object meanwhile
+    bool addObject(int fd, const std::filesystem::path &object, mode_t mode) const noexcept
+    {
+        std::error_code ec;
+        std::filesystem::create_directories(object.parent_path(), ec);
+        std::filesystem::create_directories(dir / "tmp", ec);
+        if (ec) {
+            return false;
+        }
+
+        auto tmp = dir / "tmp" / (object.filename().string() + "." + std::to_string(::getpid()));
+        auto out = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, 0600);
+        if (out == -1) {
+            return false;
+        }
+
+        auto copied = copyContent(fd, out) && ::fchmod(out, objectMode(mode)) == 0;
+        copied = ::close(out) == 0 && copied;
+        copied = copied && (::link(tmp.c_str(), object.c_str()) == 0 || errno == EEXIST);
+        ::unlink(tmp.c_str());
+        return copied;
+    }
+
+    static bool copyContent(int in, int out) noexcept
+    {
+        std::vector<std::byte> buf(1024 * 1024);
+        for (std::uint64_t offset = 0;;) {
+            auto ret = ::pread(in, buf.data(), buf.size(), static_cast<off_t>(offset));
+            if (ret == -1 && errno == EINTR) {
+                continue;
+            }
+            if (ret <= 0) {
+                return ret == 0;
+            }
+
+            for (ssize_t done = 0; done < ret;) {
+                auto written =
+                  ::write(out, buf.data() + done, static_cast<std::size_t>(ret - done));
+                if (written == -1 && errno == EINTR) {
+                    continue;
+                }
+                if (written == -1) {
+                    return false;
+                }
+                done += written;
+            }
+            offset += static_cast<std::uint64_t>(ret);
+        }
+    }
+
+    template <typename Visitor>
+    void forEachObject(Visitor visit) const noexcept
+    {
+        try {
+            std::error_code ec;
+            for (const auto &prefix : std::filesystem::directory_iterator{ dir / "objects", ec }) {
+                for (const auto &entry : std::filesystem::directory_iterator{ prefix.path(), ec }) {
+                    struct stat st{};
+                    if (::lstat(entry.path().c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                        visit(entry.path(), st);
+                    }
+                }
+            }
+        } catch (...) {
+            // the store is changed meanwhile, e.g. it's pruned by another process
+        }
+    }
+
+    std::filesystem::path dir;
+};
+
+} // namespace digest
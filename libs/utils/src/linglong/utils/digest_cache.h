@@ -0,0 +1,176 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+// Records which files were verified to have an expected digest, so that the hash of an unchanged
+// file needn't be calculated again, e.g. the bundle section of an UAB on every launch.
+//
+// An entry is keyed by the device and inode of the file and holds its size, mtime, ctime, the
+// verified range and the digest. Any write to the file changes its ctime, which can't be set by
+// the user, and replacing the file changes its inode, so a changed file always misses the cache.
+// Timestamps may be coarse-grained, a write which happens in the same tick as the former one
+// keeps them unchanged, so files which were changed recently are never recorded.
+//
+// It's header-only and depends on the standard library only, as it's used by the static
+// uab-header.
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace digest {
+
+class VerifiedCache
+{
+public:
+    // changes within this window before the verification aren't trusted
+    constexpr static std::chrono::nanoseconds default_racy_window = std::chrono::seconds(1);
+
+    explicit VerifiedCache(std::filesystem::path dir,
+                           std::chrono::nanoseconds racyWindow = default_racy_window) noexcept
+        : dir(std::move(dir))
+        , racyWindow(racyWindow)
+    {
+    }
+
+    // $XDG_CACHE_HOME/linglong/verified, it's per user
+    static std::optional<std::filesystem::path> default_directory() noexcept
+    {
+        std::filesystem::path cacheHome;
+        if (const auto *xdg = ::getenv("XDG_CACHE_HOME"); xdg != nullptr && xdg[0] == '/') {
+            cacheHome = xdg;
+        } else if (const auto *home = ::getenv("HOME"); home != nullptr && home[0] == '/') {
+            cacheHome = std::filesystem::path{ home } / ".cache";
+        } else {
+            return std::nullopt;
+        }
+
+        return cacheHome / "linglong" / "verified";
+    }
+
+    // whether [offset, offset + length) of the file with status st was verified to have digest
+    [[nodiscard]] bool contains(const struct stat &st,
+                                std::uint64_t offset,
+                                std::uint64_t length,
+                                std::string_view digest) const noexcept
+    {
+        auto fd = ::open(entryPath(st).c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+        if (fd == -1) {
+            return false;
+        }
+
+        auto expected = entryContent(st, offset, length, digest);
+        std::string content(expected.size() + 1, '\0');
+        auto len = ::read(fd, content.data(), content.size());
+        ::close(fd);
+
+        return len == static_cast<ssize_t>(expected.size())
+          && std::string_view{ content.data(), expected.size() } == expected;
+    }
+
+    // st must be taken before the digest is calculated, so that a write during the calculation
+    // invalidates the entry
+    void insert(const struct stat &st,
+                std::uint64_t offset,
+                std::uint64_t length,
+                std::string_view digest) const noexcept
+    {
+        if (changedRecently(st)) {
+            return;
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        if (ec) {
+            return;
+        }
+
+        auto path = entryPath(st);
+        auto tmp = path;
+        tmp += ".tmp." + std::to_string(::getpid());
+        auto fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, 0600);
+        if (fd == -1) {
+            return;
+        }
+
+        auto content = entryContent(st, offset, length, digest);
+        auto written = ::write(fd, content.data(), content.size());
+        ::close(fd);
+        if (written != static_cast<ssize_t>(content.size())
+            || ::rename(tmp.c_str(), path.c_str()) == -1) {
+            ::unlink(tmp.c_str());
+        }
+    }
+
+    // forget the file, e.g. its content doesn't match the digest any more
+    void erase(const struct stat &st) const noexcept { ::unlink(entryPath(st).c_str()); }
+
+private:
+    [[nodiscard]] std::filesystem::path entryPath(const struct stat &st) const
+    {
+        return dir / (toHex(st.st_dev) + "-" + toHex(st.st_ino));
+    }
+
+    static std::string entryContent(const struct stat &st,
+                                    std::uint64_t offset,
+                                    std::uint64_t length,
+                                    std::string_view digest)
+    {
+        std::string content = "1 ";
+        for (std::uint64_t field : { static_cast<std::uint64_t>(st.st_size),
+                                     toNanoseconds(st.st_mtim),
+                                     toNanoseconds(st.st_ctim),
+                                     offset,
+                                     length }) {
+            content += std::to_string(field);
+            content += ' ';
+        }
+        content += digest;
+        content += '\n';
+        return content;
+    }
+
+    [[nodiscard]] bool changedRecently(const struct stat &st) const noexcept
+    {
+        struct timespec now{};
+        if (::clock_gettime(CLOCK_REALTIME, &now) == -1) {
+            return true;
+        }
+
+        auto changed = std::max(toNanoseconds(st.st_mtim), toNanoseconds(st.st_ctim));
+        return toNanoseconds(now) < changed + static_cast<std::uint64_t>(racyWindow.count());
+    }
+
+    static std::uint64_t toNanoseconds(const struct timespec &ts) noexcept
+    {
+        return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    static std::string toHex(std::uint64_t value)
+    {
+        constexpr std::string_view digits = "0123456789abcdef";
+        std::string hex;
+        do {
+            hex.insert(hex.begin(), digits[value & 0xf]);
+            value >>= 4;
+        } while (value != 0);
+        return hex;
+    }
+
+    std::filesystem::path dir;
+    std::chrono::nanoseconds racyWindow;
+};
+
+} // namespace digest
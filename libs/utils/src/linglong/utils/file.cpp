@@ -6,15 +6,24 @@
 
 #include "linglong/common/error.h"
 #include "linglong/utils/error/error.h"
+#include "linglong/utils/finally/finally.h"
 #include "linglong/utils/log/log.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
+#include <memory>
 #include <string>
 #include <system_error>
 
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 namespace linglong::utils {
 
@@ -40,8 +49,147 @@ ensureOwnerPermissionsIfNeeded(const std::filesystem::path &path,
     return LINGLONG_OK;
 }
 
+// the kernel or the filesystem can't do it, a slower method should be tried
+bool copyUnsupported(int err) noexcept
+{
+    return err == EXDEV || err == ENOSYS || err == EINVAL || err == EOPNOTSUPP || err == ENOTTY;
+}
+
+// sendfile and copy_file_range transfer at most this many bytes at once
+constexpr uint64_t maxTransferSize = 0x7ffff000;
+
 } // namespace
 
+linglong::utils::error::Result<CopyMethod>
+copyRange(int in, off_t inOffset, int out, off_t outOffset, uint64_t length) noexcept
+{
+    LINGLONG_TRACE(fmt::format("copy {} bytes from {} to {}", length, inOffset, outOffset));
+
+    if (length == 0) {
+        return CopyMethod::Reflink;
+    }
+
+    // only whole blocks can be shared, unless the range ends at the end of the source, the
+    // filesystem refuses the others
+    struct file_clone_range range{ .src_fd = in,
+                                   .src_offset = static_cast<uint64_t>(inOffset),
+                                   .src_length = length,
+                                   .dest_offset = static_cast<uint64_t>(outOffset) };
+    if (::ioctl(out, FICLONERANGE, &range) == 0) {
+        return CopyMethod::Reflink;
+    }
+
+    uint64_t copied{ 0 };
+    auto unexpectedEnd = [&copied, length]() {
+        return fmt::format("unexpected end of file after {} of {} bytes", copied, length);
+    };
+
+    while (copied < length) {
+        loff_t from = inOffset + copied;
+        loff_t to = outOffset + copied;
+        auto ret = ::copy_file_range(in,
+                                     &from,
+                                     out,
+                                     &to,
+                                     std::min(length - copied, maxTransferSize),
+                                     0);
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ret == -1) {
+            if (copied == 0 && copyUnsupported(errno)) {
+                break;
+            }
+
+            return LINGLONG_ERR(
+              fmt::format("copy_file_range error: {}", common::error::errorString(errno)));
+        }
+        if (ret == 0) {
+            return LINGLONG_ERR(unexpectedEnd());
+        }
+
+        copied += ret;
+    }
+    if (copied == length) {
+        return CopyMethod::CopyFileRange;
+    }
+
+    // sendfile writes at the file offset of out, which is restored afterwards
+    auto position = ::lseek(out, 0, SEEK_CUR);
+    if (position != -1 && ::lseek(out, outOffset, SEEK_SET) != -1) {
+        while (copied < length) {
+            off_t from = inOffset + copied;
+            auto ret = ::sendfile(out, in, &from, std::min(length - copied, maxTransferSize));
+            if (ret == -1 && errno == EINTR) {
+                continue;
+            }
+            if (ret == -1) {
+                if (copied == 0 && copyUnsupported(errno)) {
+                    break;
+                }
+
+                auto err = errno;
+                ::lseek(out, position, SEEK_SET);
+                return LINGLONG_ERR(
+                  fmt::format("sendfile error: {}", common::error::errorString(err)));
+            }
+            if (ret == 0) {
+                ::lseek(out, position, SEEK_SET);
+                return LINGLONG_ERR(unexpectedEnd());
+            }
+
+            copied += ret;
+        }
+
+        ::lseek(out, position, SEEK_SET);
+        if (copied == length) {
+            return CopyMethod::Sendfile;
+        }
+    }
+
+    // aligned, so that it also suits the files which are opened with O_DIRECT
+    constexpr std::size_t bufferSize = 1024 * 1024;
+    std::unique_ptr<char, decltype(&std::free)> buffer{
+        static_cast<char *>(std::aligned_alloc(4096, bufferSize)),
+        &std::free
+    };
+    if (!buffer) {
+        return LINGLONG_ERR("failed to allocate buffer");
+    }
+
+    while (copied < length) {
+        auto len = ::pread(in,
+                           buffer.get(),
+                           std::min<uint64_t>(length - copied, bufferSize),
+                           inOffset + copied);
+        if (len == -1 && errno == EINTR) {
+            continue;
+        }
+        if (len == -1) {
+            return LINGLONG_ERR(fmt::format("read error: {}", common::error::errorString(errno)));
+        }
+        if (len == 0) {
+            return LINGLONG_ERR(unexpectedEnd());
+        }
+
+        for (ssize_t written = 0; written < len;) {
+            auto ret =
+              ::pwrite(out, buffer.get() + written, len - written, outOffset + copied + written);
+            if (ret == -1 && errno == EINTR) {
+                continue;
+            }
+            if (ret == -1) {
+                return LINGLONG_ERR(
+                  fmt::format("write error: {}", common::error::errorString(errno)));
+            }
+            written += ret;
+        }
+        copied += len;
+    }
+
+    return CopyMethod::Buffer;
+}
+
 linglong::utils::error::Result<std::string> readFile(const std::filesystem::path &filepath)
 {
     LINGLONG_TRACE(fmt::format("read file {}", filepath));
@@ -99,21 +247,38 @@ linglong::utils::error::Result<void> concatFile(const std::filesystem::path &sou
         return LINGLONG_ERR("source and target are the same file", ec);
     }
 
-    std::ifstream ifs(source, std::ios::binary);
-    if (!ifs) {
-        return LINGLONG_ERR(fmt::format("failed to open source {}", source));
+    auto in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in == -1) {
+        return LINGLONG_ERR(fmt::format("failed to open source {}: {}",
+                                        source,
+                                        common::error::errorString(errno)));
     }
-
-    std::ofstream ofs(target, std::ios::binary | std::ios::app);
-    if (!ofs) {
-        return LINGLONG_ERR(fmt::format("failed to open target {}", target));
+    auto closeIn = utils::finally::finally([in] {
+        ::close(in);
+    });
+
+    // not O_APPEND, copy_file_range and sendfile refuse it
+    auto out = ::open(target.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (out == -1) {
+        return LINGLONG_ERR(fmt::format("failed to open target {}: {}",
+                                        target,
+                                        common::error::errorString(errno)));
+    }
+    auto closeOut = utils::finally::finally([out] {
+        ::close(out);
+    });
+
+    struct stat sourceStat{};
+    struct stat targetStat{};
+    if (::fstat(in, &sourceStat) == -1 || ::fstat(out, &targetStat) == -1) {
+        return LINGLONG_ERR(fmt::format("failed to stat: {}", common::error::errorString(errno)));
     }
 
-    ofs << ifs.rdbuf();
-    if (ofs.bad()) {
-        return LINGLONG_ERR(
-          fmt::format("failed to write target {} {}", target, common::error::errorString(errno)));
+    auto ret = copyRange(in, 0, out, targetStat.st_size, sourceStat.st_size);
+    if (!ret) {
+        return LINGLONG_ERR(fmt::format("failed to write target {}", target), ret);
     }
+
     return LINGLONG_OK;
 }
 
@@ -5,9 +5,12 @@
 #pragma once
 #include "linglong/utils/error/error.h"
 
+#include <cstdint>
 #include <filesystem>
 #include <string>
 
+#include <sys/types.h>
+
 namespace linglong::utils {
 
 linglong::utils::error::Result<std::string> readFile(const std::filesystem::path &filepath);
@@ -15,6 +18,20 @@ linglong::utils::error::Result<std::string> readFile(const std::filesystem::path
 linglong::utils::error::Result<void> writeFile(const std::filesystem::path &filepath,
                                                const std::string &content);
 
+// how copyRange moved the data, from the cheapest to the most expensive one
+enum class CopyMethod : uint8_t {
+    Reflink,
+    CopyFileRange,
+    Sendfile,
+    Buffer,
+};
+
+// copy length bytes of in from inOffset to out at outOffset, the file offsets of both are left
+// untouched. The extents are shared by FICLONERANGE if the filesystem allows, otherwise the data
+// is copied in kernel by copy_file_range or sendfile, or through a large buffer at last.
+linglong::utils::error::Result<CopyMethod>
+copyRange(int in, off_t inOffset, int out, off_t outOffset, uint64_t length) noexcept;
+
 linglong::utils::error::Result<void> concatFile(const std::filesystem::path &source,
                                                 const std::filesystem::path &target);
 
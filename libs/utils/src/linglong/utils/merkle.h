@@ -0,0 +1,252 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+// Merkle tree of a file range, which is recorded in the meta of UAB.
+//
+// The range is split into fixed size leaves, a leaf digest is the plain SHA-256 of the leaf, so
+// it can be checked by `dd | sha256sum`. The root is the SHA-256 of the concatenated hex digests
+// of all leaves. Leaves are independent of each other, they are hashed in parallel, and a single
+// leaf can be verified without reading the others.
+//
+// It's header-only and depends on the standard library only, as it's used by the static
+// uab-header.
+
+#pragma once
+
+#include "linglong/utils/sha256.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace digest {
+
+constexpr std::size_t merkle_leaf_size = 1024 * 1024;
+
+inline std::string to_hex(const std::array<std::byte, 32> &digest)
+{
+    constexpr std::string_view digits = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(digest.size() * 2);
+    for (auto byte : digest) {
+        hex.push_back(digits[std::to_integer<unsigned>(byte) >> 4]);
+        hex.push_back(digits[std::to_integer<unsigned>(byte) & 0xf]);
+    }
+    return hex;
+}
+
+inline std::string merkle_root(const std::vector<std::string> &leaves)
+{
+    SHA256 sha256;
+    for (const auto &leaf : leaves) {
+        sha256.update(reinterpret_cast<const std::byte *>(leaf.data()), leaf.size());
+    }
+
+    std::array<std::byte, 32> digest{};
+    sha256.final(digest.data());
+    return to_hex(digest);
+}
+
+namespace details {
+
+inline std::size_t merkle_leaf_count(std::uint64_t length, std::size_t leafSize) noexcept
+{
+    return (length + leafSize - 1) / leafSize;
+}
+
+inline bool read_fully(int fd, std::byte *buf, std::size_t len, std::uint64_t offset) noexcept
+{
+    while (len > 0) {
+        auto ret = ::pread(fd, buf, len, static_cast<off_t>(offset));
+        if (ret == -1 && errno == EINTR) {
+            continue;
+        }
+        if (ret <= 0) {
+            return false;
+        }
+
+        buf += ret;
+        len -= ret;
+        offset += ret;
+    }
+
+    return true;
+}
+
+// hash every leaf of a range of length bytes by threads, read(leafOffset, len, buf) returns the
+// content of a leaf, either in buf or not, or nullptr on failure. visit(index, hex digest) is
+// called from the worker threads, hashing stops once it returns false
+template <typename Reader, typename Visitor>
+bool for_each_merkle_leaf(std::uint64_t length,
+                          std::size_t leafSize,
+                          unsigned threads,
+                          Reader &&read,
+                          Visitor &&visit) noexcept
+{
+    if (leafSize == 0) {
+        return false;
+    }
+
+    const auto count = merkle_leaf_count(length, leafSize);
+    std::atomic_size_t next{ 0 };
+    std::atomic_bool failed{ false };
+    auto worker = [&]() noexcept {
+        try {
+            std::vector<std::byte> buf;
+            for (auto index = next++; index < count && !failed; index = next++) {
+                auto leafOffset = static_cast<std::uint64_t>(index) * leafSize;
+                auto len = static_cast<std::size_t>(
+                  std::min<std::uint64_t>(leafSize, length - leafOffset));
+                const std::byte *leaf = read(leafOffset, len, buf);
+                if (leaf == nullptr) {
+                    failed = true;
+                    break;
+                }
+
+                SHA256 sha256;
+                std::array<std::byte, 32> digest{};
+                sha256.update(leaf, len);
+                sha256.final(digest.data());
+                if (!visit(index, to_hex(digest))) {
+                    failed = true;
+                }
+            }
+        } catch (...) {
+            failed = true;
+        }
+    };
+
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, count));
+
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(worker);
+        }
+    } catch (...) {
+        // fewer threads are fine
+    }
+
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    return !failed;
+}
+
+inline auto merkle_file_reader(int fd, std::uint64_t offset) noexcept
+{
+    return [fd, offset](std::uint64_t leafOffset, std::size_t len, std::vector<std::byte> &buf)
+             -> const std::byte * {
+        buf.resize(len);
+        return read_fully(fd, buf.data(), len, offset + leafOffset) ? buf.data() : nullptr;
+    };
+}
+
+inline auto merkle_memory_reader(const std::byte *data) noexcept
+{
+    return [data](std::uint64_t leafOffset,
+                  [[maybe_unused]] std::size_t len,
+                  [[maybe_unused]] std::vector<std::byte> &buf) -> const std::byte * {
+        return data + leafOffset;
+    };
+}
+
+template <typename Reader>
+std::optional<std::vector<std::string>>
+merkle_leaves(std::uint64_t length, std::size_t leafSize, unsigned threads, Reader &&read) noexcept
+{
+    if (leafSize == 0) {
+        return std::nullopt;
+    }
+
+    try {
+        std::vector<std::string> leaves(merkle_leaf_count(length, leafSize));
+        auto ok = for_each_merkle_leaf(length,
+                                       leafSize,
+                                       threads,
+                                       std::forward<Reader>(read),
+                                       [&leaves](std::size_t index, std::string digest) {
+                                           leaves[index] = std::move(digest);
+                                           return true;
+                                       });
+        if (!ok) {
+            return std::nullopt;
+        }
+
+        return leaves;
+    } catch (...) {
+        return std::nullopt;
+    }
+}
+
+} // namespace details
+
+// digests of the leaves of [offset, offset + length) of fd, threads defaults to the CPU number
+inline std::optional<std::vector<std::string>> merkle_leaves(int fd,
+                                                             std::uint64_t offset,
+                                                             std::uint64_t length,
+                                                             std::size_t leafSize = merkle_leaf_size,
+                                                             unsigned threads = 0) noexcept
+{
+    return details::merkle_leaves(length,
+                                  leafSize,
+                                  threads,
+                                  details::merkle_file_reader(fd, offset));
+}
+
+// the same as above, but the range is in memory, e.g. a mapped file
+inline std::optional<std::vector<std::string>>
+merkle_leaves(const std::byte *data,
+              std::uint64_t length,
+              std::size_t leafSize = merkle_leaf_size,
+              unsigned threads = 0) noexcept
+{
+    return details::merkle_leaves(length, leafSize, threads, details::merkle_memory_reader(data));
+}
+
+// whether [offset, offset + length) of fd matches the leaves, and the leaves match the root
+inline bool merkle_verify(int fd,
+                          std::uint64_t offset,
+                          std::uint64_t length,
+                          std::size_t leafSize,
+                          const std::vector<std::string> &leaves,
+                          std::string_view root,
+                          unsigned threads = 0) noexcept
+{
+    try {
+        if (leafSize == 0 || leaves.size() != details::merkle_leaf_count(length, leafSize)
+            || merkle_root(leaves) != root) {
+            return false;
+        }
+
+        return details::for_each_merkle_leaf(length,
+                                             leafSize,
+                                             threads,
+                                             details::merkle_file_reader(fd, offset),
+                                             [&leaves](std::size_t index,
+                                                       const std::string &digest) {
+                                                 return leaves[index] == digest;
+                                             });
+    } catch (...) {
+        return false;
+    }
+}
+
+} // namespace digest
@@ -3,6 +3,9 @@
 // SPDX-License-Identifier: LGPL-3.0-or-later
 
 // refer: https://zh.wikipedia.org/wiki/SHA-2
+//
+// The compression function has hardware backends (Intel SHA extensions and ARMv8 cryptography
+// extensions), the backend is selected by the CPU at runtime, the portable one is the fallback.
 
 #pragma once
 
@@ -11,6 +14,22 @@
 #include <cstdint>
 #include <cstring>
 
+#if defined(__x86_64__) || defined(__i386__)
+#define LINGLONG_SHA256_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#else
+#define LINGLONG_SHA256_X86 0
+#endif
+
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+#define LINGLONG_SHA256_ARM 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#else
+#define LINGLONG_SHA256_ARM 0
+#endif
+
 namespace digest {
 
 namespace details {
@@ -71,14 +90,349 @@ constexpr static uint32_t Maj(uint32_t x, uint32_t y, uint32_t z) noexcept
     return (x & y) ^ (x & z) ^ (y & z);
 }
 
+inline constexpr std::array<uint32_t, 64> K{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// compress the 64 bytes blocks of data into state
+using transform_fn = void (*)(uint32_t *state, const std::byte *data, std::size_t blocks) noexcept;
+
+inline void transform_scalar(uint32_t *state, const std::byte *data, std::size_t blocks) noexcept
+{
+    for (std::size_t i = 0; i < blocks; ++i) {
+        std::array<uint32_t, 16> M{};
+        for (int j = 0; j < 16; ++j) {
+            uint32_t tmp = 0;
+            std::memcpy(&tmp, &data[i * 64 + j * 4], 4);
+            M[j] = to_big_endian(tmp);
+        }
+
+        std::array<uint32_t, 64> W{};
+        for (std::size_t t = 0; t <= 15; ++t) {
+            W[t] = M[t];
+        }
+
+        for (std::size_t t = 16; t < 64; ++t) {
+            W[t] = sigma1(W[t - 2]) + W[t - 7] + sigma0(W[t - 15]) + W[t - 16];
+        }
+
+        auto a = state[0];
+        auto b = state[1];
+        auto c = state[2];
+        auto d = state[3];
+        auto e = state[4];
+        auto f = state[5];
+        auto g = state[6];
+        auto h = state[7];
+
+        for (std::size_t t = 0; t < 64; ++t) {
+            auto T1 = h + sum1(e) + Ch(e, f, g) + K[t] + W[t];
+            auto T2 = sum0(a) + Maj(a, b, c);
+            h = g;
+            g = f;
+            f = e;
+            e = d + T1;
+            d = c;
+            c = b;
+            b = a;
+            a = T1 + T2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+}
+
+#if LINGLONG_SHA256_X86
+
+// Intel SHA extensions, the state is kept as ABEF and CDGH, which is the layout used by
+// sha256rnds2. Each message group holds 4 words of the schedule, W[4j..4j+3].
+
+#define LINGLONG_SHA256_SHANI_TARGET __attribute__((target("sha,sse4.1")))
+
+// load a message group in big endian
+LINGLONG_SHA256_SHANI_TARGET inline __m128i
+shani_load(const std::byte *data, __m128i mask, std::size_t n) noexcept
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(data + n * 16)),
+                            mask);
+}
+
+LINGLONG_SHA256_SHANI_TARGET inline void
+shani_rounds(__m128i &abef, __m128i &cdgh, __m128i msg, std::size_t j) noexcept
+{
+    auto tmp =
+      _mm_add_epi32(msg, _mm_loadu_si128(reinterpret_cast<const __m128i *>(&K[j * 4])));
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, tmp);
+    tmp = _mm_shuffle_epi32(tmp, 0x0E);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, tmp);
+}
+
+// the next message group from the former four
+LINGLONG_SHA256_SHANI_TARGET inline __m128i
+shani_schedule(__m128i w0, __m128i w1, __m128i w2, __m128i w3) noexcept
+{
+    auto tmp = _mm_add_epi32(_mm_sha256msg1_epu32(w0, w1), _mm_alignr_epi8(w3, w2, 4));
+    return _mm_sha256msg2_epu32(tmp, w3);
+}
+
+LINGLONG_SHA256_SHANI_TARGET inline void
+transform_shani(uint32_t *state, const std::byte *data, std::size_t blocks) noexcept
+{
+    const auto mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    auto tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[0])),
+                                 0xB1);
+    auto cdgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&state[4])),
+                                  0x1B);
+    auto abef = _mm_alignr_epi8(tmp, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, tmp, 0xF0);
+
+    for (std::size_t i = 0; i < blocks; ++i, data += 64) {
+        const auto abefSaved = abef;
+        const auto cdghSaved = cdgh;
+
+        auto w0 = shani_load(data, mask, 0);
+        auto w1 = shani_load(data, mask, 1);
+        auto w2 = shani_load(data, mask, 2);
+        auto w3 = shani_load(data, mask, 3);
+
+        shani_rounds(abef, cdgh, w0, 0);
+        shani_rounds(abef, cdgh, w1, 1);
+        shani_rounds(abef, cdgh, w2, 2);
+        shani_rounds(abef, cdgh, w3, 3);
+        for (std::size_t j = 4; j < 16; j += 4) {
+            w0 = shani_schedule(w0, w1, w2, w3);
+            shani_rounds(abef, cdgh, w0, j);
+            w1 = shani_schedule(w1, w2, w3, w0);
+            shani_rounds(abef, cdgh, w1, j + 1);
+            w2 = shani_schedule(w2, w3, w0, w1);
+            shani_rounds(abef, cdgh, w2, j + 2);
+            w3 = shani_schedule(w3, w0, w1, w2);
+            shani_rounds(abef, cdgh, w3, j + 3);
+        }
+
+        abef = _mm_add_epi32(abef, abefSaved);
+        cdgh = _mm_add_epi32(cdgh, cdghSaved);
+    }
+
+    tmp = _mm_shuffle_epi32(abef, 0x1B);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xB1);
+    abef = _mm_blend_epi16(tmp, cdgh, 0xF0);
+    cdgh = _mm_alignr_epi8(cdgh, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[0]), abef);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&state[4]), cdgh);
+}
+
+#undef LINGLONG_SHA256_SHANI_TARGET
+
+inline bool shani_supported() noexcept
+{
+    unsigned int eax{ 0 };
+    unsigned int ebx{ 0 };
+    unsigned int ecx{ 0 };
+    unsigned int edx{ 0 };
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0 || (ecx & bit_SSSE3) == 0
+        || (ecx & bit_SSE4_1) == 0) {
+        return false;
+    }
+
+    if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) == 0) {
+        return false;
+    }
+
+    return (ebx & bit_SHA) != 0;
+}
+
+#endif
+
+#if LINGLONG_SHA256_ARM
+
+// ARMv8 cryptography extensions, the state is kept as ABCD and EFGH
+
+#if defined(__clang__)
+#define LINGLONG_SHA256_ARMV8_TARGET __attribute__((target("crypto")))
+#else
+#define LINGLONG_SHA256_ARMV8_TARGET __attribute__((target("+crypto")))
+#endif
+
+LINGLONG_SHA256_ARMV8_TARGET inline uint32x4_t armv8_load(const std::byte *data,
+                                                          std::size_t n) noexcept
+{
+    return vreinterpretq_u32_u8(
+      vrev32q_u8(vld1q_u8(reinterpret_cast<const uint8_t *>(data + n * 16))));
+}
+
+LINGLONG_SHA256_ARMV8_TARGET inline void
+armv8_rounds(uint32x4_t &abcd, uint32x4_t &efgh, uint32x4_t msg, std::size_t j) noexcept
+{
+    auto tmp = vaddq_u32(msg, vld1q_u32(&K[j * 4]));
+    auto saved = abcd;
+    abcd = vsha256hq_u32(abcd, efgh, tmp);
+    efgh = vsha256h2q_u32(efgh, saved, tmp);
+}
+
+LINGLONG_SHA256_ARMV8_TARGET inline uint32x4_t
+armv8_schedule(uint32x4_t w0, uint32x4_t w1, uint32x4_t w2, uint32x4_t w3) noexcept
+{
+    return vsha256su1q_u32(vsha256su0q_u32(w0, w1), w2, w3);
+}
+
+LINGLONG_SHA256_ARMV8_TARGET inline void
+transform_armv8(uint32_t *state, const std::byte *data, std::size_t blocks) noexcept
+{
+    auto abcd = vld1q_u32(&state[0]);
+    auto efgh = vld1q_u32(&state[4]);
+
+    for (std::size_t i = 0; i < blocks; ++i, data += 64) {
+        const auto abcdSaved = abcd;
+        const auto efghSaved = efgh;
+
+        auto w0 = armv8_load(data, 0);
+        auto w1 = armv8_load(data, 1);
+        auto w2 = armv8_load(data, 2);
+        auto w3 = armv8_load(data, 3);
+
+        armv8_rounds(abcd, efgh, w0, 0);
+        armv8_rounds(abcd, efgh, w1, 1);
+        armv8_rounds(abcd, efgh, w2, 2);
+        armv8_rounds(abcd, efgh, w3, 3);
+        for (std::size_t j = 4; j < 16; j += 4) {
+            w0 = armv8_schedule(w0, w1, w2, w3);
+            armv8_rounds(abcd, efgh, w0, j);
+            w1 = armv8_schedule(w1, w2, w3, w0);
+            armv8_rounds(abcd, efgh, w1, j + 1);
+            w2 = armv8_schedule(w2, w3, w0, w1);
+            armv8_rounds(abcd, efgh, w2, j + 2);
+            w3 = armv8_schedule(w3, w0, w1, w2);
+            armv8_rounds(abcd, efgh, w3, j + 3);
+        }
+
+        abcd = vaddq_u32(abcd, abcdSaved);
+        efgh = vaddq_u32(efgh, efghSaved);
+    }
+
+    vst1q_u32(&state[0], abcd);
+    vst1q_u32(&state[4], efgh);
+}
+
+#undef LINGLONG_SHA256_ARMV8_TARGET
+
+inline bool armv8_supported() noexcept
+{
+    return (::getauxval(AT_HWCAP) & HWCAP_SHA2) != 0;
+}
+
+#endif
+
 } // namespace details
 
+// implementations of the compression function, all of them produce the same digest
+enum class Backend : uint8_t {
+    Scalar,
+    SHANI,
+    ARMv8,
+};
+
+inline const char *backend_name(Backend backend) noexcept
+{
+    switch (backend) {
+    case Backend::SHANI:
+        return "sha-ni";
+    case Backend::ARMv8:
+        return "armv8-ce";
+    case Backend::Scalar:
+        break;
+    }
+
+    return "scalar";
+}
+
+// whether the backend is built in and the CPU supports it
+inline bool backend_supported(Backend backend) noexcept
+{
+    switch (backend) {
+    case Backend::Scalar:
+        return true;
+    case Backend::SHANI:
+#if LINGLONG_SHA256_X86
+        return details::shani_supported();
+#else
+        return false;
+#endif
+    case Backend::ARMv8:
+#if LINGLONG_SHA256_ARM
+        return details::armv8_supported();
+#else
+        return false;
+#endif
+    }
+
+    return false;
+}
+
+// the fastest backend of current CPU, it's detected once per process
+inline Backend default_backend() noexcept
+{
+    static const Backend backend = [] {
+        for (auto candidate : { Backend::SHANI, Backend::ARMv8 }) {
+            if (backend_supported(candidate)) {
+                return candidate;
+            }
+        }
+
+        return Backend::Scalar;
+    }();
+
+    return backend;
+}
+
 class SHA256
 {
     constexpr static auto block_size = 256 / sizeof(uint32_t);
 
 public:
-    SHA256() = default;
+    SHA256() noexcept
+        : SHA256(default_backend())
+    {
+    }
+
+    // use the given backend, the scalar one is used if it isn't supported
+    explicit SHA256(Backend backend) noexcept
+    {
+        if (!backend_supported(backend)) {
+            backend = Backend::Scalar;
+        }
+
+        switch (backend) {
+#if LINGLONG_SHA256_X86
+        case Backend::SHANI:
+            transform_impl = details::transform_shani;
+            break;
+#endif
+#if LINGLONG_SHA256_ARM
+        case Backend::ARMv8:
+            transform_impl = details::transform_armv8;
+            break;
+#endif
+        default:
+            break;
+        }
+    }
+
     SHA256(const SHA256 &) = delete;
     SHA256(SHA256 &&) = delete;
     SHA256 &operator=(const SHA256 &) = delete;
@@ -145,73 +499,14 @@ public:
     }
 
 private:
-    constexpr void transform(const std::byte *data, std::size_t block_num)
+    void transform(const std::byte *data, std::size_t block_num) noexcept
     {
-        for (std::size_t i = 0; i < block_num; ++i) {
-            std::array<uint32_t, 16> M{};
-            for (int j = 0; j < 16; ++j) {
-                uint32_t tmp = 0;
-                std::memcpy(&tmp, &data[i * 64 + j * 4], 4);
-                M[j] = details::to_big_endian(tmp);
-            }
-
-            std::array<uint32_t, 64> W{};
-            for (std::size_t t = 0; t <= 15; ++t) {
-                W[t] = M[t];
-            }
-
-            for (std::size_t t = 16; t < 64; ++t) {
-                W[t] =
-                  details::sigma1(W[t - 2]) + W[t - 7] + details::sigma0(W[t - 15]) + W[t - 16];
-            }
-
-            auto a = H[0];
-            auto b = H[1];
-            auto c = H[2];
-            auto d = H[3];
-            auto e = H[4];
-            auto f = H[5];
-            auto g = H[6];
-            auto h = H[7];
-
-            for (std::size_t t = 0; t < 64; ++t) {
-                auto T1 = h + details::sum1(e) + details::Ch(e, f, g) + K[t] + W[t];
-                auto T2 = details::sum0(a) + details::Maj(a, b, c);
-                h = g;
-                g = f;
-                f = e;
-                e = d + T1;
-                d = c;
-                c = b;
-                b = a;
-                a = T1 + T2;
-            }
-
-            H[0] += a;
-            H[1] += b;
-            H[2] += c;
-            H[3] += d;
-            H[4] += e;
-            H[5] += f;
-            H[6] += g;
-            H[7] += h;
-        }
+        transform_impl(H.data(), data, block_num);
     }
 
+    details::transform_fn transform_impl{ details::transform_scalar };
     std::size_t pos{ 0 };
     uint64_t total{ 0 };
-    static constexpr std::array<uint32_t, 64> K{
-        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4,
-        0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe,
-        0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f,
-        0x4a7484aa, 0x5cb0a9dc, 0x76f988da, 0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
-        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc,
-        0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
-        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070, 0x19a4c116,
-        0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7,
-        0xc67178f2
-    };
     std::array<uint32_t, 8> H{ 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
                                0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
     std::array<std::byte, 64> m{};
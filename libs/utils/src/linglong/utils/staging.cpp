@@ -0,0 +1,214 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#include "linglong/utils/staging.h"
+
+#include "linglong/common/error.h"
+#include "linglong/utils/file.h"
+#include "linglong/utils/finally/finally.h"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace linglong::utils::staging {
+
+namespace {
+
+struct State
+{
+    // once the filesystem refuses to clone, don't try it for every file
+    std::atomic_bool reflinkUnsupported{ false };
+    std::atomic_size_t reflinked{ 0 };
+    std::atomic_size_t hardlinked{ 0 };
+    std::atomic_size_t copied{ 0 };
+    std::atomic<uintmax_t> copiedBytes{ 0 };
+};
+
+bool cloneUnsupported(int err) noexcept
+{
+    return err == EOPNOTSUPP || err == ENOTTY || err == EINVAL || err == EXDEV || err == ENOSYS;
+}
+
+bool linkUnsupported(int err) noexcept
+{
+    // EPERM: fs.protected_hardlinks refuses files which are not owned by the caller
+    return err == EXDEV || err == EPERM || err == EMLINK || err == EOPNOTSUPP;
+}
+
+utils::error::Result<Method> stage(const std::filesystem::path &source,
+                                   const std::filesystem::path &destination,
+                                   const Options &options,
+                                   State &state) noexcept
+{
+    LINGLONG_TRACE(fmt::format("stage {} to {}", source.string(), destination.string()))
+
+    auto in = ::open(source.c_str(), O_RDONLY | O_CLOEXEC | O_NOFOLLOW);
+    if (in == -1) {
+        return LINGLONG_ERR(fmt::format("open error: {}", common::error::errorString(errno)));
+    }
+    auto closeIn = utils::finally::finally([in] {
+        ::close(in);
+    });
+
+    struct stat st{};
+    if (::fstat(in, &st) == -1) {
+        return LINGLONG_ERR(fmt::format("fstat error: {}", common::error::errorString(errno)));
+    }
+    if (!S_ISREG(st.st_mode)) {
+        return LINGLONG_ERR("not a regular file");
+    }
+
+    const auto mode = st.st_mode & 07777;
+    auto create = [&destination, mode]() noexcept {
+        return ::open(destination.c_str(),
+                      O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC | O_NOFOLLOW,
+                      mode | S_IWUSR);
+    };
+
+    if (!state.reflinkUnsupported) {
+        auto out = create();
+        if (out == -1) {
+            return LINGLONG_ERR(
+              fmt::format("create error: {}", common::error::errorString(errno)));
+        }
+
+        if (::ioctl(out, FICLONE, in) == 0) {
+            auto ret = ::fchmod(out, mode);
+            auto err = errno;
+            ::close(out);
+            if (ret == -1) {
+                return LINGLONG_ERR(
+                  fmt::format("fchmod error: {}", common::error::errorString(err)));
+            }
+
+            ++state.reflinked;
+            return Method::Reflink;
+        }
+
+        auto err = errno;
+        ::close(out);
+        ::unlink(destination.c_str());
+        if (!cloneUnsupported(err)) {
+            return LINGLONG_ERR(fmt::format("FICLONE error: {}", common::error::errorString(err)));
+        }
+        state.reflinkUnsupported = true;
+    }
+
+    if (options.hardlink) {
+        if (::link(source.c_str(), destination.c_str()) == 0) {
+            ++state.hardlinked;
+            return Method::Hardlink;
+        }
+        if (!linkUnsupported(errno)) {
+            return LINGLONG_ERR(fmt::format("link error: {}", common::error::errorString(errno)));
+        }
+    }
+
+    auto out = create();
+    if (out == -1) {
+        return LINGLONG_ERR(fmt::format("create error: {}", common::error::errorString(errno)));
+    }
+    auto closeOut = utils::finally::finally([out] {
+        ::close(out);
+    });
+
+    auto copied = utils::copyRange(in, 0, out, 0, st.st_size);
+    if (!copied) {
+        return LINGLONG_ERR(copied);
+    }
+
+    if (::fchmod(out, mode) == -1) {
+        return LINGLONG_ERR(fmt::format("fchmod error: {}", common::error::errorString(errno)));
+    }
+
+    ++state.copied;
+    state.copiedBytes += st.st_size;
+    switch (*copied) {
+    case utils::CopyMethod::Reflink:
+        return Method::Reflink;
+    case utils::CopyMethod::CopyFileRange:
+        return Method::CopyFileRange;
+    default:
+        return Method::Copy;
+    }
+}
+
+} // namespace
+
+utils::error::Result<Method> stageFile(const std::filesystem::path &source,
+                                       const std::filesystem::path &destination,
+                                       const Options &options) noexcept
+{
+    State state;
+    return stage(source, destination, options, state);
+}
+
+utils::error::Result<Summary> stageFiles(const std::vector<Task> &tasks,
+                                         const Options &options) noexcept
+{
+    LINGLONG_TRACE(fmt::format("stage {} files", tasks.size()))
+
+    State state;
+    std::atomic_size_t next{ 0 };
+    std::atomic_bool failed{ false };
+    std::mutex mutex;
+    utils::error::Result<void> failure = LINGLONG_OK;
+
+    auto worker = [&]() noexcept {
+        for (auto index = next++; index < tasks.size() && !failed; index = next++) {
+            const auto &task = tasks[index];
+            auto ret = stage(task.source, task.destination, options, state);
+            if (ret) {
+                continue;
+            }
+
+            std::lock_guard lock(mutex);
+            if (!failed.exchange(true)) {
+                failure = LINGLONG_ERR(ret);
+            }
+        }
+    };
+
+    auto threads = options.threads;
+    if (threads == 0) {
+        threads = std::max(1U, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, tasks.size()));
+
+    std::vector<std::thread> workers;
+    try {
+        for (unsigned i = 1; i < threads; ++i) {
+            workers.emplace_back(worker);
+        }
+    } catch (...) {
+        // fewer threads are fine
+    }
+
+    worker();
+    for (auto &thread : workers) {
+        thread.join();
+    }
+
+    if (!failure) {
+        return LINGLONG_ERR(failure);
+    }
+
+    return Summary{ .reflinked = state.reflinked,
+                    .hardlinked = state.hardlinked,
+                    .copied = state.copied,
+                    .copiedBytes = state.copiedBytes };
+}
+
+} // namespace linglong::utils::staging
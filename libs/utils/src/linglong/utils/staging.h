@@ -0,0 +1,57 @@
+// SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: LGPL-3.0-or-later
+
+#pragma once
+
+#include "linglong/utils/error/error.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace linglong::utils::staging {
+
+// how a file was staged, from the cheapest to the most expensive one
+enum class Method : uint8_t {
+    Reflink,
+    Hardlink,
+    CopyFileRange,
+    Copy,
+};
+
+struct Options
+{
+    // link the file if it can't be cloned, the staged file shares the inode with the source then,
+    // so it must not be modified
+    bool hardlink{ true };
+    // 0 means the number of CPUs
+    unsigned threads{ 0 };
+};
+
+struct Task
+{
+    std::filesystem::path source;
+    std::filesystem::path destination;
+};
+
+struct Summary
+{
+    std::size_t reflinked{ 0 };
+    std::size_t hardlinked{ 0 };
+    std::size_t copied{ 0 };
+    uintmax_t copiedBytes{ 0 };
+};
+
+// stage the regular file source to destination, which must not exist and its parent directory must
+// exist. FICLONE is tried first, then hardlink if allowed, the content is copied by copyRange at
+// last.
+utils::error::Result<Method> stageFile(const std::filesystem::path &source,
+                                       const std::filesystem::path &destination,
+                                       const Options &options = {}) noexcept;
+
+// stage all tasks by a pool of threads, it stops at the first failure
+utils::error::Result<Summary> stageFiles(const std::vector<Task> &tasks,
+                                         const Options &options = {}) noexcept;
+
+} // namespace linglong::utils::staging
@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#include "linglong/utils/tracing.h"
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <ctime>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace linglong::utils::tracing {
+
+namespace {
+
+struct Writer
+{
+    Writer() noexcept
+    {
+        const auto *path = ::getenv(TraceFileEnv);
+        if (path == nullptr || *path == '\0') {
+            return;
+        }
+
+        fd = ::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (fd == -1) {
+            return;
+        }
+
+        // the closing bracket is optional in the JSON array format, so that every process can
+        // simply append its events
+        struct stat st{};
+        if (::fstat(fd, &st) == 0 && st.st_size == 0) {
+            write("[\n");
+        }
+    }
+
+    ~Writer()
+    {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+
+    Writer(const Writer &) = delete;
+    Writer &operator=(const Writer &) = delete;
+    Writer(Writer &&) = delete;
+    Writer &operator=(Writer &&) = delete;
+
+    // one write per event, O_APPEND keeps events of different processes from interleaving
+    void write(const std::string &content) const noexcept
+    {
+        while (::write(fd, content.data(), content.size()) == -1 && errno == EINTR) { }
+    }
+
+    int fd{ -1 };
+    std::mutex mutex;
+};
+
+Writer &writer() noexcept
+{
+    static Writer instance;
+    return instance;
+}
+
+void emit(const char *name, char phase, std::int64_t ts, std::int64_t dur) noexcept
+{
+    auto &w = writer();
+    if (w.fd == -1) {
+        return;
+    }
+
+    try {
+        auto event = fmt::format(R"({{"name":"{}","cat":"{}","ph":"{}","ts":{},)",
+                                 name,
+                                 program_invocation_short_name,
+                                 phase,
+                                 ts);
+        if (phase == 'X') {
+            event += fmt::format(R"("dur":{},)", dur);
+        } else {
+            // scope of instant event
+            event += R"("s":"p",)";
+        }
+        event += fmt::format(R"("pid":{},"tid":{},"args":{{"launch":"{}"}}}},)"
+                             "\n",
+                             ::getpid(),
+                             ::syscall(SYS_gettid),
+                             launchID());
+
+        std::lock_guard lock(w.mutex);
+        w.write(event);
+    } catch (...) {
+        // tracing must never break the launch
+    }
+}
+
+} // namespace
+
+bool enabled() noexcept
+{
+    static const bool enabled = [] {
+        const auto *path = ::getenv(TraceFileEnv);
+        return path != nullptr && *path != '\0';
+    }();
+
+    return enabled;
+}
+
+std::int64_t now() noexcept
+{
+    struct timespec ts{};
+    ::clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<std::int64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+const std::string &launchID() noexcept
+{
+    static const std::string id = [] {
+        const auto *inherited = ::getenv(LaunchIDEnv);
+        if (inherited != nullptr && *inherited != '\0') {
+            return std::string{ inherited };
+        }
+
+        auto generated = fmt::format("{:x}-{:x}", ::getpid(), now());
+        ::setenv(LaunchIDEnv, generated.c_str(), 1);
+        return generated;
+    }();
+
+    return id;
+}
+
+void instant(const char *name) noexcept
+{
+    if (!enabled()) {
+        return;
+    }
+
+    emit(name, 'i', now(), 0);
+}
+
+void complete(const char *name, std::int64_t begin, std::int64_t end) noexcept
+{
+    if (!enabled()) {
+        return;
+    }
+
+    emit(name, 'X', begin, end - begin);
+}
+
+} // namespace linglong::utils::tracing
@@ -0,0 +1,71 @@
+/*
+ * SPDX-FileCopyrightText: 2026 UnionTech Software Technology Co., Ltd.
+ *
+ * SPDX-License-Identifier: LGPL-3.0-or-later
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Startup tracing of `ll-cli run`.
+//
+// Set LINGLONG_STARTUP_TRACE to a file path to enable it. Every process taking part in a launch
+// (ll-cli, the re-executed ll-cli in namespace, ll-init in container) appends Chrome trace
+// events to that file, the file can be loaded by chrome://tracing or ui.perfetto.dev directly.
+// Timestamps come from CLOCK_MONOTONIC, which is shared by all processes on the host, and all
+// events of one launch carry the same launch ID from LINGLONG_LAUNCH_ID.
+//
+// When the variable isn't set, a span costs a cached boolean check.
+namespace linglong::utils::tracing {
+
+inline constexpr auto TraceFileEnv = "LINGLONG_STARTUP_TRACE";
+inline constexpr auto LaunchIDEnv = "LINGLONG_LAUNCH_ID";
+
+bool enabled() noexcept;
+
+// microseconds of CLOCK_MONOTONIC
+std::int64_t now() noexcept;
+
+// the ID of current launch, a new one is generated and exported to the environment if it's not
+// inherited from the parent process, so that child processes share it
+const std::string &launchID() noexcept;
+
+// name must be a plain string literal, it's written to the trace without escaping
+void instant(const char *name) noexcept;
+
+void complete(const char *name, std::int64_t begin, std::int64_t end) noexcept;
+
+// records the lifetime of the object as a complete event
+class Span
+{
+public:
+    explicit Span(const char *name) noexcept
+        : name(name)
+        , begin(enabled() ? now() : 0)
+    {
+    }
+
+    ~Span() { end(); }
+
+    Span(const Span &) = delete;
+    Span &operator=(const Span &) = delete;
+    Span(Span &&) = delete;
+    Span &operator=(Span &&) = delete;
+
+    // finish the span before the end of scope
+    void end() noexcept
+    {
+        if (name != nullptr && enabled()) {
+            complete(name, begin, now());
+        }
+        name = nullptr;
+    }
+
+private:
+    const char *name;
+    std::int64_t begin;
+};
+
+} // namespace linglong::utils::tracing